@@ -0,0 +1,352 @@
+//=================================
+//
+//確保の追跡
+//
+//グローバルのnew/deleteを置き換え、フレームごと・フェーズごとに確保の数と量を数える。
+//呼び出し元はリターンアドレスで分け、レポートの時にシンボル名にする。
+//ステージを読み終わった後のゲームシーンでは、1フレームも確保しないのが目標。
+//
+//フックの中では確保できないので、数えるのはatomicと固定長の表だけでやる。
+//デバッグビルドだけ。リリースではフックがなく、数える関数は何もしない。
+//
+//=================================
+
+#include"AllocTrack.h"
+
+#include<atomic>
+#include<new>
+#include<stdint.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<nn/diag/diag_Symbol.h>
+
+#if defined(_MSC_VER)
+#include<intrin.h>
+#define ALLOCTRACK_CALLER() ((uintptr_t)_ReturnAddress())
+#else
+#define ALLOCTRACK_CALLER() ((uintptr_t)__builtin_return_address(0))
+#endif
+
+//デバッグのCRTならmallocも数える
+#if defined(ALLOCTRACK_USE) && defined(_MSC_VER) && defined(_DEBUG)
+#include<crtdbg.h>
+#define ALLOCTRACK_MALLOCHOOK
+#endif
+
+#define ALLOCTRACK_HEADER (16)		//確保した量を前に置く。FRAMEHEAP_ALIGNMENTと同じ
+#define ALLOCTRACK_MALLOCSITE (1)	//mallocは呼び出し元が取れないのでまとめる
+
+typedef struct
+{
+	std::atomic<uintptr_t> site;
+	std::atomic<int> count;
+	std::atomic<long long> bytes;
+	std::atomic<int> gameCount;//ゲームシーンのUPDATE、DRAW、ワーカーで確保した数
+}ALLOCSITE;
+
+static void CountAllocation(size_t size, uintptr_t site);
+static ALLOCSITE* FindAllocSite(uintptr_t site);
+static void PrintAllocSite(const ALLOCSITE* site);
+
+//フックはどのスレッドからも、静的な初期化より前にも呼ばれるので、0で始まるものだけ置く
+static std::atomic<int> g_FrameCount[ALLOCPHASEMAX];
+static std::atomic<long long> g_FrameBytes[ALLOCPHASEMAX];
+static std::atomic<long long> g_LiveBytes;
+static std::atomic<long long> g_FramePeakLive;
+static std::atomic<int> g_FrameScene;//今のフレームのシーン+1。0はまだ始まっていない
+static thread_local ALLOCPHASE g_Phase;
+static thread_local bool g_IsInNew;
+static ALLOCSITE g_Site[ALLOCTRACK_MAXSITE];
+static ALLOCSITE g_OtherSite;//表に入らなかった分
+
+static ALLOCFRAME g_LastFrame;
+static ALLOCSCENE g_Scene[SCENEMAX];
+static bool g_IsHooked;
+
+#ifdef ALLOCTRACK_MALLOCHOOK
+static int MallocHook(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* fileName, int lineNumber)
+{
+	//newから来たものはもう数えている
+	if (g_IsInNew || blockType == _CRT_BLOCK)return TRUE;
+
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+	{
+		CountAllocation(size, ALLOCTRACK_MALLOCSITE);
+	}
+	return TRUE;
+}
+#endif
+
+void AllocTrackFrame(SCENE scene)
+{
+#ifdef ALLOCTRACK_MALLOCHOOK
+	if (!g_IsHooked)_CrtSetAllocHook(MallocHook);
+#endif
+	g_IsHooked = true;
+
+	int last = g_FrameScene.load() - 1;
+	int count = 0;
+
+	for (int i = 0; i < ALLOCPHASEMAX; i++)
+	{
+		g_LastFrame.count[i] = g_FrameCount[i].exchange(0);
+		g_LastFrame.bytes[i] = g_FrameBytes[i].exchange(0);
+
+		if (i != allocphase_load)count += g_LastFrame.count[i];
+	}
+	long long peak = g_FramePeakLive.exchange(g_LiveBytes.load());
+
+	if (last >= 0 && last < SCENEMAX)
+	{
+		ALLOCSCENE* stat = &g_Scene[last];
+		stat->frameNum++;
+		if (count > 0)stat->allocFrameNum++;
+
+		for (int i = 0; i < ALLOCPHASEMAX; i++)
+		{
+			if (g_LastFrame.count[i] > stat->maxCount[i])stat->maxCount[i] = g_LastFrame.count[i];
+			if (g_LastFrame.bytes[i] > stat->maxBytes[i])stat->maxBytes[i] = g_LastFrame.bytes[i];
+		}
+		if (peak > stat->peakLive)stat->peakLive = peak;
+	}
+
+	g_FrameScene = scene + 1;
+}
+
+void SetAllocPhase(ALLOCPHASE phase)
+{
+	g_Phase = phase;
+}
+
+ALLOCPHASE GetAllocPhase(void)
+{
+	return g_Phase;
+}
+
+const ALLOCFRAME* GetAllocFrame(void)
+{
+	return &g_LastFrame;
+}
+
+const ALLOCSCENE* GetAllocScene(SCENE scene)
+{
+	return &g_Scene[scene];
+}
+
+long long GetAllocLiveBytes(void)
+{
+	return g_LiveBytes.load();
+}
+
+void AllocTrackReport(void)
+{
+#ifdef ALLOCTRACK_USE
+	static const char* sceneName[SCENEMAX] = { "title", "game", "result" };
+
+	for (int i = 0; i < SCENEMAX; i++)
+	{
+		const ALLOCSCENE* stat = &g_Scene[i];
+		if (stat->frameNum == 0)continue;
+
+		NN_LOG("AllocTrack: %s %d frames, %d with allocations, peak %dKB live\n",
+			sceneName[i], stat->frameNum, stat->allocFrameNum, (int)(stat->peakLive / 1024));
+		NN_LOG("AllocTrack:   max per frame update %d/%dB draw %d/%dB worker %d/%dB other %d/%dB load %d/%dKB\n",
+			stat->maxCount[allocphase_update], (int)stat->maxBytes[allocphase_update],
+			stat->maxCount[allocphase_draw], (int)stat->maxBytes[allocphase_draw],
+			stat->maxCount[allocphase_worker], (int)stat->maxBytes[allocphase_worker],
+			stat->maxCount[allocphase_other], (int)stat->maxBytes[allocphase_other],
+			stat->maxCount[allocphase_load], (int)(stat->maxBytes[allocphase_load] / 1024));
+	}
+
+	//ゲーム中に確保した数の多い順、同じなら全体の数の多い順に出す
+	const ALLOCSITE* top[ALLOCTRACK_REPORTNUM] = {};
+	int topNum = 0;
+
+	for (int i = 0; i <= ALLOCTRACK_MAXSITE; i++)
+	{
+		const ALLOCSITE* site = i < ALLOCTRACK_MAXSITE ? &g_Site[i] : &g_OtherSite;
+		if (site->count.load() == 0)continue;
+
+		int n = topNum < ALLOCTRACK_REPORTNUM ? topNum++ : ALLOCTRACK_REPORTNUM;
+		while (n > 0)
+		{
+			const ALLOCSITE* prev = top[n - 1];
+			if (prev->gameCount.load() > site->gameCount.load())break;
+			if (prev->gameCount.load() == site->gameCount.load() && prev->count.load() >= site->count.load())break;
+
+			if (n < ALLOCTRACK_REPORTNUM)top[n] = prev;
+			n--;
+		}
+		if (n < ALLOCTRACK_REPORTNUM)top[n] = site;
+	}
+
+	for (int i = 0; i < topNum; i++)
+	{
+		PrintAllocSite(top[i]);
+	}
+#endif
+}
+
+//=================================
+//フック
+//=================================
+static void CountAllocation(size_t size, uintptr_t site)
+{
+	ALLOCPHASE phase = g_Phase;
+	bool IsGame = g_FrameScene.load(std::memory_order_relaxed) == scene_game + 1;
+
+	g_FrameCount[phase].fetch_add(1, std::memory_order_relaxed);
+	g_FrameBytes[phase].fetch_add((long long)size, std::memory_order_relaxed);
+
+	ALLOCSITE* entry = FindAllocSite(site);
+	entry->count.fetch_add(1, std::memory_order_relaxed);
+	entry->bytes.fetch_add((long long)size, std::memory_order_relaxed);
+
+	if (IsGame && (phase == allocphase_update || phase == allocphase_draw || phase == allocphase_worker))
+	{
+		entry->gameCount.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef ALLOCTRACK_ASSERT
+		if (phase != allocphase_worker)
+		{
+			//ログを出す間の確保で止まらないようにする
+			g_Phase = allocphase_other;
+			NN_ASSERT(false, "AllocTrack: %d bytes allocated in game %s from %p\n",
+				(int)size, phase == allocphase_update ? "UPDATE" : "DRAW", (void*)site);
+		}
+#endif
+	}
+}
+
+//リターンアドレスで表を引く。なければ空いている所に入れる
+static ALLOCSITE* FindAllocSite(uintptr_t site)
+{
+	unsigned int index = (unsigned int)((site >> 2) * 2654435761u) % ALLOCTRACK_MAXSITE;
+
+	for (int i = 0; i < ALLOCTRACK_MAXSITE; i++)
+	{
+		ALLOCSITE* entry = &g_Site[index];
+		uintptr_t current = entry->site.load(std::memory_order_acquire);
+
+		if (current == site)return entry;
+		if (current == 0)
+		{
+			if (entry->site.compare_exchange_strong(current, site))return entry;
+			if (current == site)return entry;
+		}
+		index = (index + 1) % ALLOCTRACK_MAXSITE;
+	}
+
+	return &g_OtherSite;
+}
+
+static void PrintAllocSite(const ALLOCSITE* site)
+{
+	uintptr_t address = site->site.load();
+	char name[128];
+
+	if (site == &g_OtherSite)
+	{
+		snprintf(name, sizeof(name), "(table full)");
+	}
+	else if (address == ALLOCTRACK_MALLOCSITE)
+	{
+		snprintf(name, sizeof(name), "(malloc)");
+	}
+	else
+	{
+		uintptr_t symbol = nn::diag::GetSymbolName(name, sizeof(name), address);
+		if (symbol == 0)snprintf(name, sizeof(name), "%p", (void*)address);
+		else snprintf(name + strlen(name), sizeof(name) - strlen(name), "+0x%x", (unsigned int)(address - symbol));
+	}
+
+	NN_LOG("AllocTrack: %6d in game %8d total %8dKB %s\n",
+		site->gameCount.load(), site->count.load(), (int)(site->bytes.load() / 1024), name);
+}
+
+#ifdef ALLOCTRACK_USE
+static void* TrackedAllocate(size_t size, uintptr_t site)
+{
+	g_IsInNew = true;
+	unsigned char* block = (unsigned char*)malloc(ALLOCTRACK_HEADER + size);
+	g_IsInNew = false;
+
+	if (block == NULL)return NULL;
+
+	*(size_t*)block = size;
+	CountAllocation(size, site);
+
+	long long live = g_LiveBytes.fetch_add((long long)size, std::memory_order_relaxed) + (long long)size;
+	long long peak = g_FramePeakLive.load(std::memory_order_relaxed);
+	while (live > peak && !g_FramePeakLive.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+
+	return block + ALLOCTRACK_HEADER;
+}
+
+static void TrackedFree(void* p)
+{
+	if (p == NULL)return;
+
+	unsigned char* block = (unsigned char*)p - ALLOCTRACK_HEADER;
+	g_LiveBytes.fetch_sub((long long)*(size_t*)block, std::memory_order_relaxed);
+
+	g_IsInNew = true;
+	free(block);
+	g_IsInNew = false;
+}
+
+void* operator new(size_t size)
+{
+	void* p = TrackedAllocate(size, ALLOCTRACK_CALLER());
+	if (p == NULL)throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = TrackedAllocate(size, ALLOCTRACK_CALLER());
+	if (p == NULL)throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size, ALLOCTRACK_CALLER());
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size, ALLOCTRACK_CALLER());
+}
+
+void operator delete(void* p) noexcept
+{
+	TrackedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	TrackedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	TrackedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	TrackedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	TrackedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	TrackedFree(p);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef ALLOCTRACK_H_
+#define ALLOCTRACK_H_
+
+#include"main.h"
+#include"Scene.h"
+
+//グローバルのnew/deleteを置き換えて確保を数える。デバッグビルドだけ。リリースはCRTのまま
+#if defined(_DEBUG) || defined(NN_SDK_BUILD_DEBUG)
+#define ALLOCTRACK_USE
+#endif
+//ゲームシーンのUPDATE、DRAW中にメインスレッドで確保したら止める
+//#define ALLOCTRACK_ASSERT
+
+#define ALLOCTRACK_MAXSITE (512)	//数える呼び出し元の数。あふれた分はまとめて数える
+#define ALLOCTRACK_REPORTNUM (16)	//レポートに出す呼び出し元の数
+
+//どこで確保したか。メインスレッドはmainで切り替え、ジョブのワーカーはworkerになる
+enum ALLOCPHASE
+{
+	allocphase_other,
+	allocphase_update,
+	allocphase_draw,
+	allocphase_load,
+	allocphase_worker,
+
+	ALLOCPHASEMAX
+};
+
+//1フレームで確保した数
+typedef struct
+{
+	int count[ALLOCPHASEMAX];
+	long long bytes[ALLOCPHASEMAX];
+}ALLOCFRAME;
+
+//シーンごとの最大
+typedef struct
+{
+	int frameNum;
+	int allocFrameNum;//ロード以外で確保したフレームの数
+	int maxCount[ALLOCPHASEMAX];
+	long long maxBytes[ALLOCPHASEMAX];
+	long long peakLive;//確保したままの量の最大
+}ALLOCSCENE;
+
+//フレームの区切りで呼ぶ。前のフレームの数をシーンの最大に入れ、sceneのフレームを始める
+void AllocTrackFrame(SCENE scene);
+//このスレッドのフェーズを切り替える
+void SetAllocPhase(ALLOCPHASE phase);
+ALLOCPHASE GetAllocPhase(void);
+//前のフレームの数
+const ALLOCFRAME* GetAllocFrame(void);
+const ALLOCSCENE* GetAllocScene(SCENE scene);
+//今確保したままの量
+long long GetAllocLiveBytes(void);
+//シーンごとの最大と、ゲーム中に確保した呼び出し元をログに出す
+void AllocTrackReport(void);
+
+#endif
\ No newline at end of file
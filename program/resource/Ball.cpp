@@ -1,9 +1,9 @@
 
 //======================================
 //
-//ĂȂƂ擾HP}CiXB
+//動いていないことを取得してHPマイナス。
 //
-//o|WV
+//出現ポジション上に
 //
 //======================================
 
@@ -14,15 +14,29 @@
 #include"Effect.h"
 #include"sound.h"
 #include"result.h"
+#include"Random.h"
+#include"Camera.h"
+#include"FrameHeap.h"
 
-#define GRAVITY (0.1f)
-#define RESISTANCE (0.75f)
-#define BALLSIZE (MakeFloat2(32,32))
-#define BALLSTARTPOS (MakeFloat2(-SCREEN_WIDTH / 2 + BLOCKSIZE.x + BLOCKSIZE.x / 2 + BLOCKSIZE.x * 3,-SCREEN_HEIGHT / 2 - BALLSIZE.y))
+#define GRAVITY (BALLNUM_CONST(0.1f))
+#define RESISTANCE (BALLNUM_CONST(0.75f))
+#define BALLSIZE (MakeBallNum2(BALLNUM_INT(32),BALLNUM_INT(32)))
+#define BALLSTARTPOS (MakeBallNum2(BLOCKPOS_X(4),BALLNUM_INT(-SCREEN_HEIGHT / 2 - 32)))
 
-#define BALLADJUST_Y (0.5f)
+#define BALLADJUST_Y (BALLNUM_CONST(0.5f))
 #define FIRETIME (300)
 
+//物理演算用のブロックサイズと座標。ブロックの座標は配列の位置から求める。
+#define BLOCKSIZE_BN (BALLNUM_INT(SCREEN_WIDTH / SCREEN_BLOCK_WIDTH))
+#define BLOCKPOS_X(width) (BALLNUM_INT(-SCREEN_WIDTH / 2) + BLOCKSIZE_BN * (width) + BLOCKSIZE_BN / 2)
+#define BLOCKPOS_Y(height) (BALLNUM_INT(-SCREEN_HEIGHT / 2) + BLOCKSIZE_BN * (height) + BLOCKSIZE_BN / 2)
+
+#ifdef BALL_FIXEDPOINT
+#define BALLNUM_TOFLOAT(n) (FixedToFloat(n))
+#else
+#define BALLNUM_TOFLOAT(n) (n)
+#endif
+
 void SetBallPosNtoF(void);
 void SetTubeOutPos(int height, int width);
 void SetBoundEffects(int height, int width, DIR balldir);
@@ -33,29 +47,43 @@ void AirResistance(void);
 bool CheckIsBallTouchGround(void);
 void DoubleTubeOutPosProcessing(DIR outdir, int height, int width, DIR balldir);
 void TubeOutProcessing(int height, int width, DIR balldir);
+BALLNUM2 MakeBallNum2(BALLNUM x, BALLNUM y);
+void GetHitBlockRange(Int2* min, Int2* max);
 
-static BALL g_Ball;
+//物理演算の状態はスレッドごとに持つ(ソルバー用)
+static thread_local BALL g_Ball;
 static UINT g_BallTex;
-static int g_TubeCnt;
-static int g_CoinNum;
-static int g_BoundCnt;
-static int g_FireCnt;
-static int g_FireNum;
-
-static int g_BoundCountTime;
-static int g_OldBoundCountTime;
-static int g_BallLifeTimeCnt;
-static bool g_IsBallMoving;
+static thread_local int g_TubeCnt;
+static thread_local int g_CoinNum;
+static thread_local int g_BoundCnt;
+static thread_local int g_FireCnt;
+static thread_local int g_FireNum;
+
+static thread_local int g_BoundCountTime;
+static thread_local int g_OldBoundCountTime;
+static thread_local int g_BallLifeTimeCnt;
+static thread_local bool g_IsBallMoving;
+static thread_local bool g_IsBallGoal;
+static thread_local unsigned int g_BallStateHash;
 
 void BallINIT(void)
+{
+	InitBallState();
+
+	g_BallTex = LoadTexture("asset/Ball_2.tga");
+}
+
+//このスレッドのボールを最初の状態にする。HPも戻す。
+//ソルバーのワーカーはBallINITを通らないので、シミュレーションのたびにこれを呼ぶ
+void InitBallState(void)
 {
 	g_Ball.IsUse = false;
 	g_Ball.npos = MakeInt2(4, 0);
-	g_Ball.pos = BALLSTARTPOS;//{[ʒu
+	g_Ball.pos = BALLSTARTPOS;//ボール初期位置
 	
-	g_Ball.oldpos = MakeFloat2(0, 0);
-	g_Ball.size = MakeFloat2(32,32);
-	g_Ball.speed = MakeFloat2(0.0f,0.0f);
+	g_Ball.oldpos = MakeBallNum2(0, 0);
+	g_Ball.size = BALLSIZE;
+	g_Ball.speed = MakeBallNum2(0, 0);
 	g_Ball.type = balltype_normal;
 	g_Ball.HP = 5;
 	g_Ball.stopCnt = 0;
@@ -70,18 +98,18 @@ void BallINIT(void)
 	g_BoundCountTime = 0;
 	g_BallLifeTimeCnt = 0;
 	g_IsBallMoving = false;
-
-	g_BallTex = LoadTexture("asset/Ball_2.tga");
+	g_IsBallGoal = false;
+	g_BallStateHash = HASH_INIT;
 }
 
 void BallUPDATE(void)
 {
-	//Z
+	//物理演算
 	if (g_Ball.IsUse)
 	{
 		g_IsBallMoving = true;
 
-		//{[̐ԂJEgAbvB
+		//ボールの生存時間をカウントアップ。
 		g_BallLifeTimeCnt++;
 
 		if (g_Ball.type == balltype_fire)
@@ -94,13 +122,13 @@ void BallUPDATE(void)
 			g_FireCnt = 0;
 		}
 
-		//oldposۑ
+		//oldpos保存
 		g_Ball.oldpos = g_Ball.pos;
 
-		//]ĂԂȂd͂𑫂Ȃ悤ɂB
-		float addnum = CheckIsBallTouchGround() ? 0 : GRAVITY;
+		//転がっている状態なら重力を足さないようにする。
+		BALLNUM addnum = CheckIsBallTouchGround() ? 0 : GRAVITY;
 
-		//ʒuXV
+		//位置更新
 		g_Ball.speed.y += addnum;
 		g_Ball.pos.y += g_Ball.speed.y;
 		g_Ball.pos.x += g_Ball.speed.x;
@@ -110,24 +138,29 @@ void BallUPDATE(void)
 		bool IsTouchGround = false;
 		bool IsBreak = false;
 		BLOCK Block;
+		BALLNUM2 blockpos;
 		int Cnt = 0;
-		for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+		Int2 hitmin, hitmax;
+		GetHitBlockRange(&hitmin, &hitmax);
+		for (int i = hitmin.y; i <= hitmax.y; i++)
 		{
-			for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+			for (int k = hitmin.x; k <= hitmax.x; k++)
 			{
 				Block = GetBlock(i, k);
 				if (!Block.isUse)continue;
 
-				//======================================================================================{[ƕǏ
-				if ((g_Ball.pos.x    - g_Ball.size.x / 2 <= Block.fpos.x + BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.x    + g_Ball.size.x / 2 >= Block.fpos.x - BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.y    + g_Ball.size.y / 2 >= Block.fpos.y - BLOCKSIZE.y / 2) &&
-					(g_Ball.oldpos.y + g_Ball.size.y / 2 <  Block.fpos.y - BLOCKSIZE.y / 2) &&
+				blockpos = MakeBallNum2(BLOCKPOS_X(k), BLOCKPOS_Y(i));
+
+				//======================================================================================ボール下と壁上
+				if ((g_Ball.pos.x    - g_Ball.size.x / 2 <= blockpos.x + BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.x    + g_Ball.size.x / 2 >= blockpos.x - BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    + g_Ball.size.y / 2 >= blockpos.y - BLOCKSIZE_BN / 2) &&
+					(g_Ball.oldpos.y + g_Ball.size.y / 2 <  blockpos.y - BLOCKSIZE_BN / 2) &&
 					(g_Ball.IsUse))
 				{
 					SetBoundEffects(i, k, dir_under);
 
-					//oEhŃ{[폜?
+					//数回バウンドでボール削除?
 
 					if (!Block.IsBurn && !(g_Ball.type == balltype_water && GetBlock(i,k).type == type_frame))g_BoundCnt++;
 
@@ -135,11 +168,11 @@ void BallUPDATE(void)
 
 					IsBreak = true;
 				}
-				//======================================================================================{[EƕǍ
-				if ((g_Ball.pos.x    + g_Ball.size.x / 2 >= Block.fpos.x - BLOCKSIZE.x / 2) &&
-					(g_Ball.oldpos.x + g_Ball.size.x / 2 <  Block.fpos.x - BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.y    + g_Ball.size.y / 2 >= Block.fpos.y - BLOCKSIZE.y / 2) &&
-					(g_Ball.pos.y    - g_Ball.size.y / 2 <= Block.fpos.y + BLOCKSIZE.y / 2) &&
+				//======================================================================================ボール右と壁左
+				if ((g_Ball.pos.x    + g_Ball.size.x / 2 >= blockpos.x - BLOCKSIZE_BN / 2) &&
+					(g_Ball.oldpos.x + g_Ball.size.x / 2 <  blockpos.x - BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    + g_Ball.size.y / 2 >= blockpos.y - BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    - g_Ball.size.y / 2 <= blockpos.y + BLOCKSIZE_BN / 2) &&
 					(g_Ball.IsUse))
 				{
 					SetBoundEffects(i, k, dir_right);
@@ -148,11 +181,11 @@ void BallUPDATE(void)
 
 					IsBreak = true;
 				}
-				//======================================================================================{[ƕǉE
-				if ((g_Ball.pos.x    - g_Ball.size.x / 2 <= Block.fpos.x + BLOCKSIZE.x / 2) &&
-					(g_Ball.oldpos.x - g_Ball.size.x / 2 >  Block.fpos.x + BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.y    + g_Ball.size.y / 2 >= Block.fpos.y - BLOCKSIZE.y / 2) &&
-					(g_Ball.pos.y    - g_Ball.size.y / 2 <= Block.fpos.y + BLOCKSIZE.y / 2) &&
+				//======================================================================================ボール左と壁右
+				if ((g_Ball.pos.x    - g_Ball.size.x / 2 <= blockpos.x + BLOCKSIZE_BN / 2) &&
+					(g_Ball.oldpos.x - g_Ball.size.x / 2 >  blockpos.x + BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    + g_Ball.size.y / 2 >= blockpos.y - BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    - g_Ball.size.y / 2 <= blockpos.y + BLOCKSIZE_BN / 2) &&
 					(g_Ball.IsUse))
 				{
 					SetBoundEffects(i, k, dir_left);
@@ -161,11 +194,11 @@ void BallUPDATE(void)
 
 					IsBreak = true;
 				}
-				//======================================================================================{[ƕǉ
-				if ((g_Ball.pos.x    + g_Ball.size.x / 2 >= Block.fpos.x - BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.x    - g_Ball.size.x / 2 <= Block.fpos.x + BLOCKSIZE.x / 2) &&
-					(g_Ball.pos.y    - g_Ball.size.y / 2 <= Block.fpos.y + BLOCKSIZE.y / 2) &&
-					(g_Ball.oldpos.y - g_Ball.size.y / 2 >  Block.fpos.y + BLOCKSIZE.y / 2) &&
+				//======================================================================================ボール上と壁下
+				if ((g_Ball.pos.x    + g_Ball.size.x / 2 >= blockpos.x - BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.x    - g_Ball.size.x / 2 <= blockpos.x + BLOCKSIZE_BN / 2) &&
+					(g_Ball.pos.y    - g_Ball.size.y / 2 <= blockpos.y + BLOCKSIZE_BN / 2) &&
+					(g_Ball.oldpos.y - g_Ball.size.y / 2 >  blockpos.y + BLOCKSIZE_BN / 2) &&
 					(g_Ball.IsUse))
 				{
 					SetBoundEffects(i, k, dir_top);
@@ -177,25 +210,30 @@ void BallUPDATE(void)
 			if (IsBreak)break;
 		}
 
-		//oEh񐔂HP}CiXB
+		//バウンド回数でHPマイナス。
 		if (g_BoundCnt >= 128)
 		{
 			BallReset();
 			SubLife();
-			StageBlockReset();
+			StageBlockReset(stagereset_clear);
 		}
 
-		//=========================================================ʊOɏo폜@ŏIIɂ͖͂̏B
-		if (((g_Ball.pos.x <= -SCREEN_WIDTH  / 2 - g_Ball.size.x) ||
-			(g_Ball.pos.x  >=  SCREEN_WIDTH  / 2 + g_Ball.size.x) ||
-			(g_Ball.pos.y  <= -SCREEN_HEIGHT / 2 - g_Ball.size.y) ||
-			(g_Ball.pos.y  >=  SCREEN_HEIGHT / 2 + g_Ball.size.y)) &&
+		//=========================================================ステージの外に出たら削除
+		BALLNUM stageright = BALLNUM_INT(-SCREEN_WIDTH  / 2) + BLOCKSIZE_BN * GetStageWidth();
+		BALLNUM stageunder = BALLNUM_INT(-SCREEN_HEIGHT / 2) + BLOCKSIZE_BN * GetStageHeight();
+		if (((g_Ball.pos.x <= BALLNUM_INT(-SCREEN_WIDTH  / 2) - g_Ball.size.x) ||
+			(g_Ball.pos.x  >= stageright + g_Ball.size.x) ||
+			(g_Ball.pos.y  <= BALLNUM_INT(-SCREEN_HEIGHT / 2) - g_Ball.size.y) ||
+			(g_Ball.pos.y  >= stageunder + g_Ball.size.y)) &&
 			(g_Ball.IsUse))
 		{
-			//|WVݒ
+			//ポジション設定
 			BallReset();
-			StageBlockReset();
+			StageBlockReset(stagereset_clear);
 		}
+
+		//このフレームの状態を記録。環境が違っても同じ値になるはず。
+		g_BallStateHash = GetBallStateHash();
 	}
 }
 
@@ -203,26 +241,30 @@ bool CheckIsBallTouchGround(void)
 {
 	bool isbreak = false;
 
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	Int2 hitmin, hitmax;
+	GetHitBlockRange(&hitmin, &hitmax);
+	for (int i = hitmin.y; i <= hitmax.y; i++)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		for (int k = hitmin.x; k <= hitmax.x; k++)
 		{
 			BLOCK Block = GetBlock(i, k);
 
 			if (!Block.isUse)continue;
 
-			if ((g_Ball.pos.x - g_Ball.size.x / 2 < Block.fpos.x + BLOCKSIZE.x / 2) &&
-				(g_Ball.pos.x + g_Ball.size.x / 2 > Block.fpos.x - BLOCKSIZE.x / 2) &&
-				(g_Ball.pos.y + g_Ball.size.y / 2 >= Block.fpos.y - BLOCKSIZE.y / 2 - BALLADJUST_Y) &&
-				(g_Ball.oldpos.y + g_Ball.size.y / 2 < Block.fpos.y - BLOCKSIZE.y / 2) &&
+			BALLNUM2 blockpos = MakeBallNum2(BLOCKPOS_X(k), BLOCKPOS_Y(i));
+
+			if ((g_Ball.pos.x - g_Ball.size.x / 2 < blockpos.x + BLOCKSIZE_BN / 2) &&
+				(g_Ball.pos.x + g_Ball.size.x / 2 > blockpos.x - BLOCKSIZE_BN / 2) &&
+				(g_Ball.pos.y + g_Ball.size.y / 2 >= blockpos.y - BLOCKSIZE_BN / 2 - BALLADJUST_Y) &&
+				(g_Ball.oldpos.y + g_Ball.size.y / 2 < blockpos.y - BLOCKSIZE_BN / 2) &&
 				(g_Ball.IsUse))
 			{
-				//߂荞ݕ␳
+				//めり込み補正
 
 				if (Block.type != type_tube_in && Block.type != type_tube_out && 
 					!(Block.type == type_frame && g_Ball.type == balltype_water))
 				{
-					g_Ball.pos.y = Block.fpos.y - BLOCKSIZE.y / 2 - g_Ball.size.y / 2 - BALLADJUST_Y;
+					g_Ball.pos.y = blockpos.y - BLOCKSIZE_BN / 2 - g_Ball.size.y / 2 - BALLADJUST_Y;
 					if (!Block.IsBurn)
 					{
 						g_BoundCnt++;
@@ -243,41 +285,41 @@ bool CheckIsBallTouchGround(void)
 
 void AirResistance(void)
 {
-	//ɖɓ]Ȃ悤ɖC
-	if (g_Ball.speed.x != 0.0f)
+	//横に無限に転がらないように摩擦する
+	if (g_Ball.speed.x != 0)
 	{
 		if (g_Ball.speed.x < 0)
 		{
-			g_Ball.speed.x += 0.01f;
+			g_Ball.speed.x += BALLNUM_CONST(0.01f);
 		}
 		else if (g_Ball.speed.x > 0)
 		{
-			g_Ball.speed.x -= 0.01f;
+			g_Ball.speed.x -= BALLNUM_CONST(0.01f);
 		}
 	}
 }
 
 void SetTubeOutPos(int height,int width)
 {
-	//TUBEɓƂɏoʒuB
-	//oĂTUBEɓOTUBEoĂ悤ɂB
+	//TUBEに入ったときに出現位置。
+	//出てきたTUBEに入ったら一個前のTUBEから出てくるようにする。
 
-	//{[|WVړTUBẼ|WVɍ킹B
+	//ボールポジションを移動先のTUBEのポジションに合わせる。
 	Int2 alfa = GetTubeEscapePos(GetNextTubeNum(height, width));
 	g_Ball.npos = alfa;
 	SetBallPosNtoF();
 
-	//oEhZbg
+	//バウンドリセット
 	g_BoundCnt = 0;
 
 	//BLOCK outtube = GetBlock(alfa.y, alfa.x);
 	BLOCK outtube = GetNextTubeBlock(GetNextTubeNum(height, width));
 	BLOCK intube = GetBlock(height, width);
 
-	//{[̐̕yǂɍ킹ĕύX
+	//ボールの勢いの方向を土管に合わせて変更
 	if (outtube.dir == dir_left)
 	{
-		//̕X𖳌ɂ邩Y𖳌ɂ邩߂
+		//入った時の方向でXを無効にするかYを無効にするか決める
 		if (g_Ball.speed.y < 0)g_Ball.speed.y *= -1;
 		if (g_Ball.speed.x < 0)g_Ball.speed.x *= -1;
 
@@ -287,7 +329,7 @@ void SetTubeOutPos(int height,int width)
 		{
 			g_Ball.speed.x *= -1;
 		}
-		g_Ball.speed.y = 0.0f;//ł邩Y0ɂB
+		g_Ball.speed.y = 0;//横からでるからYは0にする。
 	}
 	else if (outtube.dir == dir_right)
 	{
@@ -300,7 +342,7 @@ void SetTubeOutPos(int height,int width)
 		{
 			g_Ball.speed.x *= -1;
 		}
-		g_Ball.speed.y = 0.0f;
+		g_Ball.speed.y = 0;
 	}
 	else if (outtube.dir == dir_top)
 	{
@@ -313,21 +355,21 @@ void SetTubeOutPos(int height,int width)
 		{
 			g_Ball.speed.y *= -1;
 		}
-		g_Ball.speed.x = 0.0f;
+		g_Ball.speed.x = 0;
 	}
 	else if(outtube.dir == dir_under)
 	{
-		//ォ牺ɏoꍇ͉Ȃ悤Y0ɂB
-		g_Ball.speed.y = 0.0f;
-		g_Ball.speed.x = 0.0f;
+		//上から下に出る場合は加速しすぎないようにYを0にする。
+		g_Ball.speed.y = 0;
+		g_Ball.speed.x = 0;
 	}
 }
 
 void SetBoundEffects(int height,int width,DIR balldir)
 {
-	float currentspeed = 0.0f;
+	BALLNUM currentspeed = 0;
 
-	//̕ϐɃ{[̕āAubNɍ킹ĕҏWƍŌg_ballɓ꒼B
+	//一つの変数にボールの方向を入れて、当たったブロックに合わせて編集したあと最後にg_ballに入れ直す。
 	if (balldir == dir_top || balldir == dir_under) currentspeed = g_Ball.speed.y;
 	else currentspeed = g_Ball.speed.x;
 
@@ -363,14 +405,14 @@ void SetBoundEffects(int height,int width,DIR balldir)
 
 		if (g_Ball.type == balltype_fire)
 		{
-			//RGtFNg
-			currentspeed = currentspeed > 0 ? currentspeed - 0.5f : currentspeed + 0.5f;
+			//燃えるエフェクト
+			currentspeed = currentspeed > 0 ? currentspeed - BALLNUM_CONST(0.5f) : currentspeed + BALLNUM_CONST(0.5f);
 			if(!Block.IsBurn) SetFire(Block.fpos);
 			SetBurn(height, width);
 		}
 
 		currentspeed *= -1;
-		currentspeed = currentspeed > 0 ? currentspeed - 1.5f : currentspeed + 1.5f;
+		currentspeed = currentspeed > 0 ? currentspeed - BALLNUM_CONST(1.5f) : currentspeed + BALLNUM_CONST(1.5f);
 
 		break;
 	case type_frame:
@@ -382,13 +424,13 @@ void SetBoundEffects(int height,int width,DIR balldir)
 		}
 		else
 		{
-			//ђ
+			//貫通
 			IsEnableAttach = true;
 		}
 
 		break;
 	case type_doubletube:
-		//ƃubN̕lāA90x炵ďo
+		//入った方向とブロックの方向を考えて、入った方向から90度ずらして出す
 
 		PlaySE(SE_SWING);
 
@@ -444,12 +486,12 @@ void SetBoundEffects(int height,int width,DIR balldir)
 			break;
 		}
 
-		//DOUBLETUBȄ@ĂȂB
+		//DOUBLETUBEの処理　入ったか入ってないか。
 		if (IsEnableAttachforDouble)
 		{
 			DoubleTubeOutPosProcessing(OutDoubleDir, height,width,balldir);
 		}
-		//ȂoEh
+		//入れなかったからバウンド処理
 		else
 		{
 			if (balldir == dir_top || balldir == dir_under)
@@ -478,7 +520,7 @@ void SetBoundEffects(int height,int width,DIR balldir)
 	case type_tube_out:
 
 		PlaySE(SE_SWING);
-		//oTUBE̕擾
+		//出るTUBEの方向を取得する
 
 		TubeOutProcessing(height, width, balldir);
 		IsEnableAttach = true;
@@ -486,15 +528,15 @@ void SetBoundEffects(int height,int width,DIR balldir)
 		break;
 	case type_needle:
 
-		SetSyabonBreak(g_Ball.pos);
+		SetSyabonBreak(GetBallPos());
 
-		BallReset();//{[폜
+		BallReset();//ボール削除
 		SubLife();
 
 		PlaySE(SE_POP);
 
-		//Xe[W
-		StageBlockReset();
+		//ステージ初期化
+		StageBlockReset(stagereset_clear);
 
 		break;
 	case type_bottun:
@@ -503,7 +545,7 @@ void SetBoundEffects(int height,int width,DIR balldir)
 
 		PlaySE(SE_EXPLOSION);
 
-		//ǂ𔚔j
+		//壁を爆破
 		BombBlockExplotion();
 		DestroyBlock(height,width);
 
@@ -542,11 +584,11 @@ void SetBoundEffects(int height,int width,DIR balldir)
 		}
 		if (g_Ball.speed.x > g_Ball.speed.y)
 		{
-			g_Ball.speed.x += 7.5f;
+			g_Ball.speed.x += BALLNUM_CONST(7.5f);
 		}
 		else
 		{
-			g_Ball.speed.y += 7.5f;
+			g_Ball.speed.y += BALLNUM_CONST(7.5f);
 		}
 		if (isfixX)g_Ball.speed.x *= -1;
 		if (isfixY)g_Ball.speed.y *= -1;
@@ -561,8 +603,9 @@ void SetBoundEffects(int height,int width,DIR balldir)
 
 		PlaySE(SE_CLEAR);
 
-		//NA{[ZbgĂB
+		//クリアしたらボールをリセットしておく。
 		SetClear();
+		g_IsBallGoal = true;
 		g_Ball.IsUse = false;
 		SetSyabonBreak(Block.fpos);
 		DestroyBlock(height, width);
@@ -571,7 +614,7 @@ void SetBoundEffects(int height,int width,DIR balldir)
 		break;
 	}
 
-	//ꎞIȕϐۂ̐lɓ꒼B
+	//一時的な変数から実際の数値に入れ直す処理。
 	if (!IsEnableAttach)
 	{
 		if (balldir == dir_top || balldir == dir_under)g_Ball.speed.y = currentspeed;
@@ -579,20 +622,20 @@ void SetBoundEffects(int height,int width,DIR balldir)
 
 		if (1)
 		{
-			//߂荞ݕ␳
+			//めり込み補正
 			switch (balldir)
 			{
 			case dir_top:
-				g_Ball.pos.y = Block.fpos.y + BLOCKSIZE.y / 2 + g_Ball.size.y / 2 + BALLADJUST_Y;
+				g_Ball.pos.y = BLOCKPOS_Y(height) + BLOCKSIZE_BN / 2 + g_Ball.size.y / 2 + BALLADJUST_Y;
 				break;
 			case dir_under:
-				g_Ball.pos.y = Block.fpos.y - BLOCKSIZE.y / 2 - g_Ball.size.y / 2 - BALLADJUST_Y;
+				g_Ball.pos.y = BLOCKPOS_Y(height) - BLOCKSIZE_BN / 2 - g_Ball.size.y / 2 - BALLADJUST_Y;
 				break;
 			case dir_right:
-				g_Ball.pos.x = Block.fpos.x - BLOCKSIZE.x / 2 - g_Ball.size.x / 2 - BALLADJUST_Y;
+				g_Ball.pos.x = BLOCKPOS_X(width) - BLOCKSIZE_BN / 2 - g_Ball.size.x / 2 - BALLADJUST_Y;
 				break;
 			case dir_left:
-				g_Ball.pos.x = Block.fpos.x + BLOCKSIZE.x / 2 + g_Ball.size.x / 2 + BALLADJUST_Y;
+				g_Ball.pos.x = BLOCKPOS_X(width) + BLOCKSIZE_BN / 2 + g_Ball.size.x / 2 + BALLADJUST_Y;
 				break;
 			}
 		}
@@ -621,14 +664,14 @@ void TubeOutProcessing(int height,int width,DIR balldir)
 	}
 	if (IsIn)
 	{
-		//tube_outɏo
+		//tube_outに出る
 		SetTubeOutPos(height, width);
 		g_BoundCnt = 0;
 	}
 	else
 	{
-		//ȂoEh
-		float currentspeed = 0.0f;
+		//入らなかったからバウンド
+		BALLNUM currentspeed = 0;
 
 		switch(Block.dir)
 		{
@@ -668,10 +711,10 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 	else if (outdir == dir_right)outposnumX = 1;
 	else outposnumX = -1;
 
-	//TUBEubN擾
+	//入ったTUBEブロックを取得
 	BLOCK tubeblock = GetBlock(height, width);
 
-	//oɂubN擾B
+	//出口にあるブロックを取得。
 	BLOCK outposblock = GetBlock(height + outposnumY, width + outposnumX);
 	if (outposblock.isUse)
 	{
@@ -687,12 +730,12 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 		{
 			if (outposblock.type == type_needle)
 			{
-				SetSyabonBreak(g_Ball.pos);
+				SetSyabonBreak(GetBallPos());
 
-				BallReset();//{[폜
+				BallReset();//ボール削除
 				SubLife();
 
-				StageBlockReset();
+				StageBlockReset(stagereset_clear);
 			}
 
 			if (outposblock.type == type_dirt)
@@ -709,7 +752,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			if (outposblock.type == type_frame &&
 				g_Ball.type == balltype_water)
 			{
-				//ђʂ邩珈Ƀ^[
+				//貫通するから処理せずにリターン
 				if (outposblock.dir == dir_top || outposblock.dir == dir_under)
 				{
 					if (outdir == dir_top || outdir == dir_under)return;
@@ -721,14 +764,14 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			}
 
 			bool IsInTube = false;
-			//o悪tube
+			//出た先がtubeだったら
 			if (outposblock.type == type_tube_in ||
 				outposblock.type == type_tube_out)
 			{
 				switch (tubeblock.dir)
 				{
-				case dir_top://DIR 
-					if (outposblock.dir == dir_left)IsInTube = true;//`[u
+				case dir_top://入り口のDIR 
+					if (outposblock.dir == dir_left)IsInTube = true;//チューブ処理
 					break;
 				case dir_under:
 					if (outposblock.dir == dir_right)IsInTube = true;
@@ -748,13 +791,13 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 				}
 			}
 
-			//o悪doubletube
+			//出た先がdoubletubeだったら
 			if (outposblock.type == type_doubletube)
 			{
 				switch (tubeblock.dir)
 				{
 				case dir_top:  
-					if (outposblock.dir == dir_right || outposblock.dir == dir_under)//`[u
+					if (outposblock.dir == dir_right || outposblock.dir == dir_under)//チューブ処理
 					break;
 				case dir_under:
 					break;
@@ -765,13 +808,13 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 				}
 			}
 
-			//ĂɏoĂ
+			//入ってきた方向に出ていく
 			switch (tubeblock.dir)
 			{
 			case dir_top:
 
 				g_Ball.speed.y *= -1;
-				g_Ball.speed.x = 0.0f;
+				g_Ball.speed.x = 0;
 				outposnumX = 0;
 				outposnumY = -1;
 
@@ -779,7 +822,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			case dir_under:
 
 				g_Ball.speed.y *= -1;
-				g_Ball.speed.x = 0.0f;
+				g_Ball.speed.x = 0;
 				outposnumX = 0;
 				outposnumY = 1;
 
@@ -787,7 +830,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			case dir_right:
 
 				g_Ball.speed.x *= -1;
-				g_Ball.speed.y = 0.0f;
+				g_Ball.speed.y = 0;
 				outposnumX = 1;
 				outposnumY = 0;
 
@@ -795,7 +838,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			case dir_left:
 
 				g_Ball.speed.x *= -1;
-				g_Ball.speed.y = 0.0f;
+				g_Ball.speed.y = 0;
 				outposnumX = -1;
 				outposnumY = 0;
 
@@ -803,7 +846,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 			}
 			isthrough = false;
 		}
-		else//ACe
+		else//アイテム類
 		{
 			switch (outposblock.type)
 			{
@@ -827,26 +870,26 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 				break;
 			case type_fast:
 
-				if (GetRandomNum(0, 2) == 0)
+				if (GetRandomNum(random_game, 0, 2) == 0)
 				{
 					if (g_Ball.speed.y > 0)
 					{
-						g_Ball.speed.y += 5.0f;
+						g_Ball.speed.y += BALLNUM_CONST(5.0f);
 					}
 					else
 					{
-						g_Ball.speed.y -= 5.0f;
+						g_Ball.speed.y -= BALLNUM_CONST(5.0f);
 					}
 				}
 				else
 				{
 					if (g_Ball.speed.x > 0)
 					{
-						g_Ball.speed.x += 5.0f;
+						g_Ball.speed.x += BALLNUM_CONST(5.0f);
 					}
 					else
 					{
-						g_Ball.speed.x -= 5.0f;
+						g_Ball.speed.x -= BALLNUM_CONST(5.0f);
 					}
 				}
 				break;
@@ -857,6 +900,7 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 				PlaySE(SE_CLEAR);
 
 				SetClear();
+				g_IsBallGoal = true;
 				g_Ball.IsUse = false;
 				SetSyabonBreak(outposblock.fpos);
 				SetPrincess(outposblock.fpos);
@@ -873,32 +917,32 @@ void DoubleTubeOutPosProcessing(DIR outdir,int height,int width,DIR balldir)
 		if (outdir == dir_top)
 		{
 			g_Ball.speed.y = g_Ball.speed.x > 0 ? g_Ball.speed.x * -1 : g_Ball.speed.x;
-			g_Ball.speed.y + 0.1f;
-			g_Ball.speed.x = 0.0f;
+			g_Ball.speed.y + BALLNUM_CONST(0.1f);
+			g_Ball.speed.x = 0;
 			outposnumX = 0;
 			outposnumY = -1;
 		}
 		else if (outdir == dir_under)
 		{
 			g_Ball.speed.y = g_Ball.speed.x > 0 ? g_Ball.speed.x : g_Ball.speed.x * -1;
-			g_Ball.speed.y - 0.1f;
-			g_Ball.speed.x = 0.0f;
+			g_Ball.speed.y - BALLNUM_CONST(0.1f);
+			g_Ball.speed.x = 0;
 			outposnumX = 0;
 			outposnumY = 1;
 		}
 		else if (outdir == dir_right)
 		{
 			g_Ball.speed.x = g_Ball.speed.y > 0 ? g_Ball.speed.y : g_Ball.speed.y * -1;
-			g_Ball.speed.x - 0.1f;
-			g_Ball.speed.y = 0.0f;
+			g_Ball.speed.x - BALLNUM_CONST(0.1f);
+			g_Ball.speed.y = 0;
 			outposnumX = 1;
 			outposnumY = 0;
 		}
 		else//left
 		{
 			g_Ball.speed.x = g_Ball.speed.y > 0 ? g_Ball.speed.y * -1 : g_Ball.speed.y;
-			g_Ball.speed.x + 0.1f;//xB
-			g_Ball.speed.y = 0.0f;
+			g_Ball.speed.x + BALLNUM_CONST(0.1f);//少し遅くする。
+			g_Ball.speed.y = 0;
 			outposnumX = -1;
 			outposnumY = 0;
 		}
@@ -920,55 +964,89 @@ int GetNextTubeNum(int height, int width)
 
 void BallDRAW(void)
 {
-	//{[\
+	//ボール表示
 	if (g_Ball.IsUse)
 	{
-		FaceGenforTex(g_Ball.pos, g_Ball.size, g_Ball.type, 0, 3, 1, true, g_BallTex, MakeFloat4(1, 1, 1, 1));
+		FaceGenforTex(GetScreenPos(GetBallPos()), MakeFloat2(BALLNUM_TOFLOAT(g_Ball.size.x), BALLNUM_TOFLOAT(g_Ball.size.y)),
+			g_Ball.type, 0, 3, 1, true, g_BallTex, MakeFloat4(1, 1, 1, 1));
 	
-		//{[΂Ȃ΂ł鎞ԂQ[Wŕ\
+		//ボールが火なら火でいられる時間をゲージで表示
 		if (g_Ball.type == balltype_fire)
 		{
-			//Q[Wwi
+			//ゲージ背景
 			FaceGenforTex(MakeFloat2(0, -SCREEN_HEIGHT / 2 + 32),
 				MakeFloat2(FIRETIME + 16, 32 + 16), 0, 0, 1, 1, false, 0, COLOR_BLACK);
 
-			//Q[W{
+			//ゲージ本体
 			GageGeneratorSubStyle(MakeFloat2(0, -SCREEN_HEIGHT / 2 + 32),
 				32, FIRETIME, g_FireCnt, 'R', MakeFloat4(1, 0.4f, 0, 1));
 		}
 	}
 
-	//HP\
-	char HPtext[32] = {};
-	sprintf(HPtext, "HP:%d", g_Ball.HP);
+	//HP表示
 	TextGen(MakeFloat2(SCREEN_WIDTH / 2 - 32 * 6 - BLOCKSIZE.x, -SCREEN_HEIGHT / 2 + 32 + BLOCKSIZE.y),
-		MakeFloat2(32, 32), NORMALCOLOR, HPtext);
+		MakeFloat2(32, 32), NORMALCOLOR, FormatScratch("HP:%d", g_Ball.HP));
+
+	//デバッグなら状態のハッシュを表示
+	if (GetIsDebug())
+	{
+		TextGen(MakeFloat2(SCREEN_WIDTH / 2 - 32 * 6 - BLOCKSIZE.x, -SCREEN_HEIGHT / 2 + 64 + BLOCKSIZE.y),
+			MakeFloat2(32, 32), NORMALCOLOR, FormatScratch("%08X", g_BallStateHash));
+	}
 }
 
 void SetBallPosNtoF(void)
 {
-	g_Ball.pos.y = -SCREEN_HEIGHT / 2 + BLOCKSIZE.y * g_Ball.npos.y + BLOCKSIZE.y / 2;
-	g_Ball.pos.x = -SCREEN_WIDTH  / 2 + BLOCKSIZE.x * g_Ball.npos.x + BLOCKSIZE.x / 2;
+	g_Ball.pos.y = BLOCKPOS_Y(g_Ball.npos.y);
+	g_Ball.pos.x = BLOCKPOS_X(g_Ball.npos.x);
 }
 
 void SetBallPosFtoN(void)
 {
-	g_Ball.npos.x = g_Ball.pos.x / BLOCKSIZE.x + (int)(MAX_BLOCK_WIDTH / 2);
-	g_Ball.npos.y = g_Ball.pos.y / BLOCKSIZE.y + (int)(MAX_BLOCK_HEIGHT / 2);
+#ifdef BALL_FIXEDPOINT
+	//整数の割り算は0方向への切り捨てなので、floatの時と同じになるように先に足しておく。
+	g_Ball.npos.x = (g_Ball.pos.x + BLOCKSIZE_BN * (SCREEN_BLOCK_WIDTH / 2)) / BLOCKSIZE_BN;
+	g_Ball.npos.y = (g_Ball.pos.y + BLOCKSIZE_BN * (SCREEN_BLOCK_HEIGHT / 2)) / BLOCKSIZE_BN;
+#else
+	g_Ball.npos.x = g_Ball.pos.x / BLOCKSIZE.x + (int)(SCREEN_BLOCK_WIDTH / 2);
+	g_Ball.npos.y = g_Ball.pos.y / BLOCKSIZE.y + (int)(SCREEN_BLOCK_HEIGHT / 2);
+#endif
+}
+
+//このフレームでボールが当たるかもしれないマスの範囲。oldposからposまでと、その隣のマス
+void GetHitBlockRange(Int2* min, Int2* max)
+{
+	BALLNUM left  = (g_Ball.pos.x < g_Ball.oldpos.x ? g_Ball.pos.x : g_Ball.oldpos.x) - g_Ball.size.x / 2;
+	BALLNUM right = (g_Ball.pos.x > g_Ball.oldpos.x ? g_Ball.pos.x : g_Ball.oldpos.x) + g_Ball.size.x / 2;
+	BALLNUM top   = (g_Ball.pos.y < g_Ball.oldpos.y ? g_Ball.pos.y : g_Ball.oldpos.y) - g_Ball.size.y / 2;
+	BALLNUM under = (g_Ball.pos.y > g_Ball.oldpos.y ? g_Ball.pos.y : g_Ball.oldpos.y) + g_Ball.size.y / 2;
+
+	//割り算は0方向への切り捨てなので、1マス広げれば負の座標でも足りる
+	min->x = (int)((left  - BALLNUM_INT(-SCREEN_WIDTH  / 2)) / BLOCKSIZE_BN) - 1;
+	max->x = (int)((right - BALLNUM_INT(-SCREEN_WIDTH  / 2)) / BLOCKSIZE_BN) + 1;
+	min->y = (int)((top   - BALLNUM_INT(-SCREEN_HEIGHT / 2)) / BLOCKSIZE_BN) - 1;
+	max->y = (int)((under - BALLNUM_INT(-SCREEN_HEIGHT / 2)) / BLOCKSIZE_BN) + 1;
+
+	if (min->x < 0)min->x = 0;
+	if (min->y < 0)min->y = 0;
+	if (max->x > GetStageWidth() - 1)max->x = GetStageWidth() - 1;
+	if (max->y > GetStageHeight() - 1)max->y = GetStageHeight() - 1;
 }
 
 void BallReset(void)
 {
-	g_Ball.speed = MakeFloat2(0, 0);
+	g_Ball.speed = MakeBallNum2(0, 0);
 	g_Ball.IsUse = false;
 	g_Ball.stopCnt = 0;
-	g_Ball.oldpos = MakeFloat2(0, 0);
+	g_Ball.oldpos = MakeBallNum2(0, 0);
 	g_Ball.pos = BALLSTARTPOS;
 	g_Ball.npos = MakeInt2(4, 0);
 	g_Ball.type = balltype_normal;
 	g_IsBallMoving = false;
+	g_IsBallGoal = false;
 	g_BoundCnt = 0;
 	g_CoinNum = 0;
+	g_FireCnt = 0;
 	
 
 	g_BallLifeTimeCnt = 0;
@@ -986,7 +1064,7 @@ void SetBall(void)
 {
 	if (!g_Ball.IsUse)
 	{
-		g_Ball.speed = MakeFloat2(0, 0);
+		g_Ball.speed = MakeBallNum2(0, 0);
 		g_Ball.IsUse = true;
 	}
 }
@@ -1000,7 +1078,7 @@ void SubLife(void)
 {
 	g_Ball.HP -= 1;
 
-	//Q[I[o[
+	//ゲームオーバー
 	g_Ball.HP > 0 ? SetHeart(MakeFloat2(0, 0)) : SetGameOver();
 
 }
@@ -1018,4 +1096,78 @@ bool GetIsBallMoving(void)
 int GetCoinNum(void)
 {
 	return g_CoinNum;
+}
+
+bool GetIsBallGoal(void)
+{
+	return g_IsBallGoal;
+}
+
+Float2 GetBallPos(void)
+{
+	return MakeFloat2(BALLNUM_TOFLOAT(g_Ball.pos.x), BALLNUM_TOFLOAT(g_Ball.pos.y));
+}
+
+BALLNUM2 MakeBallNum2(BALLNUM x, BALLNUM y)
+{
+	BALLNUM2 alfa;
+	alfa.x = x;
+	alfa.y = y;
+
+	return alfa;
+}
+
+//ボールとステージの状態をハッシュにする。
+//BALL_FIXEDPOINTなら環境が違っても同じ値になる。リプレイなどのずれ検出用。
+unsigned int GetBallStateHash(void)
+{
+	unsigned int hash = HASH_INIT;
+	int IsUse = g_Ball.IsUse ? 1 : 0;
+	int type = g_Ball.type;
+
+	//構造体ごとだとパディングが混ざるのでメンバごとに混ぜる。
+	hash = HashData(hash, &g_Ball.pos, sizeof(g_Ball.pos));
+	hash = HashData(hash, &g_Ball.speed, sizeof(g_Ball.speed));
+	hash = HashData(hash, &IsUse, sizeof(IsUse));
+	hash = HashData(hash, &type, sizeof(type));
+	hash = HashData(hash, &g_Ball.HP, sizeof(g_Ball.HP));
+	hash = HashData(hash, &g_BoundCnt, sizeof(g_BoundCnt));
+	hash = HashData(hash, &g_FireCnt, sizeof(g_FireCnt));
+	hash = HashData(hash, &g_CoinNum, sizeof(g_CoinNum));
+
+	return HashStageBlock(hash);
+}
+
+//物理演算の状態を保存する。
+void GetBallState(BALLSTATE* state)
+{
+	state->ball = g_Ball;
+	state->TubeCnt = g_TubeCnt;
+	state->CoinNum = g_CoinNum;
+	state->BoundCnt = g_BoundCnt;
+	state->FireCnt = g_FireCnt;
+	state->FireNum = g_FireNum;
+	state->BoundCountTime = g_BoundCountTime;
+	state->OldBoundCountTime = g_OldBoundCountTime;
+	state->BallLifeTimeCnt = g_BallLifeTimeCnt;
+	state->IsBallMoving = g_IsBallMoving;
+	state->IsBallGoal = g_IsBallGoal;
+	state->StateHash = g_BallStateHash;
+}
+
+//保存した状態に戻す。
+void SetBallState(const BALLSTATE* state)
+{
+	g_Ball = state->ball;
+	g_TubeCnt = state->TubeCnt;
+	g_CoinNum = state->CoinNum;
+	g_BoundCnt = state->BoundCnt;
+	g_FireCnt = state->FireCnt;
+	g_FireNum = state->FireNum;
+	g_BoundCountTime = state->BoundCountTime;
+	g_OldBoundCountTime = state->OldBoundCountTime;
+	g_BallLifeTimeCnt = state->BallLifeTimeCnt;
+	g_IsBallMoving = state->IsBallMoving;
+	g_IsBallGoal = state->IsBallGoal;
+	g_BallStateHash = state->StateHash;
 }
\ No newline at end of file
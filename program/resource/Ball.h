@@ -4,6 +4,23 @@
 #include"main.h"
 #include"Mytype.h"
 
+//有効にするとボールの物理演算を固定小数点で行う。
+//コンパイラ、最適化、x87/SSEの違いがあっても毎フレーム同じ結果になる。
+//リプレイとソルバーの結果が環境で変わらないように、いつも有効にしておく。
+#define BALL_FIXEDPOINT
+
+#ifdef BALL_FIXEDPOINT
+typedef FIXED BALLNUM;
+typedef Fixed2 BALLNUM2;
+#define BALLNUM_CONST(f) FIXED_CONST(f)
+#define BALLNUM_INT(n) ((BALLNUM)((n) * FIXED_ONE))
+#else
+typedef float BALLNUM;
+typedef Float2 BALLNUM2;
+#define BALLNUM_CONST(f) ((float)(f))
+#define BALLNUM_INT(n) ((float)(n))
+#endif
+
 enum BALLTYPE
 {
 	balltype_normal,
@@ -15,18 +32,36 @@ enum BALLTYPE
 
 typedef struct
 {
-	Float2 pos;
-	Float2 oldpos;
+	BALLNUM2 pos;
+	BALLNUM2 oldpos;
 	Int2 npos;
-	Float2 size;
-	Float2 speed;
+	BALLNUM2 size;
+	BALLNUM2 speed;
 	bool IsUse;
 	BALLTYPE type;
 	int HP;
 	int stopCnt;
 }BALL;
 
+//ボールの物理演算の状態全部。予測線のチェックポイント用。
+typedef struct
+{
+	BALL ball;
+	int TubeCnt;
+	int CoinNum;
+	int BoundCnt;
+	int FireCnt;
+	int FireNum;
+	int BoundCountTime;
+	int OldBoundCountTime;
+	int BallLifeTimeCnt;
+	bool IsBallMoving;
+	bool IsBallGoal;
+	unsigned int StateHash;
+}BALLSTATE;
+
 void BallINIT(void);
+void InitBallState(void);
 void BallUPDATE(void);
 void BallDRAW(void);
 void BallUNINIT(void);
@@ -37,5 +72,10 @@ BALL* GetBall(void);
 void SetBall(void);
 bool GetIsBallMoving(void);
 int GetCoinNum(void);
+bool GetIsBallGoal(void);
+Float2 GetBallPos(void);
+unsigned int GetBallStateHash(void);
+void GetBallState(BALLSTATE* state);
+void SetBallState(const BALLSTATE* state);
 
 #endif
\ No newline at end of file
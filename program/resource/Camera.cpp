@@ -0,0 +1,96 @@
+//=================================
+//
+//カメラ
+//
+//ボールが動いている間はボールを、止まっている間はカーソルを追いかける。
+//ステージの外は映さない。1画面のステージならずっと(0,0)のまま。
+//
+//=================================
+
+#include"main.h"
+#include"Camera.h"
+#include"StageMaker.h"
+#include"Ball.h"
+#include"Redraw.h"
+
+#define CAMERA_FOLLOW (0.15f)//1フレームで目標に近づく割合
+
+static Float2 GetCameraTarget(void);
+static float ClampCameraAxis(float pos, float origin, float stagesize, float screensize);
+
+static Float2 g_CameraPos;
+
+void CameraINIT(void)
+{
+	g_CameraPos = GetCameraTarget();
+}
+
+void CameraUPDATE(void)
+{
+	Float2 target = GetCameraTarget();
+	if (target.x == g_CameraPos.x && target.y == g_CameraPos.y)return;
+
+	RequestRedraw();
+
+	g_CameraPos.x += (target.x - g_CameraPos.x) * CAMERA_FOLLOW;
+	g_CameraPos.y += (target.y - g_CameraPos.y) * CAMERA_FOLLOW;
+
+	//ほとんど着いたら合わせる
+	if (fabsf(target.x - g_CameraPos.x) < 0.5f)g_CameraPos.x = target.x;
+	if (fabsf(target.y - g_CameraPos.y) < 0.5f)g_CameraPos.y = target.y;
+}
+
+Float2 GetCameraPos(void)
+{
+	return g_CameraPos;
+}
+
+void SetCameraPos(Float2 pos)
+{
+	g_CameraPos = pos;
+}
+
+Float2 GetScreenPos(Float2 pos)
+{
+	return MakeFloat2(pos.x - g_CameraPos.x, pos.y - g_CameraPos.y);
+}
+
+bool IsInCamera(Float2 pos, Float2 size)
+{
+	return fabsf(pos.x - g_CameraPos.x) < (SCREEN_WIDTH + size.x) / 2 &&
+		fabsf(pos.y - g_CameraPos.y) < (SCREEN_HEIGHT + size.y) / 2;
+}
+
+void GetCameraBlockRange(Int2* min, Int2* max, int margin)
+{
+	*min = GetBlockNpos(MakeFloat2(g_CameraPos.x - SCREEN_WIDTH / 2, g_CameraPos.y - SCREEN_HEIGHT / 2));
+	//右下の端はちょうど次のマスの境目なので、1ドット内側にする
+	*max = GetBlockNpos(MakeFloat2(g_CameraPos.x + SCREEN_WIDTH / 2 - 1, g_CameraPos.y + SCREEN_HEIGHT / 2 - 1));
+
+	min->x -= margin;
+	min->y -= margin;
+	max->x += margin;
+	max->y += margin;
+}
+
+//追いかける位置を、画面がステージからはみ出さないようにしたもの
+static Float2 GetCameraTarget(void)
+{
+	Float2 target = GetIsBallMoving() ? GetBallPos() : GetCurrentBlockPos();
+
+	target.x = ClampCameraAxis(target.x, STAGE_ORIGIN.x, BLOCKSIZE.x * GetStageWidth(), SCREEN_WIDTH);
+	target.y = ClampCameraAxis(target.y, STAGE_ORIGIN.y, BLOCKSIZE.y * GetStageHeight(), SCREEN_HEIGHT);
+
+	return target;
+}
+
+//ステージが画面より小さければ左上に合わせる
+static float ClampCameraAxis(float pos, float origin, float stagesize, float screensize)
+{
+	float min = origin + screensize / 2;
+	float max = origin + stagesize - screensize / 2;
+
+	if (pos > max)pos = max;
+	if (pos < min)pos = min;
+	return pos;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+#include"main.h"
+#include"Mytype.h"
+
+void CameraINIT(void);
+void CameraUPDATE(void);
+
+//画面の中心のワールド座標
+Float2 GetCameraPos(void);
+void SetCameraPos(Float2 pos);
+//ワールド座標を描画する座標にする
+Float2 GetScreenPos(Float2 pos);
+//posを中心にしたsizeの四角形が画面に映るか
+bool IsInCamera(Float2 pos, Float2 size);
+//画面に映っているマスの範囲をmarginマス広げたもの。ステージの外も含む
+void GetCameraBlockRange(Int2* min, Int2* max, int margin);
+
+#endif
\ No newline at end of file
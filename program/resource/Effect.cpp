@@ -1,14 +1,19 @@
 
+#include"Effect.h"
 #include"texture.h"
 #include"FaceGen.h"
 #include"StageMaker.h"
 #include"sound.h"
+#include"Random.h"
+#include"Camera.h"
 
-#define MAXEFFECT (64)
+#define PARTICLE_MAX (2048)//エミッターごとに出せる数
 #define EXPLOTIONSIZE (MakeFloat2(64,64))
 #define HEARTSIZE (MakeFloat2(512,512))
 #define FIREWORKSSIZE (MakeFloat2(128,128))
+#define EFFECTFRAMETIME (4)//アニメーションを1コマ進めるまでのフレーム
 
+//エミッター。種類ごとにパーティクルの置き場所を分ける
 enum EFFECTTYPE
 {
 	effecttype_heart,
@@ -16,55 +21,80 @@ enum EFFECTTYPE
 	effecttype_fireworks,
 	effecttype_syabon,
 	effecttype_fire,
+
+	EFFECTTYPEMAX
 };
 
+//エミッターの設定
 typedef struct
 {
-	Float2 pos;
+	const char* filename;
+	int sheetX;//テクスチャの分割数
+	int sheetY;
+	int frameNum;//コマ数
+	int frameTime;//1コマのtick
+	int life;//消えるまでのtick
 	Float2 size;
-	int Cnt;
-	int Frame;
-	bool IsUse;
-	EFFECTTYPE type;
-}EFFECT;
+	Float4 color;
+	bool IsScreen;//カメラで動かさない
+	unsigned int endSE;//消えた時のSE。0なら鳴らさない
+}EMITTERDEF;
+
+//パーティクルは要素ごとの配列で持ち、消す時は最後のものを入れ替える。生きているものは常に0～num-1に詰まっている
+//どのエフェクトも出した場所でアニメーションするだけなので、速度は持たない
+typedef struct
+{
+	int num;
+	float posX[PARTICLE_MAX];
+	float posY[PARTICLE_MAX];
+	int startTick[PARTICLE_MAX];//出したGetSpriteTime()。コマはシェーダーが決める
+}PARTICLEPOOL;
 
 void SetFireWorks();
 void SetEffect(EFFECTTYPE type, Float2 pos);
+static void UpdateParticlePool(EFFECTTYPE type);
+static void DrawParticlePool(EFFECTTYPE type);
+static void RemoveParticle(PARTICLEPOOL* pool, int n);
 
-static UINT g_ExplotionTex;
-static UINT g_HeartExplotionTex;
+static const EMITTERDEF g_EmitterDef[EFFECTTYPEMAX] =
+{
+	//ファイル, 分割数, コマ数, 1コマのフレーム, 寿命, 大きさ, 色, 画面に出すか, 消えた時のSE
+	{ "asset/heart_2.tga",       3, 4, 12, EFFECTFRAMETIME, 12 * EFFECTFRAMETIME, HEARTSIZE,     NORMALCOLOR,                  true,  SE_BREAK },
+	{ "asset/explosion_2.tga",   3, 3, 9,  EFFECTFRAMETIME, 9 * EFFECTFRAMETIME,  EXPLOTIONSIZE, MakeFloat4(0.8f, 0.3f, 0, 1), false, 0 },
+	{ "asset/Fireworks.tga",     3, 3, 9,  EFFECTFRAMETIME, 9 * EFFECTFRAMETIME,  FIREWORKSSIZE, NORMALCOLOR,                  true,  0 },
+	{ "asset/syabon_effect.tga", 3, 1, 3,  EFFECTFRAMETIME, 3 * EFFECTFRAMETIME,  FIREWORKSSIZE, NORMALCOLOR,                  false, 0 },
+	{ "asset/afterfire.tga",     3, 3, 9,  EFFECTFRAMETIME, 9 * EFFECTFRAMETIME,  BLOCKSIZE,     NORMALCOLOR,                  false, 0 },
+};
+
+static UINT g_EmitterTex[EFFECTTYPEMAX];
 static UINT g_GameFinTex;
-static UINT g_FireworksTex;
-static UINT g_SyabonTex;
 static UINT g_PrincessTex;
-static UINT g_FireTex;
-static EFFECT g_effect[MAXEFFECT] = {};
+static PARTICLEPOOL g_Particle[EFFECTTYPEMAX];
+static Float2 g_DrawPos[PARTICLE_MAX];//描画用の作業場所
+static int g_DrawStartTick[PARTICLE_MAX];
 static bool g_IsClear;
 static bool g_IsGameover;
 static int g_FireWorksCreateCnt;
-static int g_PrincessCnt;
-static int g_PrincessFrame;
+static int g_PrincessStartTick;
 static Float2 g_PrincessPos;
 static bool g_PrincessIsUse;
 
 void EffectINIT(void)
 {
-	memset(g_effect, 0, sizeof(g_effect));
+	const char* filename[EFFECTTYPEMAX];
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
+	{
+		g_Particle[i].num = 0;
+		filename[i] = g_EmitterDef[i].filename;
+	}
+	LoadTextures(filename, g_EmitterTex, EFFECTTYPEMAX);
 
-	g_ExplotionTex = LoadTexture("asset/explosion_2.tga");
-	g_HeartExplotionTex = LoadTexture("asset/heart_2.tga");
 	g_GameFinTex = LoadTexture("asset/GameEnd.tga");
-	g_FireworksTex = LoadTexture("asset/Fireworks.tga");
-	g_SyabonTex = LoadTexture("asset/syabon_effect.tga");
 	g_PrincessTex = LoadTexture("asset/Princess.tga");
-	g_FireTex = LoadTexture("asset/afterfire.tga");
 
 	g_IsClear = false;
 	g_IsGameover = false;
 	g_PrincessIsUse = false;
-
-	g_PrincessCnt = 0;
-	g_PrincessFrame = 0;
 }
 
 void EffectUPDATE(void)
@@ -74,82 +104,28 @@ void EffectUPDATE(void)
 		SetFireWorks();
 	}
 
-	if (g_PrincessIsUse)
+	//寿命が来たものを消すだけ。SEを鳴らすのでこのスレッドで
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
 	{
-		g_PrincessCnt++;
-		if (g_PrincessCnt > 3)
-		{
-			g_PrincessCnt = 0;
-			g_PrincessFrame++;
-		}
-		if (g_PrincessFrame >= 3)
-		{
-			g_PrincessFrame = 0;
-		}
-	}
-
-	for (int i = 0; i < MAXEFFECT; i++)
-	{
-		if (!g_effect[i].IsUse)continue;
-
-		g_effect[i].Cnt++;
-
-		if (g_effect[i].Cnt > 3)
-		{
-			g_effect[i].Cnt = 0;
-			g_effect[i].Frame++;
-		}
-
-		int alfa = g_effect[i].type == effecttype_heart ? 12 :
-			g_effect[i].type == effecttype_syabon ? 3 : 9;
-
-		if (g_effect[i].Frame >= alfa)
-		{
-			g_effect[i].Frame = 0;
-			g_effect[i].IsUse = false;
-
-			if (g_effect[i].type == effecttype_heart)
-			{
-				PlaySE(SE_BREAK);
-			}
-		}
+		UpdateParticlePool((EFFECTTYPE)i);
 	}
 }
 
 void EffectDRAW(void)
 {
-	for (int i = 0; i < MAXEFFECT; i++)
+	//エミッターごとに1回で描画する
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
 	{
-		if (!g_effect[i].IsUse)continue;
-
-		//eNX`XI
-		int alfa_x = 3;
-
-		//J[I
-		Float4 color = g_effect[i].type == effecttype_explotion ? MakeFloat4(0.8f, 0.3f, 0, 1) : NORMALCOLOR;
-
-		//eNX`I
-		UINT texID = g_effect[i].type == effecttype_heart ? g_HeartExplotionTex :
-			g_effect[i].type == effecttype_explotion ? g_ExplotionTex :
-			g_effect[i].type == effecttype_fireworks ? g_FireworksTex :
-			g_effect[i].type == effecttype_syabon ? g_SyabonTex : g_FireTex;
-
-		//eNX`YI
-		int alfa_y = g_effect[i].type == effecttype_heart ? 4 :
-					 g_effect[i].type == effecttype_syabon ? 1 : 3;
-
-		//\
-		FaceGenforTex(g_effect[i].pos, g_effect[i].size, g_effect[i].Frame % alfa_x,
-			g_effect[i].Frame / alfa_x, alfa_x, alfa_y, true, texID, color);
+		DrawParticlePool((EFFECTTYPE)i);
 	}
 
-	//Q[I[o[\
+	//ゲームオーバー表示
 	if (g_IsGameover)
 	{
 		FaceGenforTex(MakeFloat2(0,-SCREEN_HEIGHT / 2 + SCREEN_HEIGHT / 4),MakeFloat2(1024,512),0,1,1,2,true,g_GameFinTex,MakeFloat4(1,1,1,1));
 	}
 
-	//NA\
+	//クリア表示
 	else if (g_IsClear)
 	{
 		FaceGenforTex(MakeFloat2(0, -SCREEN_HEIGHT / 2 + SCREEN_HEIGHT / 4), 
@@ -158,33 +134,92 @@ void EffectDRAW(void)
 
 	if(g_PrincessIsUse)
 	{
-		FaceGenforTex(g_PrincessPos,BLOCKSIZE, g_PrincessFrame, 0, 3, 1, true, g_PrincessTex, MakeFloat4(1, 1, 1, 1));
+		SPRITEANIM anim = MakeSpriteAnim(0, 3, 4, 3, 1, animloop_loop, g_PrincessStartTick);
+		FaceGenAnim(GetScreenPos(g_PrincessPos), BLOCKSIZE, &anim, g_PrincessTex, MakeFloat4(1, 1, 1, 1), dir_top);
+	}
+}
+
+static void UpdateParticlePool(EFFECTTYPE type)
+{
+	PARTICLEPOOL* pool = &g_Particle[type];
+	const EMITTERDEF* def = &g_EmitterDef[type];
+
+	//寿命が来たものを消す。入れ替えたものもまだ見ていないので同じ場所をもう一回見る
+	for (int i = 0; i < pool->num;)
+	{
+		if (GetSpriteTime() - pool->startTick[i] < def->life)
+		{
+			i++;
+			continue;
+		}
+
+		RemoveParticle(pool, i);
+
+		if (def->endSE != 0)
+		{
+			PlaySE(def->endSE);
+		}
+	}
+}
+
+static void DrawParticlePool(EFFECTTYPE type)
+{
+	const PARTICLEPOOL* pool = &g_Particle[type];
+	const EMITTERDEF* def = &g_EmitterDef[type];
+	SPRITEANIM anim = MakeSpriteAnim(0, def->frameNum, def->frameTime, def->sheetX, def->sheetY, animloop_once, 0);
+	int drawnum = 0;
+
+	for (int i = 0; i < pool->num; i++)
+	{
+		Float2 pos = MakeFloat2(pool->posX[i], pool->posY[i]);
+
+		if (!def->IsScreen)
+		{
+			if (!IsInCamera(pos, def->size))continue;
+			pos = GetScreenPos(pos);
+		}
+
+		g_DrawPos[drawnum] = pos;
+		g_DrawStartTick[drawnum] = pool->startTick[i];
+		drawnum++;
 	}
+
+	if (drawnum == 0)return;
+
+	FaceGenBatch(g_DrawPos, g_DrawStartTick, drawnum, def->size, &anim, g_EmitterTex[type], def->color);
+}
+
+static void RemoveParticle(PARTICLEPOOL* pool, int n)
+{
+	int last = pool->num - 1;
+
+	pool->posX[n] = pool->posX[last];
+	pool->posY[n] = pool->posY[last];
+	pool->startTick[n] = pool->startTick[last];
+	pool->num--;
 }
 
 void SetPrincess(Float2 pos)
 {
+	if (GetIsHeadless())return;
+
 	g_PrincessPos = pos;
+	g_PrincessStartTick = GetSpriteTime();
 	g_PrincessIsUse = true;
 }
 
 void EffectUNINIT(void)
 {
-	UnloadTexture(g_ExplotionTex);
-	UnloadTexture(g_HeartExplotionTex);
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
+	{
+		UnloadTexture(g_EmitterTex[i]);
+		g_EmitterTex[i] = NULL;
+	}
 	UnloadTexture(g_GameFinTex);
-	UnloadTexture(g_FireworksTex);
-	UnloadTexture(g_SyabonTex);
 	UnloadTexture(g_PrincessTex);
-	UnloadTexture(g_FireTex);
 
-	g_ExplotionTex = NULL;
-	g_HeartExplotionTex = NULL;
 	g_GameFinTex = NULL;
-	g_FireworksTex = NULL;
-	g_SyabonTex = NULL;
 	g_PrincessTex = NULL;
-	g_FireTex = NULL;
 }
 
 void SetSyabonBreak(Float2 pos)
@@ -216,53 +251,52 @@ void SetFire(Float2 pos)
 
 void SetEffect(EFFECTTYPE type, Float2 pos)
 {
-	for (int i = 0; i < MAXEFFECT; i++)
+	//ヘッドレス(ソルバー)と早送り中はエフェクトを出さない。乱数はrandom_effectなのでゲームには影響しない
+	if (GetIsHeadless() || GetIsPresentationOff())return;
+
+	if (type == effecttype_fireworks)
 	{
-		if (g_effect[i].IsUse)continue;
+		//4回に1回だけ出す
+		g_FireWorksCreateCnt++;
+		if (g_FireWorksCreateCnt <= 3)return;
 
-		bool isSetFire = false;
-		if (type == effecttype_fireworks)
-		{
-			g_FireWorksCreateCnt++;
-			if (g_FireWorksCreateCnt > 3)
-			{
-				//_ȃ|WVZbg
-				pos.x = GetRandomNum(0, SCREEN_WIDTH / 2 - FIREWORKSSIZE.x);
-				pos.y = GetRandomNum(0, SCREEN_HEIGHT / 2 - FIREWORKSSIZE.y);
-
-				if (GetRandomNum(0, 2) == 0) pos.x *= -1;
-				if (GetRandomNum(0, 2) == 0) pos.y *= -1;
-
-				g_FireWorksCreateCnt = 0;
-			}
-			else
-			{
-				isSetFire = true;
-			}
-		}
+		//ランダムなポジションをセット
+		pos.x = GetRandomNum(random_effect, 0, SCREEN_WIDTH / 2 - FIREWORKSSIZE.x);
+		pos.y = GetRandomNum(random_effect, 0, SCREEN_HEIGHT / 2 - FIREWORKSSIZE.y);
 
-		if (!isSetFire)
-		{
-			g_effect[i].pos = pos;
-			g_effect[i].size = type == effecttype_heart ? HEARTSIZE : 
-							   type == effecttype_explotion ? EXPLOTIONSIZE : 
-							   type == effecttype_fire ? BLOCKSIZE : FIREWORKSSIZE;
+		int flip[2];
+		GetRandomNumArray(random_effect, 0, 2, flip, 2);
+		if (flip[0] == 0) pos.x *= -1;
+		if (flip[1] == 0) pos.y *= -1;
 
-			g_effect[i].IsUse = true;
-			g_effect[i].type = type;
-		}
+		g_FireWorksCreateCnt = 0;
+	}
 
-		break;
+	PARTICLEPOOL* pool = &g_Particle[type];
+	if (pool->num >= PARTICLE_MAX)
+	{
+		NN_LOG("SetEffect: type %d is full\n", type);
+		return;
 	}
+
+	int n = pool->num;
+	pool->posX[n] = pos.x;
+	pool->posY[n] = pos.y;
+	pool->startTick[n] = GetSpriteTime();
+	pool->num++;
 }
 
 void SetGameOver(void)
 {
+	if (GetIsHeadless())return;
+
 	if (!g_IsGameover)g_IsGameover = true;
 }
 
 void SetClear(void)
 {
+	if (GetIsHeadless())return;
+
 	if (!g_IsClear)g_IsClear = true;
 }
 
@@ -280,3 +314,39 @@ int getnum(void)
 {
 	return 0;
 }
+
+bool GetIsEffectActive(void)
+{
+	if (g_IsClear)return true;
+
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
+	{
+		if (g_Particle[i].num > 0)return true;
+	}
+	return false;
+}
+
+void GetEffectState(EFFECTSTATE* state)
+{
+	state->IsClear = g_IsClear;
+	state->IsGameover = g_IsGameover;
+	state->FireWorksCreateCnt = g_FireWorksCreateCnt;
+	state->PrincessStartTick = g_PrincessStartTick;
+	state->PrincessPos = g_PrincessPos;
+	state->PrincessIsUse = g_PrincessIsUse;
+}
+
+void SetEffectState(const EFFECTSTATE* state)
+{
+	for (int i = 0; i < EFFECTTYPEMAX; i++)
+	{
+		g_Particle[i].num = 0;
+	}
+
+	g_IsClear = state->IsClear;
+	g_IsGameover = state->IsGameover;
+	g_FireWorksCreateCnt = state->FireWorksCreateCnt;
+	g_PrincessStartTick = state->PrincessStartTick;
+	g_PrincessPos = state->PrincessPos;
+	g_PrincessIsUse = state->PrincessIsUse;
+}
\ No newline at end of file
@@ -2,22 +2,34 @@
 #define EFFECT_H_
 
 #include"main.h"
+#include"Mytype.h"
+
+//クリア、ゲームオーバーの状態。出ているパーティクルは見た目だけなので持たない
+typedef struct
+{
+	bool IsClear;
+	bool IsGameover;
+	int FireWorksCreateCnt;
+	int PrincessStartTick;
+	Float2 PrincessPos;
+	bool PrincessIsUse;
+}EFFECTSTATE;
 
 void EffectINIT(void);
 void EffectUPDATE(void);
 void EffectDRAW(void);
 void EffectUNINIT(void);
 
-//GtFNg
+//爆発エフェクト
 void SetExplosion(Float2 pos);
 
-//ԉ΃GtFNg
+//花火エフェクト
 void SetHeart(Float2 pos);
 
-//Q[I[o[ɏォK[~ĂGtFNg
+//ゲームオーバー時に上から青いガーンが降りてくるエフェクト
 void SetGameOver(void);
 
-//NA̕
+//クリアの文字
 void SetClear(void);
 
 bool GetIsClear(void);
@@ -32,5 +44,12 @@ void SetPrincess(Float2 pos);
 
 void SetFire(Float2 pos);
 
+//パーティクルが出ているか、花火を出し続けている
+bool GetIsEffectActive(void);
+
+void GetEffectState(EFFECTSTATE* state);
+//保存した状態に戻す。出ているパーティクルは消す
+void SetEffectState(const EFFECTSTATE* state);
+
 
 #endif
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include"FaceGen.h"
 #include"texture.h"
+#include"Redraw.h"
 
 #define MAXDEBUGTEXT (16)
 #define MAXDEBUGTEXTLENGTH (64)
+#define MAXBATCHFACE (256)//FaceGenBatchで1回のglDrawArraysに入れる四角形の数
+#define MAXPACKVERTEX (64)//DrawVertexで1回に詰める頂点の数
 
-// _\
+// 頂点構造体。組み立てる時はfloatで、描く時にVERTEX_PACKに詰める
 struct VERTEX_3D
 {
 	Float3 Position;
@@ -20,12 +23,58 @@ typedef struct
 }DEBUGTEXT;
 
 static UINT g_TextTex;
+static VERTEX_ANIM g_BatchVertex[MAXBATCHFACE * 6];
+static int g_SpriteTime;//アニメーションのtick。ゲームが止まっている間は進まない
+static bool g_IsBlend = true;//今のGL_BLEND。InitSystemでありにしてある
+static FACEGENFILL g_Fill;
+static FACEGENFILL g_LastFill;
+static FACEGENFILL g_TotalFill;
+static int g_FillFrameNum;
+
+static void DrawVertex(const VERTEX_3D* vertex, int num, GLenum mode, bool IsUseTex);
+static void PackVertex(VERTEX_PACK* pack, Float3 position, Float4 color, Float2 texcord);
+static void PackTexcord(unsigned short* pack, Float2 texcord);
+static void PackAnimQuad(VERTEX_ANIM* vertex, Float2 pos, Float2 size, Float4 color);
+static void SetAnimVertex(VERTEX_ANIM* vertex, int num, const SPRITEANIM* anim, int startTick);
+static void SetAnimRedrawTick(const VERTEX_ANIM* vertex);
+static void DrawAnimVertex(const VERTEX_ANIM* vertex, int num, GLenum mode);
+static void BeginAnimVertex(const VERTEX_ANIM* vertex);
+static void EndAnimVertex(void);
+static bool GetTextFrame(char c, int* frameX, int* frameY);
+static VERTEX_ANIM* AddFaceBatchVertex(FACEBATCH* batch, Float2 pos, Float2 size, UINT texid, Float4 color, bool IsOpaque);
+static bool GetIsOpaqueFace(UINT texid, Float2 uv0, Float2 uv1, Float4 color);
+static float GetFaceArea(Float3 pos0, Float3 pos1);
+static void SetFaceBlend(bool IsOpaque, float area);
 
 void FacegenINIT(void)
 {
 	g_TextTex = LoadTexture("asset/text.tga");
 }
 
+void FacegenUPDATE(void)
+{
+	g_SpriteTime++;
+	SetShaderTime((float)g_SpriteTime);
+}
+
+int GetSpriteTime(void)
+{
+	return g_SpriteTime;
+}
+
+SPRITEANIM MakeSpriteAnim(int firstFrame, int frameNum, int frameTime, int sheetX, int sheetY, ANIMLOOP loop, int startTick)
+{
+	SPRITEANIM anim;
+	anim.startTick = startTick;
+	anim.firstFrame = firstFrame;
+	anim.frameNum = frameNum;
+	anim.frameTime = frameTime;
+	anim.sheetX = sheetX;
+	anim.sheetY = sheetY;
+	anim.loop = loop;
+	return anim;
+}
+
 void FaceGen(Float2 pos,Float2 size,int frame,int MAXFRAMEX,int MAXFRAMEY,bool IsUseTex,unsigned int textureID,char MODE,Float4 Color)
 {
 	IsUseTex == true ? SetTexture(textureID) : SetTexture(NULL);
@@ -57,9 +106,9 @@ void FaceGen(Float2 pos,Float2 size,int frame,int MAXFRAMEX,int MAXFRAMEY,bool I
 		frameY = (frame / MAXFRAMEY) * perframeY;
 	}
 
-	VERTEX_3D vertex[4];
+	VERTEX_3D vertex[4] = {};
 
-	if (MODE == 'B')//obNOEh
+	if (MODE == 'B')//バックグラウンド
 	{
 		vertex[0].Position = MakeFloat3(-SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2, 0.0f);
 		vertex[1].Position = MakeFloat3(SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2, 0.0f);
@@ -92,11 +141,9 @@ void FaceGen(Float2 pos,Float2 size,int frame,int MAXFRAMEX,int MAXFRAMEY,bool I
 	vertex[2].Color = Color;
 	vertex[3].Color = Color;
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
+	SetFaceBlend(GetIsOpaqueFace(IsUseTex ? textureID : 0, vertex[0].Texcord, vertex[3].Texcord, Color), GetFaceArea(vertex[0].Position, vertex[3].Position));
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, IsUseTex);
 }
 
 void FaceGenforTex(Float2 pos, Float2 size, int frameX,int frameY, int MAXframeX, int MAXframeY, bool IsUseTex, UINT texid,Float4 color)
@@ -131,12 +178,10 @@ void FaceGenforTex(Float2 pos, Float2 size, int frameX,int frameY, int MAXframeX
 	vertex[3].Color = color;
 
 	IsUseTex == true ? SetTexture(texid) : SetTexture(NULL);
+	//向きを変えても0と3は対角
+	SetFaceBlend(GetIsOpaqueFace(IsUseTex ? texid : 0, vertex[0].Texcord, vertex[3].Texcord, color), GetFaceArea(vertex[0].Position, vertex[3].Position));
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, IsUseTex);
 }
 
 void FaceGenforTex(Float2 pos, Float2 size, int frameX, int frameY, int MAXframeX, int MAXframeY, bool IsUseTex, UINT texid, Float4 color,DIR dir)
@@ -198,18 +243,16 @@ void FaceGenforTex(Float2 pos, Float2 size, int frameX, int frameY, int MAXframe
 	vertex[3].Color = color;
 
 	IsUseTex == true ? SetTexture(texid) : SetTexture(NULL);
+	//向きを変えても0と3は対角
+	SetFaceBlend(GetIsOpaqueFace(IsUseTex ? texid : 0, vertex[0].Texcord, vertex[3].Texcord, color), GetFaceArea(vertex[0].Position, vertex[3].Position));
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, IsUseTex);
 }
 
 //LRTU = left right top under
 void GageGenerator(Float2 pos, Float2 size, float Gagenum, char LRTU, Float4 Color)
 {
-	VERTEX_3D vertex[4];
+	VERTEX_3D vertex[4] = {};
 	SetTexture(NULL);
 
 	float width = size.x / 2;
@@ -220,28 +263,28 @@ void GageGenerator(Float2 pos, Float2 size, float Gagenum, char LRTU, Float4 Col
 	float right = -width;
 	float left  = -width;
 
-	if (LRTU == 'L')//ɑ₷
+	if (LRTU == 'L')//左に増やす
 	{
 		left  += Gagenum;
 		right = width;
 		top   = height;
 		under = height;
 	}
-	else if (LRTU == 'R')//Eɑ₷
+	else if (LRTU == 'R')//右に増やす
 	{
 		left  = width;
 		right += Gagenum;
 		top   = height;
 		under = height;
 	}
-	else if (LRTU == 'T')//ɑ₷
+	else if (LRTU == 'T')//上に増やす
 	{
 		left  = width;
 		right = width;
 		top   += Gagenum;
 		under = height;
 	}
-	else//ɑ₷
+	else//下に増やす
 	{
 		left  = width;
 		right = width;
@@ -259,16 +302,14 @@ void GageGenerator(Float2 pos, Float2 size, float Gagenum, char LRTU, Float4 Col
 	vertex[2].Color = Color;
 	vertex[3].Color = Color;
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
+	SetFaceBlend(GetIsOpaqueFace(0, vertex[0].Texcord, vertex[3].Texcord, Color), GetFaceArea(vertex[0].Position, vertex[3].Position));
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, false);
 }
 
 void GageGeneratorSubStyle(Float2 pos, float sizeY, float Gagenum,float subnum, char LRTU, Float4 Color)
 {
-	VERTEX_3D vertex[4];
+	VERTEX_3D vertex[4] = {};
 	SetTexture(NULL);
 
 	float height = sizeY / 2;
@@ -279,28 +320,28 @@ void GageGeneratorSubStyle(Float2 pos, float sizeY, float Gagenum,float subnum,
 	float right = -width;
 	float left = -width;
 
-	if (LRTU == 'L')//EɌ炷
+	if (LRTU == 'L')//右に減らす
 	{
 		left = (left * -1) - subnum;
 		right = width;
 		top = height;
 		under = height;
 	}
-	else if (LRTU == 'R')//Ɍ炷
+	else if (LRTU == 'R')//左に減らす
 	{
 		left = width;
 		right = (right * - 1) - subnum;
 		top = height;
 		under = height;
 	}
-	else if (LRTU == 'T')//Ɍ炷
+	else if (LRTU == 'T')//上に減らす
 	{
 		left = width;
 		right = width;
 		top = (top * -1) - subnum;
 		under = height;
 	}
-	else//Ɍ炷
+	else//下に減らす
 	{
 		left = width;
 		right = width;
@@ -318,16 +359,227 @@ void GageGeneratorSubStyle(Float2 pos, float sizeY, float Gagenum,float subnum,
 	vertex[2].Color = Color;
 	vertex[3].Color = Color;
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
+	SetFaceBlend(GetIsOpaqueFace(0, vertex[0].Texcord, vertex[3].Texcord, Color), GetFaceArea(vertex[0].Position, vertex[3].Position));
+
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, false);
+}
+
+void FaceGenAnim(Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color, DIR dir)
+{
+	VERTEX_ANIM vertex[4] = {};
+
+	float width = size.x / 2;
+	float height = size.y / 2;
+
+	//向きはFaceGenforTexと同じようにUVの角を入れ替える
+	int tl = dir == dir_left ? 2 : dir == dir_right ? 1 : dir == dir_under ? 3 : 0;
+	int tr = dir == dir_left ? 0 : dir == dir_right ? 3 : dir == dir_under ? 2 : 1;
+	int dl = dir == dir_left ? 3 : dir == dir_right ? 0 : dir == dir_under ? 1 : 2;
+	int dr = dir == dir_left ? 1 : dir == dir_right ? 2 : dir == dir_under ? 0 : 3;
+
+	Float2 texcord[4];
+	texcord[tl] = MakeFloat2(0, 0);
+	texcord[tr] = MakeFloat2(1, 0);
+	texcord[dl] = MakeFloat2(0, 1);
+	texcord[dr] = MakeFloat2(1, 1);
+
+	Float3 topLeft = MakeFloat3(pos.x - width, pos.y - height, 0.0f);
+	Float3 underRight = MakeFloat3(pos.x + width, pos.y + height, 0.0f);
+	PackVertex(&vertex[0].Pack, topLeft, color, texcord[0]);
+	PackVertex(&vertex[1].Pack, MakeFloat3(pos.x + width, pos.y - height, 0.0f), color, texcord[1]);
+	PackVertex(&vertex[2].Pack, MakeFloat3(pos.x - width, pos.y + height, 0.0f), color, texcord[2]);
+	PackVertex(&vertex[3].Pack, underRight, color, texcord[3]);
+
+	SetAnimVertex(vertex, 4, anim, anim->startTick);
+	SetAnimRedrawTick(vertex);
+
+	SetTexture(texid);
+	//どのコマになるかはシェーダーが決めるので、シート全体で見る
+	SetFaceBlend(GetIsOpaqueFace(texid, MakeFloat2(0, 0), MakeFloat2(1, 1), color), GetFaceArea(topLeft, underRight));
+	DrawAnimVertex(vertex, 4, GL_TRIANGLE_STRIP);
+}
+
+void FaceGenBatch(const Float2* pos, const int* startTick, int num, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color)
+{
+	SetTexture(texid);
+	bool IsOpaque = GetIsOpaqueFace(texid, MakeFloat2(0, 0), MakeFloat2(1, 1), color);
+
+	float width = size.x / 2;
+	float height = size.y / 2;
+
+	for (int start = 0; start < num; start += MAXBATCHFACE)
+	{
+		int facenum = num - start < MAXBATCHFACE ? num - start : MAXBATCHFACE;
+
+		//ストリップは繋げられないので三角形2枚ずつにする
+		float area = 0.0f;
+		for (int i = 0; i < facenum; i++)
+		{
+			Float2 p = pos[start + i];
+			VERTEX_ANIM* vertex = &g_BatchVertex[i * 6];
+
+			PackAnimQuad(vertex, p, size, color);
+			SetAnimVertex(vertex, 6, anim, startTick[start + i]);
+			SetAnimRedrawTick(vertex);
+
+			vertex[3] = vertex[2];
+			vertex[4] = vertex[1];
+
+			area += GetFaceArea(MakeFloat3(p.x - width, p.y - height, 0.0f), MakeFloat3(p.x + width, p.y + height, 0.0f));
+		}
+
+		SetFaceBlend(IsOpaque, area);
+		DrawAnimVertex(g_BatchVertex, facenum * 6, GL_TRIANGLES);
+	}
+}
+
+static void SetAnimVertex(VERTEX_ANIM* vertex, int num, const SPRITEANIM* anim, int startTick)
+{
+	for (int i = 0; i < num; i++)
+	{
+		vertex[i].StartTick = (float)startTick;
+		vertex[i].Anim[0] = (unsigned short)anim->frameNum;
+		vertex[i].Anim[1] = (unsigned short)anim->frameTime;
+		vertex[i].Anim[2] = anim->loop == animloop_once ? 1 : 0;
+		vertex[i].Anim[3] = 0;
+		vertex[i].Sheet[0] = (unsigned short)anim->sheetX;
+		vertex[i].Sheet[1] = (unsigned short)anim->sheetY;
+		vertex[i].Sheet[2] = (unsigned short)anim->firstFrame;
+		vertex[i].Sheet[3] = 0;
+	}
+}
+
+//コマが次に変わるtickを知らせる。シェーダーと同じ数え方。もう変わらなければ知らせない
+static void SetAnimRedrawTick(const VERTEX_ANIM* vertex)
+{
+	int startTick = (int)vertex->StartTick;
+	int frameNum = vertex->Anim[0];
+	int frameTime = vertex->Anim[1];
+	bool IsOnce = vertex->Anim[2] != 0;
+
+	if (frameNum <= 1 || frameTime <= 0)return;
+
+	int elapsed = g_SpriteTime - startTick;
+	if (elapsed < 0)elapsed = 0;
+
+	int next = elapsed / frameTime + 1;
+	if (IsOnce && next >= frameNum)return;
+
+	SetRedrawTick(startTick + next * frameTime);
+}
+
+//float の頂点を詰めて描く。プログラムはテクスチャを使うかで選ぶ
+static void DrawVertex(const VERTEX_3D* vertex, int num, GLenum mode, bool IsUseTex)
+{
+	VERTEX_PACK pack[MAXPACKVERTEX];
+	if (num > MAXPACKVERTEX)num = MAXPACKVERTEX;
+
+	for (int i = 0; i < num; i++)
+	{
+		PackVertex(&pack[i], vertex[i].Position, vertex[i].Color, IsUseTex ? vertex[i].Texcord : MakeFloat2(0, 0));
+	}
+
+	UseShaderProgram(IsUseTex ? shader_textured : shader_untextured);
+
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(VERTEX_PACK), (GLvoid*)pack->Position);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VERTEX_PACK), (GLvoid*)pack->Color);
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(VERTEX_PACK), (GLvoid*)pack->Texcord);
+
+	glDrawArrays(mode, 0, num);
+}
+
+static void PackVertex(VERTEX_PACK* pack, Float3 position, Float4 color, Float2 texcord)
+{
+	//範囲の外は端に寄せる。画面の外なので見えない
+	float x = fminf(fmaxf(position.x * VERTEX_POSITIONSCALE, -32767.0f), 32767.0f);
+	float y = fminf(fmaxf(position.y * VERTEX_POSITIONSCALE, -32767.0f), 32767.0f);
+	pack->Position[0] = (short)(x < 0.0f ? x - 0.5f : x + 0.5f);
+	pack->Position[1] = (short)(y < 0.0f ? y - 0.5f : y + 0.5f);
+
+	pack->Color[0] = (unsigned char)(fminf(fmaxf(color.x, 0.0f), 1.0f) * 255.0f + 0.5f);
+	pack->Color[1] = (unsigned char)(fminf(fmaxf(color.y, 0.0f), 1.0f) * 255.0f + 0.5f);
+	pack->Color[2] = (unsigned char)(fminf(fmaxf(color.z, 0.0f), 1.0f) * 255.0f + 0.5f);
+	pack->Color[3] = (unsigned char)(fminf(fmaxf(color.w, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+	PackTexcord(pack->Texcord, texcord);
+}
+
+static void PackTexcord(unsigned short* pack, Float2 texcord)
+{
+	pack[0] = (unsigned short)(fminf(fmaxf(texcord.x, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	pack[1] = (unsigned short)(fminf(fmaxf(texcord.y, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+//三角形2枚の四角形の0,1,2,5に位置と色とコマのなかのUVを入れる。3と4は呼んだ方でコピーする
+static void PackAnimQuad(VERTEX_ANIM* vertex, Float2 pos, Float2 size, Float4 color)
+{
+	float width = size.x / 2;
+	float height = size.y / 2;
+
+	PackVertex(&vertex[0].Pack, MakeFloat3(pos.x - width, pos.y - height, 0.0f), color, MakeFloat2(0, 0));
+	PackVertex(&vertex[1].Pack, MakeFloat3(pos.x + width, pos.y - height, 0.0f), color, MakeFloat2(1, 0));
+	PackVertex(&vertex[2].Pack, MakeFloat3(pos.x - width, pos.y + height, 0.0f), color, MakeFloat2(0, 1));
+	PackVertex(&vertex[5].Pack, MakeFloat3(pos.x + width, pos.y + height, 0.0f), color, MakeFloat2(1, 1));
+}
+
+static void DrawAnimVertex(const VERTEX_ANIM* vertex, int num, GLenum mode)
+{
+	UseShaderProgram(shader_anim);
+	BeginAnimVertex(vertex);
+	glDrawArrays(mode, 0, num);
+	EndAnimVertex();
+}
+
+//アニメーションの属性は描画する間だけ配列にする。アニメーションしないプログラムは3～5を読まない
+static void BeginAnimVertex(const VERTEX_ANIM* vertex)
+{
+	glEnableVertexAttribArray(3);
+	glEnableVertexAttribArray(4);
+	glEnableVertexAttribArray(5);
+
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(VERTEX_ANIM), (GLvoid*)vertex->Pack.Position);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(VERTEX_ANIM), (GLvoid*)vertex->Pack.Color);
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(VERTEX_ANIM), (GLvoid*)vertex->Pack.Texcord);
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(VERTEX_ANIM), (GLvoid*)&vertex->StartTick);
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(VERTEX_ANIM), (GLvoid*)vertex->Anim);
+	glVertexAttribPointer(5, 4, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(VERTEX_ANIM), (GLvoid*)vertex->Sheet);
+}
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+static void EndAnimVertex(void)
+{
+	glDisableVertexAttribArray(3);
+	glDisableVertexAttribArray(4);
+	glDisableVertexAttribArray(5);
+}
+
+void FaceGenFrameTex(UINT texid, Float4 color)
+{
+	VERTEX_3D vertex[4] = {};
+
+	vertex[0].Position = MakeFloat3(-SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2, 0.0f);
+	vertex[1].Position = MakeFloat3(SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2, 0.0f);
+	vertex[2].Position = MakeFloat3(-SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 0.0f);
+	vertex[3].Position = MakeFloat3(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 0.0f);
+
+	vertex[0].Texcord = MakeFloat2(0, 1);
+	vertex[1].Texcord = MakeFloat2(1, 1);
+	vertex[2].Texcord = MakeFloat2(0, 0);
+	vertex[3].Texcord = MakeFloat2(1, 0);
+
+	for (int i = 0; i < 4; i++)
+	{
+		vertex[i].Color = color;
+	}
+
+	SetTexture(texid);
+	SetFaceBlend(GetIsOpaqueFace(texid, MakeFloat2(0, 0), MakeFloat2(1, 1), color), (float)(SCREEN_WIDTH * SCREEN_HEIGHT));
+
+	DrawVertex(vertex, 4, GL_TRIANGLE_STRIP, true);
 }
 
 void LineGenerator(Float2 StartPos, Float2 EndPos,Float4 Color)
 {
-	VERTEX_3D vertex[2];
+	VERTEX_3D vertex[2] = {};
 	SetTexture(NULL);
 
 	vertex[0].Position = MakeFloat3(StartPos.x, StartPos.y, 0.0f);
@@ -336,11 +588,10 @@ void LineGenerator(Float2 StartPos, Float2 EndPos,Float4 Color)
 	vertex[0].Color = Color;
 	vertex[1].Color = Color;
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&vertex->Texcord);
+	//線は面積に入れない
+	SetFaceBlend(Color.w >= 1.0f, 0.0f);
 
-	glDrawArrays(GL_LINE_STRIP, 0, 2);
+	DrawVertex(vertex, 2, GL_LINE_STRIP, false);
 }
 
 void CercleGen(Float2 pos, float R, Float4 color)
@@ -362,11 +613,9 @@ void CercleGen(Float2 pos, float R, Float4 color)
 		cube[i].Color = color;
 	}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&cube->Position);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&cube->Color);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX_3D), (GLvoid*)&cube->Texcord);
+	SetFaceBlend(color.w >= 1.0f, PI * R * R);
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, N);
+	DrawVertex(cube, N, GL_TRIANGLE_FAN, false);
 }
 
 void TextGen(Float2 pos, Float2 size, Float4 color, const char* text)
@@ -377,42 +626,231 @@ void TextGen(Float2 pos, Float2 size, Float4 color, const char* text)
 	{
 		Float2 nextpos = MakeFloat2(pos.x + size.x * i - startposX, pos.y);
 
-		if (*text >= '0' && *text <= '9')
-		{
-			FaceGenforTex(nextpos, size, *text - '0', 0, 10, 4, true, g_TextTex, color);
-		}
-		else if((*text >= 'A' && *text <= 'Z') || (*text >= 'a' && *text <= 'z'))
+		int frameX, frameY;
+		if (GetTextFrame(*text, &frameX, &frameY))
 		{
-			char c = *text <= 'Z' ? *text - 'A' : *text - 'a';
-			FaceGenforTex(nextpos, size, c % 10, (c / 10) + 1, 10, 4, true, g_TextTex, color);
-		}
-		else
-		{
-			switch (*text)
-			{
-			case '!':
-				FaceGenforTex(nextpos, size,
-					6, 3, 10, 4, true, g_TextTex, color);
-				break;
-			case '/':
-				FaceGenforTex(nextpos, size,
-					7, 3, 10, 4, true, g_TextTex, color);
-				break;
-			case '-':
-				FaceGenforTex(nextpos, size,
-					8, 3, 10, 4, true, g_TextTex, color);
-				break;
-			case ';':
-				FaceGenforTex(nextpos, size,
-					9, 3, 10, 4, true, g_TextTex, color);
-				break;
-			}
+			FaceGenforTex(nextpos, size, frameX, frameY, 10, 4, true, g_TextTex, color);
 		}
 	}
 }
 
+//text.tgaのどのコマか。ない文字ならfalse
+static bool GetTextFrame(char c, int* frameX, int* frameY)
+{
+	if (c >= '0' && c <= '9')
+	{
+		*frameX = c - '0';
+		*frameY = 0;
+		return true;
+	}
+	if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+	{
+		int n = c <= 'Z' ? c - 'A' : c - 'a';
+		*frameX = n % 10;
+		*frameY = (n / 10) + 1;
+		return true;
+	}
+
+	*frameY = 3;
+	switch (c)
+	{
+	case '!': *frameX = 6; return true;
+	case '/': *frameX = 7; return true;
+	case '-': *frameX = 8; return true;
+	case ';': *frameX = 9; return true;
+	}
+	return false;
+}
+
+//=================================
+//作っておくバッチ
+//=================================
+void ClearFaceBatch(FACEBATCH* batch)
+{
+	batch->faceNum = 0;
+	batch->runNum = 0;
+}
+
+void AddFaceBatch(FACEBATCH* batch, Float2 pos, Float2 size, int frameX, int frameY, int MAXframeX, int MAXframeY, UINT texid, Float4 color)
+{
+	float texcutsizex = (1.0f / MAXframeX);
+	float texcutsizey = (1.0f / MAXframeY);
+	float texX = texcutsizex * frameX;
+	float texY = texcutsizey * frameY;
+
+	bool IsOpaque = GetIsOpaqueFace(texid, MakeFloat2(texX, texY), MakeFloat2(texX + texcutsizex, texY + texcutsizey), color);
+	VERTEX_ANIM* vertex = AddFaceBatchVertex(batch, pos, size, texid, color, IsOpaque);
+	if (vertex == NULL)return;
+
+	PackTexcord(vertex[0].Pack.Texcord, MakeFloat2(texX, texY));
+	PackTexcord(vertex[1].Pack.Texcord, MakeFloat2(texX + texcutsizex, texY));
+	PackTexcord(vertex[2].Pack.Texcord, MakeFloat2(texX, texY + texcutsizey));
+	PackTexcord(vertex[5].Pack.Texcord, MakeFloat2(texX + texcutsizex, texY + texcutsizey));
+	vertex[3] = vertex[2];
+	vertex[4] = vertex[1];
+}
+
+void AddFaceBatchAnim(FACEBATCH* batch, Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color)
+{
+	bool IsOpaque = GetIsOpaqueFace(texid, MakeFloat2(0, 0), MakeFloat2(1, 1), color);
+	VERTEX_ANIM* vertex = AddFaceBatchVertex(batch, pos, size, texid, color, IsOpaque);
+	if (vertex == NULL)return;
+
+	SetAnimVertex(vertex, 6, anim, anim->startTick);
+	vertex[3] = vertex[2];
+	vertex[4] = vertex[1];
+}
+
+void AddTextBatch(FACEBATCH* batch, Float2 pos, Float2 size, Float4 color, const char* text)
+{
+	float startposX = (size.x * strlen(text)) / 2 - size.x / 2;
+
+	for (int i = 0; *text; text++, i++)
+	{
+		int frameX, frameY;
+		if (!GetTextFrame(*text, &frameX, &frameY))continue;
+
+		AddFaceBatch(batch, MakeFloat2(pos.x + size.x * i - startposX, pos.y), size, frameX, frameY, 10, 4, g_TextTex, color);
+	}
+}
+
+void DrawFaceBatch(const FACEBATCH* batch)
+{
+	if (batch->faceNum == 0)return;
+
+	//アニメーションしない四角形はframeNumが0なので何もしない
+	for (int i = 0; i < batch->faceNum; i++)
+	{
+		SetAnimRedrawTick(&batch->vertex[i * 6]);
+	}
+
+	BeginAnimVertex(batch->vertex);
+	for (int i = 0; i < batch->runNum; i++)
+	{
+		const FACEBATCHRUN* run = &batch->run[i];
+		SetTexture(run->texture);
+		//テクスチャのない所はアニメーションもしない
+		UseShaderProgram(run->texture != 0 ? shader_anim : shader_untextured);
+		SetFaceBlend(run->IsOpaque, run->area);
+		glDrawArrays(GL_TRIANGLES, run->first * 6, run->num * 6);
+	}
+	EndAnimVertex();
+}
+
+//四角形を1枚足して、位置と色とアニメーションなしを入れる。UVは呼んだ方で入れる
+static VERTEX_ANIM* AddFaceBatchVertex(FACEBATCH* batch, Float2 pos, Float2 size, UINT texid, Float4 color, bool IsOpaque)
+{
+	if (batch->faceNum >= FACEBATCH_MAXFACE)return NULL;
+
+	FACEBATCHRUN* run = batch->runNum > 0 ? &batch->run[batch->runNum - 1] : NULL;
+
+	//テクスチャかブレンドが変わる所で区切る
+	if (run == NULL || run->texture != texid || run->IsOpaque != IsOpaque)
+	{
+		if (batch->runNum >= FACEBATCH_MAXRUN)return NULL;
+		run = &batch->run[batch->runNum++];
+		run->texture = texid;
+		run->first = batch->faceNum;
+		run->num = 0;
+		run->IsOpaque = IsOpaque;
+		run->area = 0.0f;
+	}
+
+	VERTEX_ANIM* vertex = &batch->vertex[batch->faceNum * 6];
+	batch->faceNum++;
+	run->num++;
+
+	float width = size.x / 2;
+	float height = size.y / 2;
+	run->area += GetFaceArea(MakeFloat3(pos.x - width, pos.y - height, 0.0f), MakeFloat3(pos.x + width, pos.y + height, 0.0f));
+
+	//アニメーションなしは1コマだけのシート
+	SPRITEANIM still = MakeSpriteAnim(0, 1, 1, 1, 1, animloop_loop, 0);
+	PackAnimQuad(vertex, pos, size, color);
+	SetAnimVertex(vertex, 6, &still, 0);
+	return vertex;
+}
+
+//=================================
+//ブレンドと塗った面積
+//=================================
+void FaceGenFillFrame(void)
+{
+	if (g_Fill.opaqueArea > 0.0f || g_Fill.blendArea > 0.0f)
+	{
+		g_LastFill = g_Fill;
+		g_TotalFill.opaqueArea += g_Fill.opaqueArea;
+		g_TotalFill.blendArea += g_Fill.blendArea;
+		g_TotalFill.blendSwitchNum += g_Fill.blendSwitchNum;
+		g_FillFrameNum++;
+	}
+
+	g_Fill.opaqueArea = 0.0f;
+	g_Fill.blendArea = 0.0f;
+	g_Fill.blendSwitchNum = 0;
+}
+
+const FACEGENFILL* GetFaceGenFill(void)
+{
+	return &g_LastFill;
+}
+
+void ResetFaceGenBlend(void)
+{
+	glEnable(GL_BLEND);
+	g_IsBlend = true;
+}
+
+//ブレンドしなくても同じ色になるか。texidが0ならテクスチャなし。uvは対角の2つの角
+static bool GetIsOpaqueFace(UINT texid, Float2 uv0, Float2 uv1, Float4 color)
+{
+	if (color.w < 1.0f)return false;
+	if (texid == 0)return true;
+
+	return GetTextureOpacity(texid, uv0.x, uv0.y, uv1.x, uv1.y) == texopacity_opaque;
+}
+
+//対角の2つの角から、画面に入っている所の面積
+static float GetFaceArea(Float3 pos0, Float3 pos1)
+{
+	float left = fmaxf(fminf(pos0.x, pos1.x), -SCREEN_WIDTH / 2);
+	float right = fminf(fmaxf(pos0.x, pos1.x), SCREEN_WIDTH / 2);
+	float top = fmaxf(fminf(pos0.y, pos1.y), -SCREEN_HEIGHT / 2);
+	float under = fminf(fmaxf(pos0.y, pos1.y), SCREEN_HEIGHT / 2);
+
+	if (right <= left || under <= top)return 0.0f;
+	return (right - left) * (under - top);
+}
+
+//描く前に呼ぶ。GL_BLENDは変わる時だけ切り替える
+static void SetFaceBlend(bool IsOpaque, float area)
+{
+	if (IsOpaque == g_IsBlend)
+	{
+		IsOpaque ? glDisable(GL_BLEND) : glEnable(GL_BLEND);
+		g_IsBlend = !IsOpaque;
+		g_Fill.blendSwitchNum++;
+	}
+
+	if (IsOpaque)
+	{
+		g_Fill.opaqueArea += area;
+	}
+	else
+	{
+		g_Fill.blendArea += area;
+	}
+}
+
 void FacegenUNINIT(void)
 {
 	UnloadTexture(g_TextTex);
 	g_TextTex = NULL;
+
+	if (g_FillFrameNum > 0)
+	{
+		float screen = (float)(SCREEN_WIDTH * SCREEN_HEIGHT) * g_FillFrameNum;
+		NN_LOG("FaceGen: per frame opaque %.2f blend %.2f screens, %d blend switches\n",
+			g_TotalFill.opaqueArea / screen, g_TotalFill.blendArea / screen, g_TotalFill.blendSwitchNum / g_FillFrameNum);
+	}
 }
\ No newline at end of file
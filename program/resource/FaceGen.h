@@ -4,6 +4,44 @@
 #include "main.h"
 #include "Mytype.h"
 
+enum ANIMLOOP
+{
+	animloop_loop,	//最後のコマの次は最初に戻る
+	animloop_once,	//最後のコマで止まる
+};
+
+#define FACEBATCH_MAXFACE (128)	//作っておくバッチの四角形の数
+#define FACEBATCH_MAXRUN (32)	//テクスチャかブレンドを切り替える数
+
+//GPUに渡す頂点。12バイト。位置は1/VERTEX_POSITIONSCALEドット、色とUVは0～1を整数にしたもの
+struct VERTEX_PACK
+{
+	short Position[2];
+	unsigned char Color[4];
+	unsigned short Texcord[2];
+};
+
+//シェーダーでコマを決める頂点。TexcordはコマのなかのUV(0～1)
+struct VERTEX_ANIM
+{
+	VERTEX_PACK Pack;
+	float StartTick;
+	unsigned short Anim[4];//コマ数(アニメーションしないなら1), 1コマのtick, 1回だけなら1
+	unsigned short Sheet[4];//シートの横の分割数, 縦の分割数, 最初のコマ
+};
+
+//シートのアニメーション。コマはシェーダーがtickから決めるので、毎フレーム更新しなくていい
+typedef struct
+{
+	int startTick;//GetSpriteTime()で始めた時間。ずっとループするなら0でいい
+	int firstFrame;//シートの左上から横に数えて何コマ目から始めるか
+	int frameNum;
+	int frameTime;//1コマのtick
+	int sheetX;//シートの分割数
+	int sheetY;
+	ANIMLOOP loop;
+}SPRITEANIM;
+
 void FaceGen(Float2 pos, Float2 size, int frame, int MAXFRAMEX, int MAXFRAMEY, bool IsUseTex, unsigned int textureID, char MODE, Float4 Color);
 
 void CercleGen(Float2 pos, float R, Float4 color);
@@ -12,14 +50,71 @@ void GageGenerator(Float2 pos, Float2 size, float Gagenum, char LRTU, Float4 Col
 
 void FaceGenforTex(Float2 pos, Float2 size, int frameX, int frameY, int MAXframeX, int MAXframeY, bool IsUseTex, UINT texid,Float4 color);
 
+SPRITEANIM MakeSpriteAnim(int firstFrame, int frameNum, int frameTime, int sheetX, int sheetY, ANIMLOOP loop, int startTick);
+
+//アニメーションするスプライト。向きはFaceGenforTexと同じ
+void FaceGenAnim(Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color, DIR dir);
+
+//同じ大きさ、同じアニメーションの四角形をまとめて描画する。開始tickだけ一つずつ変えられる
+void FaceGenBatch(const Float2* pos, const int* startTick, int num, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color);
+
+//同じテクスチャとブレンドが続く所。1回のglDrawArraysで描く
+typedef struct
+{
+	UINT texture;
+	int first;
+	int num;
+	bool IsOpaque;//ブレンドしないで描く
+	float area;//塗る面積
+}FACEBATCHRUN;
+
+//一度作っておいて毎フレームそのまま描く四角形の集まり。足した順に描く
+typedef struct
+{
+	VERTEX_ANIM vertex[FACEBATCH_MAXFACE * 6];
+	FACEBATCHRUN run[FACEBATCH_MAXRUN];
+	int faceNum;
+	int runNum;
+}FACEBATCH;
+
+void ClearFaceBatch(FACEBATCH* batch);
+//FaceGenforTexと同じ。入らなければ足さない
+void AddFaceBatch(FACEBATCH* batch, Float2 pos, Float2 size, int frameX, int frameY, int MAXframeX, int MAXframeY, UINT texid, Float4 color);
+void AddFaceBatchAnim(FACEBATCH* batch, Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texid, Float4 color);
+//TextGenと同じ
+void AddTextBatch(FACEBATCH* batch, Float2 pos, Float2 size, Float4 color, const char* text);
+void DrawFaceBatch(const FACEBATCH* batch);
+
 void LineGenerator(Float2 StartPos, Float2 EndPos, Float4 Color);
 
+//フレームバッファから作ったテクスチャを画面いっぱいに描く。下の行から入っているので上下を返す
+void FaceGenFrameTex(UINT texid, Float4 color);
+
 void FaceGenforTex(Float2 pos, Float2 size, int frameX, int frameY, int MAXframeX, int MAXframeY, bool IsUseTex, UINT texid, Float4 color, DIR dir);
 
 void FacegenUNINIT(void);
 
 void FacegenINIT(void);
 
+//アニメーションのtickを進める。ゲームが進んだフレームだけ呼ぶ
+void FacegenUPDATE(void);
+
+//1フレームに塗った面積。画面の面積で割ると何回塗り重ねたか
+typedef struct
+{
+	float opaqueArea;//ブレンドしないで描いた
+	float blendArea;//ブレンドして描いた。読んでから書くので高い
+	int blendSwitchNum;//ブレンドを切り替えた回数
+}FACEGENFILL;
+
+//描くフレームの最初に呼ぶ。前に描いたフレームの分をGetFaceGenFillで見られるようにする
+void FaceGenFillFrame(void);
+const FACEGENFILL* GetFaceGenFill(void);
+//FaceGenの外でGL_BLENDを変えた後に呼ぶ。ブレンドありに戻す
+void ResetFaceGenBlend(void);
+
+int GetSpriteTime(void);
+
 void TextGen(Float2 pos, Float2 size, Float4 color, const char* text);
 
 void GageGeneratorSubStyle(Float2 pos, float sizeY, float Gagenum, float subnum, char LRTU, Float4 Color);
@@ -0,0 +1,190 @@
+//=================================
+//
+//フレームヒープ
+//
+//1フレームだけ使うデータを先頭から詰めて取り、フレームの区切りでまとめて返す。
+//スレッドごとに持つので、取る時にロックしない。
+//メインスレッドはフレームの最初、ジョブのワーカーはジョブを一つ終えるたびに戻す。
+//
+//=================================
+
+#include"FrameHeap.h"
+#include"MemoryLedger.h"
+#include"Job.h"
+
+#include<stdarg.h>
+
+//入らなかった分はヒープから取り、つないでおく
+typedef struct FRAMEHEAPOVERFLOW
+{
+	struct FRAMEHEAPOVERFLOW* next;
+}FRAMEHEAPOVERFLOW;
+
+static void FreeOverflow(FRAMEHEAP* heap, void* until);
+
+static thread_local FRAMEHEAP* g_ThreadHeap;
+
+void InitFrameHeap(FRAMEHEAP* heap, void* start, size_t size)
+{
+	heap->start = (unsigned char*)start;
+	heap->size = size;
+	heap->head = 0;
+	heap->tail = size;
+	heap->peak = 0;
+	heap->overflowNum = 0;
+	heap->overflow = NULL;
+}
+
+void* AllocateFromFrameHeap(FRAMEHEAP* heap, size_t size, int alignment)
+{
+	size_t align = alignment < 0 ? (size_t)-alignment : (size_t)alignment;
+	size_t base = (size_t)heap->start;
+	size_t begin;
+
+	if (align == 0)align = FRAMEHEAP_ALIGNMENT;
+	if (size > heap->tail - heap->head)return NULL;
+
+	if (alignment >= 0)
+	{
+		begin = ((base + heap->head + align - 1) & ~(align - 1)) - base;
+		if (begin + size > heap->tail)return NULL;
+		heap->head = begin + size;
+	}
+	else
+	{
+		size_t end = (base + heap->tail - size) & ~(align - 1);
+		if (end < base + heap->head)return NULL;
+		begin = end - base;
+		heap->tail = begin;
+	}
+
+	if (heap->head + heap->size - heap->tail > heap->peak)
+	{
+		heap->peak = heap->head + heap->size - heap->tail;
+	}
+	return heap->start + begin;
+}
+
+void FreeToFrameHeap(FRAMEHEAP* heap, int mode)
+{
+	if (mode & frameheap_freehead)heap->head = 0;
+	if (mode & frameheap_freetail)heap->tail = heap->size;
+
+	//どちらから取った分か分からないので、全部返す時だけ消す
+	if (mode == frameheap_freeall)FreeOverflow(heap, NULL);
+}
+
+size_t GetFrameHeapAllocatableSize(const FRAMEHEAP* heap, int alignment)
+{
+	size_t align = alignment < 0 ? (size_t)-alignment : (size_t)alignment;
+	size_t base = (size_t)heap->start;
+	if (align == 0)align = FRAMEHEAP_ALIGNMENT;
+
+	size_t begin = ((base + heap->head + align - 1) & ~(align - 1)) - base;
+
+	return begin < heap->tail ? heap->tail - begin : 0;
+}
+
+FRAMEHEAPSTATE GetFrameHeapState(const FRAMEHEAP* heap)
+{
+	FRAMEHEAPSTATE state;
+	state.head = heap->head;
+	state.tail = heap->tail;
+	state.overflow = heap->overflow;
+	return state;
+}
+
+void RestoreFrameHeapState(FRAMEHEAP* heap, const FRAMEHEAPSTATE* state)
+{
+	heap->head = state->head;
+	heap->tail = state->tail;
+	FreeOverflow(heap, state->overflow);
+}
+
+void CreateThreadFrameHeap(size_t size)
+{
+	if (g_ThreadHeap != NULL)return;
+
+	g_ThreadHeap = new FRAMEHEAP;
+	InitFrameHeap(g_ThreadHeap, new unsigned char[size], size);
+
+	RegisterLedger(ledger_buffer, (uintptr_t)g_ThreadHeap, size, __FILE__, GetJobWorkerIndex() < 0 ? "main frame heap" : "worker frame heap");
+}
+
+void DestroyThreadFrameHeap(void)
+{
+	if (g_ThreadHeap == NULL)return;
+
+	UnregisterLedger(ledger_buffer, (uintptr_t)g_ThreadHeap);
+
+	FreeToFrameHeap(g_ThreadHeap, frameheap_freeall);
+	delete[] g_ThreadHeap->start;
+	delete g_ThreadHeap;
+	g_ThreadHeap = NULL;
+}
+
+void ResetThreadFrameHeap(void)
+{
+	if (g_ThreadHeap == NULL)return;
+
+	FreeToFrameHeap(g_ThreadHeap, frameheap_freeall);
+}
+
+const FRAMEHEAP* GetThreadFrameHeap(void)
+{
+	return g_ThreadHeap;
+}
+
+void* AllocScratch(size_t size)
+{
+	NN_ASSERT(g_ThreadHeap != NULL, "AllocScratch: CreateThreadFrameHeap has not been called\n");
+
+	void* p = AllocateFromFrameHeap(g_ThreadHeap, size, FRAMEHEAP_ALIGNMENT);
+	if (p != NULL)return p;
+
+	//入らなかった。ヘッダーの後ろを渡す
+	FRAMEHEAPOVERFLOW* block = (FRAMEHEAPOVERFLOW*)new unsigned char[FRAMEHEAP_ALIGNMENT + size];
+	block->next = (FRAMEHEAPOVERFLOW*)g_ThreadHeap->overflow;
+	g_ThreadHeap->overflow = block;
+	g_ThreadHeap->overflowNum++;
+
+	return (unsigned char*)block + FRAMEHEAP_ALIGNMENT;
+}
+
+const char* FormatScratch(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if (length < 0)length = 0;
+
+	char* text = (char*)AllocScratch(length + 1);
+	va_start(args, format);
+	vsnprintf(text, length + 1, format, args);
+	va_end(args);
+
+	return text;
+}
+
+FRAMEHEAPSTATE GetScratchState(void)
+{
+	return GetFrameHeapState(g_ThreadHeap);
+}
+
+void RestoreScratch(const FRAMEHEAPSTATE* state)
+{
+	RestoreFrameHeapState(g_ThreadHeap, state);
+}
+
+//untilより後にヒープから取ったものを消す
+static void FreeOverflow(FRAMEHEAP* heap, void* until)
+{
+	while (heap->overflow != until && heap->overflow != NULL)
+	{
+		FRAMEHEAPOVERFLOW* block = (FRAMEHEAPOVERFLOW*)heap->overflow;
+		heap->overflow = block->next;
+		delete[] (unsigned char*)block;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef FRAMEHEAP_H_
+#define FRAMEHEAP_H_
+
+#include"main.h"
+
+#define FRAMEHEAP_MAINSIZE (16 * 1024 * 1024)	//メインスレッド。テクスチャを読む時の画像も入る
+#define FRAMEHEAP_WORKERSIZE (1024 * 1024)		//ジョブのワーカー
+#define FRAMEHEAP_ALIGNMENT (16)
+
+//nn::lmemのFrameHeapと同じで、前からも後ろからも取れて、返す時はまとめて返す
+enum FRAMEHEAPFREE
+{
+	frameheap_freehead = 1,
+	frameheap_freetail = 2,
+	frameheap_freeall = frameheap_freehead | frameheap_freetail,
+};
+
+typedef struct
+{
+	unsigned char* start;
+	size_t size;
+	size_t head;//前から取った所の終わり
+	size_t tail;//後ろから取った所の始まり
+	size_t peak;//一番多く使った量
+	int overflowNum;//入らずにヒープから取った数
+	void* overflow;//入らずにヒープから取ったもの。戻す時に一緒に消す
+}FRAMEHEAP;
+
+typedef struct
+{
+	size_t head;
+	size_t tail;
+	void* overflow;
+}FRAMEHEAPSTATE;
+
+void InitFrameHeap(FRAMEHEAP* heap, void* start, size_t size);
+//alignmentが負なら後ろから取る。入らなければNULL
+void* AllocateFromFrameHeap(FRAMEHEAP* heap, size_t size, int alignment);
+void FreeToFrameHeap(FRAMEHEAP* heap, int mode);
+size_t GetFrameHeapAllocatableSize(const FRAMEHEAP* heap, int alignment);
+FRAMEHEAPSTATE GetFrameHeapState(const FRAMEHEAP* heap);
+//stateを取った後に取ったものを全部返す
+void RestoreFrameHeapState(FRAMEHEAP* heap, const FRAMEHEAPSTATE* state);
+
+//スレッドごとのフレームヒープ。スクラッチを使うスレッドは最初に作る
+void CreateThreadFrameHeap(size_t size);
+void DestroyThreadFrameHeap(void);
+//フレームの区切りで呼ぶ。それまでのスクラッチは全部使えなくなる
+void ResetThreadFrameHeap(void);
+const FRAMEHEAP* GetThreadFrameHeap(void);
+
+//このスレッドのフレームヒープから取る。入らなければヒープから取って、戻す時に一緒に消す。NULLは返さない
+void* AllocScratch(size_t size);
+//書式を付けた文字列をスクラッチに作る。次のリセットまで使える
+const char* FormatScratch(const char* format, ...);
+//フレームの途中で使い終わったスクラッチを返す時に使う
+FRAMEHEAPSTATE GetScratchState(void);
+void RestoreScratch(const FRAMEHEAPSTATE* state);
+
+#endif
\ No newline at end of file
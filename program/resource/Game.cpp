@@ -1,6 +1,7 @@
 
 #include"main.h"
 #include"Scene.h"
+#include"Game.h"
 #include"StageMaker.h"
 #include"Ball.h"
 #include"Effect.h"
@@ -10,16 +11,12 @@
 #include"paint.h"
 #include"sound.h"
 #include"Background.h"
-
-static enum GAMEKEY
-{
-	gamekey_w,
-	gamekey_s,
-	gamekey_enter,
-	gamekey_tab,
-
-	GAMEKEYMAX,
-};
+#include"Preview.h"
+#include"Camera.h"
+#include"Input.h"
+#include"Widget.h"
+#include"Layer.h"
+#include"Redraw.h"
 
 static enum GAMEBOTTUN
 {
@@ -30,189 +27,119 @@ static enum GAMEBOTTUN
 	GAMEBOTTUNMAX,
 };
 
-static bool g_IsTouch_game[GAMEKEYMAX] = {};
-static GAMEBOTTUN g_CurrentBottun;
 static UINT g_BottunTex;
 static UINT g_FrameTex;
 static UINT g_BottunDispTex;
-static bool g_IsFirst;
+static WIDGETSCREEN g_UI;
+static int g_BottunList;
+static int g_Bottun[GAMEBOTTUNMAX];
+static GAMESTATE g_StartState;//GameINITの直後
+static LAYER g_StageLayer;//背景と動かないブロック
 
 void GameINIT(void)
 {
 	StageBlockINIT();
 	BallINIT();
+	CameraINIT();
+	PreviewINIT();
 	EffectINIT();
 	PaintINIT();
 	backgroundINIT();
-
-	memset(g_IsTouch_game, false, sizeof(g_IsTouch_game));
-
-	g_CurrentBottun = gamebottun_next;
-	g_IsFirst = false;
+	InitLayer(&g_StageLayer, "stage layer");
 
 	g_BottunTex = LoadTexture("asset/bottun.tga");
 	g_FrameTex = LoadTexture("asset/Frame.tga");
 	g_BottunDispTex = LoadTexture("asset/DispKey.tga");
+
+	//クリア、ゲームオーバーの時のボタン
+	InitWidgetScreen(&g_UI);
+	g_BottunList = AddListWidget(&g_UI, MakeFloat2(512, 128), g_FrameTex);
+
+	//次へ、もう一度、終了
+	static const int bottunFrame[GAMEBOTTUNMAX] = { 2, 3, 1 };
+	for (int i = 0; i < GAMEBOTTUNMAX; i++)
+	{
+		g_Bottun[i] = AddButtonWidget(&g_UI, MakeFloat2(0, 128 * (i + 1) + 32), MakeFloat2(512, 128), g_BottunTex, 0, bottunFrame[i], 1, 4);
+		AddListItem(&g_UI, g_BottunList, g_Bottun[i]);
+	}
+
+	//決定キー
+	int alpha = GetCurrentStage() < STAGEMAX - 1 ? 3 : 1;
+	AddImageWidget(&g_UI, MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
+		g_BottunDispTex, 0, alpha, 1, 4, NORMALCOLOR);
+	SetWidgetScreenVisible(&g_UI, false);
+
+	GetGameState(&g_StartState);
 }
 
 void GameUPDATE(void)
 {
 	StageBlockUPDATE();
 	BallUPDATE();
+	CameraUPDATE();
+	PreviewUPDATE();
 	EffectUPDATE();
 	PaintUPDATE();
 
-	if (GetIsGameover())
-	{
-		if (!g_IsFirst)
-		{
-			if (g_CurrentBottun == gamebottun_next)
-			{
-				g_CurrentBottun = gamebottun_replay;
-			}
-			g_IsFirst = true;
-		}
-	}
-
-	//NAĂ{^
-	if (GetIsClear() || GetIsGameover())
-	{
-		if (GetKeyState('W') & 0x80)
-		{
-			if (!g_IsTouch_game[gamekey_w])
-			{
-				PlaySE(SE_FINGER);
-
-				g_CurrentBottun = (GAMEBOTTUN)((g_CurrentBottun - 1));
+	//ボールとパーティクルは毎フレーム動く
+	if (GetIsBallMoving() || GetIsEffectActive())RequestRedraw();
 
-				if (GetIsClear())
-				{
-					if (g_CurrentBottun < gamebottun_next)
-					{
-						g_CurrentBottun = gamebottun_end;
-					}
-				}
-
-				if (GetIsGameover())
-				{
-					if (g_CurrentBottun < gamebottun_replay)
-					{
-						g_CurrentBottun = gamebottun_end;
-					}
-				}
+	//クリアかゲームオーバーならボタン操作。ゲームオーバーでは次へを出さない
+	bool IsEnd = GetIsClear() || GetIsGameover();
+	SetWidgetScreenVisible(&g_UI, IsEnd);
 
+	if (IsEnd)
+	{
+		SetWidgetVisible(&g_UI, g_Bottun[gamebottun_next], GetIsClear());
 
-				g_IsTouch_game[gamekey_w] = true;
-			}
-		}
-		else
+		int decide = UpdateWidgetList(&g_UI, g_BottunList, action_launch);
+		if (decide >= 0)
 		{
-			g_IsTouch_game[gamekey_w] = false;
-		}
+			PlaySE(SE_POP);
 
-		if (GetKeyState('S') & 0x80)
-		{
-			if (!g_IsTouch_game[gamekey_s])
+			if (decide == gamebottun_next)
 			{
-				PlaySE(SE_FINGER);
-
-				g_CurrentBottun = (GAMEBOTTUN)((g_CurrentBottun + 1));
-
-				if (GetIsClear())
-				{
-					if (g_CurrentBottun > gamebottun_end)
-					{
-						g_CurrentBottun = gamebottun_next;
-					}
-				}
-
-				if (GetIsGameover())
-				{
-					if (g_CurrentBottun > gamebottun_end)
-					{
-						g_CurrentBottun = gamebottun_replay;
-					}
-				}
-
-				g_IsTouch_game[gamekey_s] = true;
+				SetNextStage(scene_result);
 			}
-		}
-		else
-		{
-			g_IsTouch_game[gamekey_s] = false;
-		}
-
-		if (GetKeyState(VK_RETURN) & 0x80)
-		{
-			if (!g_IsTouch_game[gamekey_enter])
+			else if (decide == gamebottun_replay)
 			{
-				PlaySE(SE_POP);
-
-				if (g_CurrentBottun == gamebottun_next)
-				{
-					SetNextStage(scene_result);
-				}
-				else if (g_CurrentBottun == gamebottun_replay)
-				{
-					Replay();
-				}
-				else
-				{
-					UNINIT();
-				}
-
-				g_IsTouch_game[gamekey_enter] = true;
+				Replay();
+			}
+			else
+			{
+				UNINIT();
 			}
-		}
-		else
-		{
-			g_IsTouch_game[gamekey_enter] = false;
 		}
 	}
 }
 
 void GameDRAW(void)
 {
-	backgroundDRAW();
+	//背景と動かないブロックは、カメラかマスが変わった時だけ描き直す
+	if (BeginLayer(&g_StageLayer, GetStageDrawKey()))
+	{
+		backgroundDRAW();
+		StageBlockStaticDRAW();
+		EndLayer(&g_StageLayer);
+	}
+	DrawLayer(&g_StageLayer);
+
 	StageBlockDRAW();
+	PreviewDRAW();
 	BallDRAW();
 	EffectDRAW();
 	PaintDRAW();
 
-	if (GetIsClear() || GetIsGameover())
-	{
-		//ݑIĂ{^̃t[\
-		FaceGenforTex(MakeFloat2(0, 128 * (g_CurrentBottun + 1) + 32),
-			MakeFloat2(512, 128), 0, 0, 1, 1, true, g_FrameTex, MakeFloat4(1, 1, 1, 1));
-
-		if (GetIsClear())
-		{
-			//
-			FaceGenforTex(MakeFloat2(0, 128 + 32), MakeFloat2(512, 128),
-				0, 2, 1, 4, true, g_BottunTex, MakeFloat4(1, 1, 1, 1));
-		}
-
-		//x
-		FaceGenforTex(MakeFloat2(0, 256 + 32), MakeFloat2(512, 128),
-			0, 3, 1, 4, true, g_BottunTex, MakeFloat4(1, 1, 1, 1));
-
-		//I
-		FaceGenforTex(MakeFloat2(0, 384 + 32), MakeFloat2(512, 128),
-			0, 1, 1, 4, true, g_BottunTex, MakeFloat4(1, 1, 1, 1));
-
-		int alpha = GetCurrentStage() < STAGEMAX - 1 ? 3 : 1;
-
-		//L[
-		FaceGenforTex(MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
-			0, alpha, 1, 4, true, g_BottunDispTex, MakeFloat4(1, 1, 1, 1));
-	}
-
+	DrawWidgetScreen(&g_UI);
 }
 
 void GameUNINIT(void)
 {
+	UninitLayer(&g_StageLayer);
 	backgroundUNINIT();
 	EffectUNINIT();
+	PreviewUNINIT();
+	ReleaseStageData(&g_StartState.stage.stage);
 	StageBlockUNINIT();
 	BallUNINIT();
 	PaintUNINIT();
@@ -225,3 +152,35 @@ void GameUNINIT(void)
 	g_BottunTex = NULL;
 	g_BottunDispTex = NULL;
 }
+
+void GetGameState(GAMESTATE* state)
+{
+	GetStageBlockState(&state->stage);
+	GetBallState(&state->ball);
+	GetEffectState(&state->effect);
+	GetPaintState(&state->paint);
+	GetRandomState(random_game, &state->random);
+	state->cameraPos = GetCameraPos();
+	state->currentBottun = GetListSelect(&g_UI, g_BottunList);
+	state->IsFirst = !GetWidgetVisible(&g_UI, g_Bottun[gamebottun_next]);
+}
+
+void SetGameState(const GAMESTATE* state)
+{
+	SetStageBlockState(&state->stage);
+	SetBallState(&state->ball);
+	SetEffectState(&state->effect);
+	SetPaintState(&state->paint);
+	SetRandomState(random_game, &state->random);
+	SetCameraPos(state->cameraPos);
+	SetWidgetVisible(&g_UI, g_Bottun[gamebottun_next], !state->IsFirst);
+	SetListSelect(&g_UI, g_BottunList, state->currentBottun);
+
+	//予測線はステージとボールから作り直す
+	PreviewINIT();
+}
+
+void GameReset(void)
+{
+	SetGameState(&g_StartState);
+}
\ No newline at end of file
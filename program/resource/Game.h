@@ -1,9 +1,34 @@
 #ifndef GAME_H_
 #define GAME_H_
 
+#include"StageMaker.h"
+#include"Ball.h"
+#include"Effect.h"
+#include"paint.h"
+#include"Random.h"
+
+//ゲームの状態全部。GameINITの最後に取っておき、リプレイはそこに戻すだけにする
+typedef struct
+{
+	STAGEBLOCKSTATE stage;
+	BALLSTATE ball;
+	EFFECTSTATE effect;
+	PAINTSTATE paint;
+	RANDOMSTATE random;//random_gameだけ。エフェクトと音の乱数は見た目にしか使わない
+	Float2 cameraPos;
+	int currentBottun;
+	bool IsFirst;//ゲームオーバーになって次へを隠した
+}GAMESTATE;
+
 void GameINIT(void);
 void GameUPDATE(void);
 void GameDRAW(void);
 void GameUNINIT(void);
 
+void GetGameState(GAMESTATE* state);
+//保存した状態に戻す。ファイルもテクスチャも読まない
+void SetGameState(const GAMESTATE* state);
+//ステージを読んだ直後の状態に戻す
+void GameReset(void);
+
 #endif
\ No newline at end of file
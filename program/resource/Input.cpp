@@ -0,0 +1,870 @@
+//=================================
+//
+//入力
+//
+//全部のデバイスを1フレームに1回だけ読んでINPUTRAWにし、
+//アクションごとの押している・押した・離した・リピートをビットでまとめて求める。
+//ゲームはキーを直接見ずにアクションを見る。
+//
+//入力スレッドを使う時は、スレッドがデバイスを読んで変わった所だけをINPUTEVENTにして
+//ロックなしのキューに積み、InputUPDATEがそれを順番に当てる。
+//
+//=================================
+
+#include"main.h"
+#include"Input.h"
+
+#include<thread>
+#include<atomic>
+#include<chrono>
+
+#if defined(NN_BUILD_CONFIG_OS_WIN32)
+#include<Xinput.h>
+#pragma comment(lib, "xinput.lib")
+#elif defined(__linux__)
+#include<linux/input.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#endif
+
+#define INPUT_QUEUESIZE (1024)//2の累乗
+
+static void SetRawKey(INPUTRAW* raw, int key, bool IsDown);
+static void SetKeyTime(const INPUTRAW* old, const INPUTRAW* raw, long long time);
+static long long GetBindingTime(INPUTACTION action);
+static void InputThread(INPUTRAW sent, int hz);
+static void PushRawChange(INPUTRAW* sent, const INPUTRAW* raw, long long time);
+static bool PushInputEvent(const INPUTEVENT* event);
+static bool PopInputEvent(INPUTEVENT* event);
+static void ApplyInputEvent(const INPUTEVENT* event);
+
+static bool ScriptINIT(void);
+static void ScriptUNINIT(void);
+static void ScriptSample(INPUTRAW* raw);
+
+static const INPUTBACKEND* g_Backend;
+static INPUTRAW g_Raw;
+static INPUTSNAPSHOT g_Snapshot;
+static INPUTBINDING g_Binding[ACTIONMAX][INPUT_MAXBINDING];
+static int g_HoldFrame[ACTIONMAX];//押し続けているフレーム数。リピート用
+static long long g_KeyTime[INPUTKEY_MAX];//キーが最後に変わった時間
+static std::chrono::steady_clock::time_point g_StartTime;
+
+//入力スレッド
+static std::thread g_InputThread;
+static std::atomic<bool> g_IsInputThreadEnd;
+static bool g_IsInputThreadRun;
+static int g_InputThreadHz;
+static thread_local bool g_IsOnInputThread;
+static std::atomic<unsigned int> g_WatchKey[INPUTKEY_MAX / 32];//入力スレッドで読むキー
+
+//入力スレッドだけが積んで、ゲームスレッドだけが取り出す
+static INPUTEVENT g_EventQueue[INPUT_QUEUESIZE];
+static std::atomic<unsigned int> g_QueueHead;//次に取り出す位置。ゲームスレッドだけが書く
+static std::atomic<unsigned int> g_QueueTail;//次に積む位置。入力スレッドだけが書く
+
+static INPUTFEED g_Feed;
+static long long g_PendingPressTime;//まだ画面に出ていない一番古い入力の時間。なければ-1
+static INPUTLATENCY g_Latency;
+
+static const INPUTSCRIPTEVENT* g_ScriptEvent;
+static int g_ScriptEventNum;
+static int g_ScriptPos;
+static int g_ScriptFrame;
+static INPUTRAW g_ScriptRaw;
+
+static const INPUTBACKEND g_ScriptBackend = { "script", ScriptINIT, ScriptUNINIT, ScriptSample };
+
+//===================================Windows
+#if defined(NN_BUILD_CONFIG_OS_WIN32)
+
+static bool WindowsINIT(void);
+static void WindowsUNINIT(void);
+static void WindowsSample(INPUTRAW* raw);
+
+static RECT g_ScreenRect;
+
+static const INPUTBACKEND g_DefaultBackend = { "windows", WindowsINIT, WindowsUNINIT, WindowsSample };
+
+static bool WindowsINIT(void)
+{
+	GetClientRect(GetForegroundWindow(), &g_ScreenRect);
+	return true;
+}
+
+static void WindowsUNINIT(void)
+{
+}
+
+//キーボードはGetKeyboardStateで256キーを1回で読む。
+//GetKeyboardStateはウィンドウのスレッドでしか変わらないので、入力スレッドでは使うキーだけGetAsyncKeyStateで読む
+static void WindowsSample(INPUTRAW* raw)
+{
+	if (g_IsOnInputThread)
+	{
+		for (int i = 0; i < 256 / 32; i++)
+		{
+			unsigned int watch = g_WatchKey[i];
+			for (int k = 0; watch != 0; k++, watch >>= 1)
+			{
+				if (watch & 1)SetRawKey(raw, i * 32 + k, (GetAsyncKeyState(i * 32 + k) & 0x8000) != 0);
+			}
+		}
+	}
+	else
+	{
+		BYTE keyboard[256];
+		if (GetKeyboardState(keyboard))
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				SetRawKey(raw, i, (keyboard[i] & 0x80) != 0);
+			}
+		}
+	}
+
+	XINPUT_STATE xi_sts;
+	memset(&xi_sts, 0, sizeof(xi_sts));
+	XInputGetState(0, &xi_sts);
+	for (int i = 0; i < 16; i++)
+	{
+		SetRawKey(raw, INPUTKEY_PAD(i), (xi_sts.Gamepad.wButtons & (1 << i)) != 0);
+	}
+	raw->leftStick[0] = xi_sts.Gamepad.sThumbLX;
+	raw->leftStick[1] = xi_sts.Gamepad.sThumbLY;
+	raw->rightStick[0] = xi_sts.Gamepad.sThumbRX;
+	raw->rightStick[1] = xi_sts.Gamepad.sThumbRY;
+	raw->leftTrigger = xi_sts.Gamepad.bLeftTrigger;
+	raw->rightTrigger = xi_sts.Gamepad.bRightTrigger;
+
+	POINT pt;
+	GetCursorPos(&pt);
+	ScreenToClient(GetForegroundWindow(), &pt);
+	raw->IsPointerIn = PtInRect(&g_ScreenRect, pt) != 0;
+	if (g_ScreenRect.right > 0 && g_ScreenRect.bottom > 0)
+	{
+		raw->pointer.x = (float)pt.x * SCREEN_WIDTH / g_ScreenRect.right - SCREEN_WIDTH / 2;
+		raw->pointer.y = (float)pt.y * SCREEN_HEIGHT / g_ScreenRect.bottom - SCREEN_HEIGHT / 2;
+	}
+}
+
+//===================================Linux evdev
+#elif defined(__linux__)
+
+#define EVDEV_MAXDEVICE (16)
+#define EVDEV_MAXNODE (32)//探す/dev/input/eventNの数
+#define EVDEV_AXISMAX (0x7FFF)
+
+typedef struct
+{
+	int code;//KEY_*、BTN_*
+	int key;//INPUTKEY_*
+}EVDEVKEY;
+
+static bool EvdevINIT(void);
+static void EvdevUNINIT(void);
+static void EvdevSample(INPUTRAW* raw);
+static short GetEvdevAxis(int fd, int code, int value, bool IsFlip);
+
+static int g_EvdevFd[EVDEV_MAXDEVICE];
+static int g_EvdevNum;
+static INPUTRAW g_EvdevRaw;//evdevは変わった所しか送ってこないので、状態を持っておく
+
+static const INPUTBACKEND g_DefaultBackend = { "evdev", EvdevINIT, EvdevUNINIT, EvdevSample };
+
+//パッドのボタンはXInputのビットの位置に合わせる
+static const EVDEVKEY g_EvdevKey[] =
+{
+	{ KEY_A, 'A' },{ KEY_B, 'B' },{ KEY_C, 'C' },{ KEY_D, 'D' },{ KEY_E, 'E' },{ KEY_F, 'F' },{ KEY_G, 'G' },
+	{ KEY_H, 'H' },{ KEY_I, 'I' },{ KEY_J, 'J' },{ KEY_K, 'K' },{ KEY_L, 'L' },{ KEY_M, 'M' },{ KEY_N, 'N' },
+	{ KEY_O, 'O' },{ KEY_P, 'P' },{ KEY_Q, 'Q' },{ KEY_R, 'R' },{ KEY_S, 'S' },{ KEY_T, 'T' },{ KEY_U, 'U' },
+	{ KEY_V, 'V' },{ KEY_W, 'W' },{ KEY_X, 'X' },{ KEY_Y, 'Y' },{ KEY_Z, 'Z' },
+	{ KEY_TAB, INPUTKEY_TAB },{ KEY_ENTER, INPUTKEY_RETURN },{ KEY_SPACE, INPUTKEY_SPACE },
+	{ KEY_F5, INPUTKEY_F5 },{ KEY_F6, INPUTKEY_F6 },{ KEY_F7, INPUTKEY_F7 },
+	{ KEY_LEFT, INPUTKEY_LEFT },{ KEY_UP, INPUTKEY_UP },{ KEY_RIGHT, INPUTKEY_RIGHT },{ KEY_DOWN, INPUTKEY_DOWN },
+	{ KEY_LEFTSHIFT, INPUTKEY_LSHIFT },{ KEY_RIGHTSHIFT, INPUTKEY_RSHIFT },
+	{ KEY_LEFTCTRL, INPUTKEY_LCONTROL },{ KEY_RIGHTCTRL, INPUTKEY_RCONTROL },
+	{ BTN_LEFT, INPUTKEY_LBUTTON },
+	{ BTN_START, INPUTKEY_PAD(4) },{ BTN_SELECT, INPUTKEY_PAD(5) },
+	{ BTN_THUMBL, INPUTKEY_PAD(6) },{ BTN_THUMBR, INPUTKEY_PAD(7) },
+	{ BTN_TL, INPUTKEY_PAD(8) },{ BTN_TR, INPUTKEY_PAD(9) },
+	{ BTN_SOUTH, INPUTKEY_PAD(12) },{ BTN_EAST, INPUTKEY_PAD(13) },
+	{ BTN_WEST, INPUTKEY_PAD(14) },{ BTN_NORTH, INPUTKEY_PAD(15) },
+};
+
+static bool EvdevINIT(void)
+{
+	memset(&g_EvdevRaw, 0, sizeof(g_EvdevRaw));
+	g_EvdevNum = 0;
+
+	for (int i = 0; i < EVDEV_MAXNODE && g_EvdevNum < EVDEV_MAXDEVICE; i++)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "/dev/input/event%d", i);
+
+		//ないデバイスと読めないデバイス(権限がないなど)は飛ばす
+		int fd = open(path, O_RDONLY | O_NONBLOCK);
+		if (fd < 0)continue;
+
+		g_EvdevFd[g_EvdevNum] = fd;
+		g_EvdevNum++;
+	}
+
+	NN_LOG("EvdevINIT: %d devices\n", g_EvdevNum);
+	return g_EvdevNum > 0;
+}
+
+static void EvdevUNINIT(void)
+{
+	for (int i = 0; i < g_EvdevNum; i++)
+	{
+		close(g_EvdevFd[i]);
+	}
+	g_EvdevNum = 0;
+}
+
+//前のフレームから届いたイベントを全部読む
+static void EvdevSample(INPUTRAW* raw)
+{
+	for (int i = 0; i < g_EvdevNum; i++)
+	{
+		struct input_event event[64];
+		ssize_t size;
+
+		while ((size = read(g_EvdevFd[i], event, sizeof(event))) > 0)
+		{
+			for (int n = 0; n < (int)(size / sizeof(struct input_event)); n++)
+			{
+				const struct input_event* ev = &event[n];
+
+				if (ev->type == EV_KEY)
+				{
+					for (int k = 0; k < (int)(sizeof(g_EvdevKey) / sizeof(g_EvdevKey[0])); k++)
+					{
+						if (g_EvdevKey[k].code != ev->code)continue;
+
+						//2はキーリピート。押したままとして扱う
+						SetRawKey(&g_EvdevRaw, g_EvdevKey[k].key, ev->value != 0);
+						break;
+					}
+				}
+				else if (ev->type == EV_REL)
+				{
+					//マウスは相対移動なので、画面の中で動かす
+					if (ev->code == REL_X)g_EvdevRaw.pointer.x += ev->value;
+					if (ev->code == REL_Y)g_EvdevRaw.pointer.y += ev->value;
+					if (g_EvdevRaw.pointer.x < -SCREEN_WIDTH / 2)g_EvdevRaw.pointer.x = -SCREEN_WIDTH / 2;
+					if (g_EvdevRaw.pointer.x > SCREEN_WIDTH / 2)g_EvdevRaw.pointer.x = SCREEN_WIDTH / 2;
+					if (g_EvdevRaw.pointer.y < -SCREEN_HEIGHT / 2)g_EvdevRaw.pointer.y = -SCREEN_HEIGHT / 2;
+					if (g_EvdevRaw.pointer.y > SCREEN_HEIGHT / 2)g_EvdevRaw.pointer.y = SCREEN_HEIGHT / 2;
+					g_EvdevRaw.IsPointerIn = true;
+				}
+				else if (ev->type == EV_ABS)
+				{
+					//十字キーはハットで来る
+					switch (ev->code)
+					{
+					case ABS_X: g_EvdevRaw.leftStick[0] = GetEvdevAxis(g_EvdevFd[i], ev->code, ev->value, false); break;
+					case ABS_Y: g_EvdevRaw.leftStick[1] = GetEvdevAxis(g_EvdevFd[i], ev->code, ev->value, true); break;
+					case ABS_RX: g_EvdevRaw.rightStick[0] = GetEvdevAxis(g_EvdevFd[i], ev->code, ev->value, false); break;
+					case ABS_RY: g_EvdevRaw.rightStick[1] = GetEvdevAxis(g_EvdevFd[i], ev->code, ev->value, true); break;
+					case ABS_Z: g_EvdevRaw.leftTrigger = ev->value > 0 ? (unsigned char)(ev->value > 255 ? 255 : ev->value) : 0; break;
+					case ABS_RZ: g_EvdevRaw.rightTrigger = ev->value > 0 ? (unsigned char)(ev->value > 255 ? 255 : ev->value) : 0; break;
+					case ABS_HAT0X:
+						SetRawKey(&g_EvdevRaw, INPUTKEY_PAD(2), ev->value < 0);
+						SetRawKey(&g_EvdevRaw, INPUTKEY_PAD(3), ev->value > 0);
+						break;
+					case ABS_HAT0Y:
+						SetRawKey(&g_EvdevRaw, INPUTKEY_PAD(0), ev->value < 0);
+						SetRawKey(&g_EvdevRaw, INPUTKEY_PAD(1), ev->value > 0);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	//左右どちらかのキーはWindowsと同じように作る
+	SetRawKey(&g_EvdevRaw, INPUTKEY_CONTROL, GetInputRawKey(&g_EvdevRaw, INPUTKEY_LCONTROL) || GetInputRawKey(&g_EvdevRaw, INPUTKEY_RCONTROL));
+	SetRawKey(&g_EvdevRaw, INPUTKEY_SHIFT, GetInputRawKey(&g_EvdevRaw, INPUTKEY_LSHIFT) || GetInputRawKey(&g_EvdevRaw, INPUTKEY_RSHIFT));
+
+	*raw = g_EvdevRaw;
+}
+
+//スティックの値をXInputと同じ-0x7FFF～0x7FFFにする。evdevはyが下向き
+static short GetEvdevAxis(int fd, int code, int value, bool IsFlip)
+{
+	struct input_absinfo info;
+	if (ioctl(fd, EVIOCGABS(code), &info) < 0 || info.maximum <= info.minimum)
+	{
+		return 0;
+	}
+
+	float rate = (float)(value - info.minimum) / (info.maximum - info.minimum) * 2 - 1;
+	if (IsFlip)rate *= -1;
+
+	return (short)(rate * EVDEV_AXISMAX);
+}
+
+//===================================その他
+#else
+
+static const INPUTBACKEND g_DefaultBackend = { "script", ScriptINIT, ScriptUNINIT, ScriptSample };
+
+#endif
+
+void InputINIT(void)
+{
+	memset(&g_Raw, 0, sizeof(g_Raw));
+	memset(&g_Snapshot, 0, sizeof(g_Snapshot));
+	memset(g_HoldFrame, 0, sizeof(g_HoldFrame));
+	memset(g_KeyTime, 0, sizeof(g_KeyTime));
+	g_StartTime = std::chrono::steady_clock::now();
+	g_PendingPressTime = -1;
+	g_Feed = NULL;
+	ResetInputLatency();
+
+	for (int i = 0; i < INPUTKEY_MAX / 32; i++)
+	{
+		g_WatchKey[i] = 0;
+	}
+	ResetInputBinding();
+
+	g_Backend = NULL;
+	if (!SetInputBackend(&g_DefaultBackend))
+	{
+		//デバイスが読めなくてもゲームは動くように、何も押していない入力にする
+		SetInputBackend(&g_ScriptBackend);
+	}
+}
+
+void InputUNINIT(void)
+{
+	InputStopThread();
+
+	if (g_Latency.num > 0)
+	{
+		NN_LOG("Input latency: %d presses avg:%lldus max:%lldus\n",
+			g_Latency.num, g_Latency.total / g_Latency.num, g_Latency.max);
+	}
+
+	if (g_Backend != NULL)g_Backend->uninit();
+	g_Backend = NULL;
+}
+
+void InputUPDATE(void)
+{
+	long long now = GetInputTime();
+
+	//入力スレッドから届いた変化を届いた順に当てる
+	INPUTEVENT event;
+	while (PopInputEvent(&event))
+	{
+		ApplyInputEvent(&event);
+	}
+
+	//入力スレッドがなければここで読む
+	if (!g_IsInputThreadRun && g_Backend != NULL)
+	{
+		INPUTRAW old = g_Raw;
+		g_Backend->sample(&g_Raw);
+		SetKeyTime(&old, &g_Raw, now);
+	}
+
+	unsigned int down = 0;
+	for (int i = 0; i < ACTIONMAX; i++)
+	{
+		for (int k = 0; k < INPUT_MAXBINDING; k++)
+		{
+			const INPUTBINDING* binding = &g_Binding[i][k];
+			if (binding->key == 0)continue;
+
+			if (GetInputRawKey(&g_Raw, binding->key) &&
+				(binding->modifier == 0 || GetInputRawKey(&g_Raw, binding->modifier)))
+			{
+				down |= 1u << i;
+			}
+		}
+	}
+
+	//リプレイ中は記録した入力を使う。記録や再生の操作だけはその時の入力
+	INPUTFRAME frame;
+	bool IsFeed = g_Feed != NULL && g_Feed(&frame);
+	if (g_Feed != NULL && !IsFeed)g_Feed = NULL;
+	if (IsFeed)
+	{
+		down = (frame.down & ~INPUT_METAACTION) | (down & INPUT_METAACTION);
+	}
+
+	//押した・離したは前のフレームとの差
+	unsigned int old = g_Snapshot.down;
+	g_Snapshot.down = down;
+	g_Snapshot.pressed = down & ~old;
+	g_Snapshot.released = ~down & old;
+
+	//リピートは押した瞬間と、INPUT_REPEATDELAYフレームより長く押している間
+	g_Snapshot.repeat = 0;
+	for (int i = 0; i < ACTIONMAX; i++)
+	{
+		g_HoldFrame[i] = (down & (1u << i)) ? g_HoldFrame[i] + 1 : 0;
+
+		if (g_HoldFrame[i] == 1 || g_HoldFrame[i] > INPUT_REPEATDELAY)
+		{
+			g_Snapshot.repeat |= 1u << i;
+		}
+	}
+
+	g_Snapshot.pointer = IsFeed ? frame.pointer : g_Raw.pointer;
+	g_Snapshot.IsPointerIn = IsFeed ? frame.IsPointerIn : g_Raw.IsPointerIn;
+	g_Snapshot.time = now;
+
+	for (int i = 0; i < ACTIONMAX; i++)
+	{
+		if (!(g_Snapshot.pressed & (1u << i)))continue;
+
+		//再生した入力はデバイスから来ていないのでレイテンシに入れない
+		if (IsFeed && !(INPUT_METAACTION & (1u << i)))
+		{
+			g_Snapshot.pressedTime[i] = now;
+			continue;
+		}
+
+		g_Snapshot.pressedTime[i] = GetBindingTime((INPUTACTION)i);
+
+		//画面に出るまでのレイテンシは一番古い入力から測る
+		if (g_PendingPressTime < 0 || g_Snapshot.pressedTime[i] < g_PendingPressTime)
+		{
+			g_PendingPressTime = g_Snapshot.pressedTime[i];
+		}
+	}
+}
+
+//今押されている割り当ての中で、一番早く揃った時間
+static long long GetBindingTime(INPUTACTION action)
+{
+	long long time = -1;
+
+	for (int i = 0; i < INPUT_MAXBINDING; i++)
+	{
+		const INPUTBINDING* binding = &g_Binding[action][i];
+		if (binding->key == 0 || !GetInputRawKey(&g_Raw, binding->key))continue;
+		if (binding->modifier != 0 && !GetInputRawKey(&g_Raw, binding->modifier))continue;
+
+		long long keytime = g_KeyTime[binding->key];
+		if (binding->modifier != 0 && g_KeyTime[binding->modifier] > keytime)
+		{
+			keytime = g_KeyTime[binding->modifier];
+		}
+
+		if (time < 0 || keytime < time)time = keytime;
+	}
+
+	return time < 0 ? g_Snapshot.time : time;
+}
+
+//変わったキーの時間を記録する
+static void SetKeyTime(const INPUTRAW* old, const INPUTRAW* raw, long long time)
+{
+	for (int i = 0; i < INPUTKEY_MAX / 32; i++)
+	{
+		unsigned int diff = old->key[i] ^ raw->key[i];
+		for (int k = 0; diff != 0; k++, diff >>= 1)
+		{
+			if (diff & 1)g_KeyTime[i * 32 + k] = time;
+		}
+	}
+}
+
+bool GetInputDown(INPUTACTION action)
+{
+	return (g_Snapshot.down & (1u << action)) != 0;
+}
+
+bool GetInputPressed(INPUTACTION action)
+{
+	return (g_Snapshot.pressed & (1u << action)) != 0;
+}
+
+bool GetInputReleased(INPUTACTION action)
+{
+	return (g_Snapshot.released & (1u << action)) != 0;
+}
+
+bool GetInputRepeat(INPUTACTION action)
+{
+	return (g_Snapshot.repeat & (1u << action)) != 0;
+}
+
+Float2 GetInputPointer(void)
+{
+	return g_Snapshot.pointer;
+}
+
+bool GetIsInputPointerIn(void)
+{
+	return g_Snapshot.IsPointerIn;
+}
+
+long long GetInputPressedTime(INPUTACTION action)
+{
+	return g_Snapshot.pressedTime[action];
+}
+
+const INPUTSNAPSHOT* GetInputSnapshot(void)
+{
+	return &g_Snapshot;
+}
+
+void GetInputFrame(INPUTFRAME* frame)
+{
+	frame->down = g_Snapshot.down & ~INPUT_METAACTION;
+	frame->pointer = g_Snapshot.pointer;
+	frame->IsPointerIn = g_Snapshot.IsPointerIn;
+}
+
+void ResetInputState(void)
+{
+	g_Snapshot.down = 0;
+	g_Snapshot.pressed = 0;
+	g_Snapshot.released = 0;
+	g_Snapshot.repeat = 0;
+	memset(g_HoldFrame, 0, sizeof(g_HoldFrame));
+}
+
+void SetInputFeed(INPUTFEED feed)
+{
+	g_Feed = feed;
+}
+
+const INPUTRAW* GetInputRaw(void)
+{
+	return &g_Raw;
+}
+
+bool GetInputRawKey(const INPUTRAW* raw, int key)
+{
+	if (key < 0 || key >= INPUTKEY_MAX)return false;
+
+	return (raw->key[key / 32] & (1u << (key % 32))) != 0;
+}
+
+static void SetRawKey(INPUTRAW* raw, int key, bool IsDown)
+{
+	if (key < 0 || key >= INPUTKEY_MAX)return;
+
+	if (IsDown)
+	{
+		raw->key[key / 32] |= 1u << (key % 32);
+	}
+	else
+	{
+		raw->key[key / 32] &= ~(1u << (key % 32));
+	}
+}
+
+void BindInputAction(INPUTACTION action, int slot, int key, int modifier)
+{
+	if (action < 0 || action >= ACTIONMAX || slot < 0 || slot >= INPUT_MAXBINDING)return;
+
+	g_Binding[action][slot].key = key;
+	g_Binding[action][slot].modifier = modifier;
+
+	if (key != 0)WatchInputKey(key);
+	if (modifier != 0)WatchInputKey(modifier);
+}
+
+void WatchInputKey(int key)
+{
+	if (key < 0 || key >= INPUTKEY_MAX)return;
+
+	g_WatchKey[key / 32] |= 1u << (key % 32);
+}
+
+//今までのキー操作と同じ割り当て
+void ResetInputBinding(void)
+{
+	memset(g_Binding, 0, sizeof(g_Binding));
+
+	BindInputAction(action_left, 0, 'A', 0);
+	BindInputAction(action_right, 0, 'D', 0);
+	BindInputAction(action_up, 0, 'W', 0);
+	BindInputAction(action_down, 0, 'S', 0);
+	BindInputAction(action_place, 0, INPUTKEY_SPACE, 0);
+	BindInputAction(action_launch, 0, INPUTKEY_RETURN, 0);
+	BindInputAction(action_delete, 0, 'F', 0);
+	BindInputAction(action_changetype, 0, 'E', 0);
+	BindInputAction(action_rotate, 0, 'Q', 0);
+	BindInputAction(action_reset, 0, 'T', INPUTKEY_CONTROL);
+	BindInputAction(action_resetkeep, 0, 'R', INPUTKEY_CONTROL);
+	BindInputAction(action_convert, 0, 'V', INPUTKEY_CONTROL);
+	BindInputAction(action_paint, 0, INPUTKEY_LBUTTON, 0);
+	BindInputAction(action_paintclear, 0, 'Z', INPUTKEY_LCONTROL);
+	BindInputAction(action_debug, 0, 'B', 0);
+	BindInputAction(action_voice, 0, 'P', 0);
+	BindInputAction(action_menu, 0, INPUTKEY_TAB, 0);
+	BindInputAction(action_solve, 0, 'K', 0);
+	BindInputAction(action_record, 0, INPUTKEY_F5, 0);
+	BindInputAction(action_playback, 0, INPUTKEY_F6, 0);
+	BindInputAction(action_fastforward, 0, INPUTKEY_F7, 0);
+}
+
+bool SetInputBackend(const INPUTBACKEND* backend)
+{
+	//入力スレッドは前のバックエンドを読んでいるので止めてから切り替える
+	int hz = g_IsInputThreadRun ? g_InputThreadHz : 0;
+	InputStopThread();
+	g_QueueHead = g_QueueTail.load();
+
+	if (g_Backend != NULL)g_Backend->uninit();
+	g_Backend = NULL;
+
+	if (backend == NULL || !backend->init())
+	{
+		NN_LOG("SetInputBackend: %s init failed\n", backend != NULL ? backend->name : "NULL");
+		return false;
+	}
+
+	//前のバックエンドで押していたキーが残らないようにする
+	memset(&g_Raw, 0, sizeof(g_Raw));
+	g_Backend = backend;
+
+	if (hz > 0 && backend != &g_ScriptBackend)InputStartThread(hz);
+	return true;
+}
+
+long long GetInputTime(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_StartTime).count();
+}
+
+//===================================入力スレッド
+bool InputStartThread(int hz)
+{
+	InputStopThread();
+
+	//スクリプトはフレームごとに進むので、スレッドで読むと速さが変わってしまう
+	if (g_Backend == NULL || g_Backend == &g_ScriptBackend || hz <= 0)
+	{
+		NN_LOG("InputStartThread: %s can not use thread\n", g_Backend != NULL ? g_Backend->name : "NULL");
+		return false;
+	}
+
+	g_IsInputThreadEnd = false;
+	g_InputThread = std::thread(InputThread, g_Raw, hz);
+	g_IsInputThreadRun = true;
+	g_InputThreadHz = hz;
+
+	NN_LOG("InputStartThread: %s %dHz\n", g_Backend->name, hz);
+	return true;
+}
+
+void InputStopThread(void)
+{
+	if (!g_IsInputThreadRun)return;
+
+	g_IsInputThreadEnd = true;
+	g_InputThread.join();
+	g_IsInputThreadRun = false;
+	g_InputThreadHz = 0;
+}
+
+bool GetIsInputThread(void)
+{
+	return g_IsInputThreadRun;
+}
+
+//sentはゲームスレッドに送った状態。変わった所だけを送る
+static void InputThread(INPUTRAW sent, int hz)
+{
+	g_IsOnInputThread = true;
+
+	std::chrono::microseconds period(1000000 / hz);
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+	while (!g_IsInputThreadEnd)
+	{
+		INPUTRAW raw = sent;
+		g_Backend->sample(&raw);
+		PushRawChange(&sent, &raw, GetInputTime());
+
+		//大きく遅れたら追いつこうとせずに今から数え直す
+		next += period;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (next < now - period)next = now;
+
+		std::this_thread::sleep_until(next);
+	}
+}
+
+//キューがいっぱいなら送れなかった所はsentに残らないので、次に読んだ時にまた送る
+static void PushRawChange(INPUTRAW* sent, const INPUTRAW* raw, long long time)
+{
+	INPUTEVENT event;
+	memset(&event, 0, sizeof(event));
+	event.time = time;
+
+	for (int i = 0; i < INPUTKEY_MAX / 32; i++)
+	{
+		unsigned int diff = sent->key[i] ^ raw->key[i];
+		for (int k = 0; diff != 0; k++, diff >>= 1)
+		{
+			if (!(diff & 1))continue;
+
+			event.type = inputevent_key;
+			event.key = i * 32 + k;
+			event.IsDown = GetInputRawKey(raw, event.key);
+			if (!PushInputEvent(&event))return;
+
+			SetRawKey(sent, event.key, event.IsDown);
+		}
+	}
+
+	if (sent->pointer.x != raw->pointer.x || sent->pointer.y != raw->pointer.y || sent->IsPointerIn != raw->IsPointerIn)
+	{
+		event.type = inputevent_pointer;
+		event.pointer = raw->pointer;
+		event.IsDown = raw->IsPointerIn;
+		if (!PushInputEvent(&event))return;
+
+		sent->pointer = raw->pointer;
+		sent->IsPointerIn = raw->IsPointerIn;
+	}
+
+	if (memcmp(sent->leftStick, raw->leftStick, sizeof(raw->leftStick)) != 0 ||
+		memcmp(sent->rightStick, raw->rightStick, sizeof(raw->rightStick)) != 0)
+	{
+		event.type = inputevent_stick;
+		memcpy(event.value, raw->leftStick, sizeof(event.value));
+		memcpy(event.value2, raw->rightStick, sizeof(event.value2));
+		if (!PushInputEvent(&event))return;
+
+		memcpy(sent->leftStick, raw->leftStick, sizeof(raw->leftStick));
+		memcpy(sent->rightStick, raw->rightStick, sizeof(raw->rightStick));
+	}
+
+	if (sent->leftTrigger != raw->leftTrigger || sent->rightTrigger != raw->rightTrigger)
+	{
+		event.type = inputevent_trigger;
+		event.value[0] = raw->leftTrigger;
+		event.value[1] = raw->rightTrigger;
+		if (!PushInputEvent(&event))return;
+
+		sent->leftTrigger = raw->leftTrigger;
+		sent->rightTrigger = raw->rightTrigger;
+	}
+}
+
+static bool PushInputEvent(const INPUTEVENT* event)
+{
+	unsigned int tail = g_QueueTail.load(std::memory_order_relaxed);
+	unsigned int head = g_QueueHead.load(std::memory_order_acquire);
+	if (tail - head >= INPUT_QUEUESIZE)return false;
+
+	g_EventQueue[tail % INPUT_QUEUESIZE] = *event;
+	g_QueueTail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+static bool PopInputEvent(INPUTEVENT* event)
+{
+	unsigned int head = g_QueueHead.load(std::memory_order_relaxed);
+	unsigned int tail = g_QueueTail.load(std::memory_order_acquire);
+	if (head == tail)return false;
+
+	*event = g_EventQueue[head % INPUT_QUEUESIZE];
+	g_QueueHead.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+static void ApplyInputEvent(const INPUTEVENT* event)
+{
+	switch (event->type)
+	{
+	case inputevent_key:
+		SetRawKey(&g_Raw, event->key, event->IsDown);
+		g_KeyTime[event->key] = event->time;
+		break;
+	case inputevent_pointer:
+		g_Raw.pointer = event->pointer;
+		g_Raw.IsPointerIn = event->IsDown;
+		break;
+	case inputevent_stick:
+		memcpy(g_Raw.leftStick, event->value, sizeof(g_Raw.leftStick));
+		memcpy(g_Raw.rightStick, event->value2, sizeof(g_Raw.rightStick));
+		break;
+	case inputevent_trigger:
+		g_Raw.leftTrigger = (unsigned char)event->value[0];
+		g_Raw.rightTrigger = (unsigned char)event->value[1];
+		break;
+	}
+}
+
+//===================================レイテンシ
+void InputPresent(void)
+{
+	if (g_PendingPressTime < 0)return;
+
+	long long latency = GetInputTime() - g_PendingPressTime;
+	g_PendingPressTime = -1;
+
+	g_Latency.num++;
+	g_Latency.total += latency;
+	g_Latency.last = latency;
+	if (latency > g_Latency.max)g_Latency.max = latency;
+}
+
+const INPUTLATENCY* GetInputLatency(void)
+{
+	return &g_Latency;
+}
+
+void ResetInputLatency(void)
+{
+	memset(&g_Latency, 0, sizeof(g_Latency));
+}
+
+const INPUTBACKEND* GetDefaultInputBackend(void)
+{
+	return &g_DefaultBackend;
+}
+
+const INPUTBACKEND* GetScriptInputBackend(void)
+{
+	return &g_ScriptBackend;
+}
+
+void SetInputScript(const INPUTSCRIPTEVENT* event, int num)
+{
+	g_ScriptEvent = event;
+	g_ScriptEventNum = event != NULL ? num : 0;
+	g_ScriptPos = 0;
+	g_ScriptFrame = 0;
+	memset(&g_ScriptRaw, 0, sizeof(g_ScriptRaw));
+}
+
+//===================================スクリプト
+static bool ScriptINIT(void)
+{
+	g_ScriptPos = 0;
+	g_ScriptFrame = 0;
+	memset(&g_ScriptRaw, 0, sizeof(g_ScriptRaw));
+	return true;
+}
+
+static void ScriptUNINIT(void)
+{
+}
+
+//このフレームまでのイベントを当てる
+static void ScriptSample(INPUTRAW* raw)
+{
+	while (g_ScriptPos < g_ScriptEventNum && g_ScriptEvent[g_ScriptPos].frame <= g_ScriptFrame)
+	{
+		SetRawKey(&g_ScriptRaw, g_ScriptEvent[g_ScriptPos].key, g_ScriptEvent[g_ScriptPos].IsDown);
+		g_ScriptPos++;
+	}
+	g_ScriptFrame++;
+
+	*raw = g_ScriptRaw;
+}
\ No newline at end of file
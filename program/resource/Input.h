@@ -0,0 +1,202 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include"main.h"
+#include"Mytype.h"
+
+//キーの番号。Windowsの仮想キーコードと同じ値にして、他のバックエンドはここに合わせる
+#define INPUTKEY_LBUTTON (0x01)
+#define INPUTKEY_TAB (0x09)
+#define INPUTKEY_RETURN (0x0D)
+#define INPUTKEY_SHIFT (0x10)
+#define INPUTKEY_CONTROL (0x11)//左右どちらか
+#define INPUTKEY_SPACE (0x20)
+#define INPUTKEY_LEFT (0x25)
+#define INPUTKEY_UP (0x26)
+#define INPUTKEY_RIGHT (0x27)
+#define INPUTKEY_DOWN (0x28)
+#define INPUTKEY_F5 (0x74)
+#define INPUTKEY_F6 (0x75)
+#define INPUTKEY_F7 (0x76)
+#define INPUTKEY_LSHIFT (0xA0)
+#define INPUTKEY_RSHIFT (0xA1)
+#define INPUTKEY_LCONTROL (0xA2)
+#define INPUTKEY_RCONTROL (0xA3)
+#define INPUTKEY_PAD(bit) (256 + (bit))//パッドのボタン。bitはXINPUT_GAMEPAD_*のビットの位置
+#define INPUTKEY_MAX (256 + 16)
+
+#define INPUT_MAXBINDING (2)//一つのアクションに割り当てられるキーの数
+#define INPUT_REPEATDELAY (31)//押し続けてからリピートが始まるまでのフレーム数。そこからは毎フレーム
+#define INPUT_THREADHZ (1000)//入力スレッドがデバイスを読む回数(1秒)
+
+//入力スレッドを使う。フレームの途中の入力も読んだ時間つきで受け取れる
+//#define INPUT_USETHREAD
+
+//ゲームの操作。キーを直接見ずにこれを使う
+enum INPUTACTION
+{
+	action_left,
+	action_right,
+	action_up,
+	action_down,
+	action_place,		//ブロック設置。タイトルとリザルトの決定
+	action_launch,		//ボール発射。メニューの決定
+	action_delete,
+	action_changetype,
+	action_rotate,
+	action_reset,		//ステージ初期化
+	action_resetkeep,	//置いたブロックを残して初期化
+	action_convert,		//古い形式のステージを変換(デバッグ)
+	action_paint,		//線を描く
+	action_paintclear,	//線を消す
+	action_debug,
+	action_voice,
+	action_menu,
+	action_solve,		//全ステージの解を探す(デバッグ)
+	action_record,		//入力の記録を始める・止める
+	action_playback,	//記録した入力を再生
+	action_fastforward,	//記録した入力を描画なしで早送り再生
+
+	ACTIONMAX
+};
+
+//リプレイでも再生しないで、その時の入力を使うアクション
+#define INPUT_METAACTION ((1u << action_record) | (1u << action_playback) | (1u << action_fastforward))
+
+typedef struct
+{
+	int key;//INPUTKEY_*か文字('A'など)。0なら割り当てなし
+	int modifier;//一緒に押しておくキー。なければ0
+}INPUTBINDING;
+
+//デバイスから読んだそのままの状態
+typedef struct
+{
+	unsigned int key[INPUTKEY_MAX / 32];//キーごとのビット
+	short leftStick[2];
+	short rightStick[2];
+	unsigned char leftTrigger;
+	unsigned char rightTrigger;
+	Float2 pointer;//マウスの位置。画面の中心が0
+	bool IsPointerIn;//マウスがウィンドウの中にある
+}INPUTRAW;
+
+//1フレーム分の入力。全部アクションごとのビット
+typedef struct
+{
+	unsigned int down;
+	unsigned int pressed;//このフレームで押した
+	unsigned int released;//このフレームで離した
+	unsigned int repeat;//押した瞬間と、押し続けた時のリピート
+	Float2 pointer;
+	bool IsPointerIn;
+	long long time;//このフレームの入力を読んだ時間(us)
+	long long pressedTime[ACTIONMAX];//押した時間(us)。入力スレッドならフレームの途中の時間になる
+}INPUTSNAPSHOT;
+
+//1フレーム分のゲームに使う入力。リプレイで記録・再生する
+typedef struct
+{
+	unsigned int down;//INPUT_METAACTIONは入らない
+	Float2 pointer;
+	bool IsPointerIn;
+}INPUTFRAME;
+
+//trueを返したフレームはデバイスではなくframeを使う。falseを返したら外れる
+typedef bool(*INPUTFEED)(INPUTFRAME* frame);
+
+enum INPUTEVENTTYPE
+{
+	inputevent_key,
+	inputevent_pointer,	//value=位置
+	inputevent_stick,	//value=左スティック、value2=右スティック
+	inputevent_trigger,	//value=左右のトリガー
+};
+
+//入力スレッドからゲームスレッドに送る変化
+typedef struct
+{
+	long long time;//デバイスを読んだ時間(us)
+	INPUTEVENTTYPE type;
+	int key;
+	bool IsDown;//inputevent_keyなら押した、inputevent_pointerならウィンドウの中
+	short value[2];
+	short value2[2];
+	Float2 pointer;
+}INPUTEVENT;
+
+//入力してから画面に出るまでの時間(us)
+typedef struct
+{
+	int num;
+	long long total;
+	long long max;
+	long long last;
+}INPUTLATENCY;
+
+//入力の取得元。sampleは1フレームに1回だけ呼ばれる
+typedef struct
+{
+	const char* name;
+	bool(*init)(void);
+	void(*uninit)(void);
+	void(*sample)(INPUTRAW* raw);
+}INPUTBACKEND;
+
+//スクリプトの入力。frameはInputUPDATEの回数
+typedef struct
+{
+	int frame;
+	int key;
+	bool IsDown;
+}INPUTSCRIPTEVENT;
+
+void InputINIT(void);
+//全部のデバイスを1回読んで、アクションと押した・離した・リピートを求める。毎フレーム最初に呼ぶ
+void InputUPDATE(void);
+void InputUNINIT(void);
+
+bool GetInputDown(INPUTACTION action);
+bool GetInputPressed(INPUTACTION action);
+bool GetInputReleased(INPUTACTION action);
+bool GetInputRepeat(INPUTACTION action);
+Float2 GetInputPointer(void);
+bool GetIsInputPointerIn(void);
+//押した時間(us)。GetInputTimeと同じ時間
+long long GetInputPressedTime(INPUTACTION action);
+const INPUTSNAPSHOT* GetInputSnapshot(void);
+void GetInputFrame(INPUTFRAME* frame);
+//押している状態とリピートを忘れて、次のフレームで押しているものは全部押した瞬間にする
+void ResetInputState(void);
+//InputUPDATEで使う入力を差し替える。NULLで外す
+void SetInputFeed(INPUTFEED feed);
+//アクションにしていないデバイスの状態(パッドのスティックなど)
+const INPUTRAW* GetInputRaw(void);
+bool GetInputRawKey(const INPUTRAW* raw, int key);
+
+void BindInputAction(INPUTACTION action, int slot, int key, int modifier);
+void ResetInputBinding(void);
+//入力スレッドで読むキーに加える。アクションに割り当てたキーは自動で加わる
+void WatchInputKey(int key);
+
+//InputINITからの時間(us)
+long long GetInputTime(void);
+
+//hz回/秒でデバイスを読むスレッドを動かす。スクリプトのバックエンドでは使えない
+bool InputStartThread(int hz);
+void InputStopThread(void);
+bool GetIsInputThread(void);
+
+//画面を出した直後に呼ぶ。押してからここまでをレイテンシとして記録する
+void InputPresent(void);
+const INPUTLATENCY* GetInputLatency(void);
+void ResetInputLatency(void);
+
+//バックエンドを切り替える。前のバックエンドは終了する
+bool SetInputBackend(const INPUTBACKEND* backend);
+const INPUTBACKEND* GetDefaultInputBackend(void);
+const INPUTBACKEND* GetScriptInputBackend(void);
+//スクリプトのバックエンドで流す入力。eventはframe順で、終わるまで持っておく
+void SetInputScript(const INPUTSCRIPTEVENT* event, int num);
+
+#endif
\ No newline at end of file
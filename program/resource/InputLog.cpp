@@ -0,0 +1,456 @@
+//=================================
+//
+//入力の記録と再生
+//
+//記録を始める時にseedを決めて今のシーンを始め直し、そこからの1フレームごとの入力を記録する。
+//再生は同じseed、同じシーンから始め直して、記録した入力をInputUPDATEに流す。
+//決まったフレームごとにボールとステージのチェックサムを比べて、ずれたら知らせる。
+//早送りは描画と待ちをしないので、同じ記録を流せばベンチマークにもなる。
+//
+//=================================
+
+#include"main.h"
+#include"InputLog.h"
+#include"Scene.h"
+#include"Ball.h"
+#include"StageMaker.h"
+#include"Random.h"
+
+#include<stdio.h>
+#include<time.h>
+#include<math.h>
+#include<vector>
+#include<chrono>
+
+#define INPUTLOG_POINTERIN (1u << 31)//記録する状態の、IsPointerInのビット
+#define INPUTLOG_CHANGEDOWN (1 << 0)
+#define INPUTLOG_CHANGEPOINTER (1 << 1)
+
+static void BeginLog(void);
+static void RecordFrame(void);
+static bool FeedFrame(INPUTFRAME* frame);
+static void CheckFrame(void);
+static void FinishPlayback(void);
+static bool ReadEntryHeader(void);
+static bool ReadEntryBody(void);
+static void WriteVarint(unsigned int num);
+static bool ReadVarint(unsigned int* num);
+static unsigned int ZigZag(int num);
+static int UnZigZag(unsigned int num);
+static int ReadU16(const unsigned char* src);
+static unsigned int ReadU32(const unsigned char* src);
+static void WriteU16(unsigned char* dst, int num);
+static void WriteU32(unsigned char* dst, unsigned int num);
+
+static INPUTLOGMODE g_Mode;
+static bool g_IsFastForward;
+static int g_Frame;
+static unsigned int g_Seed;
+static SCENE g_Scene;
+static STAGE g_Stage;
+static int g_CoinNum;
+static std::vector<unsigned char> g_Data;
+static std::vector<unsigned int> g_Check;
+
+//記録と再生で同じように変わる、前の変化の状態
+static unsigned int g_State;
+static int g_PointerX;
+static int g_PointerY;
+static int g_LastFrame;
+
+//再生
+static int g_FrameNum;
+static size_t g_ReadPos;
+static int g_NextFrame;//次の変化のフレーム。もうなければ-1
+static int g_NextFlags;
+static bool g_IsFed;//このフレームの入力を流した
+static int g_DivergeFrame;//最初にチェックサムがずれたフレーム。ずれていなければ-1
+static int g_CheckOkNum;
+static std::chrono::steady_clock::time_point g_PlayStart;
+
+bool StartInputRecord(void)
+{
+	if (g_Mode != inputlog_none)return false;
+
+	g_Seed = (unsigned int)time(NULL);
+	g_Scene = GetCurrentScene();
+	g_Stage = GetCurrentStage();
+	g_CoinNum = GetCoinNumScene();
+	g_Data.clear();
+	g_Check.clear();
+
+	BeginLog();
+	g_Mode = inputlog_record;
+
+	NN_LOG("InputLog: record start seed:%u scene:%d stage%d\n", g_Seed, g_Scene, g_Stage + 1);
+	return true;
+}
+
+bool StopInputRecord(const char* filename)
+{
+	if (g_Mode != inputlog_record)return false;
+	g_Mode = inputlog_none;
+
+	INPUTLOGHEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INPUTLOG_MAGIC, 4);
+	WriteU16(header.version, INPUTLOG_VERSION);
+	header.scene = (unsigned char)g_Scene;
+	header.stage = (unsigned char)g_Stage;
+	WriteU32(header.seed, g_Seed);
+	WriteU32(header.coinNum, (unsigned int)g_CoinNum);
+	WriteU32(header.frameNum, (unsigned int)g_Frame);
+	WriteU32(header.dataSize, (unsigned int)g_Data.size());
+	WriteU32(header.checkNum, (unsigned int)g_Check.size());
+	WriteU16(header.checkInterval, INPUTLOG_CHECKINTERVAL);
+
+	FILE* fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		NN_LOG("StopInputRecord: %s open failed\n", filename);
+		return false;
+	}
+
+	bool IsOK = fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (!g_Data.empty())IsOK = IsOK && fwrite(&g_Data[0], g_Data.size(), 1, fp) == 1;
+	for (size_t i = 0; i < g_Check.size() && IsOK; i++)
+	{
+		unsigned char check[4];
+		WriteU32(check, g_Check[i]);
+		IsOK = fwrite(check, sizeof(check), 1, fp) == 1;
+	}
+	fclose(fp);
+
+	NN_LOG("InputLog: %s %d frames %d bytes\n", filename, g_Frame, (int)(sizeof(header) + g_Data.size() + g_Check.size() * 4));
+	return IsOK;
+}
+
+bool StartInputPlayback(const char* filename, bool IsFastForward)
+{
+	if (g_Mode != inputlog_none)return false;
+
+	FILE* fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		NN_LOG("StartInputPlayback: %s not found\n", filename);
+		return false;
+	}
+
+	INPUTLOGHEADER header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, INPUTLOG_MAGIC, 4) != 0 ||
+		ReadU16(header.version) != INPUTLOG_VERSION || ReadU16(header.checkInterval) != INPUTLOG_CHECKINTERVAL ||
+		header.scene >= SCENEMAX || header.stage >= STAGEMAX)
+	{
+		NN_LOG("StartInputPlayback: %s is not a replay\n", filename);
+		fclose(fp);
+		return false;
+	}
+
+	g_Seed = ReadU32(header.seed);
+	g_Scene = (SCENE)header.scene;
+	g_Stage = (STAGE)header.stage;
+	g_CoinNum = (int)ReadU32(header.coinNum);
+	g_FrameNum = (int)ReadU32(header.frameNum);
+
+	g_Data.resize(ReadU32(header.dataSize));
+	g_Check.resize(ReadU32(header.checkNum));
+	bool IsOK = g_Data.empty() || fread(&g_Data[0], g_Data.size(), 1, fp) == 1;
+	for (size_t i = 0; i < g_Check.size() && IsOK; i++)
+	{
+		unsigned char check[4];
+		IsOK = fread(check, sizeof(check), 1, fp) == 1;
+		g_Check[i] = ReadU32(check);
+	}
+	fclose(fp);
+
+	if (!IsOK)
+	{
+		NN_LOG("StartInputPlayback: %s is broken\n", filename);
+		g_Data.clear();
+		g_Check.clear();
+		return false;
+	}
+
+	BeginLog();
+	g_ReadPos = 0;
+	g_IsFed = false;
+	g_DivergeFrame = -1;
+	g_CheckOkNum = 0;
+	ReadEntryHeader();
+
+	g_Mode = inputlog_play;
+	g_IsFastForward = IsFastForward;
+	if (IsFastForward)SetIsPresentationOff(true);
+	SetInputFeed(FeedFrame);
+	g_PlayStart = std::chrono::steady_clock::now();
+
+	NN_LOG("InputLog: play %s seed:%u scene:%d stage%d %d frames%s\n", filename, g_Seed, g_Scene, g_Stage + 1,
+		g_FrameNum, IsFastForward ? " fast" : "");
+	return true;
+}
+
+void StopInputPlayback(void)
+{
+	if (g_Mode != inputlog_play)return;
+
+	SetInputFeed(NULL);
+	if (g_IsFastForward)SetIsPresentationOff(false);
+
+	g_Mode = inputlog_none;
+	g_IsFastForward = false;
+	g_Data.clear();
+	g_Check.clear();
+}
+
+//記録と再生で同じ状態から始める
+static void BeginLog(void)
+{
+	g_Frame = 0;
+	g_State = 0;
+	g_PointerX = 0;
+	g_PointerY = 0;
+	g_LastFrame = 0;
+
+	RandomINIT(g_Seed);
+	ResetInputState();
+	RestartScene(g_Scene, g_Stage, g_CoinNum);
+}
+
+void InputLogUPDATE(void)
+{
+	switch (g_Mode)
+	{
+	case inputlog_record:
+		RecordFrame();
+		break;
+
+	case inputlog_play:
+		//最後まで流したら終わり
+		if (!g_IsFed)
+		{
+			FinishPlayback();
+			break;
+		}
+		g_IsFed = false;
+
+		CheckFrame();
+		g_Frame++;
+		break;
+
+	default:
+		break;
+	}
+}
+
+//変わったフレームだけ [前の変化からのフレーム数と変わったもの][押している状態の差][位置の差] を書く
+static void RecordFrame(void)
+{
+	if (g_Frame % INPUTLOG_CHECKINTERVAL == 0)
+	{
+		g_Check.push_back(GetInputLogChecksum());
+	}
+
+	INPUTFRAME frame;
+	GetInputFrame(&frame);
+
+	unsigned int state = frame.down | (frame.IsPointerIn ? INPUTLOG_POINTERIN : 0);
+	int x = (int)floorf(frame.pointer.x + 0.5f);
+	int y = (int)floorf(frame.pointer.y + 0.5f);
+
+	int flags = 0;
+	if (state != g_State)flags |= INPUTLOG_CHANGEDOWN;
+	if (x != g_PointerX || y != g_PointerY)flags |= INPUTLOG_CHANGEPOINTER;
+
+	if (flags != 0)
+	{
+		WriteVarint(((unsigned int)(g_Frame - g_LastFrame) << 2) | flags);
+		if (flags & INPUTLOG_CHANGEDOWN)WriteVarint(state ^ g_State);
+		if (flags & INPUTLOG_CHANGEPOINTER)
+		{
+			WriteVarint(ZigZag(x - g_PointerX));
+			WriteVarint(ZigZag(y - g_PointerY));
+		}
+
+		g_State = state;
+		g_PointerX = x;
+		g_PointerY = y;
+		g_LastFrame = g_Frame;
+	}
+
+	g_Frame++;
+}
+
+//InputUPDATEから呼ばれる。このフレームまでの変化を当てて渡す
+static bool FeedFrame(INPUTFRAME* frame)
+{
+	if (g_Mode != inputlog_play || g_Frame >= g_FrameNum)return false;
+
+	while (g_NextFrame == g_Frame)
+	{
+		if (!ReadEntryBody() || !ReadEntryHeader())
+		{
+			NN_LOG("InputLog: broken entry at frame %d\n", g_Frame);
+			g_NextFrame = -1;
+		}
+	}
+
+	frame->down = g_State & ~INPUTLOG_POINTERIN;
+	frame->IsPointerIn = (g_State & INPUTLOG_POINTERIN) != 0;
+	frame->pointer = MakeFloat2((float)g_PointerX, (float)g_PointerY);
+
+	g_IsFed = true;
+	return true;
+}
+
+static void CheckFrame(void)
+{
+	if (g_Frame % INPUTLOG_CHECKINTERVAL != 0)return;
+
+	size_t n = g_Frame / INPUTLOG_CHECKINTERVAL;
+	if (n >= g_Check.size())return;
+
+	unsigned int checksum = GetInputLogChecksum();
+	if (checksum == g_Check[n])
+	{
+		g_CheckOkNum++;
+	}
+	else if (g_DivergeFrame < 0)
+	{
+		g_DivergeFrame = g_Frame;
+		NN_LOG("InputLog: diverged at frame %d (%08X != %08X)\n", g_Frame, checksum, g_Check[n]);
+	}
+}
+
+static void FinishPlayback(void)
+{
+	long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_PlayStart).count();
+
+	NN_LOG("InputLog: played %d frames in %lldms (%lld fps)%s, check %d/%d %s\n",
+		g_Frame, ms, ms > 0 ? g_Frame * 1000LL / ms : 0LL, g_IsFastForward ? " fast" : "",
+		g_CheckOkNum, (int)g_Check.size(), g_DivergeFrame < 0 ? "ok" : "diverged");
+
+	StopInputPlayback();
+}
+
+//次の変化の、前の変化からのフレーム数と変わったもの
+static bool ReadEntryHeader(void)
+{
+	if (g_ReadPos >= g_Data.size())
+	{
+		g_NextFrame = -1;
+		return true;
+	}
+
+	unsigned int head;
+	if (!ReadVarint(&head))return false;
+
+	g_NextFrame = g_LastFrame + (int)(head >> 2);
+	g_NextFlags = head & 3;
+	return true;
+}
+
+static bool ReadEntryBody(void)
+{
+	if (g_NextFlags & INPUTLOG_CHANGEDOWN)
+	{
+		unsigned int diff;
+		if (!ReadVarint(&diff))return false;
+		g_State ^= diff;
+	}
+	if (g_NextFlags & INPUTLOG_CHANGEPOINTER)
+	{
+		unsigned int dx, dy;
+		if (!ReadVarint(&dx) || !ReadVarint(&dy))return false;
+		g_PointerX += UnZigZag(dx);
+		g_PointerY += UnZigZag(dy);
+	}
+
+	g_LastFrame = g_NextFrame;
+	return true;
+}
+
+INPUTLOGMODE GetInputLogMode(void)
+{
+	return g_Mode;
+}
+
+bool GetIsInputLogFastForward(void)
+{
+	return g_IsFastForward;
+}
+
+int GetInputLogFrame(void)
+{
+	return g_Frame;
+}
+
+unsigned int GetInputLogChecksum(void)
+{
+	int scene[3] = { GetCurrentScene(), GetCurrentStage(), GetCoinNumScene() };
+	Float2 cursor = GetCurrentBlockPos();
+	unsigned int ball = GetBallStateHash();
+
+	unsigned int hash = HashData(HASH_INIT, scene, sizeof(scene));
+	hash = HashData(hash, &cursor, sizeof(cursor));
+	return HashData(hash, &ball, sizeof(ball));
+}
+
+//7ビットずつ、続きがあれば上のビットを立てる
+static void WriteVarint(unsigned int num)
+{
+	while (num >= 0x80)
+	{
+		g_Data.push_back((unsigned char)(num | 0x80));
+		num >>= 7;
+	}
+	g_Data.push_back((unsigned char)num);
+}
+
+static bool ReadVarint(unsigned int* num)
+{
+	*num = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (g_ReadPos >= g_Data.size())return false;
+
+		unsigned char byte = g_Data[g_ReadPos++];
+		*num |= (unsigned int)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))return true;
+	}
+	return false;
+}
+
+//小さい負の数も短くなるように、符号を一番下のビットにする
+static unsigned int ZigZag(int num)
+{
+	return ((unsigned int)num << 1) ^ (unsigned int)(num >> 31);
+}
+
+static int UnZigZag(unsigned int num)
+{
+	return (int)(num >> 1) ^ -(int)(num & 1);
+}
+
+static int ReadU16(const unsigned char* src)
+{
+	return src[0] | (src[1] << 8);
+}
+
+static unsigned int ReadU32(const unsigned char* src)
+{
+	return src[0] | (src[1] << 8) | (src[2] << 16) | ((unsigned int)src[3] << 24);
+}
+
+static void WriteU16(unsigned char* dst, int num)
+{
+	dst[0] = (unsigned char)(num & 0xFF);
+	dst[1] = (unsigned char)((num >> 8) & 0xFF);
+}
+
+static void WriteU32(unsigned char* dst, unsigned int num)
+{
+	dst[0] = (unsigned char)(num & 0xFF);
+	dst[1] = (unsigned char)((num >> 8) & 0xFF);
+	dst[2] = (unsigned char)((num >> 16) & 0xFF);
+	dst[3] = (unsigned char)((num >> 24) & 0xFF);
+}
\ No newline at end of file
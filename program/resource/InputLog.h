@@ -0,0 +1,56 @@
+#ifndef INPUTLOG_H_
+#define INPUTLOG_H_
+
+#include"main.h"
+#include"Input.h"
+
+//入力の記録ファイル(.rpl)
+//[ヘッダー][フレームの変化 × dataSize バイト][チェックサム × checkNum]
+//フレームの変化は、変わったフレームだけを前の変化からの差で可変長(7ビットずつ)に詰めたもの。
+#define INPUTLOG_MAGIC ("RPLB")
+#define INPUTLOG_VERSION (1)
+#define INPUTLOG_FILENAME ("replay.rpl")
+#define INPUTLOG_CHECKINTERVAL (60)//チェックサムを取るフレームの間隔
+#define INPUTLOG_DRAWINTERVAL (600)//早送り中に描画するフレームの間隔
+
+enum INPUTLOGMODE
+{
+	inputlog_none,
+	inputlog_record,
+	inputlog_play,
+};
+
+//2バイト以上の数値はリトルエンディアン
+typedef struct
+{
+	char magic[4];
+	unsigned char version[2];
+	unsigned char scene;
+	unsigned char stage;
+	unsigned char seed[4];
+	unsigned char coinNum[4];
+	unsigned char frameNum[4];
+	unsigned char dataSize[4];
+	unsigned char checkNum[4];
+	unsigned char checkInterval[2];
+	unsigned char reserved[2];
+}INPUTLOGHEADER;
+
+//今のシーンを新しいseedで始め直して、そこから記録する
+bool StartInputRecord(void);
+//記録をfilenameに書く
+bool StopInputRecord(const char* filename);
+//記録したseed、ステージから始め直して再生する。IsFastForwardなら描画、音、エフェクトなしで待たずに進める
+bool StartInputPlayback(const char* filename, bool IsFastForward);
+void StopInputPlayback(void);
+//InputUPDATEの直後、シーンを更新する前に呼ぶ
+void InputLogUPDATE(void);
+
+INPUTLOGMODE GetInputLogMode(void);
+bool GetIsInputLogFastForward(void);
+//記録・再生を始めてからのフレーム数
+int GetInputLogFrame(void);
+//ボールとステージ、シーンのチェックサム。同じ入力なら同じ値になる
+unsigned int GetInputLogChecksum(void);
+
+#endif
\ No newline at end of file
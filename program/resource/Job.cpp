@@ -0,0 +1,452 @@
+//=================================
+//
+//ジョブシステム
+//
+//ワーカースレッドごとのキューにジョブを積む。自分のキューは後ろから取り(深さ優先)、
+//空になったら他のキューの前から古いジョブを盗む。
+//終わりはJOBCOUNTERで待ち、RunJobsAfterでカウンターの後にジョブをつなげるとタスクグラフになる。
+//名前はnn::osのEvent(Initialize/Wait/TryWait)に合わせてある。
+//
+//メインスレッドのステージやボールはthread_localなので、メインスレッドでは他のジョブを動かさない。
+//待っている間にジョブを動かすのはワーカーと、ParallelForの自分のループだけ。
+//
+//=================================
+
+#include"Job.h"
+#include"FrameHeap.h"
+#include"AllocTrack.h"
+
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<deque>
+#include<vector>
+
+typedef struct
+{
+	JOB job;
+	JOBCOUNTER* counter;
+}JOBENTRY;
+
+typedef struct
+{
+	std::mutex mutex;
+	std::deque<JOBENTRY> job;
+}JOBQUEUE;
+
+//dependencyが0になるのを待っているジョブ
+typedef struct
+{
+	JOBCOUNTER* dependency;
+	JOBENTRY entry;
+}JOBPARK;
+
+#define JOB_MAXLOOP (16)//同時に回せるParallelFor。足りなければヒープから取る
+
+//ParallelForのループ。遅れて動いたジョブも触るので、最後に離したスレッドが返す
+typedef struct
+{
+	PARALLELFUNCTION function;
+	void* argument;
+	int num;
+	int batch;
+	int batchNum;
+	std::atomic<int> next;
+	std::atomic<int> doneNum;
+	std::atomic<int> refNum;//0なら空き
+	bool IsPool;
+}PARALLELFOR;
+
+static void JobWorker(int worker);
+static void StartJob(const JOBENTRY* entry);
+static void PushJob(const JOBENTRY* entry);
+static bool PopJob(int worker, JOBENTRY* entry);
+static void ExecuteJob(const JOBENTRY* entry);
+static void FinishJob(JOBCOUNTER* counter);
+static void ParallelForJob(void* argument);
+static void RunParallelFor(PARALLELFOR* loop);
+static void ReleaseParallelFor(PARALLELFOR* loop);
+
+static std::thread g_Thread[JOB_MAXTHREAD];
+static JOBQUEUE g_Queue[JOB_MAXTHREAD];
+static int g_ThreadNum;
+static std::atomic<int> g_QueuedNum;
+static std::atomic<unsigned int> g_NextQueue;//ワーカー以外から積むキュー
+static std::atomic<int> g_RunNum;
+static std::atomic<int> g_StealNum;
+static std::mutex g_WakeMutex;
+static std::condition_variable g_WakeCond;//ジョブが積まれた
+static std::condition_variable g_DoneCond;//カウンターが0になった
+static bool g_IsJobEnd;
+static std::mutex g_ParkMutex;
+static std::vector<JOBPARK> g_Park;
+static PARALLELFOR g_Loop[JOB_MAXLOOP];
+static thread_local int g_WorkerIndex = -1;
+
+void JobINIT(int threadnum)
+{
+	if (g_ThreadNum > 0)return;
+
+	//メインスレッドの分を1コア残す
+	if (threadnum <= 0)
+	{
+		threadnum = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if (threadnum < 1)threadnum = 1;
+	if (threadnum > JOB_MAXTHREAD)threadnum = JOB_MAXTHREAD;
+
+	g_QueuedNum = 0;
+	g_NextQueue = 0;
+	g_RunNum = 0;
+	g_StealNum = 0;
+	g_IsJobEnd = false;
+	g_ThreadNum = threadnum;
+
+	for (int i = 0; i < threadnum; i++)
+	{
+		g_Thread[i] = std::thread(JobWorker, i);
+	}
+}
+
+void JobUNINIT(void)
+{
+	if (g_ThreadNum == 0)return;
+
+	{
+		std::lock_guard<std::mutex> lock(g_WakeMutex);
+		g_IsJobEnd = true;
+	}
+	g_WakeCond.notify_all();
+
+	for (int i = 0; i < g_ThreadNum; i++)
+	{
+		g_Thread[i].join();
+	}
+
+	if (!g_Park.empty())
+	{
+		NN_LOG("Job: %d jobs are still waiting for a counter\n", (int)g_Park.size());
+		g_Park.clear();
+	}
+	NN_LOG("Job: %d threads, %d jobs, %d stolen\n", g_ThreadNum, (int)g_RunNum, (int)g_StealNum);
+
+	g_ThreadNum = 0;
+}
+
+int GetJobThreadNum(void)
+{
+	return g_ThreadNum;
+}
+
+int GetJobWorkerIndex(void)
+{
+	return g_WorkerIndex;
+}
+
+void InitializeJobCounter(JOBCOUNTER* counter)
+{
+	counter->count = 0;
+}
+
+void RunJobs(const JOB* job, int num, JOBCOUNTER* counter)
+{
+	//先に全部数えておかないと、最初のジョブが終わった時に0になってしまう
+	if (counter != NULL)counter->count += num;
+
+	for (int i = 0; i < num; i++)
+	{
+		JOBENTRY entry;
+		entry.job = job[i];
+		entry.counter = counter;
+		StartJob(&entry);
+	}
+}
+
+void RunJobsAfter(JOBCOUNTER* dependency, const JOB* job, int num, JOBCOUNTER* counter)
+{
+	if (counter != NULL)counter->count += num;
+
+	//FinishJobは0にしてからg_ParkMutexを取るので、ここで0でなければ後で必ず見つけてもらえる
+	std::unique_lock<std::mutex> lock(g_ParkMutex);
+	bool IsPark = dependency->count > 0;
+
+	for (int i = 0; i < num; i++)
+	{
+		JOBPARK park;
+		park.dependency = dependency;
+		park.entry.job = job[i];
+		park.entry.counter = counter;
+
+		if (IsPark)
+		{
+			g_Park.push_back(park);
+		}
+		else
+		{
+			lock.unlock();
+			StartJob(&park.entry);
+			lock.lock();
+		}
+	}
+}
+
+void WaitJobCounter(JOBCOUNTER* counter)
+{
+	while (counter->count > 0)
+	{
+		//ワーカーは待っている間に他のジョブを動かす。止まるとキューが詰まる
+		if (g_WorkerIndex >= 0)
+		{
+			JOBENTRY entry;
+			if (PopJob(g_WorkerIndex, &entry))
+			{
+				ExecuteJob(&entry);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(g_WakeMutex);
+		if (counter->count > 0)
+		{
+			g_DoneCond.wait(lock);
+		}
+	}
+}
+
+bool TryWaitJobCounter(JOBCOUNTER* counter)
+{
+	return counter->count <= 0;
+}
+
+void ParallelFor(int num, int batch, PARALLELFUNCTION function, void* argument)
+{
+	if (num <= 0)return;
+	if (batch < 1)batch = 1;
+
+	if (num <= batch || g_ThreadNum == 0)
+	{
+		function(0, num, argument);
+		return;
+	}
+
+	//毎フレーム呼ばれるので、ヒープから取らずに空いているものを使う
+	PARALLELFOR* loop = NULL;
+	for (int i = 0; i < JOB_MAXLOOP && loop == NULL; i++)
+	{
+		int free = 0;
+		if (g_Loop[i].refNum.compare_exchange_strong(free, -1))
+		{
+			loop = &g_Loop[i];
+			loop->IsPool = true;
+		}
+	}
+	if (loop == NULL)
+	{
+		loop = new PARALLELFOR;
+		loop->IsPool = false;
+	}
+
+	loop->function = function;
+	loop->argument = argument;
+	loop->num = num;
+	loop->batch = batch;
+	loop->batchNum = (num + batch - 1) / batch;
+	loop->next = 0;
+	loop->doneNum = 0;
+
+	//呼んだスレッドも回すので、ワーカーにはバッチ数-1まで配る
+	int jobnum = loop->batchNum - 1 < g_ThreadNum ? loop->batchNum - 1 : g_ThreadNum;
+	loop->refNum = jobnum + 1;
+
+	JOB job[JOB_MAXTHREAD];
+	for (int i = 0; i < jobnum; i++)
+	{
+		job[i].function = ParallelForJob;
+		job[i].argument = loop;
+	}
+	RunJobs(job, jobnum, NULL);
+
+	RunParallelFor(loop);
+
+	//ワーカーが処理中のバッチだけ待つ。まだ始まっていないジョブは後で何もせずに終わる
+	while (loop->doneNum < loop->batchNum)
+	{
+		std::this_thread::yield();
+	}
+
+	ReleaseParallelFor(loop);
+}
+
+static void JobWorker(int worker)
+{
+	g_WorkerIndex = worker;
+
+	//ワーカーでは描画、音、エフェクトを使わない
+	SetIsHeadless(true);
+
+	//スクラッチはジョブ一つの間だけ使える
+	CreateThreadFrameHeap(FRAMEHEAP_WORKERSIZE);
+
+	//ワーカーでの確保は別に数える
+	SetAllocPhase(allocphase_worker);
+
+	while (true)
+	{
+		JOBENTRY entry;
+		if (PopJob(worker, &entry))
+		{
+			ExecuteJob(&entry);
+			ResetThreadFrameHeap();
+			continue;
+		}
+
+		//積まれた数は先に増えるので、まだ取れていないジョブがあればもう一回探す
+		std::unique_lock<std::mutex> lock(g_WakeMutex);
+		if (g_QueuedNum > 0)continue;
+		if (g_IsJobEnd)break;
+		g_WakeCond.wait(lock);
+	}
+
+	DestroyThreadFrameHeap();
+}
+
+static void StartJob(const JOBENTRY* entry)
+{
+	//JobINITの前は呼んだスレッドでそのまま動かす
+	if (g_ThreadNum == 0)
+	{
+		ExecuteJob(entry);
+		return;
+	}
+	PushJob(entry);
+}
+
+static void PushJob(const JOBENTRY* entry)
+{
+	int queue = g_WorkerIndex >= 0 ? g_WorkerIndex : (int)(g_NextQueue++ % g_ThreadNum);
+
+	g_QueuedNum++;
+	{
+		std::lock_guard<std::mutex> lock(g_Queue[queue].mutex);
+		g_Queue[queue].job.push_back(*entry);
+	}
+
+	//寝ようとしているワーカーがg_QueuedNumを見てから待つまでの間に起こさないようにする
+	{
+		std::lock_guard<std::mutex> lock(g_WakeMutex);
+	}
+	g_WakeCond.notify_one();
+}
+
+static bool PopJob(int worker, JOBENTRY* entry)
+{
+	//自分のジョブ(深さ優先)
+	{
+		std::lock_guard<std::mutex> lock(g_Queue[worker].mutex);
+		if (!g_Queue[worker].job.empty())
+		{
+			*entry = g_Queue[worker].job.back();
+			g_Queue[worker].job.pop_back();
+			g_QueuedNum--;
+			return true;
+		}
+	}
+
+	//他のスレッドから古いジョブを盗む
+	for (int i = 1; i < g_ThreadNum; i++)
+	{
+		int victim = (worker + i) % g_ThreadNum;
+
+		std::lock_guard<std::mutex> lock(g_Queue[victim].mutex);
+		if (!g_Queue[victim].job.empty())
+		{
+			*entry = g_Queue[victim].job.front();
+			g_Queue[victim].job.pop_front();
+			g_QueuedNum--;
+			g_StealNum++;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ExecuteJob(const JOBENTRY* entry)
+{
+	entry->job.function(entry->job.argument);
+	g_RunNum++;
+
+	FinishJob(entry->counter);
+}
+
+//カウンターを減らす。0になったらつながっているジョブを積んで、待っているスレッドを起こす
+static void FinishJob(JOBCOUNTER* counter)
+{
+	if (counter == NULL)return;
+	if (--counter->count > 0)return;
+
+	std::vector<JOBENTRY> ready;
+	{
+		std::lock_guard<std::mutex> lock(g_ParkMutex);
+		for (std::vector<JOBPARK>::iterator it = g_Park.begin(); it != g_Park.end();)
+		{
+			if (it->dependency == counter)
+			{
+				ready.push_back(it->entry);
+				it = g_Park.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		StartJob(&ready[i]);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(g_WakeMutex);
+	}
+	g_DoneCond.notify_all();
+}
+
+static void ParallelForJob(void* argument)
+{
+	PARALLELFOR* loop = (PARALLELFOR*)argument;
+
+	RunParallelFor(loop);
+	ReleaseParallelFor(loop);
+}
+
+//残っているバッチを一つずつ取って処理する
+static void RunParallelFor(PARALLELFOR* loop)
+{
+	while (true)
+	{
+		int n = loop->next++;
+		if (n >= loop->batchNum)break;
+
+		int begin = n * loop->batch;
+		int end = begin + loop->batch < loop->num ? begin + loop->batch : loop->num;
+		loop->function(begin, end, loop->argument);
+
+		loop->doneNum++;
+	}
+}
+
+static void ReleaseParallelFor(PARALLELFOR* loop)
+{
+	//0にした後は他のParallelForが使い始めるかもしれないので、先に見ておく
+	bool IsPool = loop->IsPool;
+
+	if (--loop->refNum == 0 && !IsPool)
+	{
+		delete loop;
+	}
+}
\ No newline at end of file
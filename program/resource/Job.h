@@ -0,0 +1,50 @@
+#ifndef JOB_H_
+#define JOB_H_
+
+#include"main.h"
+
+#include<atomic>
+
+#define JOB_MAXTHREAD (64)
+
+//nn::os::ThreadFunctionと同じ形
+typedef void(*JOBFUNCTION)(void* argument);
+//ParallelForで[begin, end)を処理する関数
+typedef void(*PARALLELFUNCTION)(int begin, int end, void* argument);
+
+typedef struct
+{
+	JOBFUNCTION function;
+	void* argument;
+}JOB;
+
+//nn::os::EventTypeのように使う。積んだジョブが全部終わると0になる。
+typedef struct
+{
+	std::atomic<int> count;
+}JOBCOUNTER;
+
+//ワーカースレッドを作る。threadnumが0ならCPUのコア数-1(最低1)。
+void JobINIT(int threadnum);
+//積まれているジョブを全部終わらせてから止める
+void JobUNINIT(void);
+
+int GetJobThreadNum(void);
+//ワーカースレッドなら番号、それ以外は-1
+int GetJobWorkerIndex(void);
+
+void InitializeJobCounter(JOBCOUNTER* counter);
+//ジョブを積む。counterは積んだ数だけ増えて、終わるたびに減る。NULLでもいい。
+//ワーカーから積んだジョブは自分のキューに入り、暇なワーカーに盗まれる。
+void RunJobs(const JOB* job, int num, JOBCOUNTER* counter);
+//dependencyが0になってから動かす。タスクグラフの辺になる。
+void RunJobsAfter(JOBCOUNTER* dependency, const JOB* job, int num, JOBCOUNTER* counter);
+//counterが0になるまで待つ。ワーカーから呼ぶと待つ間ほかのジョブを動かす。
+void WaitJobCounter(JOBCOUNTER* counter);
+bool TryWaitJobCounter(JOBCOUNTER* counter);
+
+//0～num-1をbatch個ずつに分けてワーカーと呼んだスレッドで処理する。終わるまで戻らない。
+//num <= batchかワーカーがいなければ呼んだスレッドだけで処理する。
+void ParallelFor(int num, int batch, PARALLELFUNCTION function, void* argument);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+//=================================
+//
+//キャッシュする層
+//
+//背景と動かないブロックのように、変わった時だけ描き直せばいいものを
+//画面と同じ大きさのテクスチャに描いておき、毎フレームは1枚貼るだけにする。
+//
+//keyが変わったフレームは直接描き、同じkeyがもう1フレーム続いたらテクスチャに描く。
+//カメラが動いている間は毎フレーム変わるので、描き直して貼る分の無駄が出ない。
+//フレームバッファが作れなければずっと直接描く。
+//
+//=================================
+
+#include"Layer.h"
+#include"texture.h"
+#include"FaceGen.h"
+#include"MemoryLedger.h"
+
+static bool CreateLayer(LAYER* layer);
+
+static GLint g_Viewport[4];//テクスチャに描く前のビューポート
+static GLint g_FrameBuffer;//テクスチャに描く前のフレームバッファ。内部解像度のターゲットのこともある
+
+void InitLayerFrom(LAYER* layer, const char* Owner, const char* Name)
+{
+	layer->frameBuffer = 0;
+	layer->texture = 0;
+	layer->IsCreated = false;
+	layer->IsFailed = false;
+	layer->IsValid = false;
+	layer->IsDirect = true;
+	layer->IsRendering = false;
+	layer->key = 0;
+	layer->scene = GetLedgerScene();
+	layer->renderNum = 0;
+	layer->directNum = 0;
+	layer->owner = Owner;
+	layer->name = Name;
+}
+
+void UninitLayer(LAYER* layer)
+{
+	if (layer->IsCreated)
+	{
+		glDeleteFramebuffers(1, &layer->frameBuffer);
+		UnloadTexture(layer->texture);
+	}
+
+	layer->frameBuffer = 0;
+	layer->texture = 0;
+	layer->IsCreated = false;
+	layer->IsValid = false;
+}
+
+void InvalidateLayer(LAYER* layer)
+{
+	layer->IsValid = false;
+}
+
+bool BeginLayer(LAYER* layer, unsigned int key)
+{
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &g_FrameBuffer);
+
+	if (!layer->IsCreated && !layer->IsFailed)CreateLayer(layer);
+
+	bool IsChanged = key != layer->key;
+	layer->key = key;
+
+	if (layer->IsFailed || IsChanged)
+	{
+		layer->IsValid = false;
+		layer->IsDirect = true;
+		layer->directNum++;
+		return true;
+	}
+
+	layer->IsDirect = false;
+	if (layer->IsValid)return false;
+
+	glGetIntegerv(GL_VIEWPORT, g_Viewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, layer->frameBuffer);
+	glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	//mainのクリアと同じ色
+	glClearColor(0.0f, 0.05f, 0.09f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	layer->IsRendering = true;
+	return true;
+}
+
+void EndLayer(LAYER* layer)
+{
+	if (!layer->IsRendering)return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, g_FrameBuffer);
+	glViewport(g_Viewport[0], g_Viewport[1], g_Viewport[2], g_Viewport[3]);
+
+	layer->IsRendering = false;
+	layer->IsValid = true;
+	layer->renderNum++;
+}
+
+void DrawLayer(const LAYER* layer)
+{
+	if (layer->IsDirect || !layer->IsValid)return;
+
+	FaceGenFrameTex(layer->texture, NORMALCOLOR);
+}
+
+//一番下の層なのでアルファはいらない
+static bool CreateLayer(LAYER* layer)
+{
+	glGenTextures(1, &layer->texture);
+	glBindTexture(GL_TEXTURE_2D, layer->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &layer->frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, layer->frameBuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer->texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, g_FrameBuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		NN_LOG("CreateLayer: %s framebuffer is not complete (0x%x), drawing directly\n", layer->name, status);
+		glDeleteFramebuffers(1, &layer->frameBuffer);
+		glDeleteTextures(1, &layer->texture);
+		layer->frameBuffer = 0;
+		layer->texture = 0;
+		layer->IsFailed = true;
+		return false;
+	}
+
+	//INITした時のシーンに入れる
+	int scene = GetLedgerScene();
+	SetLedgerScene(layer->scene);
+	RegisterLedger(ledger_texture, layer->texture, SCREEN_WIDTH * SCREEN_HEIGHT * 3, layer->owner, layer->name);
+	SetLedgerScene(scene);
+
+	//貼る時にブレンドしない
+	SetTextureOpacity(layer->texture, texopacity_opaque);
+
+	layer->IsCreated = true;
+	return true;
+}
\ No newline at end of file
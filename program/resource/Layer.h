@@ -0,0 +1,40 @@
+#ifndef LAYER_H_
+#define LAYER_H_
+
+#include"main.h"
+
+//画面と同じ大きさのテクスチャに描いておく、動かない一番下の層。
+//keyが変わらない間は描き直さず、1枚貼るだけにする
+typedef struct
+{
+	UINT frameBuffer;
+	UINT texture;
+	bool IsCreated;
+	bool IsFailed;//フレームバッファが作れなかった。毎フレーム直接描く
+	bool IsValid;//テクスチャの中身がkeyのもの
+	bool IsDirect;//このフレームは画面に直接描いた
+	bool IsRendering;
+	unsigned int key;
+	int scene;//台帳に入れるシーン。作るのは最初に描く時なので覚えておく
+	int renderNum;//テクスチャに描き直した回数
+	int directNum;//直接描いた回数
+	const char* owner;
+	const char* name;
+}LAYER;
+
+//シーンのINITで呼ぶ。フレームバッファは最初に描く時に作る
+void InitLayerFrom(LAYER* layer, const char* Owner, const char* Name);
+#define InitLayer(layer, Name) InitLayerFrom(layer, __FILE__, Name)
+void UninitLayer(LAYER* layer);
+//次に描く時に描き直す
+void InvalidateLayer(LAYER* layer);
+
+//中身を描くならtrue。trueならEndLayerまでに描く。
+//keyが前のフレームと違う時は、まだ変わり続けるかもしれないので画面に直接描かせる。
+//同じkeyが続いたらテクスチャに描いて、その後は描かせない
+bool BeginLayer(LAYER* layer, unsigned int key);
+void EndLayer(LAYER* layer);
+//テクスチャを画面に貼る。直接描いたフレームは何もしない
+void DrawLayer(const LAYER* layer);
+
+#endif
\ No newline at end of file
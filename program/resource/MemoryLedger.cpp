@@ -0,0 +1,266 @@
+//=================================
+//
+//メモリの台帳
+//
+//テクスチャ、バッファ、音を作る所で大きさと持ち主とシーンを登録し、消す所で外す。
+//シーンごとに今の量と最大を数え、予算を超えたらログに出す。
+//シーンを終えた後に残っているものはリークとして出す。
+//
+//フレームヒープはワーカーからも登録するのでロックする。どのシーンに入れるかはスレッドごと。
+//
+//=================================
+
+#include"MemoryLedger.h"
+
+#include<mutex>
+#include<string.h>
+
+#define LEDGER_GPUBUDGET (64 * 1024 * 1024)
+#define LEDGER_CPUBUDGET (32 * 1024 * 1024)
+
+typedef struct
+{
+	bool IsUse;
+	bool IsLeaked;//リークとして出した。同じものは二度出さない
+	LEDGERKIND kind;
+	uintptr_t id;
+	size_t size;
+	int scene;
+	char owner[LEDGER_OWNERMAX];
+	char name[LEDGER_NAMEMAX];
+}LEDGERENTRY;
+
+typedef struct
+{
+	size_t size[LEDGERKINDMAX];
+	size_t peak[LEDGERKINDMAX];
+	int overNum;//予算を超えた回数
+	bool IsOver;
+}LEDGERSCENE;
+
+static LEDGERENTRY* FindLedger(LEDGERKIND kind, uintptr_t id);
+static void CopyOwner(char* dest, const char* owner);
+static void AddLedgerSize(int scene, LEDGERKIND kind, size_t size, bool IsAdd);
+static void CheckLedgerBudget(int scene);
+static size_t GetLedgerGpuSize(int scene);
+static size_t GetLedgerCpuSize(int scene);
+
+static const char* g_SceneName[LEDGER_SCENENUM] = { "title", "game", "result", "shared" };
+static const char* g_KindName[LEDGERKINDMAX] = { "texture", "buffer", "sound" };
+
+static std::mutex g_Mutex;
+static LEDGERENTRY g_Entry[LEDGER_MAX];
+static LEDGERSCENE g_Scene[LEDGER_SCENENUM];
+static LEDGERBUDGET g_Budget[LEDGER_SCENENUM] =
+{
+	{ LEDGER_GPUBUDGET, LEDGER_CPUBUDGET },
+	{ LEDGER_GPUBUDGET, LEDGER_CPUBUDGET },
+	{ LEDGER_GPUBUDGET, LEDGER_CPUBUDGET },
+	{ LEDGER_GPUBUDGET, LEDGER_CPUBUDGET },
+};
+static thread_local int g_LedgerScene = LEDGER_SHARED;
+static int g_LeakNum;
+static int g_FullNum;
+
+void SetLedgerScene(int scene)
+{
+	g_LedgerScene = scene;
+}
+
+int GetLedgerScene(void)
+{
+	return g_LedgerScene;
+}
+
+void RegisterLedger(LEDGERKIND kind, uintptr_t id, size_t size, const char* owner, const char* name)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	//同じidを作り直した時は前のものを外す
+	LEDGERENTRY* entry = FindLedger(kind, id);
+	if (entry != NULL)
+	{
+		AddLedgerSize(entry->scene, entry->kind, entry->size, false);
+		entry->IsUse = false;
+	}
+
+	for (int i = 0; i < LEDGER_MAX && entry == NULL; i++)
+	{
+		if (!g_Entry[i].IsUse)entry = &g_Entry[i];
+	}
+	if (entry == NULL)
+	{
+		g_FullNum++;
+		return;
+	}
+
+	entry->IsUse = true;
+	entry->IsLeaked = false;
+	entry->kind = kind;
+	entry->id = id;
+	entry->size = size;
+	entry->scene = g_LedgerScene;
+	CopyOwner(entry->owner, owner);
+	strncpy(entry->name, name != NULL ? name : "", LEDGER_NAMEMAX - 1);
+	entry->name[LEDGER_NAMEMAX - 1] = '\0';
+
+	AddLedgerSize(entry->scene, kind, size, true);
+	CheckLedgerBudget(entry->scene);
+}
+
+void UnregisterLedger(LEDGERKIND kind, uintptr_t id)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	LEDGERENTRY* entry = FindLedger(kind, id);
+	if (entry == NULL)return;
+
+	AddLedgerSize(entry->scene, entry->kind, entry->size, false);
+	entry->IsUse = false;
+	CheckLedgerBudget(entry->scene);
+}
+
+void SetLedgerOwner(LEDGERKIND kind, uintptr_t id, const char* owner)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	LEDGERENTRY* entry = FindLedger(kind, id);
+	if (entry == NULL)return;
+
+	AddLedgerSize(entry->scene, entry->kind, entry->size, false);
+	entry->scene = g_LedgerScene;
+	CopyOwner(entry->owner, owner);
+	AddLedgerSize(entry->scene, entry->kind, entry->size, true);
+	CheckLedgerBudget(entry->scene);
+}
+
+void CheckLedgerLeak(int scene)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	for (int i = 0; i < LEDGER_MAX; i++)
+	{
+		LEDGERENTRY* entry = &g_Entry[i];
+		if (!entry->IsUse || entry->IsLeaked || entry->scene != scene)continue;
+
+		entry->IsLeaked = true;
+		g_LeakNum++;
+		NN_LOG("Ledger: leaked %s %s (%dKB) from %s in %s\n",
+			g_KindName[entry->kind], entry->name, (int)(entry->size / 1024), entry->owner, g_SceneName[scene]);
+	}
+}
+
+void SetLedgerBudget(int scene, size_t gpu, size_t cpu)
+{
+	g_Budget[scene].gpu = gpu;
+	g_Budget[scene].cpu = cpu;
+}
+
+const LEDGERBUDGET* GetLedgerBudget(int scene)
+{
+	return &g_Budget[scene];
+}
+
+size_t GetLedgerSize(int scene, LEDGERKIND kind)
+{
+	return g_Scene[scene].size[kind];
+}
+
+void LedgerReport(void)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+
+	for (int i = 0; i < LEDGER_SCENENUM; i++)
+	{
+		const LEDGERSCENE* stat = &g_Scene[i];
+
+		NN_LOG("Ledger: %s peak texture %dKB buffer %dKB sound %dKB, budget gpu %dKB cpu %dKB, %d overruns\n",
+			g_SceneName[i], (int)(stat->peak[ledger_texture] / 1024), (int)(stat->peak[ledger_buffer] / 1024),
+			(int)(stat->peak[ledger_sound] / 1024), (int)(g_Budget[i].gpu / 1024), (int)(g_Budget[i].cpu / 1024), stat->overNum);
+	}
+
+	//全部UNINITした後に呼ぶので、残っているものはリーク
+	int remainNum = 0;
+	for (int i = 0; i < LEDGER_MAX; i++)
+	{
+		const LEDGERENTRY* entry = &g_Entry[i];
+		if (!entry->IsUse)continue;
+
+		remainNum++;
+		NN_LOG("Ledger: not released %s %s (%dKB) from %s in %s\n",
+			g_KindName[entry->kind], entry->name, (int)(entry->size / 1024), entry->owner, g_SceneName[entry->scene]);
+	}
+
+	NN_LOG("Ledger: %d leaked at scene change, %d not released, %d not registered (ledger full)\n", g_LeakNum, remainNum, g_FullNum);
+}
+
+static LEDGERENTRY* FindLedger(LEDGERKIND kind, uintptr_t id)
+{
+	for (int i = 0; i < LEDGER_MAX; i++)
+	{
+		if (g_Entry[i].IsUse && g_Entry[i].kind == kind && g_Entry[i].id == id)return &g_Entry[i];
+	}
+	return NULL;
+}
+
+//"../program/Title.cpp"なら"Title"にする
+static void CopyOwner(char* dest, const char* owner)
+{
+	if (owner == NULL)owner = "";
+
+	const char* begin = owner;
+	for (const char* p = owner; *p != '\0'; p++)
+	{
+		if (*p == '/' || *p == '\\')begin = p + 1;
+	}
+
+	int length = 0;
+	while (begin[length] != '\0' && begin[length] != '.' && length < LEDGER_OWNERMAX - 1)
+	{
+		dest[length] = begin[length];
+		length++;
+	}
+	dest[length] = '\0';
+}
+
+static void AddLedgerSize(int scene, LEDGERKIND kind, size_t size, bool IsAdd)
+{
+	LEDGERSCENE* stat = &g_Scene[scene];
+
+	if (IsAdd)
+	{
+		stat->size[kind] += size;
+		if (stat->size[kind] > stat->peak[kind])stat->peak[kind] = stat->size[kind];
+	}
+	else
+	{
+		stat->size[kind] -= size;
+	}
+}
+
+//超えた時に一度だけ出す。下回ったらまた出す
+static void CheckLedgerBudget(int scene)
+{
+	LEDGERSCENE* stat = &g_Scene[scene];
+	size_t gpu = GetLedgerGpuSize(scene);
+	size_t cpu = GetLedgerCpuSize(scene);
+	bool IsOver = gpu > g_Budget[scene].gpu || cpu > g_Budget[scene].cpu;
+
+	if (IsOver && !stat->IsOver)
+	{
+		stat->overNum++;
+		NN_LOG("Ledger: %s over budget, gpu %dKB/%dKB cpu %dKB/%dKB\n", g_SceneName[scene],
+			(int)(gpu / 1024), (int)(g_Budget[scene].gpu / 1024), (int)(cpu / 1024), (int)(g_Budget[scene].cpu / 1024));
+	}
+	stat->IsOver = IsOver;
+}
+
+static size_t GetLedgerGpuSize(int scene)
+{
+	return g_Scene[scene].size[ledger_texture];
+}
+
+static size_t GetLedgerCpuSize(int scene)
+{
+	return g_Scene[scene].size[ledger_buffer] + g_Scene[scene].size[ledger_sound];
+}
\ No newline at end of file
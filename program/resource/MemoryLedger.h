@@ -0,0 +1,48 @@
+#ifndef MEMORYLEDGER_H_
+#define MEMORYLEDGER_H_
+
+#include"main.h"
+#include"Scene.h"
+
+#include<stdint.h>
+
+#define LEDGER_MAX (256)			//同時に登録できる数
+#define LEDGER_SHARED (SCENEMAX)	//シーンに属さないもの。フレームヒープ、音、先読みなど
+#define LEDGER_SCENENUM (SCENEMAX + 1)
+#define LEDGER_NAMEMAX (64)
+#define LEDGER_OWNERMAX (32)
+
+//テクスチャはGPU、それ以外はCPUの予算に入る
+enum LEDGERKIND
+{
+	ledger_texture,
+	ledger_buffer,
+	ledger_sound,
+
+	LEDGERKINDMAX
+};
+
+typedef struct
+{
+	size_t gpu;
+	size_t cpu;
+}LEDGERBUDGET;
+
+//このスレッドでこれから登録するものをどのシーンに入れるか。LEDGER_SHAREDならどのシーンにも入らない
+void SetLedgerScene(int scene);
+int GetLedgerScene(void);
+//idは種類ごとに一つ。ownerは__FILE__でもいい(フォルダと拡張子は取る)
+void RegisterLedger(LEDGERKIND kind, uintptr_t id, size_t size, const char* owner, const char* name);
+void UnregisterLedger(LEDGERKIND kind, uintptr_t id);
+//先読みしたものを使う所に渡す。今のシーンに移る
+void SetLedgerOwner(LEDGERKIND kind, uintptr_t id, const char* owner);
+//シーンのUNINITの後に呼ぶ。そのシーンのものが残っていたらリークとして出す
+void CheckLedgerLeak(int scene);
+
+void SetLedgerBudget(int scene, size_t gpu, size_t cpu);
+const LEDGERBUDGET* GetLedgerBudget(int scene);
+size_t GetLedgerSize(int scene, LEDGERKIND kind);
+//シーンごとの最大と、残っているものをログに出す
+void LedgerReport(void);
+
+#endif
\ No newline at end of file
@@ -1,6 +1,5 @@
 
 #include"Mytype.h"
-#include<stdlib.h>
 
 Int2 MakeInt2(int x, int y)
 {
@@ -11,13 +10,30 @@ Int2 MakeInt2(int x, int y)
 	return alfa;
 }
 
-//߂l͍ŏminAőmax - 1B
-int GetRandomNum(int min, int max)
+Fixed2 MakeFixed2(FIXED x, FIXED y)
 {
-	int alfa = 0;
-	for (int i = 0; i < 128; i++)
+	Fixed2 alfa;
+	alfa.x = x;
+	alfa.y = y;
+
+	return alfa;
+}
+
+//表示用。物理演算には使わない。
+float FixedToFloat(FIXED num)
+{
+	return (float)num / FIXED_ONE;
+}
+
+//FNV-1aでdataをhashに混ぜる。
+unsigned int HashData(unsigned int hash, const void* data, unsigned int size)
+{
+	const unsigned char* byte = (const unsigned char*)data;
+
+	for (unsigned int i = 0; i < size; i++)
 	{
-		alfa = rand() % max + min;
+		hash ^= byte[i];
+		hash *= 16777619u;
 	}
-	return alfa;
+	return hash;
 }
\ No newline at end of file
@@ -17,8 +17,28 @@ enum DIR
 	DIRMAX
 };
 
-int GetRandomNum(int min, int max);
+//固定小数点数(16.16)。コンパイラやFPUの違いで結果が変わらない。
+typedef int FIXED;
+
+#define FIXED_SHIFT (16)
+#define FIXED_ONE (1 << FIXED_SHIFT)
+//定数をFIXEDに変換する。四捨五入。
+#define FIXED_CONST(f) ((FIXED)((f) * FIXED_ONE + ((f) >= 0 ? 0.5 : -0.5)))
+
+typedef struct
+{
+	FIXED x;
+	FIXED y;
+}Fixed2;
+
+//ハッシュの初期値(FNV-1a)
+#define HASH_INIT (2166136261u)
 
 Int2 MakeInt2(int x, int y);
 
+Fixed2 MakeFixed2(FIXED x, FIXED y);
+float FixedToFloat(FIXED num);
+
+unsigned int HashData(unsigned int hash, const void* data, unsigned int size);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,397 @@
+//=================================
+//
+//ボールの予測線
+//
+//ブロックを置いている間、発射したらボールがどう動くかを先にシミュレーションして表示する。
+//一定フレームごとにボールとステージの状態をチェックポイントとして保存し、
+//区間ごとにボールが通ったマスの範囲を記録しておく。
+//ブロックを置いたら、そのマスを最初に通った区間のチェックポイントからだけやり直す。
+//チェックポイントはステージ全体を持たずに、前の区間から変わったマスだけを持つ。
+//先読みのマップで読み込みが間に合わないチャンクに当たったら、その区間は次のフレームでやり直す。
+//
+//=================================
+
+#include"Preview.h"
+#include"FaceGen.h"
+#include"StageMaker.h"
+#include"Ball.h"
+#include"Scene.h"
+#include"Effect.h"
+#include"Random.h"
+#include"Camera.h"
+#include"FrameHeap.h"
+
+#include<stdlib.h>
+#include<chrono>
+
+#define PREVIEW_MAXFRAME (60 * 30)		//これ以上先は予測しない
+#define PREVIEW_INTERVAL (60)			//チェックポイントの間隔
+#define PREVIEW_MAXCHECKPOINT (PREVIEW_MAXFRAME / PREVIEW_INTERVAL)
+#define PREVIEW_DOTSTEP (4)				//何フレームごとに点を打つか
+#define PREVIEW_DELTAGROWMIN (256)
+
+//ステージはg_BaseStageに1～今のチェックポイントまでのdeltaを順に重ねたもの
+typedef struct
+{
+	BALLSTATE ball;
+	RANDOMSTATE random;
+	TIMERWHEEL burnTimer;
+	int deltaBegin;//g_Deltaの中で、前のチェックポイントから変わったマス
+	int deltaNum;
+}CHECKPOINT;
+
+static void PreviewSimulate(void);
+static bool RestoreCheckpoint(int segment);
+static bool SaveCheckpoint(int segment, unsigned int version);
+static bool IsTileMiss(const TILEMAP* map);
+static void MarkTouchedCell(int segment, Float2 pos);
+static void MarkTouchedArea(int segment, Int2 min, Int2 max);
+static bool IsTubeBlock(const BLOCK* block);
+
+static CHECKPOINT g_Checkpoint[PREVIEW_MAXCHECKPOINT];
+static STAGEDATA g_BaseStage;//発射した時のステージ
+static STAGEEDIT* g_Delta;
+static int g_DeltaNum;
+static int g_DeltaMax;
+//区間ごとに通ったマスを囲む四角形。ステージが大きくてもマスごとには持たない
+static bool g_IsTouched[PREVIEW_MAXCHECKPOINT];
+static Int2 g_TouchedMin[PREVIEW_MAXCHECKPOINT];
+static Int2 g_TouchedMax[PREVIEW_MAXCHECKPOINT];
+static int g_CheckpointNum;
+static Float2 g_PreviewPath[PREVIEW_MAXFRAME];
+static int g_PreviewFrameNum;
+static bool g_IsPreviewGoal;
+static bool g_IsPreviewDirty;
+static bool g_IsBallMovingOld;
+static STAGEDATA g_LiveStage;//シミュレーション中に今のステージを退避しておく
+static int g_SimulateTime;//最後のシミュレーションにかかった時間(マイクロ秒)
+static int g_SimulateFrame;//最後のシミュレーションで進めたフレーム数
+
+void PreviewINIT(void)
+{
+	g_CheckpointNum = 0;
+	g_PreviewFrameNum = 0;
+	g_IsPreviewGoal = false;
+	g_IsPreviewDirty = true;
+	g_IsBallMovingOld = false;
+	g_SimulateTime = 0;
+	g_SimulateFrame = 0;
+}
+
+void PreviewUPDATE(void)
+{
+	//ボールが動いている間は作らない
+	if (GetIsBallMoving())
+	{
+		g_IsBallMovingOld = true;
+		return;
+	}
+
+	//ボールが止まったらステージが読み直されているので最初から
+	if (g_IsBallMovingOld)
+	{
+		g_IsBallMovingOld = false;
+		PreviewReset();
+	}
+
+	if (GetIsClear() || GetIsGameover())return;
+
+	if (g_IsPreviewDirty)
+	{
+		PreviewSimulate();
+	}
+}
+
+void PreviewDRAW(void)
+{
+	if (GetIsBallMoving() || GetIsClear() || GetIsGameover())return;
+
+	//ゴールに届くなら緑
+	Float4 color = g_IsPreviewGoal ? MakeFloat4(0.4f, 1, 0.4f, 0.8f) : MakeFloat4(1, 1, 1, 0.6f);
+
+	for (int i = 0; i < g_PreviewFrameNum; i += PREVIEW_DOTSTEP)
+	{
+		CercleGen(GetScreenPos(g_PreviewPath[i]), 5, color);
+	}
+
+	//デバッグならシミュレーションにかかった時間を表示
+	if (GetIsDebug())
+	{
+		TextGen(MakeFloat2(SCREEN_WIDTH / 2 - 32 * 12 - BLOCKSIZE.x, -SCREEN_HEIGHT / 2 + 96 + BLOCKSIZE.y),
+			MakeFloat2(32, 32), NORMALCOLOR, FormatScratch("%dF %dus", g_SimulateFrame, g_SimulateTime));
+	}
+}
+
+//チェックポイントのタイマーと、退避したステージのeditを解放する
+void PreviewUNINIT(void)
+{
+	for (int i = 0; i < PREVIEW_MAXCHECKPOINT; i++)
+	{
+		DestroyTimerWheel(&g_Checkpoint[i].burnTimer);
+	}
+	ReleaseStageData(&g_BaseStage);
+	ReleaseStageData(&g_LiveStage);
+	free(g_Delta);
+	g_Delta = NULL;
+	g_DeltaNum = 0;
+	g_DeltaMax = 0;
+	g_CheckpointNum = 0;
+}
+
+void PreviewEditCell(Int2 npos)
+{
+	//まだ一回も作っていない
+	if (g_CheckpointNum == 0)return;
+
+	BLOCK block = GetBlock(npos.y, npos.x);
+	BLOCK oldblock = GetStageDataBlock(&g_BaseStage, npos.y, npos.x);
+
+	//土管はワープ先の番号がステージ全体で決まるので最初から
+	if (IsTubeBlock(&block) || IsTubeBlock(&oldblock))
+	{
+		PreviewReset();
+		return;
+	}
+
+	//このマスを最初に通った区間
+	int segment = 0;
+	for (segment = 0; segment < g_CheckpointNum; segment++)
+	{
+		if (g_IsTouched[segment] &&
+			npos.x >= g_TouchedMin[segment].x && npos.x <= g_TouchedMax[segment].x &&
+			npos.y >= g_TouchedMin[segment].y && npos.y <= g_TouchedMax[segment].y)break;
+	}
+
+	//それより前の区間はこのマスを通っていないので、チェックポイントに書き込むだけでいい
+	SetStageDataBlock(&g_BaseStage, npos.y, npos.x, &block);
+	int cell = npos.y * GetStageWidth() + npos.x;
+	for (int i = 1; i < g_CheckpointNum && i <= segment; i++)
+	{
+		for (int n = g_Checkpoint[i].deltaBegin; n < g_Checkpoint[i].deltaBegin + g_Checkpoint[i].deltaNum; n++)
+		{
+			if (g_Delta[n].cell == cell)g_Delta[n].block = block;
+		}
+	}
+
+	//一回も通っていなければ予測線は変わらない
+	if (segment >= g_CheckpointNum)return;
+
+	g_CheckpointNum = segment + 1;
+	g_IsPreviewDirty = true;
+}
+
+void PreviewReset(void)
+{
+	g_CheckpointNum = 0;
+	g_DeltaNum = 0;
+	g_PreviewFrameNum = 0;
+	g_IsPreviewDirty = true;
+
+	//前の予測線が使っていたチャンクはもう要らない
+	TILEMAP* map = GetStageTileMap();
+	if (map != NULL)ClearTileMapPin(map);
+}
+
+//最後のチェックポイントからボールが止まるまでシミュレーションする。
+//今のボールとステージの状態は退避して、終わったら元に戻す。
+static void PreviewSimulate(void)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	BALLSTATE live;
+	RANDOMSTATE liverandom;
+	GetBallState(&live);
+	GetStageData(&g_LiveStage);
+	GetRandomState(random_game, &liverandom);
+
+	//音やエフェクトを出さない
+	bool IsHeadless = GetIsHeadless();
+	SetIsHeadless(true);
+
+	//読み込みを待たない。通ったチャンクにはピンが付くので、やり直す時はもう置いてある
+	TILEMAP* map = GetStageTileMap();
+	if (map != NULL)SetTileMapNoWait(map, true);
+
+	//発射した直後を最初のチェックポイントにする
+	if (g_CheckpointNum == 0)
+	{
+		BallReset();
+		SetBall();
+		GetStageData(&g_BaseStage);
+		g_DeltaNum = 0;
+		SaveCheckpoint(0, GetStageEditVersion());
+		g_CheckpointNum = 1;
+	}
+
+	int segment = g_CheckpointNum - 1;
+	bool IsRestored = RestoreCheckpoint(segment);
+	unsigned int version = GetStageEditVersion();
+	g_IsTouched[segment] = false;
+
+	g_PreviewFrameNum = segment * PREVIEW_INTERVAL;
+	g_SimulateFrame = 0;
+	bool IsFire = false;
+	bool IsWait = map != NULL && !IsRestored && map->fullNum == 0;
+
+	while (IsRestored && g_PreviewFrameNum < PREVIEW_MAXFRAME)
+	{
+		//区間の頭でチェックポイントを保存
+		if (g_PreviewFrameNum / PREVIEW_INTERVAL != segment)
+		{
+			segment++;
+			if (!SaveCheckpoint(segment, version))break;
+			version = GetStageEditVersion();
+			g_IsTouched[segment] = false;
+			g_CheckpointNum = segment + 1;
+		}
+
+		MarkTouchedCell(segment, GetBallPos());
+
+		StageBlockBurnUPDATE();
+		BallUPDATE();
+		g_SimulateFrame++;
+
+		//チャンクが読み終わっていなければ、この区間は次のフレームでやり直す。
+		//スロットが空かなければそこで予測線を終わりにする
+		if (map != NULL && IsTileMiss(map))
+		{
+			IsWait = map->fullNum == 0;
+			break;
+		}
+
+		//ゴールか死亡
+		if (!GetBall()->IsUse)break;
+
+		MarkTouchedCell(segment, GetBallPos());
+
+		//燃え移りはボールと関係なく広がるので、燃えているブロックの周りも通ったことにする
+		if (GetBall()->type == balltype_fire)IsFire = true;
+		Int2 burnmin, burnmax;
+		if (IsFire && GetBurnArea(&burnmin, &burnmax))
+		{
+			MarkTouchedArea(segment, MakeInt2(burnmin.x - 1, burnmin.y - 1), MakeInt2(burnmax.x + 1, burnmax.y + 1));
+		}
+
+		g_PreviewPath[g_PreviewFrameNum] = GetBallPos();
+		g_PreviewFrameNum++;
+	}
+
+	if (IsWait)
+	{
+		g_PreviewFrameNum = segment * PREVIEW_INTERVAL;
+		g_DeltaNum = g_Checkpoint[segment].deltaBegin + g_Checkpoint[segment].deltaNum;
+		g_CheckpointNum = segment + 1;
+		g_IsPreviewGoal = false;
+	}
+	else
+	{
+		g_IsPreviewGoal = IsRestored && GetIsBallGoal();
+		g_IsPreviewDirty = false;
+	}
+
+	//元に戻す
+	if (map != NULL)SetTileMapNoWait(map, false);
+	SetIsHeadless(IsHeadless);
+	SetStageData(&g_LiveStage);
+	SetBallState(&live);
+	SetRandomState(random_game, &liverandom);
+
+	g_SimulateTime = (int)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//ベースのステージに1～segmentのdeltaを重ねて、ボールと乱数とタイマーを戻す。
+//チャンクが読み終わっていなくて戻せなければfalse
+static bool RestoreCheckpoint(int segment)
+{
+	SetStageData(&g_BaseStage);
+
+	int width = GetStageWidth();
+	for (int i = 1; i <= segment; i++)
+	{
+		for (int n = g_Checkpoint[i].deltaBegin; n < g_Checkpoint[i].deltaBegin + g_Checkpoint[i].deltaNum; n++)
+		{
+			SetBlock(g_Delta[n].cell / width, g_Delta[n].cell % width, &g_Delta[n].block);
+		}
+	}
+
+	SetBurnTimer(&g_Checkpoint[segment].burnTimer);
+	SetBallState(&g_Checkpoint[segment].ball);
+	SetRandomState(random_game, &g_Checkpoint[segment].random);
+
+	//この区間より後のdeltaは作り直す
+	g_DeltaNum = g_Checkpoint[segment].deltaBegin + g_Checkpoint[segment].deltaNum;
+
+	TILEMAP* map = GetStageTileMap();
+	return map == NULL || !IsTileMiss(map);
+}
+
+//今の状態をチェックポイントにする。ステージはversionより後に変わったマスだけ写す
+static bool SaveCheckpoint(int segment, unsigned int version)
+{
+	CHECKPOINT* checkpoint = &g_Checkpoint[segment];
+	checkpoint->deltaBegin = g_DeltaNum;
+	checkpoint->deltaNum = 0;
+
+	for (int n = 0; n < GetStageEditNum(); n++)
+	{
+		const STAGEEDIT* edit = GetStageEdit(n);
+		if (edit->version <= version)continue;
+
+		if (g_DeltaNum >= g_DeltaMax)
+		{
+			int deltamax = g_DeltaMax * 2 > PREVIEW_DELTAGROWMIN ? g_DeltaMax * 2 : PREVIEW_DELTAGROWMIN;
+			STAGEEDIT* delta = (STAGEEDIT*)realloc(g_Delta, sizeof(STAGEEDIT) * deltamax);
+			if (delta == NULL)
+			{
+				NN_LOG("SaveCheckpoint: out of memory\n");
+				return false;
+			}
+			g_Delta = delta;
+			g_DeltaMax = deltamax;
+		}
+
+		g_Delta[g_DeltaNum] = *edit;
+		g_DeltaNum++;
+		checkpoint->deltaNum++;
+	}
+
+	GetBallState(&checkpoint->ball);
+	GetRandomState(random_game, &checkpoint->random);
+	GetBurnTimer(&checkpoint->burnTimer);
+	return true;
+}
+
+//NoWaitのマップで、置かれていないチャンクに当たったか
+static bool IsTileMiss(const TILEMAP* map)
+{
+	return map->waitNum > 0 || map->fullNum > 0;
+}
+
+//ボールと隣のマスまでを通ったことにする
+static void MarkTouchedCell(int segment, Float2 pos)
+{
+	MarkTouchedArea(segment, GetBlockNpos(MakeFloat2(pos.x - 16 - BLOCKSIZE.x, pos.y - 16 - BLOCKSIZE.y)),
+		GetBlockNpos(MakeFloat2(pos.x + 16 + BLOCKSIZE.x, pos.y + 16 + BLOCKSIZE.y)));
+}
+
+//区間の四角形をmin～maxを含むように広げる。土管で飛んだ時は間のマスも含んでしまうが、やり直しが増えるだけ
+static void MarkTouchedArea(int segment, Int2 min, Int2 max)
+{
+	if (!g_IsTouched[segment])
+	{
+		g_TouchedMin[segment] = min;
+		g_TouchedMax[segment] = max;
+		g_IsTouched[segment] = true;
+		return;
+	}
+
+	if (min.x < g_TouchedMin[segment].x)g_TouchedMin[segment].x = min.x;
+	if (min.y < g_TouchedMin[segment].y)g_TouchedMin[segment].y = min.y;
+	if (max.x > g_TouchedMax[segment].x)g_TouchedMax[segment].x = max.x;
+	if (max.y > g_TouchedMax[segment].y)g_TouchedMax[segment].y = max.y;
+}
+
+static bool IsTubeBlock(const BLOCK* block)
+{
+	return block->isUse && (block->type == type_tube_in || block->type == type_tube_out);
+}
\ No newline at end of file
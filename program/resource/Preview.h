@@ -0,0 +1,17 @@
+#ifndef PREVIEW_H_
+#define PREVIEW_H_
+
+#include"main.h"
+#include"Mytype.h"
+
+void PreviewINIT(void);
+void PreviewUPDATE(void);
+void PreviewDRAW(void);
+void PreviewUNINIT(void);
+
+//ブロックを置いた、消した時に呼ぶ。そのマスを通った所から予測線を作り直す。
+void PreviewEditCell(Int2 npos);
+//ステージが変わった時に呼ぶ。予測線を最初から作り直す。
+void PreviewReset(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+//=================================
+//
+//乱数
+//
+//TinyMTで用途ごとに乱数列を持つ。
+//乱数列はスレッドごとなので、ソルバーのスレッドはそれぞれでseedを決める。
+//
+//=================================
+
+#include"Random.h"
+
+static thread_local nn::util::TinyMt g_Random[RANDOMSTREAMMAX];
+
+void RandomINIT(unsigned int seed)
+{
+	for (int i = 0; i < RANDOMSTREAMMAX; i++)
+	{
+		SetRandomSeed((RANDOMSTREAM)i, seed);
+	}
+}
+
+void SetRandomSeed(RANDOMSTREAM stream, unsigned int seed)
+{
+	//同じseedでも乱数列ごとに違う列になるようにする
+	nn::Bit32 alfa[2];
+	alfa[0] = seed;
+	alfa[1] = stream;
+
+	g_Random[stream].Initialize(alfa, 2);
+}
+
+//rangeの範囲の乱数。掛け算して上位32bitを使い、はみ出す分だけ引き直すので偏らない。
+static unsigned int RandomRange(nn::util::TinyMt* random, unsigned int range, unsigned int threshold)
+{
+	unsigned long long alfa = (unsigned long long)random->GenerateRandomU32() * range;
+
+	while ((unsigned int)alfa < threshold)
+	{
+		alfa = (unsigned long long)random->GenerateRandomU32() * range;
+	}
+	return (unsigned int)(alfa >> 32);
+}
+
+int GetRandomNum(RANDOMSTREAM stream, int min, int max)
+{
+	if (max <= min)return min;
+
+	unsigned int range = (unsigned int)(max - min);
+
+	return min + (int)RandomRange(&g_Random[stream], range, (0u - range) % range);
+}
+
+void GetRandomNumArray(RANDOMSTREAM stream, int min, int max, int* out, int num)
+{
+	if (max <= min)
+	{
+		for (int i = 0; i < num; i++)out[i] = min;
+		return;
+	}
+
+	//割り算は最初に一回だけ
+	unsigned int range = (unsigned int)(max - min);
+	unsigned int threshold = (0u - range) % range;
+
+	for (int i = 0; i < num; i++)
+	{
+		out[i] = min + (int)RandomRange(&g_Random[stream], range, threshold);
+	}
+}
+
+unsigned int GetRandomU32(RANDOMSTREAM stream)
+{
+	return g_Random[stream].GenerateRandomU32();
+}
+
+float GetRandomFloat(RANDOMSTREAM stream)
+{
+	return g_Random[stream].GenerateRandomF32();
+}
+
+void GetRandomState(RANDOMSTREAM stream, RANDOMSTATE* state)
+{
+	g_Random[stream].SaveState(state);
+}
+
+void SetRandomState(RANDOMSTREAM stream, const RANDOMSTATE* state)
+{
+	g_Random[stream].RestoreState(state);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <nn/util/util_TinyMt.h>
+
+//用途ごとに別の乱数列を使う。
+//エフェクトや音で乱数を使ってもゲームの乱数列はずれない。
+enum RANDOMSTREAM
+{
+	random_game,
+	random_effect,
+	random_sound,
+
+	RANDOMSTREAMMAX
+};
+
+typedef nn::util::TinyMt::State RANDOMSTATE;
+
+//全部の乱数列をseedから初期化する。同じseedなら同じ乱数列になる。
+void RandomINIT(unsigned int seed);
+void SetRandomSeed(RANDOMSTREAM stream, unsigned int seed);
+
+//戻り値は最小でmin、最大でmax - 1。偏りなし。
+int GetRandomNum(RANDOMSTREAM stream, int min, int max);
+//num個まとめて作る。
+void GetRandomNumArray(RANDOMSTREAM stream, int min, int max, int* out, int num);
+unsigned int GetRandomU32(RANDOMSTREAM stream);
+//0以上1未満
+float GetRandomFloat(RANDOMSTREAM stream);
+
+//乱数列の途中の状態を保存、復帰する。
+void GetRandomState(RANDOMSTREAM stream, RANDOMSTATE* state);
+void SetRandomState(RANDOMSTREAM stream, const RANDOMSTATE* state);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+//=================================
+//
+//描き直しの管理
+//
+//入力、動いているもの、スプライトのコマが変わる時だけ描く。
+//何も変わらないフレームはDRAWもSwapBuffersもしないで、前の画面を出したままにする。
+//メニューの画面、リザルト、ボールを打つ前のゲームでは描く回数がほとんどなくなる。
+//
+//見た目を変えるのに入力を使わないものは、UPDATEでRequestRedrawを呼ぶ。
+//呼び忘れてもREDRAW_MAXSKIPフレームで描き直すので、止まったままにはならない。
+//
+//=================================
+
+#include"Redraw.h"
+#include"Input.h"
+#include"FaceGen.h"
+
+#include<limits.h>
+
+static int g_RequestNum;//あと何フレーム描くか
+static int g_RedrawTick = INT_MAX;//次にコマが変わるtick
+static int g_SkipFrame;//続けて描かなかったフレーム
+static int g_RedrawNum;
+static int g_RedrawSkipNum;
+static Float2 g_OldPointer;
+static bool g_OldIsPointerIn;
+
+void RequestRedraw(void)
+{
+	g_RequestNum = 2;
+}
+
+void SetRedrawTick(int tick)
+{
+	if (tick < g_RedrawTick)g_RedrawTick = tick;
+}
+
+bool UpdateRedraw(void)
+{
+	//押した、離した、リピート、マウスが動いた
+	const INPUTSNAPSHOT* input = GetInputSnapshot();
+	if (input->pressed != 0 || input->released != 0 || input->repeat != 0 ||
+		input->IsPointerIn != g_OldIsPointerIn ||
+		(input->IsPointerIn && (input->pointer.x != g_OldPointer.x || input->pointer.y != g_OldPointer.y)))
+	{
+		RequestRedraw();
+	}
+	g_OldPointer = input->pointer;
+	g_OldIsPointerIn = input->IsPointerIn;
+
+	//デバッグ表示は毎フレーム変わる
+	if (GetIsDebug())RequestRedraw();
+
+	bool IsDraw = g_RequestNum > 0 || GetSpriteTime() >= g_RedrawTick || g_SkipFrame >= REDRAW_MAXSKIP;
+
+	if (g_RequestNum > 0)g_RequestNum--;
+
+	if (!IsDraw)
+	{
+		g_SkipFrame++;
+		g_RedrawSkipNum++;
+		return false;
+	}
+
+	//描く時にアニメーションがまた入れる
+	g_RedrawTick = INT_MAX;
+	g_SkipFrame = 0;
+	g_RedrawNum++;
+	return true;
+}
+
+bool GetIsWindowActive(void)
+{
+#if defined(NN_BUILD_CONFIG_OS_WIN32)
+	DWORD processId = 0;
+	GetWindowThreadProcessId(GetForegroundWindow(), &processId);
+	return processId == GetCurrentProcessId();
+#else
+	return true;
+#endif
+}
+
+int GetRedrawNum(void)
+{
+	return g_RedrawNum;
+}
+
+int GetRedrawSkipNum(void)
+{
+	return g_RedrawSkipNum;
+}
\ No newline at end of file
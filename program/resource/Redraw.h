@@ -0,0 +1,23 @@
+#ifndef REDRAW_H_
+#define REDRAW_H_
+
+#include"main.h"
+
+#define REDRAW_MAXSKIP (30)			//何も変わらなくても、これだけ描かなかったら描く
+#define REDRAW_PAUSERATE (20)		//メニューを出している間のフレームレート
+#define REDRAW_BACKGROUNDRATE (10)	//ウィンドウが裏にある間のフレームレート
+
+//見た目が変わった。このフレームと次のフレームを描く。
+//次のフレームも描くのは、止まった時の最後の絵を出すため
+void RequestRedraw(void);
+//スプライトのコマがtick(GetSpriteTime)で変わる。アニメーションを描く時にFaceGenが呼ぶ
+void SetRedrawTick(int tick);
+//UPDATEの後に毎フレーム呼ぶ。描くならtrue。描かないフレームは前の画面をそのまま出しておく
+bool UpdateRedraw(void);
+//ウィンドウが前に出ているか
+bool GetIsWindowActive(void);
+//描いたフレームと描かなかったフレームの数
+int GetRedrawNum(void);
+int GetRedrawSkipNum(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,389 @@
+//=================================
+//
+//動的解像度
+//
+//ゲームの画面は内部解像度のターゲットに描き、最後に画面の大きさに拡大する。
+//拡大する時に隣のドットとの差を足してぼけを戻す。
+//投影はSCREEN_WIDTH x SCREEN_HEIGHTのままで、ビューポートだけ小さくするのでゲームの座標は変わらない。
+//
+//GPUの時間はタイマークエリで数フレーム遅れて受け取り、目標を超えたら下げ、余裕があれば上げる。
+//タイマークエリがない環境では、描き始めてからSwapBuffersが返るまでの時間を使う。
+//
+//ターゲットやシェーダーが作れなければ、今までどおり画面に直接描く。
+//
+//=================================
+
+#include"Resolution.h"
+#include"texture.h"
+#include"MemoryLedger.h"
+#include"FaceGen.h"
+
+#include<chrono>
+
+#if defined(GL_TIME_ELAPSED)
+#define RESOLUTION_USEQUERY
+#endif
+
+typedef struct
+{
+	Float3 Position;
+	Float4 Color;
+	Float2 Texcord;
+}RESOLUTIONVERTEX;
+
+static GLuint CreateResolutionShader(GLenum type, const char* source);
+static void AddResolutionFrameTime(int us);
+
+static const char* g_UpscaleVertexSource =
+"#version 330\n"
+"precision highp float;\n"
+
+"layout( location = 0 ) in vec3 inPosition;\n"
+"layout( location = 2 ) in vec2 inTexCoord;\n"
+
+"out vec2 vTexCoord;\n"
+
+"void main() {\n"
+"    vTexCoord = inTexCoord;\n"
+"    gl_Position = vec4(inPosition, 1.0);\n"
+"}\n";
+
+static const char* g_UpscaleFragmentSource =
+"#version 330\n"
+"precision highp float;\n"
+
+"uniform sampler2D uSampler;\n"
+"uniform vec2 uTexel;\n"//テクスチャの1ドット
+"uniform vec2 uUvMax;\n"//描いた所の端。外のドットを混ぜない
+"uniform float uSharpness;\n"
+
+"in vec2 vTexCoord;\n"
+
+"out vec4 outColor;\n"
+
+"vec3 Fetch(vec2 uv) {\n"
+"    return texture(uSampler, clamp(uv, uTexel * 0.5, uUvMax)).rgb;\n"
+"}\n"
+
+"void main() {\n"
+"    vec3 color = Fetch(vTexCoord);\n"
+"    vec3 around = Fetch(vTexCoord + vec2(uTexel.x, 0.0)) + Fetch(vTexCoord - vec2(uTexel.x, 0.0))\n"
+"                + Fetch(vTexCoord + vec2(0.0, uTexel.y)) + Fetch(vTexCoord - vec2(0.0, uTexel.y));\n"
+"    outColor = vec4(clamp(color + (color * 4.0 - around) * (uSharpness * 0.25), 0.0, 1.0), 1.0);\n"
+"}\n";
+
+static bool g_IsUse;
+static bool g_IsResolved = true;
+static bool g_IsNativeUI = true;
+static GLuint g_FrameBuffer;
+static GLuint g_Texture;
+static GLuint g_VertexShader;
+static GLuint g_FragmentShader;
+static GLuint g_Program;
+static GLint g_WindowViewport[4];
+static int g_Width = SCREEN_WIDTH;//このフレームの内部解像度
+static int g_Height = SCREEN_HEIGHT;
+static float g_Scale = RESOLUTION_MAXSCALE;
+static float g_MinScale = RESOLUTION_MINSCALE;
+static float g_MaxScale = RESOLUTION_MAXSCALE;
+static int g_TargetUs = RESOLUTION_TARGETUS;
+static int g_FrameTime;
+static int g_Cooldown;
+static int g_ChangeNum;
+#ifdef RESOLUTION_USEQUERY
+static GLuint g_Query[RESOLUTION_QUERYNUM];
+static int g_QueryBegin;//一番古い計測
+static int g_QueryNum;
+static bool g_IsQuerying;
+#else
+static std::chrono::steady_clock::time_point g_BeginTime;
+#endif
+
+void ResolutionINIT(void)
+{
+	g_IsUse = false;
+	g_IsResolved = true;
+
+	g_VertexShader = CreateResolutionShader(GL_VERTEX_SHADER, g_UpscaleVertexSource);
+	g_FragmentShader = CreateResolutionShader(GL_FRAGMENT_SHADER, g_UpscaleFragmentSource);
+	if (g_VertexShader == 0 || g_FragmentShader == 0)return;
+
+	g_Program = glCreateProgram();
+	glAttachShader(g_Program, g_VertexShader);
+	glAttachShader(g_Program, g_FragmentShader);
+	glLinkProgram(g_Program);
+
+	GLint result;
+	glGetProgramiv(g_Program, GL_LINK_STATUS, &result);
+	if (!result)
+	{
+		NN_LOG("ResolutionINIT: failed to link upscale shader, drawing at native resolution\n");
+		return;
+	}
+
+	//大きさは最大で作っておき、下げた時は左下だけ使う
+	glGenTextures(1, &g_Texture);
+	glBindTexture(GL_TEXTURE_2D, g_Texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &g_FrameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, g_FrameBuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_Texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		NN_LOG("ResolutionINIT: framebuffer is not complete (0x%x), drawing at native resolution\n", status);
+		return;
+	}
+
+	//どのシーンでも使うので共有に入れる
+	int scene = GetLedgerScene();
+	SetLedgerScene(LEDGER_SHARED);
+	RegisterLedger(ledger_texture, g_Texture, SCREEN_WIDTH * SCREEN_HEIGHT * 3, __FILE__, "internal resolution");
+	SetLedgerScene(scene);
+
+#ifdef RESOLUTION_USEQUERY
+	glGenQueries(RESOLUTION_QUERYNUM, g_Query);
+	g_QueryBegin = 0;
+	g_QueryNum = 0;
+	g_IsQuerying = false;
+#endif
+
+	g_Scale = g_MaxScale;
+	g_FrameTime = 0;
+	g_Cooldown = RESOLUTION_COOLDOWN;
+	g_IsUse = true;
+}
+
+void ResolutionUNINIT(void)
+{
+	if (g_IsUse)
+	{
+#ifdef RESOLUTION_USEQUERY
+		glDeleteQueries(RESOLUTION_QUERYNUM, g_Query);
+#endif
+		glDeleteFramebuffers(1, &g_FrameBuffer);
+		UnloadTexture(g_Texture);
+
+		NN_LOG("Resolution: scale %d%%, gpu %dus, changed %d times\n", (int)(g_Scale * 100), g_FrameTime, g_ChangeNum);
+	}
+
+	if (g_Program != 0)
+	{
+		glDetachShader(g_Program, g_VertexShader);
+		glDetachShader(g_Program, g_FragmentShader);
+		glDeleteProgram(g_Program);
+	}
+	if (g_VertexShader != 0)glDeleteShader(g_VertexShader);
+	if (g_FragmentShader != 0)glDeleteShader(g_FragmentShader);
+
+	g_FrameBuffer = 0;
+	g_Texture = 0;
+	g_Program = 0;
+	g_VertexShader = 0;
+	g_FragmentShader = 0;
+	g_IsUse = false;
+}
+
+void BeginResolutionFrame(void)
+{
+	if (!g_IsUse)return;
+
+	glGetIntegerv(GL_VIEWPORT, g_WindowViewport);
+
+	//8ドットにそろえる
+	g_Width = ((int)(SCREEN_WIDTH * g_Scale + 0.5f) + 7) & ~7;
+	g_Height = ((int)(SCREEN_HEIGHT * g_Scale + 0.5f) + 7) & ~7;
+	if (g_Width > SCREEN_WIDTH)g_Width = SCREEN_WIDTH;
+	if (g_Height > SCREEN_HEIGHT)g_Height = SCREEN_HEIGHT;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, g_FrameBuffer);
+	glViewport(0, 0, g_Width, g_Height);
+	g_IsResolved = false;
+
+#ifdef RESOLUTION_USEQUERY
+	//結果を待っているものが多ければこのフレームは測らない
+	g_IsQuerying = g_QueryNum < RESOLUTION_QUERYNUM;
+	if (g_IsQuerying)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, g_Query[(g_QueryBegin + g_QueryNum) % RESOLUTION_QUERYNUM]);
+	}
+#else
+	g_BeginTime = std::chrono::steady_clock::now();
+#endif
+}
+
+void BeginResolutionUI(void)
+{
+	if (g_IsNativeUI)ResolveResolution();
+}
+
+void ResolveResolution(void)
+{
+	if (g_IsResolved)return;
+	g_IsResolved = true;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(g_WindowViewport[0], g_WindowViewport[1], g_WindowViewport[2], g_WindowViewport[3]);
+
+	//描いた所だけを画面いっぱいに。ターゲットは下の行から入っているので、そのまま下から貼る
+	float u = (float)g_Width / SCREEN_WIDTH;
+	float v = (float)g_Height / SCREEN_HEIGHT;
+	RESOLUTIONVERTEX vertex[4] = {};
+	vertex[0].Position = MakeFloat3(-1.0f, 1.0f, 0.0f);
+	vertex[1].Position = MakeFloat3(1.0f, 1.0f, 0.0f);
+	vertex[2].Position = MakeFloat3(-1.0f, -1.0f, 0.0f);
+	vertex[3].Position = MakeFloat3(1.0f, -1.0f, 0.0f);
+	vertex[0].Texcord = MakeFloat2(0, v);
+	vertex[1].Texcord = MakeFloat2(u, v);
+	vertex[2].Texcord = MakeFloat2(0, 0);
+	vertex[3].Texcord = MakeFloat2(u, 0);
+	for (int i = 0; i < 4; i++)
+	{
+		vertex[i].Color = NORMALCOLOR;
+	}
+
+	glUseProgram(g_Program);
+	glUniform1i(glGetUniformLocation(g_Program, "uSampler"), 0);
+	glUniform2f(glGetUniformLocation(g_Program, "uTexel"), 1.0f / SCREEN_WIDTH, 1.0f / SCREEN_HEIGHT);
+	glUniform2f(glGetUniformLocation(g_Program, "uUvMax"), (g_Width - 0.5f) / SCREEN_WIDTH, (g_Height - 0.5f) / SCREEN_HEIGHT);
+	//同じ大きさならぼけていないのでシャープもいらない
+	glUniform1f(glGetUniformLocation(g_Program, "uSharpness"), g_Width < SCREEN_WIDTH ? RESOLUTION_SHARPNESS : 0.0f);
+
+	glBindTexture(GL_TEXTURE_2D, g_Texture);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RESOLUTIONVERTEX), (GLvoid*)&vertex->Position);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(RESOLUTIONVERTEX), (GLvoid*)&vertex->Color);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(RESOLUTIONVERTEX), (GLvoid*)&vertex->Texcord);
+
+	glDisable(GL_BLEND);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	ResetFaceGenBlend();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	ResetShaderProgram();
+}
+
+void PresentResolution(void)
+{
+	ResolveResolution();
+
+#ifdef RESOLUTION_USEQUERY
+	if (g_IsUse && g_IsQuerying)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		g_QueryNum++;
+		g_IsQuerying = false;
+	}
+#endif
+
+	SwapBuffers();
+
+	if (!g_IsUse)return;
+
+#ifdef RESOLUTION_USEQUERY
+	//終わっている計測を古い順に受け取る
+	while (g_QueryNum > 0)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(g_Query[g_QueryBegin], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)break;
+
+		GLuint ns = 0;
+		glGetQueryObjectuiv(g_Query[g_QueryBegin], GL_QUERY_RESULT, &ns);
+		g_QueryBegin = (g_QueryBegin + 1) % RESOLUTION_QUERYNUM;
+		g_QueryNum--;
+
+		AddResolutionFrameTime((int)(ns / 1000));
+	}
+#else
+	AddResolutionFrameTime((int)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_BeginTime).count());
+#endif
+}
+
+void SetResolutionBounds(float minScale, float maxScale)
+{
+	g_MinScale = minScale;
+	g_MaxScale = maxScale;
+
+	if (g_Scale < g_MinScale)g_Scale = g_MinScale;
+	if (g_Scale > g_MaxScale)g_Scale = g_MaxScale;
+}
+
+void SetResolutionTarget(int us)
+{
+	g_TargetUs = us;
+}
+
+void SetResolutionNativeUI(bool IsNative)
+{
+	g_IsNativeUI = IsNative;
+}
+
+float GetResolutionScale(void)
+{
+	return g_IsUse ? g_Scale : 1.0f;
+}
+
+int GetResolutionFrameTime(void)
+{
+	return g_FrameTime;
+}
+
+static GLuint CreateResolutionShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	if (shader == 0)return 0;
+
+	glShaderSource(shader, 1, &source, 0);
+	glCompileShader(shader);
+
+	GLint result;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+	if (!result)
+	{
+		GLchar shaderLog[1024];
+		GLsizei shaderLogSize;
+		glGetShaderInfoLog(shader, sizeof(shaderLog), &shaderLogSize, shaderLog);
+		NN_LOG("ResolutionINIT: failed to compile upscale shader: %s\n", shaderLog);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+//平均を取って、目標を超えたら下げ、かなり下回ったら上げる。変えた後はしばらく測るだけ
+static void AddResolutionFrameTime(int us)
+{
+	g_FrameTime = g_FrameTime == 0 ? us : (g_FrameTime * 7 + us) / 8;
+
+	if (g_Cooldown > 0)
+	{
+		g_Cooldown--;
+		return;
+	}
+
+	float scale = g_Scale;
+	if (g_FrameTime > g_TargetUs)
+	{
+		scale -= RESOLUTION_STEP;
+	}
+	else if (g_FrameTime < g_TargetUs * 3 / 4)
+	{
+		scale += RESOLUTION_STEP;
+	}
+
+	if (scale < g_MinScale)scale = g_MinScale;
+	if (scale > g_MaxScale)scale = g_MaxScale;
+	if (scale == g_Scale)return;
+
+	g_Scale = scale;
+	g_Cooldown = RESOLUTION_COOLDOWN;
+	g_ChangeNum++;
+}
\ No newline at end of file
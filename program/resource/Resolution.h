@@ -0,0 +1,34 @@
+#ifndef RESOLUTION_H_
+#define RESOLUTION_H_
+
+#include"main.h"
+
+#define RESOLUTION_MINSCALE (0.5f)	//内部解像度の下限。画面の大きさに掛ける
+#define RESOLUTION_MAXSCALE (1.0f)
+#define RESOLUTION_STEP (0.05f)		//1回に変える量
+#define RESOLUTION_TARGETUS (14000)	//GPUの1フレームの時間(us)をこれより下に保つ
+#define RESOLUTION_COOLDOWN (30)	//変えた後、次に変えるまでに測るフレーム数
+#define RESOLUTION_SHARPNESS (0.5f)	//拡大する時のシャープの強さ
+#define RESOLUTION_QUERYNUM (4)		//結果を待っている計測の数
+
+//内部解像度のターゲットとシャープのシェーダーを作る。InitSystemの後に呼ぶ
+void ResolutionINIT(void);
+void ResolutionUNINIT(void);
+
+//DRAWの前に呼ぶ。ここからは内部解像度のターゲットに描く
+void BeginResolutionFrame(void);
+//UIを描く前に呼ぶ。UIをネイティブで描く設定なら、ここまでを画面に拡大する
+void BeginResolutionUI(void);
+//ここまでを画面に拡大する。この後はネイティブで描く。1フレームに何回呼んでもいい
+void ResolveResolution(void);
+//SwapBuffersの代わりに呼ぶ。拡大していなければ拡大して、測った時間で次の解像度を決める
+void PresentResolution(void);
+
+void SetResolutionBounds(float minScale, float maxScale);
+void SetResolutionTarget(int us);
+void SetResolutionNativeUI(bool IsNative);
+float GetResolutionScale(void);
+//測ったGPUの時間(us)の平均
+int GetResolutionFrameTime(void);
+
+#endif
\ No newline at end of file
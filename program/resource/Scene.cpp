@@ -4,11 +4,70 @@
 #include"Game.h"
 #include"result.h"
 #include"Ball.h"
+#include"Effect.h"
+#include"texture.h"
+#include"FaceGen.h"
+#include"MemoryLedger.h"
+#include"Redraw.h"
+#include"Resolution.h"
+
+#include<chrono>
+
+#define SCENE_FADEFRAME (20)			//切り替えた後に前の画面を重ねて消していくフレーム数。0なら切り替えるだけ
+#define SCENE_UPLOADPERFRAME (1)		//先読みを1フレームにテクスチャにする数
+#define SCENE_FRAMEBUDGET (1000000 / 60)//切り替えにかけていい時間(us)
+#define SCENE_MANIFESTMAX (24)
+
+//シーンのINITで読むテクスチャ。前のシーンの間に先読みしておく
+typedef struct
+{
+	const char* const* texture;
+	int textureNum;
+}SCENEMANIFEST;
+
+static SCENE GetPreloadScene(void);
+static void PreloadScene(SCENE scene);
+static void CaptureFadeFrame(void);
+
+static const char* const g_TitleManifest[] =
+{
+	"asset/bottun.tga", "asset/Frame.tga", "asset/DispKey.tga", "asset/title_2.tga",
+	"asset/stage_1_background.tga", "asset/stage_2_background.tga", "asset/stage_3_background.tga",
+};
+
+//ステージの背景はステージで変わるのでPreloadSceneで足す
+static const char* const g_GameManifest[] =
+{
+	"asset/Block_4.tga", "asset/choose_2.tga", "asset/num.tga", "asset/Chooseframe.tga",
+	"asset/Ball_2.tga",
+	"asset/heart_2.tga", "asset/explosion_2.tga", "asset/Fireworks.tga", "asset/syabon_effect.tga", "asset/afterfire.tga",
+	"asset/GameEnd.tga", "asset/Princess.tga",
+	"asset/bottun.tga", "asset/Frame.tga", "asset/DispKey.tga",
+};
+
+static const char* const g_ResultManifest[] =
+{
+	"asset/result_2.tga", "asset/Coin.tga", "asset/DispKey.tga", "asset/result_text.tga",
+};
+
+static const SCENEMANIFEST g_SceneManifest[] =
+{
+	{ g_TitleManifest,  sizeof(g_TitleManifest) / sizeof(g_TitleManifest[0]) },
+	{ g_GameManifest,   sizeof(g_GameManifest) / sizeof(g_GameManifest[0]) },
+	{ g_ResultManifest, sizeof(g_ResultManifest) / sizeof(g_ResultManifest[0]) },
+};
 
 static SCENE g_CurrentScene;
 static SCENE g_NextStage = g_CurrentScene;
 static STAGE g_CurrentStage = stage_3;
 static int g_coinCnt = 0;
+static SCENE g_PreloadScene = SCENEMAX;//先読みしているシーン
+static STAGE g_PreloadStage;
+static UINT g_FadeTex;
+static int g_FadeFrame;
+static bool g_IsFadeCaptured;
+static int g_TransitionNum;
+static int g_OverBudgetNum;
 
 typedef void(*SceneFunction)(void);
 
@@ -43,22 +102,58 @@ static const SceneFunction g_pSceneUnInit[] =
 
 void SceneINIT(void)
 {
+	//INITで作ったものはこのシーンの台帳に載せる
+	SetLedgerScene(g_CurrentScene);
 	g_pSceneInit[g_CurrentScene]();
+	SetLedgerScene(LEDGER_SHARED);
 }
 
 void SceneUPDATE(void)
 {
 	g_pSceneUpdate[g_CurrentScene]();
+
+	//前の画面を消している間
+	if (g_FadeFrame > 0)RequestRedraw();
+
+	//次に行きそうなシーンのテクスチャを読んでおき、少しずつテクスチャにする
+	SCENE next = GetPreloadScene();
+	if (next != SCENEMAX)
+	{
+		PreloadScene(next);
+	}
+	UpdateTexturePreload(SCENE_UPLOADPERFRAME);
 }
 
 void SceneDRAW(void)
 {
 	g_pSceneDraw[g_CurrentScene]();
+
+	//前のシーンの最後の画面を重ねて消していく
+	if (g_FadeFrame > 0)
+	{
+		FaceGenFrameTex(g_FadeTex, MakeFloat4(1, 1, 1, (float)g_FadeFrame / SCENE_FADEFRAME));
+
+		g_FadeFrame--;
+		if (g_FadeFrame == 0)
+		{
+			UnloadTexture(g_FadeTex);
+			g_FadeTex = NULL;
+		}
+	}
+
+	//このフレームの後で切り替わるなら画面を取っておく
+	if (SCENE_FADEFRAME > 0 && g_CurrentScene != g_NextStage)
+	{
+		CaptureFadeFrame();
+	}
 }
 
 void SceneUNINIT(void)
 {
 	g_pSceneUnInit[g_CurrentScene]();
+
+	//消し忘れたものを出す
+	CheckLedgerLeak(g_CurrentScene);
 }
 
 SCENE GetCurrentScene(void)
@@ -69,6 +164,9 @@ SCENE GetCurrentScene(void)
 void SetNextStage(SCENE nextstage)
 {
 	g_NextStage = nextstage;
+
+	//切り替える前の画面を取っておくので、このフレームは描く
+	RequestRedraw();
 }
 
 STAGE GetCurrentStage(void)
@@ -78,6 +176,14 @@ STAGE GetCurrentStage(void)
 
 void Replay(void)
 {
+	//ゲームは読み込んだ直後の状態に戻すだけ。ほかのシーンは読み直す
+	if (g_CurrentScene == scene_game)
+	{
+		GameReset();
+		return;
+	}
+
+	SceneUNINIT();
 	SceneINIT();
 }
 
@@ -85,20 +191,44 @@ void ExecuteStage(void)
 {
 	if (g_CurrentScene == g_NextStage)return;
 
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int loadNum, preloadNum;
+	GetTextureLoadCount(&loadNum, &preloadNum);
+
 	if (g_CurrentScene == scene_game)
 	{
 		g_coinCnt = GetCoinNum();
 	}
 
+	SCENE oldScene = g_CurrentScene;
 
 	SceneUNINIT();
 
-	//ÕQ[Xe[WL^B
+	//前のゲームステージを記録する。
 	if (g_CurrentScene == scene_game)g_CurrentStage = (STAGE)(g_CurrentStage + 1);
 
 	g_CurrentScene = g_NextStage;
 
 	SceneINIT();
+
+	//使われなかった先読みは捨てる
+	DiscardTexturePreload();
+	g_PreloadScene = SCENEMAX;
+
+	g_FadeFrame = g_IsFadeCaptured ? SCENE_FADEFRAME : 0;
+	g_IsFadeCaptured = false;
+	RequestRedraw();
+
+	//切り替えで1フレームの時間を超えたかを数える
+	int us = (int)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	int newLoadNum, newPreloadNum;
+	GetTextureLoadCount(&newLoadNum, &newPreloadNum);
+
+	g_TransitionNum++;
+	if (us > SCENE_FRAMEBUDGET)g_OverBudgetNum++;
+
+	NN_LOG("Scene: %d -> %d %dus, %d/%d textures preloaded, %d/%d transitions over budget\n",
+		oldScene, g_CurrentScene, us, newPreloadNum - preloadNum, newLoadNum - loadNum, g_OverBudgetNum, g_TransitionNum);
 }
 
 int GetCoinNumScene(void)
@@ -114,4 +244,89 @@ void CoinNumResetScene(void)
 void StageReset(void)
 {
 	g_CurrentStage = stage_1;
+}
+
+void RestartScene(SCENE scene, STAGE stage, int coinNum)
+{
+	SceneUNINIT();
+
+	g_CurrentScene = scene;
+	g_NextStage = scene;
+	g_CurrentStage = stage;
+	g_coinCnt = coinNum;
+
+	SceneINIT();
+}
+
+//今のシーンから次に行きそうなシーン。まだ先読みしないならSCENEMAX
+static SCENE GetPreloadScene(void)
+{
+	switch (g_CurrentScene)
+	{
+	case scene_title:
+		//タイトルは待っているだけなので最初から
+		return scene_game;
+
+	case scene_game:
+		//クリアの演出を見ている間に
+		return GetIsClear() ? scene_result : SCENEMAX;
+
+	case scene_result:
+		return g_CurrentStage <= stage_4 ? scene_game : scene_title;
+
+	default:
+		return SCENEMAX;
+	}
+}
+
+static void PreloadScene(SCENE scene)
+{
+	if (scene == g_PreloadScene && g_CurrentStage == g_PreloadStage)return;
+
+	g_PreloadScene = scene;
+	g_PreloadStage = g_CurrentStage;
+
+	const char* name[SCENE_MANIFESTMAX];
+	char background[32] = {};
+	int num = 0;
+
+	for (int i = 0; i < g_SceneManifest[scene].textureNum && num < SCENE_MANIFESTMAX; i++)
+	{
+		name[num++] = g_SceneManifest[scene].texture[i];
+	}
+
+	//backgroundINITと同じ名前
+	if (scene == scene_game && g_CurrentStage <= stage_3 && num < SCENE_MANIFESTMAX)
+	{
+		sprintf(background, "asset/stage_%d_background.tga", g_CurrentStage + 1);
+		name[num++] = background;
+	}
+
+	PreloadTextures(name, num);
+}
+
+//描き終わった画面をテクスチャにする。SwapBuffersの前に呼ぶ
+static void CaptureFadeFrame(void)
+{
+	if (GetIsHeadless())return;
+
+	//内部解像度で描いている所も画面に出してから写す
+	ResolveResolution();
+
+	if (g_FadeTex == NULL)
+	{
+		glGenTextures(1, &g_FadeTex);
+		RegisterLedger(ledger_texture, g_FadeTex, SCREEN_WIDTH * SCREEN_HEIGHT * 3, __FILE__, "fade");
+		SetTextureOpacity(g_FadeTex, texopacity_opaque);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, g_FadeTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	g_IsFadeCaptured = true;
 }
\ No newline at end of file
@@ -33,5 +33,7 @@ void SetNextStage(SCENE nextstage);
 int GetCoinNumScene(void);
 void CoinNumResetScene(void);
 void StageReset(void);
+//今のシーンを終わらせて、sceneをstage、コインcoinNumの状態から始め直す。リプレイ用
+void RestartScene(SCENE scene, STAGE stage, int coinNum);
 
 #endif
\ No newline at end of file
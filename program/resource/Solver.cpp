@@ -0,0 +1,331 @@
+//=================================
+//
+//ステージソルバー
+//
+//描画、音、エフェクトなしでボールを発射して、ゴールに届くブロックの置き方を探す。
+//ボールが通らないマスにブロックを置いても結果は変わらないので、
+//ボールが通ったマスの周りだけに次のブロックを置いてみる。
+//置き方一つが一つのジョブになり、ジョブシステムのワーカーに盗まれながら広がる。
+//
+//=================================
+
+#include"main.h"
+#include"Solver.h"
+#include"StageMaker.h"
+#include"Ball.h"
+#include"Random.h"
+#include"Job.h"
+
+#include<mutex>
+#include<atomic>
+#include<vector>
+#include<set>
+#include<chrono>
+#include<algorithm>
+
+#define SOLVER_MAXPLACE (4)			//一つの解で置くブロックの最大数
+#define SOLVER_MAXFRAME (60 * 60)	//これ以上動き続けたら失敗にする
+#define SOLVER_SEED (0)				//毎回同じ乱数列でシミュレーションする
+#define SOLVER_MAXSIMULATE (5000)	//ステージごとにこれ以上は積んであるタスクを捨てて終わる。置き方は組み合わせで増える
+
+typedef struct
+{
+	Int2 npos;
+	BLOCKTYPE type;
+	DIR dir;
+}PLACEMENT;
+
+typedef struct
+{
+	STAGE stage;
+	int placeNum;
+	PLACEMENT place[SOLVER_MAXPLACE];
+	int itemNum[TYPEMAX];//残りのアイテム数
+}SOLVERTASK;
+
+typedef struct
+{
+	STAGE stage;
+	int coinNum;
+	int frame;
+	int placeNum;
+	PLACEMENT place[SOLVER_MAXPLACE];
+}SOLVERRESULT;
+
+static bool IsDirBlock(BLOCKTYPE type);
+static void PushTask(const SOLVERTASK* task);
+static bool CheckVisited(const SOLVERTASK* task);
+static bool SimulateLaunch(const SOLVERTASK* task, std::vector<char>* touched, int* coin, int* frame);
+static void ExpandTask(const SOLVERTASK* task, const std::vector<char>* touched);
+static void SolverJob(void* argument);
+
+//ソルバーは全部のスレッドから読むので、チャンクを全部読んだマップを使う
+static TILEMAP g_SolverMap[STAGEMAX];
+static STAGEDATA g_SolverStage[STAGEMAX];
+static JOBCOUNTER g_TaskCounter;
+static std::atomic<int> g_SimulateNum;
+static std::atomic<int> g_TaskNum[STAGEMAX];
+static std::atomic<int> g_SkipNum;
+static std::mutex g_ResultMutex;
+static std::vector<SOLVERRESULT> g_Result;
+static std::mutex g_VisitedMutex;
+static std::set<std::vector<int> > g_Visited;
+
+int SolveAllStages(void)
+{
+	const STAGE stage[] = { stage_1, stage_2, stage_3, stage_4 };
+
+	return SolveStages(stage, STAGEMAX);
+}
+
+int SolveStages(const STAGE* stage, int stagenum)
+{
+	//シミュレーションはthread_localのステージを書き換えるので、ワーカーでしか動かせない
+	if (GetJobThreadNum() == 0)
+	{
+		NN_LOG("Solver: JobINIT has not been called\n");
+		return 0;
+	}
+
+	InitializeJobCounter(&g_TaskCounter);
+	g_SimulateNum = 0;
+	g_SkipNum = 0;
+	for (int i = 0; i < STAGEMAX; i++)
+	{
+		g_TaskNum[i] = 0;
+	}
+	g_Result.clear();
+	g_Visited.clear();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//最初のタスク(何も置かない)をステージごとに積む
+	for (int i = 0; i < stagenum; i++)
+	{
+		if (!LoadStageData(stage[i], &g_SolverMap[stage[i]], tilemap_resident, &g_SolverStage[stage[i]]))
+		{
+			NN_LOG("Solver: stage%d load failed\n", stage[i] + 1);
+			continue;
+		}
+
+		SOLVERTASK root;
+		memset(&root, 0, sizeof(root));
+		root.stage = stage[i];
+		for (int k = 0; k < TYPEMAX; k++)
+		{
+			root.itemNum[k] = g_SolverStage[stage[i]].item[k].IsUse ? g_SolverStage[stage[i]].item[k].num : 0;
+		}
+		CheckVisited(&root);
+		PushTask(&root);
+	}
+
+	WaitJobCounter(&g_TaskCounter);
+
+	//全部読んだマップは大きいので、解き終わったら閉じる
+	for (int i = 0; i < stagenum; i++)
+	{
+		ReleaseStageData(&g_SolverStage[stage[i]]);
+		CloseTileMap(&g_SolverMap[stage[i]]);
+	}
+
+	long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	//ステージ順、コインが多い順、置いた数が少ない順
+	std::sort(g_Result.begin(), g_Result.end(), [](const SOLVERRESULT& a, const SOLVERRESULT& b)
+	{
+		if (a.stage != b.stage)return a.stage < b.stage;
+		if (a.coinNum != b.coinNum)return a.coinNum > b.coinNum;
+		return a.placeNum < b.placeNum;
+	});
+
+	for (size_t i = 0; i < g_Result.size(); i++)
+	{
+		NN_LOG("Solver: stage%d goal coin:%d frame:%d", g_Result[i].stage + 1, g_Result[i].coinNum, g_Result[i].frame);
+		for (int k = 0; k < g_Result[i].placeNum; k++)
+		{
+			NN_LOG(" (%d,%d type:%d dir:%d)", g_Result[i].place[k].npos.x, g_Result[i].place[k].npos.y,
+				g_Result[i].place[k].type, g_Result[i].place[k].dir);
+		}
+		NN_LOG("\n");
+	}
+	NN_LOG("Solver: %d solutions, %d simulations, %d threads, %lld ms\n",
+		(int)g_Result.size(), (int)g_SimulateNum, GetJobThreadNum(), ms);
+	if (g_SkipNum > 0)
+	{
+		NN_LOG("Solver: stopped at %d simulations per stage, %d tasks skipped\n", SOLVER_MAXSIMULATE, (int)g_SkipNum);
+	}
+
+	return (int)g_Result.size();
+}
+
+//置き方一つを調べる。ワーカーは最初から描画、音、エフェクトを使わない
+static void SolverJob(void* argument)
+{
+	SOLVERTASK* task = (SOLVERTASK*)argument;
+
+	//打ち切った後のタスクは数えるだけ
+	if (g_TaskNum[task->stage].fetch_add(1) >= SOLVER_MAXSIMULATE)
+	{
+		g_SkipNum++;
+		delete task;
+		return;
+	}
+
+	std::vector<char> touched;
+	int coin = 0;
+	int frame = 0;
+
+	if (SimulateLaunch(task, &touched, &coin, &frame))
+	{
+		SOLVERRESULT result;
+		result.stage = task->stage;
+		result.coinNum = coin;
+		result.frame = frame;
+		result.placeNum = task->placeNum;
+		memcpy(result.place, task->place, sizeof(result.place));
+
+		std::lock_guard<std::mutex> lock(g_ResultMutex);
+		g_Result.push_back(result);
+	}
+	else
+	{
+		//ゴールしなかったらもう一個置いてみる。子は自分のキューに入るので深さ優先になる
+		ExpandTask(task, &touched);
+	}
+
+	//ワーカーのステージのeditとタイマーはジョブごとに返す
+	ReleaseThreadStageData();
+	delete task;
+}
+
+//ブロックを置いてボールを発射する。ゴールしたらtrue。
+static bool SimulateLaunch(const SOLVERTASK* task, std::vector<char>* touched, int* coin, int* frame)
+{
+	g_SimulateNum++;
+
+	SetStageData(&g_SolverStage[task->stage]);
+	touched->assign(GetStageWidth() * GetStageHeight(), 0);
+
+	for (int i = 0; i < task->placeNum; i++)
+	{
+		//ゲームでも置けない並べ方なので解にしない。通った所もないので先も調べない
+		if (!SetPlayerBlock(task->place[i].npos, task->place[i].type, task->place[i].dir))return false;
+	}
+
+	//前のジョブのボールが残っているので、HPまで全部戻す
+	SetRandomSeed(random_game, SOLVER_SEED);
+	InitBallState();
+	SetBall();
+
+	for (*frame = 0; *frame < SOLVER_MAXFRAME; (*frame)++)
+	{
+		StageBlockBurnUPDATE();
+		BallUPDATE();
+
+		//ゴールか死亡
+		if (!GetBall()->IsUse)break;
+
+		//ボールと隣のマスまでを通ったことにする
+		Float2 pos = GetBallPos();
+		Int2 min = GetBlockNpos(MakeFloat2(pos.x - 16 - BLOCKSIZE.x, pos.y - 16 - BLOCKSIZE.y));
+		Int2 max = GetBlockNpos(MakeFloat2(pos.x + 16 + BLOCKSIZE.x, pos.y + 16 + BLOCKSIZE.y));
+
+		if (min.x < 0)min.x = 0;
+		if (min.y < 0)min.y = 0;
+		if (max.x > GetStageWidth() - 1)max.x = GetStageWidth() - 1;
+		if (max.y > GetStageHeight() - 1)max.y = GetStageHeight() - 1;
+
+		for (int i = min.y; i <= max.y; i++)
+		{
+			for (int k = min.x; k <= max.x; k++)
+			{
+				(*touched)[i * GetStageWidth() + k] = 1;
+			}
+		}
+	}
+
+	*coin = GetCoinNum();
+
+	return GetIsBallGoal();
+}
+
+//ボールが通ったマスに残りのアイテムを一つ置いたタスクを積む
+static void ExpandTask(const SOLVERTASK* task, const std::vector<char>* touched)
+{
+	if (task->placeNum >= SOLVER_MAXPLACE)return;
+
+	const STAGEDATA* stage = &g_SolverStage[task->stage];
+	int width = stage->map->file.width;
+	int height = stage->map->file.height;
+
+	for (int i = 0; i < height; i++)
+	{
+		for (int k = 0; k < width; k++)
+		{
+			if (!(*touched)[i * width + k])continue;
+
+			if (GetStageDataBlock(stage, i, k).isUse)continue;
+
+			bool IsPlaced = false;
+			for (int n = 0; n < task->placeNum; n++)
+			{
+				if (task->place[n].npos.x == k && task->place[n].npos.y == i)IsPlaced = true;
+			}
+			if (IsPlaced)continue;
+
+			for (int type = 0; type < TYPEMAX; type++)
+			{
+				if (task->itemNum[type] <= 0)continue;
+
+				int dirnum = IsDirBlock((BLOCKTYPE)type) ? DIRMAX : 1;
+				for (int dir = 0; dir < dirnum; dir++)
+				{
+					SOLVERTASK child = *task;
+					child.place[child.placeNum].npos = MakeInt2(k, i);
+					child.place[child.placeNum].type = (BLOCKTYPE)type;
+					child.place[child.placeNum].dir = (DIR)dir;
+					child.placeNum++;
+					child.itemNum[type]--;
+
+					//置く順番が違うだけの組み合わせは一回だけ調べる
+					if (CheckVisited(&child))continue;
+
+					PushTask(&child);
+				}
+			}
+		}
+	}
+}
+
+//向きで動きが変わるブロック
+static bool IsDirBlock(BLOCKTYPE type)
+{
+	return type == type_doubletube || type == type_tube_in || type == type_tube_out || type == type_frame;
+}
+
+//調べたことがある組み合わせならtrue。なければ登録する。
+static bool CheckVisited(const SOLVERTASK* task)
+{
+	std::vector<int> key;
+	key.push_back(task->stage);
+
+	for (int i = 0; i < task->placeNum; i++)
+	{
+		int cell = task->place[i].npos.y * g_SolverStage[task->stage].map->file.width + task->place[i].npos.x;
+		key.push_back((cell * TYPEMAX + task->place[i].type) * DIRMAX + task->place[i].dir);
+	}
+	std::sort(key.begin() + 1, key.end());
+
+	std::lock_guard<std::mutex> lock(g_VisitedMutex);
+	return !g_Visited.insert(key).second;
+}
+
+//ジョブが終わるまでタスクを置いておく場所はジョブが持つ
+static void PushTask(const SOLVERTASK* task)
+{
+	JOB job;
+	job.function = SolverJob;
+	job.argument = new SOLVERTASK(*task);
+
+	RunJobs(&job, 1, &g_TaskCounter);
+}
\ No newline at end of file
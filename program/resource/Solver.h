@@ -0,0 +1,11 @@
+#ifndef SOLVER_H_
+#define SOLVER_H_
+
+#include"Scene.h"
+
+//ステージの解(ゴールに届くブロックの置き方)を探す。
+//ジョブシステムのワーカーで探すので、JobINITの後で呼ぶ。見つかった解の数を返す。
+int SolveStages(const STAGE* stage, int stagenum);
+int SolveAllStages(void);
+
+#endif
\ No newline at end of file
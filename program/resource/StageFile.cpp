@@ -0,0 +1,524 @@
+//=================================
+//
+//ステージファイルの読み書き
+//
+//開く時はヘッダーとチャンク表だけ読んで、セルはチャンクごとに後から読む。
+//大きいステージでも、画面の近くのチャンクしかメモリに置かなくていいように。
+//ファイルはマップしない。セルは1バイト単位の構造体なので、チャンクをスロットにそのまま読めば
+//フィールドごとの変換はいらない。マップするとステージ全体をアドレス空間に置くことになる。
+//
+//=================================
+
+#include"StageFile.h"
+#include"StageMaker.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#define STAGEFILE_CHUNKCELLNUM (CHUNK_SIZE * CHUNK_SIZE)
+
+static bool OpenVersion1(FILE* fp, const STAGEFILEHEADER* header, STAGEFILEINFO* info);
+static bool OpenVersion2(FILE* fp, const STAGEFILEHEADER* header, STAGEFILEINFO* info);
+static void SetEmptyCell(STAGEFILECELL* cell, int num);
+static bool IsObjectCell(const STAGEFILECELL* cell);
+static bool IsBurnCell(const STAGEFILECELL* cell);
+static int ReadU16(const unsigned char* src);
+static unsigned int ReadU32(const unsigned char* src);
+static void WriteU16(unsigned char* dst, int num);
+static void WriteU32(unsigned char* dst, unsigned int num);
+
+bool OpenStageFile(const char* filename, STAGEFILEINFO* info)
+{
+	memset(info, 0, sizeof(STAGEFILEINFO));
+	strncpy(info->filename, filename, sizeof(info->filename) - 1);
+
+	FILE* fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	STAGEFILEHEADER header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, STAGEFILE_MAGIC, 4) != 0)
+	{
+		NN_LOG("OpenStageFile: %s is not a stage file\n", filename);
+		fclose(fp);
+		return false;
+	}
+
+	info->version = ReadU16(header.version);
+
+	bool IsOpen = false;
+	if (info->version == 1)
+	{
+		IsOpen = OpenVersion1(fp, &header, info);
+	}
+	else if (info->version == STAGEFILE_VERSION)
+	{
+		IsOpen = OpenVersion2(fp, &header, info);
+	}
+	else
+	{
+		NN_LOG("OpenStageFile: %s version %d is not supported\n", filename, info->version);
+	}
+	fclose(fp);
+
+	return IsOpen;
+}
+
+//バージョン1はセルが行ごとに並んでいるだけなので、開く時に全部読んで確認する。1画面分なので小さい。
+static bool OpenVersion1(FILE* fp, const STAGEFILEHEADER* header, STAGEFILEINFO* info)
+{
+	info->width = header->width;
+	info->height = header->height;
+	info->chunkWidth = (info->width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	info->chunkHeight = (info->height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	if (info->width == 0 || info->height == 0)
+	{
+		NN_LOG("OpenStageFile: %s is empty\n", info->filename);
+		return false;
+	}
+
+	unsigned int cellsize = sizeof(STAGEFILECELL) * info->width * info->height;
+	unsigned int payloadsize = cellsize + sizeof(STAGEFILEITEM) * header->itemNum;
+	unsigned char* payload = (unsigned char*)malloc(payloadsize + 1);
+
+	//後ろに余計なものが付いていたらサイズ違い
+	bool IsRead = fread(payload, 1, payloadsize + 1, fp) == payloadsize;
+	if (!IsRead || HashData(HASH_INIT, payload, payloadsize) != ReadU32(header->checksum))
+	{
+		NN_LOG("OpenStageFile: %s size or checksum mismatch\n", info->filename);
+		free(payload);
+		return false;
+	}
+
+	const STAGEFILECELL* cell = (const STAGEFILECELL*)payload;
+	for (int i = 0; i < info->height; i++)
+	{
+		for (int k = 0; k < info->width; k++)
+		{
+			if (IsBurnCell(&cell[i * info->width + k]))info->burnNum++;
+			if (!IsObjectCell(&cell[i * info->width + k]))continue;
+			if (info->objectNum >= STAGEFILE_MAXOBJECT)continue;
+
+			info->object[info->objectNum] = MakeInt2(k, i);
+			info->objectNum++;
+		}
+	}
+
+	info->itemNum = header->itemNum < STAGEFILE_MAXITEM ? header->itemNum : STAGEFILE_MAXITEM;
+	memcpy(info->item, payload + cellsize, sizeof(STAGEFILEITEM) * info->itemNum);
+
+	free(payload);
+	return true;
+}
+
+static bool OpenVersion2(FILE* fp, const STAGEFILEHEADER* header, STAGEFILEINFO* info)
+{
+	STAGEFILEMAPINFO mapinfo;
+	if (fread(&mapinfo, sizeof(mapinfo), 1, fp) != 1)
+	{
+		NN_LOG("OpenStageFile: %s size mismatch\n", info->filename);
+		return false;
+	}
+
+	info->width = ReadU16(mapinfo.width);
+	info->height = ReadU16(mapinfo.height);
+	info->chunkWidth = header->width;
+	info->chunkHeight = header->height;
+	info->objectNum = ReadU16(mapinfo.objectNum);
+
+	if (mapinfo.chunkSize != CHUNK_SIZE ||
+		info->width == 0 || info->height == 0 ||
+		info->chunkWidth != (info->width + CHUNK_SIZE - 1) / CHUNK_SIZE ||
+		info->chunkHeight != (info->height + CHUNK_SIZE - 1) / CHUNK_SIZE ||
+		info->chunkWidth > STAGEFILE_MAXCHUNKX || info->chunkHeight > STAGEFILE_MAXCHUNKY ||
+		info->objectNum > STAGEFILE_MAXOBJECT)
+	{
+		NN_LOG("OpenStageFile: %s (%dx%d chunk:%d) is not supported\n", info->filename, info->width, info->height, mapinfo.chunkSize);
+		return false;
+	}
+
+	int chunknum = info->chunkWidth * info->chunkHeight;
+	unsigned int itemsize = sizeof(STAGEFILEITEM) * header->itemNum;
+	unsigned int objectsize = sizeof(STAGEFILEOBJECT) * info->objectNum;
+	unsigned int tablesize = sizeof(STAGEFILECHUNK) * chunknum;
+
+	unsigned char buffer[sizeof(STAGEFILEITEM) * 256 + sizeof(STAGEFILEOBJECT) * STAGEFILE_MAXOBJECT + sizeof(STAGEFILECHUNK) * STAGEFILE_MAXCHUNK];
+	if (fread(buffer, itemsize + objectsize + tablesize, 1, fp) != 1)
+	{
+		NN_LOG("OpenStageFile: %s size mismatch\n", info->filename);
+		return false;
+	}
+
+	unsigned int checksum = HashData(HASH_INIT, &mapinfo, sizeof(mapinfo));
+	checksum = HashData(checksum, buffer, itemsize + objectsize + tablesize);
+	if (checksum != ReadU32(header->checksum))
+	{
+		NN_LOG("OpenStageFile: %s checksum mismatch\n", info->filename);
+		return false;
+	}
+
+	info->itemNum = header->itemNum < STAGEFILE_MAXITEM ? header->itemNum : STAGEFILE_MAXITEM;
+	memcpy(info->item, buffer, sizeof(STAGEFILEITEM) * info->itemNum);
+
+	const STAGEFILEOBJECT* object = (const STAGEFILEOBJECT*)(buffer + itemsize);
+	for (int i = 0; i < info->objectNum; i++)
+	{
+		info->object[i] = MakeInt2(ReadU16(object[i].x), ReadU16(object[i].y));
+	}
+
+	//空でないチャンクは表の順に詰めて入っている
+	const STAGEFILECHUNK* table = (const STAGEFILECHUNK*)(buffer + itemsize + objectsize);
+	long offset = (long)(sizeof(STAGEFILEHEADER) + sizeof(STAGEFILEMAPINFO) + itemsize + objectsize + tablesize);
+	for (int i = 0; i < chunknum; i++)
+	{
+		if (table[i].flags & STAGEFILE_CHUNK_EMPTY)continue;
+
+		info->chunkOffset[i] = offset;
+		info->chunkChecksum[i] = ReadU32(table[i].checksum);
+		info->burnNum += ReadU16(table[i].burnNum);
+		offset += sizeof(STAGEFILECELL) * STAGEFILE_CHUNKCELLNUM;
+	}
+
+	return true;
+}
+
+//ロードスレッドからも呼ぶので、infoは読むだけにする
+bool ReadStageFileChunk(const STAGEFILEINFO* info, int chunk, STAGEFILECELL* cell)
+{
+	SetEmptyCell(cell, STAGEFILE_CHUNKCELLNUM);
+
+	if (info->version == 0)return false;
+	if (chunk < 0 || chunk >= info->chunkWidth * info->chunkHeight)return true;
+	if (info->version != 1 && info->chunkOffset[chunk] == 0)return true;
+
+	FILE* fp = fopen(info->filename, "rb");
+	if (fp == NULL)
+	{
+		NN_LOG("ReadStageFileChunk: %s open failed\n", info->filename);
+		return false;
+	}
+
+	bool IsRead = true;
+	if (info->version == 1)
+	{
+		//行ごとに、このチャンクにかかる所だけ読む
+		int left = (chunk % info->chunkWidth) * CHUNK_SIZE;
+		int top = (chunk / info->chunkWidth) * CHUNK_SIZE;
+		int num = info->width - left < CHUNK_SIZE ? info->width - left : CHUNK_SIZE;
+
+		for (int i = 0; i < CHUNK_SIZE && top + i < info->height; i++)
+		{
+			long offset = (long)(sizeof(STAGEFILEHEADER) + sizeof(STAGEFILECELL) * ((top + i) * info->width + left));
+			if (fseek(fp, offset, SEEK_SET) != 0 ||
+				fread(&cell[i * CHUNK_SIZE], sizeof(STAGEFILECELL), num, fp) != (size_t)num)
+			{
+				IsRead = false;
+				break;
+			}
+		}
+	}
+	else
+	{
+		IsRead = fseek(fp, info->chunkOffset[chunk], SEEK_SET) == 0 &&
+			fread(cell, sizeof(STAGEFILECELL), STAGEFILE_CHUNKCELLNUM, fp) == STAGEFILE_CHUNKCELLNUM &&
+			HashData(HASH_INIT, cell, sizeof(STAGEFILECELL) * STAGEFILE_CHUNKCELLNUM) == info->chunkChecksum[chunk];
+	}
+	fclose(fp);
+
+	//壊れたチャンクは空にしておく
+	if (!IsRead)
+	{
+		NN_LOG("ReadStageFileChunk: %s chunk %d is broken\n", info->filename, chunk);
+		SetEmptyCell(cell, STAGEFILE_CHUNKCELLNUM);
+	}
+	return IsRead;
+}
+
+bool MakeStageFileInfo(STAGEFILEINFO* info, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum)
+{
+	memset(info, 0, sizeof(STAGEFILEINFO));
+
+	info->width = width;
+	info->height = height;
+	info->chunkWidth = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	info->chunkHeight = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	if (width <= 0 || height <= 0 ||
+		info->chunkWidth > STAGEFILE_MAXCHUNKX || info->chunkHeight > STAGEFILE_MAXCHUNKY)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < height; i++)
+	{
+		for (int k = 0; k < width; k++)
+		{
+			if (IsBurnCell(&cell[i * width + k]))info->burnNum++;
+			if (!IsObjectCell(&cell[i * width + k]))continue;
+			if (info->objectNum >= STAGEFILE_MAXOBJECT)continue;
+
+			info->object[info->objectNum] = MakeInt2(k, i);
+			info->objectNum++;
+		}
+	}
+
+	info->itemNum = itemNum < STAGEFILE_MAXITEM ? itemNum : STAGEFILE_MAXITEM;
+	memcpy(info->item, item, sizeof(STAGEFILEITEM) * info->itemNum);
+
+	return true;
+}
+
+bool SaveStageFile(const char* filename, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum)
+{
+	int chunkwidth = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	int chunkheight = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	int chunknum = chunkwidth * chunkheight;
+
+	if (width <= 0 || height <= 0 ||
+		chunkwidth > STAGEFILE_MAXCHUNKX || chunkheight > STAGEFILE_MAXCHUNKY || itemNum > 255)
+	{
+		NN_LOG("SaveStageFile: %s (%dx%d) is too large\n", filename, width, height);
+		return false;
+	}
+
+	STAGEFILEOBJECT object[STAGEFILE_MAXOBJECT];
+	int objectnum = 0;
+	for (int i = 0; i < height; i++)
+	{
+		for (int k = 0; k < width; k++)
+		{
+			if (!IsObjectCell(&cell[i * width + k]))continue;
+
+			if (objectnum >= STAGEFILE_MAXOBJECT)
+			{
+				NN_LOG("SaveStageFile: %s has too many tubes\n", filename);
+				return false;
+			}
+			WriteU16(object[objectnum].x, k);
+			WriteU16(object[objectnum].y, i);
+			objectnum++;
+		}
+	}
+
+	STAGEFILECELL chunkcell[STAGEFILE_CHUNKCELLNUM];
+	STAGEFILECHUNK table[STAGEFILE_MAXCHUNK];
+	memset(table, 0, sizeof(table));
+
+	for (int i = 0; i < chunknum; i++)
+	{
+		GetStageFileChunkCell(cell, width, height, i % chunkwidth, i / chunkwidth, chunkcell);
+
+		bool IsEmpty = true;
+		int burnnum = 0;
+		for (int n = 0; n < STAGEFILE_CHUNKCELLNUM; n++)
+		{
+			if (chunkcell[n].flags & STAGEFILE_CELL_USE)IsEmpty = false;
+			if (IsBurnCell(&chunkcell[n]))burnnum++;
+		}
+
+		table[i].flags = IsEmpty ? STAGEFILE_CHUNK_EMPTY : 0;
+		WriteU16(table[i].burnNum, burnnum);
+		WriteU32(table[i].checksum, IsEmpty ? 0 : HashData(HASH_INIT, chunkcell, sizeof(chunkcell)));
+	}
+
+	STAGEFILEMAPINFO mapinfo;
+	memset(&mapinfo, 0, sizeof(mapinfo));
+	WriteU16(mapinfo.width, width);
+	WriteU16(mapinfo.height, height);
+	mapinfo.chunkSize = CHUNK_SIZE;
+	WriteU16(mapinfo.objectNum, objectnum);
+
+	unsigned int checksum = HashData(HASH_INIT, &mapinfo, sizeof(mapinfo));
+	checksum = HashData(checksum, item, sizeof(STAGEFILEITEM) * itemNum);
+	checksum = HashData(checksum, object, sizeof(STAGEFILEOBJECT) * objectnum);
+	checksum = HashData(checksum, table, sizeof(STAGEFILECHUNK) * chunknum);
+
+	STAGEFILEHEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STAGEFILE_MAGIC, 4);
+	WriteU16(header.version, STAGEFILE_VERSION);
+	header.width = (unsigned char)chunkwidth;
+	header.height = (unsigned char)chunkheight;
+	header.itemNum = (unsigned char)itemNum;
+	WriteU32(header.checksum, checksum);
+
+	FILE* fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	bool IsWrite = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		fwrite(&mapinfo, sizeof(mapinfo), 1, fp) == 1 &&
+		fwrite(item, sizeof(STAGEFILEITEM), itemNum, fp) == (size_t)itemNum &&
+		fwrite(object, sizeof(STAGEFILEOBJECT), objectnum, fp) == (size_t)objectnum &&
+		fwrite(table, sizeof(STAGEFILECHUNK), chunknum, fp) == (size_t)chunknum;
+
+	for (int i = 0; i < chunknum && IsWrite; i++)
+	{
+		if (table[i].flags & STAGEFILE_CHUNK_EMPTY)continue;
+
+		GetStageFileChunkCell(cell, width, height, i % chunkwidth, i / chunkwidth, chunkcell);
+		IsWrite = fwrite(chunkcell, sizeof(chunkcell), 1, fp) == 1;
+	}
+	fclose(fp);
+
+	return IsWrite;
+}
+
+bool LoadLegacyStageFile(STAGE stage, STAGEFILECELL* cell, STAGEFILEITEM* item)
+{
+	const char* filename = stage == stage_1 ? "asset/stage1.bin" :
+		stage == stage_2 ? "asset/stage2.bin" :
+		stage == stage_3 ? "asset/stage3.bin" : "asset/stage4.bin";
+	const char* itemfilename = stage == stage_1 ? "asset/data/Stage_1_Item.bin" :
+		stage == stage_2 ? "asset/data/Stage_2_Item.bin" :
+		stage == stage_3 ? "asset/data/Stage_3_Item.bin" : "asset/data/Stage_4_Item.bin";
+
+	BLOCK block[STAGEFILE_LEGACYHEIGHT][STAGEFILE_LEGACYWIDTH + 1];
+	ENABLEBLOCK enable[TYPEMAX];
+	memset(block, 0, sizeof(block));
+	memset(enable, 0, sizeof(enable));
+
+	FILE* fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		return false;
+	}
+	//途中で切れたファイルはゴミのセルを読むことになるので使わない
+	if (fread(block, sizeof(block), 1, fp) != 1)
+	{
+		NN_LOG("LoadLegacyStageFile: %s size mismatch\n", filename);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+
+	FILE* itemfp = fopen(itemfilename, "rb");
+	if (itemfp == NULL)
+	{
+		return false;
+	}
+	if (fread(enable, sizeof(enable), 1, itemfp) != 1)
+	{
+		NN_LOG("LoadLegacyStageFile: %s size mismatch\n", itemfilename);
+		fclose(itemfp);
+		return false;
+	}
+	fclose(itemfp);
+
+	//使っていないセルにはゴミが入っているので、土管の番号は土管だけ残す
+	for (int i = 0; i < STAGEFILE_LEGACYHEIGHT; i++)
+	{
+		for (int k = 0; k < STAGEFILE_LEGACYWIDTH; k++)
+		{
+			const BLOCK* src = &block[i][k];
+			STAGEFILECELL* dst = &cell[i * STAGEFILE_LEGACYWIDTH + k];
+
+			bool IsTube = src->isUse && (src->type == type_tube_in || src->type == type_tube_out);
+
+			dst->type = (unsigned char)src->type;
+			dst->dir = (unsigned char)src->dir;
+			dst->tube = IsTube ? (signed char)src->warp_turn_num : -1;
+			dst->flags = src->isUse ? STAGEFILE_CELL_USE : 0;
+		}
+	}
+
+	for (int i = 0; i < TYPEMAX; i++)
+	{
+		WriteU16(item[i].num, enable[i].num);
+		item[i].flags = enable[i].IsUse ? STAGEFILE_ITEM_USE : 0;
+		item[i].reserved = 0;
+	}
+
+	return true;
+}
+
+int ConvertLegacyStageFiles(void)
+{
+	int num = 0;
+
+	for (int i = 0; i < STAGEMAX; i++)
+	{
+		STAGEFILECELL cell[STAGEFILE_LEGACYWIDTH * STAGEFILE_LEGACYHEIGHT];
+		STAGEFILEITEM item[TYPEMAX];
+
+		if (!LoadLegacyStageFile((STAGE)i, cell, item))
+		{
+			NN_LOG("ConvertLegacyStageFiles: stage%d load failed\n", i + 1);
+			continue;
+		}
+		if (!SaveStageFile(GetStageFileName((STAGE)i), cell, STAGEFILE_LEGACYWIDTH, STAGEFILE_LEGACYHEIGHT, item, TYPEMAX))
+		{
+			NN_LOG("ConvertLegacyStageFiles: %s save failed\n", GetStageFileName((STAGE)i));
+			continue;
+		}
+		NN_LOG("ConvertLegacyStageFiles: %s\n", GetStageFileName((STAGE)i));
+		num++;
+	}
+	return num;
+}
+
+void GetStageFileChunkCell(const STAGEFILECELL* cell, int width, int height, int chunkx, int chunky, STAGEFILECELL* dst)
+{
+	SetEmptyCell(dst, STAGEFILE_CHUNKCELLNUM);
+
+	for (int i = 0; i < CHUNK_SIZE && chunky * CHUNK_SIZE + i < height; i++)
+	{
+		for (int k = 0; k < CHUNK_SIZE && chunkx * CHUNK_SIZE + k < width; k++)
+		{
+			dst[i * CHUNK_SIZE + k] = cell[(chunky * CHUNK_SIZE + i) * width + chunkx * CHUNK_SIZE + k];
+		}
+	}
+}
+
+static void SetEmptyCell(STAGEFILECELL* cell, int num)
+{
+	for (int i = 0; i < num; i++)
+	{
+		cell[i].type = type_normal;
+		cell[i].dir = dir_top;
+		cell[i].tube = -1;
+		cell[i].flags = 0;
+	}
+}
+
+//ステージ全体から探すブロック
+static bool IsObjectCell(const STAGEFILECELL* cell)
+{
+	return (cell->flags & STAGEFILE_CELL_USE) &&
+		(cell->type == type_tube_in || cell->type == type_tube_out || cell->type == type_move);
+}
+
+//燃えるブロック。燃焼タイマーはこの数だけあれば足りる
+static bool IsBurnCell(const STAGEFILECELL* cell)
+{
+	return (cell->flags & STAGEFILE_CELL_USE) && cell->type == type_grass;
+}
+
+static int ReadU16(const unsigned char* src)
+{
+	return src[0] | (src[1] << 8);
+}
+
+static unsigned int ReadU32(const unsigned char* src)
+{
+	return src[0] | (src[1] << 8) | (src[2] << 16) | ((unsigned int)src[3] << 24);
+}
+
+static void WriteU16(unsigned char* dst, int num)
+{
+	dst[0] = num & 0xff;
+	dst[1] = (num >> 8) & 0xff;
+}
+
+static void WriteU32(unsigned char* dst, unsigned int num)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		dst[i] = (num >> (i * 8)) & 0xff;
+	}
+}
\ No newline at end of file
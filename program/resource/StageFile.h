@@ -0,0 +1,116 @@
+#ifndef STAGEFILE_H_
+#define STAGEFILE_H_
+
+#include"main.h"
+#include"Mytype.h"
+#include"Scene.h"
+
+//ステージファイル(.stg)
+//全部1バイト単位の構造体なのでパディングが入らない。2バイト以上の数値はリトルエンディアン。
+//バージョン1 [ヘッダー][セル × width × height][アイテム × itemNum]
+//バージョン2 [ヘッダー][マップ情報][アイテム × itemNum][オブジェクト × objectNum][チャンク表 × チャンク数][チャンク × 空でない数]
+//バージョン2はセルをCHUNK_SIZE四方のチャンクにまとめて、チャンクごとに読めるようにしたもの。
+#define STAGEFILE_MAGIC ("STGB")
+#define STAGEFILE_VERSION (2)
+
+#define CHUNK_SIZE (32)
+#define STAGEFILE_MAXCHUNKX (32)//横に並べられるチャンクの最大数
+#define STAGEFILE_MAXCHUNKY (32)
+#define STAGEFILE_MAXCHUNK (STAGEFILE_MAXCHUNKX * STAGEFILE_MAXCHUNKY)
+#define STAGEFILE_MAXITEM (32)
+#define STAGEFILE_MAXOBJECT (256)
+
+//古い形式(BLOCKの配列をそのまま書いたもの)は1画面分
+#define STAGEFILE_LEGACYWIDTH (32)
+#define STAGEFILE_LEGACYHEIGHT (18)
+
+#define STAGEFILE_CELL_USE (1 << 0)
+#define STAGEFILE_ITEM_USE (1 << 0)
+#define STAGEFILE_CHUNK_EMPTY (1 << 0)
+
+typedef struct
+{
+	char magic[4];
+	unsigned char version[2];
+	unsigned char width;//バージョン1はマス数、バージョン2はチャンク数
+	unsigned char height;
+	unsigned char itemNum;
+	unsigned char reserved[3];
+	unsigned char checksum[4];//バージョン1はセルとアイテム、バージョン2はチャンクより前のFNV-1a
+}STAGEFILEHEADER;
+
+//バージョン2でヘッダーの次に入る
+typedef struct
+{
+	unsigned char width[2];//マス数
+	unsigned char height[2];
+	unsigned char chunkSize;
+	unsigned char reserved;
+	unsigned char objectNum[2];
+}STAGEFILEMAPINFO;
+
+typedef struct
+{
+	unsigned char type;
+	unsigned char dir;
+	signed char tube;//土管の番号。土管でなければ-1
+	unsigned char flags;
+}STAGEFILECELL;
+
+typedef struct
+{
+	unsigned char num[2];
+	unsigned char flags;
+	unsigned char reserved;
+}STAGEFILEITEM;
+
+//土管と爆弾ブロックの位置。ステージ全体から探す時にチャンクを全部読まなくて済むように
+typedef struct
+{
+	unsigned char x[2];
+	unsigned char y[2];
+}STAGEFILEOBJECT;
+
+typedef struct
+{
+	unsigned char flags;
+	unsigned char burnNum[2];//草ブロックの数。前に書いたファイルは0
+	unsigned char reserved;
+	unsigned char checksum[4];//チャンクのセルのFNV-1a
+}STAGEFILECHUNK;
+
+//開いたファイルの情報。セルはReadStageFileChunkで必要なチャンクだけ読む。
+typedef struct
+{
+	char filename[64];
+	int version;//MakeStageFileInfoで作ったものは0
+	int width;//マス数
+	int height;
+	int chunkWidth;//チャンク数
+	int chunkHeight;
+	int itemNum;
+	STAGEFILEITEM item[STAGEFILE_MAXITEM];
+	int objectNum;
+	Int2 object[STAGEFILE_MAXOBJECT];
+	int burnNum;//草ブロックの数。燃焼タイマーの数を決める
+	long chunkOffset[STAGEFILE_MAXCHUNK];//空のチャンクは0
+	unsigned int chunkChecksum[STAGEFILE_MAXCHUNK];
+}STAGEFILEINFO;
+
+//ヘッダーとチャンク表だけ読む
+bool OpenStageFile(const char* filename, STAGEFILEINFO* info);
+//チャンク一つ分(CHUNK_SIZE × CHUNK_SIZE)のセルを読む。ステージの外と空のチャンクは空のセルになる。
+bool ReadStageFileChunk(const STAGEFILEINFO* info, int chunk, STAGEFILECELL* cell);
+//ファイルを使わずに、メモリにあるwidth × heightのセルからinfoを作る。ReadStageFileChunkは使えない。
+bool MakeStageFileInfo(STAGEFILEINFO* info, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum);
+//width × heightのセルからチャンク一つ分を切り出す
+void GetStageFileChunkCell(const STAGEFILECELL* cell, int width, int height, int chunkx, int chunky, STAGEFILECELL* dst);
+//width × heightのセルをバージョン2で書く
+bool SaveStageFile(const char* filename, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum);
+
+//古い形式を読む。cellはSTAGEFILE_LEGACYWIDTH × STAGEFILE_LEGACYHEIGHT、itemはTYPEMAX個
+bool LoadLegacyStageFile(STAGE stage, STAGEFILECELL* cell, STAGEFILEITEM* item);
+//全ステージを古い形式から変換する。変換できた数を返す。
+int ConvertLegacyStageFiles(void);
+
+#endif
\ No newline at end of file
@@ -4,9 +4,9 @@
 
 //=================================
 //
-//GtFNg
+//爆発エフェクト
 //
-//Q[[hɂč쐬BQ[[hȂAɃubN̂ꏊɂ͂ȂBׂ̃ubNɍsB
+//ゲームモードにして作成。ゲームモードなら、既にブロックのある場所にはいけない。一個隣のブロックに行く。
 //
 //=================================
 
@@ -18,173 +18,72 @@
 #include"Mytype.h"
 #include"Ball.h"
 #include"Scene.h"
+#include"Preview.h"
+#include"StageFile.h"
 #include"Effect.h"
+#include"Camera.h"
+#include"Input.h"
+#include"FrameHeap.h"
+#include"sound.h"
+#include<stdlib.h>
 
 #define BLOCKTEXTURE_MAXWIDTHBLOCK (6)
-
-enum KEY
-{
-	//ړ
-	KEY_A,
-	KEY_D,
-	KEY_W,
-	KEY_S,
-
-	KEY_R,//Zbg
-	KEY_T,//Xe[Wǂݍ
-	KEY_F,//폜
-	KEY_E,//^CvύX
-	KEY_Q,//]
-	KEY_V,//Z[u
-	KEY_G,//Z[u
-	KEY_SPACE,//ݒu
-	KEY_ENTER,//{[
-	KEY_C,
-	KEY_H,
-
-	KEYMAX
-};
-
-enum PLAYKEY
-{
-	//ړ
-	PLAYKEY_A,
-	PLAYKEY_D,
-	PLAYKEY_W,
-	PLAYKEY_S,
-
-	PLAYKEY_F,
-	PLAYKEY_E,
-	PLAYKEY_Q,
-	PLAYKEY_SPACE,
-	PLAYKEY_ENTER,
-
-	PLAYKEYMAX,
-};
-
-typedef struct
-{
-	int num;
-	bool IsUse;
-}ENABLEBLOCK;
-
+#define BURNTIME (30)//草が燃え尽きるまでのtick
+#define STAGE_MAXANIMBLOCK ((SCREEN_BLOCK_WIDTH + 1) * (SCREEN_BLOCK_HEIGHT + 1))//画面に入るマスの数
 
 void DeleteBlock(void);
-void StageBlockReset(void);
-int GetTubeNum(void);
-bool CheckTubeNum(void);
+static BLOCK* EditBlock(int height, int width);
+static BLOCK* EditStageDataBlock(STAGEDATA* data, int height, int width);
+static int FindEditSlot(const STAGEDATA* data, int cell);
+static bool GrowStageEdit(STAGEDATA* data, int editMax);
+static void RebuildEditIndex(STAGEDATA* data);
+static bool IsInStage(const STAGEDATA* data, int height, int width);
+static BLOCK MakeBlock(const STAGEFILECELL* cell, int height, int width);
+static void CopyStageData(STAGEDATA* dst, const STAGEDATA* src);
+static int GetObjectNum(void);
+static Int2 GetObjectNpos(int n);
+static Int2 FindTube(int tubenum);
 
 static UINT g_CurrentFrameTex;
-static int g_CurrentFrameCnt;
-static int g_CurrentFrameFrame;
 static UINT g_BlockTex;
 static UINT g_PlayerFrameTex;
-static BLOCK g_Block[MAX_BLOCK_HEIGHT][MAX_BLOCK_WIDTH + 1] = {};
-static bool g_IsTouch_StageMaker[KEYMAX] = {};
-static bool g_IsTouch_StageMaker_Game[PLAYKEYMAX] = {};
-static int g_IsTouchTime[KEYMAX] = {};
+//ソルバーはスレッドごとにステージを持つ。
+static thread_local STAGEDATA g_Stage;
 static BLOCK g_CurrentBlock;
-static int g_TubeTurnNum;
 static UINT g_numtex;
-static int g_GoalCnt;
-static int g_GoalFrame;
-static int g_CoinCnt;
-static int g_CoinFrame;
-static char g_filename[32] = {};
-static char g_filename_2[32] = {};
-
-static ENABLEBLOCK g_Item[TYPEMAX] = {};
+static TILEMAP g_StageMap;//ゲームのステージのセル。カメラの近くのチャンクだけ置く
+static STAGEDATA g_PristineStage;//読み込んだ直後のステージ。リセットはここから戻す
+static thread_local unsigned int g_StageVersion;//g_Stageのマスを変えるたびに増やす
+static Int2 g_AnimBlock[STAGE_MAXANIMBLOCK];//StageBlockStaticDRAWで見つけたアニメーションするマス
+static int g_AnimBlockNum;
 
 
 void StageBlockINIT(void)
 {
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
-	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
-		{
-			g_Block[i][k].fpos = MakeFloat2(-SCREEN_WIDTH / 2 + BLOCKSIZE.x / 2, -SCREEN_HEIGHT / 2 + BLOCKSIZE.x / 2);
-			g_Block[i][k].npos = MakeInt2(0, 0);
-			g_Block[i][k].isUse = false;
-			g_Block[i][k].type = type_normal;
-			g_Block[i][k].dir = dir_top;
-			g_Block[i][k].warp_turn_num = -1;
-			g_Block[i][k].fireCnt = 0;
-			g_Block[i][k].IsBurn = false;
-			g_Block[i][k].IsPlayerBlock = false;
-		}
-	}
-
-	//Current\ubN
-	g_CurrentBlock.fpos = MakeFloat2(-SCREEN_WIDTH / 2 + BLOCKSIZE.x / 2, -SCREEN_HEIGHT / 2 + BLOCKSIZE.x / 2);
+	//Current表示ブロック
+	g_CurrentBlock.fpos = GetBlockFpos(MakeInt2(0, 0));
 	g_CurrentBlock.npos = MakeInt2(0, 0);
 	g_CurrentBlock.isUse = false;
-
-	g_CurrentFrameCnt = 0;
-	g_CurrentFrameFrame = 0;
-	g_GoalCnt = 0;
-	g_GoalFrame = 0;
-	g_CoinCnt = 0;
-	g_CoinFrame = 0;
+	g_AnimBlockNum = 0;
 
 	g_BlockTex = LoadTexture("asset/Block_4.tga");
 	g_CurrentFrameTex = LoadTexture("asset/choose_2.tga");
 	g_numtex = LoadTexture("asset/num.tga");
 	g_PlayerFrameTex = LoadTexture("asset/Chooseframe.tga");
 
-	memset(g_IsTouch_StageMaker, false, sizeof(g_IsTouch_StageMaker));
-	memset(g_IsTouchTime, 0, sizeof(g_IsTouchTime));
-	memset(g_filename, 0, sizeof(g_filename));
-
-	g_TubeTurnNum = 0;
-
-	//Xe[Wǂݍ
-	const char* filename = GetCurrentStage() == stage_1 ? "asset/stage1.bin" :
-		GetCurrentStage() == stage_2 ? "asset/stage2.bin" :
-		GetCurrentStage() == stage_3 ? "asset/stage3.bin" : "asset/stage4.bin";
-
-	strcpy(g_filename, filename);
-
-	//Xe[Wǂݍ
-	FILE* fp = fopen(filename, "rb");
-	if (fp != NULL)
-	{
-		fread(g_Block, sizeof(g_Block), 1, fp);
-		fclose(fp);
-	}
-
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	//ステージを開いてアイテムを読み込んでおく。リセットはここから戻すのでアイテムは読み直さない。
+	//セルはカメラが近づいた所からチャンクごとに読む。
+	if (!LoadStageData(GetCurrentStage(), &g_StageMap, tilemap_stream, &g_PristineStage))
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
-		{
-			if (g_Block[i][k].type == type_tube_in ||
-				g_Block[i][k].type == type_tube_out)
-			{
-				g_TubeTurnNum++;
-			}
-			g_Block[i][k].IsBurn = false;
-			g_Block[i][k].IsPlayerBlock = false;
-		}
+		NN_LOG("StageBlockINIT: stage%d load failed\n", GetCurrentStage() + 1);
 	}
+	SetStageData(&g_PristineStage);
 
-	memset(g_IsTouch_StageMaker_Game, false, sizeof(g_IsTouch_StageMaker_Game));
-	memset(g_Item, 0, sizeof(g_Item));
-
-	//ACeǂݍ
-	const char* filename_2 = GetCurrentStage() == stage_1 ? "asset/data/Stage_1_Item.bin" :
-		GetCurrentStage() == stage_2 ? "asset/data/Stage_2_Item.bin" :
-		GetCurrentStage() == stage_3 ? "asset/data/Stage_3_Item.bin" : "asset/data/Stage_4_Item.bin";
-
-	strcpy(g_filename_2, filename_2);
-
-	FILE* itemfp = fopen(g_filename_2, "rb");
-	fread(g_Item, sizeof(g_Item), 1, itemfp);
-	fclose(itemfp);
-
-	//ŏɎACe
+	//最初に持つアイテムを決定
 	bool isfirst = true;
 	for (int i = 0; i < TYPEMAX; i++)
 	{
-		if (g_Item[i].IsUse)
+		if (g_Stage.item[i].IsUse)
 		{
 			if (isfirst)
 			{
@@ -197,457 +96,332 @@ void StageBlockINIT(void)
 
 void StageBlockUPDATE(void)
 {
+	//カメラに近づいてきたチャンクを先読みする
+	Int2 min, max;
+	GetCameraBlockRange(&min, &max, CHUNK_SIZE / 2);
+	UpdateTileMap(&g_StageMap, min, max);
+
 	if (!(GetIsClear() || GetIsGameover()))
 	{
-		//===================================================ړ
-		if (GetKeyState('A') & 0x80)
+		//===================================================左移動
+		if (GetInputRepeat(action_left))
 		{
-			if (!g_IsTouch_StageMaker[KEY_A])
-			{
-				if (g_CurrentBlock.npos.x > 0)
-				{
-					g_CurrentBlock.fpos.x -= BLOCKSIZE.x;
-					g_CurrentBlock.npos.x -= 1;
-				}
-				g_IsTouch_StageMaker[KEY_A] = true;
-			}
-
-			g_IsTouchTime[KEY_A]++;
-			if (g_IsTouchTime[KEY_A] > 30)
+			if (g_CurrentBlock.npos.x > 0)
 			{
-				g_IsTouch_StageMaker[KEY_A] = false;
+				g_CurrentBlock.fpos.x -= BLOCKSIZE.x;
+				g_CurrentBlock.npos.x -= 1;
 			}
 		}
-		else
-		{
-			g_IsTouchTime[KEY_A] = 0;
-			g_IsTouch_StageMaker[KEY_A] = false;
-		}
 
-		//===================================================Eړ
-		if (GetKeyState('D') & 0x80)
+		//===================================================右移動
+		if (GetInputRepeat(action_right))
 		{
-			if (!g_IsTouch_StageMaker[KEY_D])
-			{
-				if (g_CurrentBlock.npos.x < MAX_BLOCK_WIDTH - 1)
-				{
-					g_CurrentBlock.fpos.x += BLOCKSIZE.x;
-					g_CurrentBlock.npos.x += 1;
-				}
-				g_IsTouch_StageMaker[KEY_D] = true;
-			}
-
-			g_IsTouchTime[KEY_D]++;
-			if (g_IsTouchTime[KEY_D] > 30)
+			if (g_CurrentBlock.npos.x < GetStageWidth() - 1)
 			{
-				g_IsTouch_StageMaker[KEY_D] = false;
+				g_CurrentBlock.fpos.x += BLOCKSIZE.x;
+				g_CurrentBlock.npos.x += 1;
 			}
 		}
-		else
-		{
-			g_IsTouchTime[KEY_D] = 0;
-			g_IsTouch_StageMaker[KEY_D] = false;
-		}
 
-		//===================================================ړ
-		if (GetKeyState('W') & 0x80)
+		//===================================================上移動
+		if (GetInputRepeat(action_up))
 		{
-			if (!g_IsTouch_StageMaker[KEY_W])
+			if (g_CurrentBlock.npos.y > 0)
 			{
-				if (g_CurrentBlock.npos.y > 0)
-				{
-					g_CurrentBlock.fpos.y -= BLOCKSIZE.y;
-					g_CurrentBlock.npos.y -= 1;
-				}
-				g_IsTouch_StageMaker[KEY_W] = true;
-			}
-
-			g_IsTouchTime[KEY_W]++;
-			if (g_IsTouchTime[KEY_W] > 30)
-			{
-				g_IsTouch_StageMaker[KEY_W] = false;
+				g_CurrentBlock.fpos.y -= BLOCKSIZE.y;
+				g_CurrentBlock.npos.y -= 1;
 			}
 		}
-		else
-		{
-			g_IsTouchTime[KEY_W] = 0;
-			g_IsTouch_StageMaker[KEY_W] = false;
-		}
 
-		//===================================================ړ
-		if (GetKeyState('S') & 0x80)
+		//===================================================下移動
+		if (GetInputRepeat(action_down))
 		{
-			if (!g_IsTouch_StageMaker[KEY_S])
-			{
-				if (g_CurrentBlock.npos.y < MAX_BLOCK_HEIGHT - 1)
-				{
-					g_CurrentBlock.fpos.y += BLOCKSIZE.y;
-					g_CurrentBlock.npos.y += 1;
-				}
-				g_IsTouch_StageMaker[KEY_S] = true;
-			}
-
-			g_IsTouchTime[KEY_S]++;
-			if (g_IsTouchTime[KEY_S] > 30)
+			if (g_CurrentBlock.npos.y < GetStageHeight() - 1)
 			{
-				g_IsTouch_StageMaker[KEY_S] = false;
+				g_CurrentBlock.fpos.y += BLOCKSIZE.y;
+				g_CurrentBlock.npos.y += 1;
 			}
 		}
-		else
-		{
-			g_IsTouchTime[KEY_S] = 0;
-			g_IsTouch_StageMaker[KEY_S] = false;
-		}
 
-		//===================================================ݒu
-		int tubenum = 0;
-		if (GetKeyState(VK_SPACE) & 0x80)
+		//===================================================設置
+		if (GetInputPressed(action_place) && !GetIsBallMoving())
 		{
-			if (!g_IsTouch_StageMaker[KEY_SPACE] && !GetIsBallMoving())
+			//設置するアイテムが1個以上あったら設置できる
+			if (g_Stage.item[g_CurrentBlock.type].num > 0 &&
+				!GetBlock(g_CurrentBlock.npos.y, g_CurrentBlock.npos.x).isUse)
 			{
-				//ݒuACe1ȏ゠ݒuł
-				if (g_Item[g_CurrentBlock.type].num > 0 &&
-					!g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].isUse)
-				{
-					//ݒuꏊɊɃubN邩mF@	uƂĂACe邩ǂmF@̒uubN̓nCCg
-					DeleteBlock();
-
-					//ݒu
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].isUse = true;
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].fpos = g_CurrentBlock.fpos;
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].npos = g_CurrentBlock.npos;
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].type = g_CurrentBlock.type;
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].dir = g_CurrentBlock.dir;
-					g_Block[g_CurrentBlock.npos.y][g_CurrentBlock.npos.x].IsPlayerBlock = true;
-
-					g_Item[g_CurrentBlock.type].num--;
-				}
-				g_IsTouch_StageMaker[KEY_SPACE] = true;
-			}
-		}
-		else
-		{
-			g_IsTouch_StageMaker[KEY_SPACE] = false;
-		}
+				//設置場所に既にブロックがあるか確認　あったら消す	置こうとしているアイテムがあるかどうかを確認する　自分の置いたブロックはハイライトする
+				DeleteBlock();
 
-		//==================================================={[s
-		if (GetKeyState(VK_RETURN) & 0x80)
-		{
-			if (!g_IsTouch_StageMaker[KEY_ENTER])
-			{
-				if (!GetIsBallMoving())
+				//設置。editのメモリが取れずに置けなければアイテムは減らさない
+				if (SetPlayerBlock(g_CurrentBlock.npos, g_CurrentBlock.type, g_CurrentBlock.dir))
 				{
-					BallReset();
+					g_Stage.item[g_CurrentBlock.type].num--;
 
-					//{[
-					SetBall();
+					//予測線を置いた場所から更新
+					PreviewEditCell(g_CurrentBlock.npos);
+				}
+				else
+				{
+					PlaySE(SE_BREAK);
 				}
 			}
-			g_IsTouch_StageMaker[KEY_ENTER] = true;
-		}
-		else
-		{
-			g_IsTouch_StageMaker[KEY_ENTER] = false;
 		}
-		//===================================================폜
-		if (GetKeyState('F') & 0x80)
+
+		//===================================================ボール実行
+		if (GetInputPressed(action_launch))
 		{
-			if (!g_IsTouch_StageMaker[KEY_F])//uubNȂ󂹂 mainasu
+			if (!GetIsBallMoving())
 			{
-				DeleteBlock();
+				BallReset();
 
-				g_IsTouch_StageMaker[KEY_F] = true;
+				//ボール発射
+				SetBall();
 			}
 		}
-		else
+		//===================================================削除
+		if (GetInputPressed(action_delete))//自分が置いたブロックなら壊せる mainasu
 		{
-			g_IsTouch_StageMaker[KEY_F] = false;
+			DeleteBlock();
+			PreviewEditCell(g_CurrentBlock.npos);
 		}
 
-		//===================================================^CvύX
-		if (GetKeyState('E') & 0x80)
+		//===================================================タイプ変更
+		if (GetInputPressed(action_changetype))//自分の持っているアイテムだけを表示
 		{
-			if (!g_IsTouch_StageMaker[KEY_E])//̎ĂACe\
+			for (int i = g_CurrentBlock.type; TYPEMAX; i++)
 			{
-				for (int i = g_CurrentBlock.type; TYPEMAX; i++)
+				if (i > TYPEMAX)
 				{
-					if (i > TYPEMAX)
-					{
-						i = 0;
-					}
+					i = 0;
+				}
 
-					if (!g_Item[i].IsUse)continue;
+				if (!g_Stage.item[i].IsUse)continue;
 
-					if (g_CurrentBlock.type == (BLOCKTYPE)(i))continue;
+				if (g_CurrentBlock.type == (BLOCKTYPE)(i))continue;
 
-					g_CurrentBlock.type = (BLOCKTYPE)(i);
-					break;
-				}
-				g_IsTouch_StageMaker[KEY_E] = true;
+				g_CurrentBlock.type = (BLOCKTYPE)(i);
+				break;
 			}
 		}
-		else
-		{
-			g_IsTouch_StageMaker[KEY_E] = false;
-		}
 
-		//===================================================E]
-		if (GetKeyState('Q') & 0x80)
+		//===================================================右回転
+		if (GetInputPressed(action_rotate))
 		{
-			if (!g_IsTouch_StageMaker[KEY_Q])
+			g_CurrentBlock.dir = (DIR)(g_CurrentBlock.dir + 1);
+			if (g_CurrentBlock.dir >= DIRMAX)
 			{
-				g_CurrentBlock.dir = (DIR)(g_CurrentBlock.dir + 1);
-				if (g_CurrentBlock.dir >= DIRMAX)
-				{
-					g_CurrentBlock.dir = dir_top;
-				}
-				g_IsTouch_StageMaker[KEY_Q] = true;
+				g_CurrentBlock.dir = dir_top;
 			}
 		}
-		else
-		{
-			g_IsTouch_StageMaker[KEY_Q] = false;
-		}
 	}
-	//===================================================Xe[W
-	if (GetKeyState('T') & 0x80 && GetKeyState(VK_CONTROL) & 0x80)
+	//===================================================ステージ初期化
+	if (GetInputPressed(action_reset))
 	{
-		if (!g_IsTouch_StageMaker[KEY_T])
-		{
-			StageBlockReset();
-			BallReset();
-
-			g_IsTouch_StageMaker[KEY_T] = true;
-		}
+		StageBlockReset(stagereset_clear);
+		BallReset();
+		PreviewReset();
 	}
-	else
+	//===================================================古い形式のステージを変換(デバッグ)
+	if (GetInputPressed(action_convert) && GetIsDebug())
 	{
-		g_IsTouch_StageMaker[KEY_T] = false;
+		ConvertLegacyStageFiles();
 	}
-
-	if (GetIsBallMoving())
+	//===================================================置いたブロックを残して初期化
+	if (GetInputPressed(action_resetkeep))
 	{
-		//RڂB
-		for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
-		{
-			for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
-			{
-				if (!g_Block[i][k].isUse)continue;
-
-				if (g_Block[i][k].type == type_grass &&
-					g_Block[i][k].IsBurn)
-				{
-					g_Block[i][k].fireCnt++;
-				}
-				//RIB
-				if (g_Block[i][k].fireCnt >= 30)
-				{
-					g_Block[i][k].isUse = false;
-					g_Block[i][k].fireCnt = 0;
-
-					//RڂB
-					for (int m = 0; m < 3; m++)
-					{
-						for (int n = 0; n < 3; n++)
-						{
-							if (g_Block[i - 1 + m][k - 1 + n].type == type_grass &&
-								!g_Block[i - 1 + m][k - 1 + n].IsBurn)
-							{
-								if (i == m && k == k)continue;
-								g_Block[i - 1 + m][k - 1 + n].IsBurn = true;
-								g_Block[i - 1 + m][k - 1 + n].fireCnt = 0;
-
-								SetFire(g_Block[i - 1 + m][k - 1 + n].fpos);
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-
-	//Jg}[NAj[V
-	g_CurrentFrameCnt++;
-	if (g_CurrentFrameCnt > 10)
-	{
-		g_CurrentFrameCnt = 0;
-		g_CurrentFrameFrame++;
-	}
-	if (g_CurrentFrameFrame >= 3)
-	{
-		g_CurrentFrameFrame = 0;
-	}
-
-	//S[Aj[VJEg
-	g_GoalCnt++;
-	if (g_GoalCnt > 12)
-	{
-		g_GoalCnt = 0;
-		g_GoalFrame++;
-	}
-	if (g_GoalFrame >= 3)
-	{
-		g_GoalFrame = 0;
+		StageBlockReset(stagereset_keepplayer);
+		BallReset();
+		PreviewReset();
 	}
 
-	g_CoinCnt++;
-	if (g_CoinCnt > 12)
-	{
-		g_CoinCnt = 0;
-		g_CoinFrame++;
-	}
-	if (g_CoinFrame >= 2)
-	{
-		g_CoinFrame = 0;
-	}
+	StageBlockBurnUPDATE();
 }
 
-bool CheckTubeNum(void)
+//草ブロックの燃焼。ボールが動いている間だけ進める。
+void StageBlockBurnUPDATE(void)
 {
-	int InNum = 0;
-	int OutNum = 0;
-
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	if (GetIsBallMoving())
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		AdvanceTimerWheel(&g_Stage.burnTimer);
+
+		//燃え終わったブロックだけ処理する
+		TIMEREVENT event;
+		while (PopTimerEvent(&g_Stage.burnTimer, &event))
 		{
-			if (!g_Block[i][k].isUse)continue;
+			int i = event.param / GetStageWidth();
+			int k = event.param % GetStageWidth();
 
-			if (g_Block[i][k].type == type_tube_in)InNum++;
-			else if (g_Block[i][k].type == type_tube_out)OutNum++;
-		}
-	}
-	if (InNum == OutNum)return true;
-	else return false;
-}
+			if (!GetBlock(i, k).isUse)continue;
 
-int GetTubeNum(void)
-{
-	int cnt = 0;
+			BLOCK* block = EditBlock(i, k);
+			if (block == NULL)continue;
 
-	if (g_CurrentBlock.type == type_tube_in || g_CurrentBlock.type == type_tube_out)
-	{
-		for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
-		{
-			for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+			//燃え終わり。
+			block->isUse = false;
+			block->fireCnt = 0;
+
+			//燃え移り。
+			for (int m = 0; m < 3; m++)
 			{
-				if (!g_Block[i][k].isUse)continue;
+				for (int n = 0; n < 3; n++)
+				{
+					if (i - 1 + m < 0 || i - 1 + m >= GetStageHeight() ||
+						k - 1 + n < 0 || k - 1 + n >= GetStageWidth())continue;
+
+					BLOCK next = GetBlock(i - 1 + m, k - 1 + n);
+					if (next.type == type_grass && !next.IsBurn)
+					{
+						if (i == m && k == k)continue;
+						SetBurn(i - 1 + m, k - 1 + n);
 
-				if (g_Block[i][k].type == type_tube_in || g_Block[i][k].type == type_tube_out)cnt++;
+						SetFire(next.fpos);
+					}
+				}
 			}
 		}
 	}
-	return cnt;
 }
 
 BLOCK GetNextTubeBlock(int tubenum)
 {
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	Int2 npos = FindTube(tubenum);
+	if (npos.x >= 0)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
-		{
-			if (!g_Block[i][k].isUse)continue;
-
-			if (g_Block[i][k].type == type_tube_in || g_Block[i][k].type == type_tube_out)
-			{
-				if (g_Block[i][k].warp_turn_num == tubenum)
-				{
-					return g_Block[i][k];
-				}
-			}
-		}
+		return GetBlock(npos.y, npos.x);
 	}
+
 	BLOCK block;
 	memset(&block, -1, sizeof(BLOCK));
 	return block;
 }
 
-void StageBlockDRAW(void)
+//レイヤーに入れる動かないマス。アニメーションするマスはここで覚えておいてStageBlockDRAWで描く
+void StageBlockStaticDRAW(void)
 {
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	//カメラに映っているマスだけ描く
+	Int2 min, max;
+	GetCameraBlockRange(&min, &max, 0);
+	if (min.x < 0)min.x = 0;
+	if (min.y < 0)min.y = 0;
+	if (max.x > GetStageWidth() - 1)max.x = GetStageWidth() - 1;
+	if (max.y > GetStageHeight() - 1)max.y = GetStageHeight() - 1;
+
+	g_AnimBlockNum = 0;
+
+	for (int i = min.y; i <= max.y; i++)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		for (int k = min.x; k <= max.x; k++)
 		{
-			if (!g_Block[i][k].isUse)continue;
+			BLOCK block = GetBlock(i, k);
+			if (!block.isUse)continue;
+
+			Float2 pos = GetScreenPos(block.fpos);
 
-			//S[ƃRCAj[V
-			int texanimationcnt = 0;
-			if (g_Block[i][k].type == type_goal_1)
+			//ブロック本体。ゴールとコインだけアニメーションさせる
+			if (block.type == type_goal_1 || block.type == type_coin_1)
 			{
-				texanimationcnt = g_GoalFrame;
+				if (g_AnimBlockNum < STAGE_MAXANIMBLOCK)g_AnimBlock[g_AnimBlockNum++] = block.npos;
 			}
-			if (g_Block[i][k].type == type_coin_1)
+			else
 			{
-				texanimationcnt = g_CoinFrame;
+				FaceGenforTex(pos, BLOCKSIZE, block.type % BLOCKTEXTURE_MAXWIDTHBLOCK,
+					block.type / BLOCKTEXTURE_MAXWIDTHBLOCK, BLOCKTEXTURE_MAXWIDTHBLOCK, 3, true,
+					g_BlockTex, MakeFloat4(1, 1, 1, 1), block.dir);
 			}
 
-			//ubN{
-			FaceGenforTex(g_Block[i][k].fpos, BLOCKSIZE, (g_Block[i][k].type + texanimationcnt) % BLOCKTEXTURE_MAXWIDTHBLOCK,
-				(g_Block[i][k].type + texanimationcnt) / BLOCKTEXTURE_MAXWIDTHBLOCK, BLOCKTEXTURE_MAXWIDTHBLOCK, 3, true,
-				g_BlockTex, MakeFloat4(1, 1, 1, 1), g_Block[i][k].dir);
-
-			//vC[̒uubNȂnCCg
-			if (g_Block[i][k].IsPlayerBlock)
+			//プレイヤーの置いたブロックならハイライト
+			if (block.IsPlayerBlock)
 			{
-				FaceGenforTex(g_Block[i][k].fpos, MakeFloat2(BLOCKSIZE.x - 5.0f, BLOCKSIZE.y - 5.0f), 0, 0, 1, 1, true, g_PlayerFrameTex, NORMALCOLOR);
+				FaceGenforTex(pos, MakeFloat2(BLOCKSIZE.x - 5.0f, BLOCKSIZE.y - 5.0f), 0, 0, 1, 1, true, g_PlayerFrameTex, NORMALCOLOR);
 			}
 
-			//fobOȂԍ\
-			if ((g_Block[i][k].type == type_tube_in || g_Block[i][k].type == type_tube_out) && GetIsDebug())
+			//デバッグなら番号を表示
+			if ((block.type == type_tube_in || block.type == type_tube_out) && GetIsDebug())
 			{
-				char numtext[16] = {};
-				sprintf(numtext, "%d", g_Block[i][k].warp_turn_num);
-				TextGen(g_Block[i][k].fpos, BLOCKSIZE, NORMALCOLOR, numtext);
+				TextGen(pos, BLOCKSIZE, NORMALCOLOR, FormatScratch("%d", block.warp_turn_num));
 			}
 		}
 	}
+}
+
+//StageBlockStaticDRAWの後に毎フレーム呼ぶ
+void StageBlockDRAW(void)
+{
+	for (int n = 0; n < g_AnimBlockNum; n++)
+	{
+		BLOCK block = GetBlock(g_AnimBlock[n].y, g_AnimBlock[n].x);
+		SPRITEANIM anim = MakeSpriteAnim(block.type, block.type == type_goal_1 ? 3 : 2, 13,
+			BLOCKTEXTURE_MAXWIDTHBLOCK, 3, animloop_loop, 0);
+		FaceGenAnim(GetScreenPos(block.fpos), BLOCKSIZE, &anim, g_BlockTex, MakeFloat4(1, 1, 1, 1), block.dir);
+	}
 
-	//{[ĂȂJg̃ubNƃ}[N\B
+	//ボールが動いていなかったらカレントのブロックとマークを表示する。
 	if (!GetIsBallMoving())
 	{
-		//JgubN\
-		FaceGenforTex(g_CurrentBlock.fpos, BLOCKSIZE, g_CurrentBlock.type % BLOCKTEXTURE_MAXWIDTHBLOCK,
+		Float2 pos = GetScreenPos(g_CurrentBlock.fpos);
+
+		//カレントブロック表示
+		FaceGenforTex(pos, BLOCKSIZE, g_CurrentBlock.type % BLOCKTEXTURE_MAXWIDTHBLOCK,
 			g_CurrentBlock.type / BLOCKTEXTURE_MAXWIDTHBLOCK, BLOCKTEXTURE_MAXWIDTHBLOCK, 3, true, g_BlockTex, MakeFloat4(1, 1, 1, 0.6f), g_CurrentBlock.dir);
 
 
-		//Jg}[NJ[₷悤ɐݒ
+		//カレントマークカラーを見えやすいように設定
 		Float4 color = g_CurrentBlock.type == type_normal ? MakeFloat4(1, 0.5f, 0, 1) :
 			g_CurrentBlock.type == type_dirt ? MakeFloat4(1, 1, 1, 1) :
 			g_CurrentBlock.type == type_grass ? MakeFloat4(1, 0, 0, 1) :
 			g_CurrentBlock.type == type_frame ? MakeFloat4(0.8f, 0.8f, 0, 1) : MakeFloat4(1, 1, 1, 1);
 
-		//Jg}[N\
-		FaceGenforTex(g_CurrentBlock.fpos, BLOCKSIZE, g_CurrentFrameFrame, 0, 3, 1, true, g_CurrentFrameTex, color);
+		//カレントマーク表示
+		SPRITEANIM anim = MakeSpriteAnim(0, 3, 11, 3, 1, animloop_loop, 0);
+		FaceGenAnim(pos, BLOCKSIZE, &anim, g_CurrentFrameTex, color, dir_top);
 	}
-}
 
-void StageBlockReset(void)
-{
-	//Xe[Wǂݍ
-	FILE* fp = fopen(g_filename, "rb");
-	if (fp != NULL)
+	//デバッグならチャンクを読んだ数と、先読みが間に合わなかった数を表示
+	if (GetIsDebug())
 	{
-		fread(g_Block, sizeof(g_Block), 1, fp);
-		fclose(fp);
+		TextGen(MakeFloat2(SCREEN_WIDTH / 2 - 32 * 14 - BLOCKSIZE.x, -SCREEN_HEIGHT / 2 + 128 + BLOCKSIZE.y),
+			MakeFloat2(32, 32), NORMALCOLOR, FormatScratch("ch:%d miss:%d", g_StageMap.loadNum, g_StageMap.missNum));
 	}
+}
+
+//ステージを読み込んだ直後に戻す。変わったマスを捨てるだけなのでファイルは読まない。
+//stagereset_keepplayerならプレイヤーのブロックは置き直して、アイテムの数もそのまま。
+void StageBlockReset(STAGERESET mode)
+{
+	//ヘッドレスではボールが死んだ時点でシミュレーションを止めるので戻さない。
+	if (GetIsHeadless())return;
+
+	int editnum = g_Stage.editNum;
+	g_Stage.editNum = 0;
+	g_StageVersion++;
+	if (g_Stage.editIndex != NULL)memset(g_Stage.editIndex, 0, sizeof(int) * g_Stage.editMax * 2);
 
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	//置き直したマスは前に詰めて入るので、まだ見ていない所は上書きされない
+	if (mode == stagereset_keepplayer)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		for (int n = 0; n < editnum; n++)
 		{
-			g_Block[i][k].IsPlayerBlock = false;
+			int cell = g_Stage.edit[n].cell;
+			BLOCK block = g_Stage.edit[n].block;
+
+			if (!block.IsPlayerBlock)continue;
+
+			SetPlayerBlock(MakeInt2(cell % GetStageWidth(), cell / GetStageWidth()), block.type, block.dir);
 		}
 	}
 
-	FILE* itemfp = fopen(g_filename_2, "rb");
-	fread(g_Item, sizeof(g_Item), 1, itemfp);
-	fclose(itemfp);
+	InitTimerWheel(&g_Stage.burnTimer);
+
+	if (mode == stagereset_keepplayer)return;
 
-	//ŏɎACe
+	memcpy(g_Stage.item, g_PristineStage.item, sizeof(g_Stage.item));
+
+	//最初に持つアイテムを決定
 	bool isfirst = true;
 	for (int i = 0; i < TYPEMAX; i++)
 	{
-		if (g_Item[i].IsUse)
+		if (g_Stage.item[i].IsUse)
 		{
 			if (isfirst)
 			{
@@ -660,107 +434,543 @@ void StageBlockReset(void)
 
 void DestroyBlock(int height, int width)
 {
-	g_Block[height][width].isUse = false;
-	//GtFNg
+	BLOCK* block = EditBlock(height, width);
+	if (block == NULL)return;
+
+	block->isUse = false;
+	//エフェクト
 }
 
-//OutTubeNum̓{[oTUBẼio[
-//TUBẼio[͒uB
+//OutTubeNumはボールを出現させるTUBEのナンバー
+//TUBEのナンバーは置いた順。
 Int2 GetTubeEscapePos(int OutTubeNum)
 {
-	Int2 alfa;
+	return FindTube(OutTubeNum);
+}
 
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+//燃やし始める。燃え終わるtickをfireCntに入れてタイマーに登録する。
+void SetBurn(int height, int width)
+{
+	if (GetBlock(height, width).IsBurn)return;
+
+	BLOCK* block = EditBlock(height, width);
+	if (block == NULL)return;
+
+	//タイマーは草ブロックの数だけ作ってある。足りなければ増やす
+	TIMERWHEEL* timer = &g_Stage.burnTimer;
+	int id = AddTimer(timer, BURNTIME, 0, height * GetStageWidth() + width);
+	if (id == 0 && GrowTimerWheel(timer, timer->nodeMax * 2 > TIMER_GROWMIN ? timer->nodeMax * 2 : TIMER_GROWMIN))
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
-		{
-			if (!g_Block[i][k].isUse)continue;
+		id = AddTimer(timer, BURNTIME, 0, height * GetStageWidth() + width);
+	}
 
-			if (g_Block[i][k].type == type_tube_in || g_Block[i][k].type == type_tube_out)
-			{
-				if (g_Block[i][k].warp_turn_num != OutTubeNum)continue;
+	//登録できなければ燃やさない。燃え尽きないまま燃えているブロックを残さない
+	if (id == 0)
+	{
+		NN_LOG("SetBurn: burn timer is full\n");
+		return;
+	}
 
-				alfa.y = i;
-				alfa.x = k;
+	block->IsBurn = true;
+	block->fireCnt = GetTimerTick(timer) + BURNTIME;
+}
 
-				return alfa;
-			}
-		}
+void BombBlockExplotion(void)
+{
+	//消すとeditが増えるので、先に数えておく
+	int num = GetObjectNum();
+
+	for (int n = 0; n < num; n++)
+	{
+		Int2 npos = GetObjectNpos(n);
+		BLOCK block = GetBlock(npos.y, npos.x);
+
+		if (!block.isUse)continue;
+
+		if (block.type != type_move)continue;
+
+		DestroyBlock(npos.y, npos.x);
+
+		//爆発エフェクト
+		SetExplosion(block.fpos);
+	}
+}
+
+void DeleteBlock(void)
+{
+	Int2 npos = g_CurrentBlock.npos;
+	BLOCK block = GetBlock(npos.y, npos.x);
+
+	if (!block.isUse)return;
+
+	//デバッグならステージのブロックも消せる
+	if (!GetIsDebug() && !block.IsPlayerBlock)return;
+
+	BLOCK* edit = EditBlock(npos.y, npos.x);
+	if (edit == NULL)return;
+
+	if (!GetIsDebug())
+	{
+		edit->IsPlayerBlock = false;
+		g_Stage.item[edit->type].num++;
 	}
 
-	alfa.x = -1;
-	alfa.y = -1;
-	return alfa;
+	edit->isUse = false;
+	edit->npos = MakeInt2(0, 0);
+	edit->fpos = MakeFloat2(0, 0);
+	edit->type = type_normal;
 }
 
-void SetBurn(int height, int width)
+BLOCK GetBlock(int height, int width)
 {
-	g_Block[height][width].IsBurn = true;
+	return GetStageDataBlock(&g_Stage, height, width);
 }
 
-void BombBlockExplotion(void)
+void SetBlock(int height, int width, const BLOCK* block)
+{
+	BLOCK* edit = EditBlock(height, width);
+	if (edit == NULL)return;
+
+	*edit = *block;
+}
+
+unsigned int GetStageEditVersion(void)
+{
+	return g_Stage.editVersion;
+}
+
+int GetStageEditNum(void)
+{
+	return g_Stage.editNum;
+}
+
+const STAGEEDIT* GetStageEdit(int n)
+{
+	return &g_Stage.edit[n];
+}
+
+void GetBurnTimer(TIMERWHEEL* timer)
+{
+	if (!CopyTimerWheel(timer, &g_Stage.burnTimer))
+	{
+		NN_LOG("GetBurnTimer: copy failed\n");
+	}
+}
+
+void SetBurnTimer(const TIMERWHEEL* timer)
+{
+	if (!CopyTimerWheel(&g_Stage.burnTimer, timer))
+	{
+		NN_LOG("SetBurnTimer: copy failed\n");
+	}
+}
+
+TILEMAP* GetStageTileMap(void)
+{
+	return g_Stage.map;
+}
+
+//燃えている(燃え終わった)ブロックの範囲。なければfalse
+bool GetBurnArea(Int2* min, Int2* max)
 {
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	bool IsBurn = false;
+
+	for (int n = 0; n < g_Stage.editNum; n++)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		if (!g_Stage.edit[n].block.IsBurn)continue;
+
+		Int2 npos = MakeInt2(g_Stage.edit[n].cell % GetStageWidth(), g_Stage.edit[n].cell / GetStageWidth());
+		if (!IsBurn)
 		{
-			if (!g_Block[i][k].isUse)continue;
+			*min = npos;
+			*max = npos;
+			IsBurn = true;
+		}
+		if (npos.x < min->x)min->x = npos.x;
+		if (npos.y < min->y)min->y = npos.y;
+		if (npos.x > max->x)max->x = npos.x;
+		if (npos.y > max->y)max->y = npos.y;
+	}
+	return IsBurn;
+}
+
+int GetStageWidth(void)
+{
+	return g_Stage.map != NULL ? g_Stage.map->file.width : 0;
+}
+
+int GetStageHeight(void)
+{
+	return g_Stage.map != NULL ? g_Stage.map->file.height : 0;
+}
+
+//ワールド座標があるマス。ステージの外なら範囲外の値になる
+Int2 GetBlockNpos(Float2 pos)
+{
+	return MakeInt2((int)floorf((pos.x - STAGE_ORIGIN.x) / BLOCKSIZE.x), (int)floorf((pos.y - STAGE_ORIGIN.y) / BLOCKSIZE.y));
+}
+
+//マスの中心のワールド座標
+Float2 GetBlockFpos(Int2 npos)
+{
+	return MakeFloat2(STAGE_ORIGIN.x + BLOCKSIZE.x * npos.x + BLOCKSIZE.x / 2,
+		STAGE_ORIGIN.y + BLOCKSIZE.y * npos.y + BLOCKSIZE.y / 2);
+}
+
+Float2 GetCurrentBlockPos(void)
+{
+	return g_CurrentBlock.fpos;
+}
+
+const char* GetStageFileName(STAGE stage)
+{
+	return stage == stage_1 ? "asset/stage1.stg" :
+		stage == stage_2 ? "asset/stage2.stg" :
+		stage == stage_3 ? "asset/stage3.stg" : "asset/stage4.stg";
+}
 
-			if (g_Block[i][k].type != type_move)continue;
+//ステージをmapに開いて、読み込んだ直後の状態をdataに入れる。燃焼タイマーは空になる。
+//tilemap_streamならセルはまだ読まない。
+bool LoadStageData(STAGE stage, TILEMAP* map, TILEMAPMODE mode, STAGEDATA* data)
+{
+	ReleaseStageData(data);
+	data->map = map;
 
-			g_Block[i][k].isUse = false;
+	if (!OpenTileMap(map, GetStageFileName(stage), mode))
+	{
+		//変換前の古い形式。1画面分なので全部メモリに置く
+		STAGEFILECELL cell[STAGEFILE_LEGACYWIDTH * STAGEFILE_LEGACYHEIGHT];
+		STAGEFILEITEM item[TYPEMAX];
 
-			//GtFNg
-			SetExplosion(g_Block[i][k].fpos);
+		if (!LoadLegacyStageFile(stage, cell, item) ||
+			!OpenTileMapFromCell(map, cell, STAGEFILE_LEGACYWIDTH, STAGEFILE_LEGACYHEIGHT, item, TYPEMAX))
+		{
+			return false;
 		}
 	}
+
+	//知らないアイテムは無視する
+	for (int i = 0; i < map->file.itemNum && i < TYPEMAX; i++)
+	{
+		data->item[i].num = map->file.item[i].num[0] | (map->file.item[i].num[1] << 8);
+		data->item[i].IsUse = (map->file.item[i].flags & STAGEFILE_ITEM_USE) != 0;
+	}
+
+	//燃えるのはステージの草ブロックと、プレイヤーが置く草ブロックだけ
+	return CreateTimerWheel(&data->burnTimer, map->file.burnNum + data->item[type_grass].num);
 }
 
-void DeleteBlock(void)
+//editと燃焼タイマーを解放する。全部0の状態に戻るので、そのままLoadStageDataやCopyに使える
+void ReleaseStageData(STAGEDATA* data)
+{
+	DestroyTimerWheel(&data->burnTimer);
+	free(data->edit);
+	free(data->editIndex);
+	memset(data, 0, sizeof(STAGEDATA));
+}
+
+//このスレッドの今のステージを解放する。ソルバーのワーカーはジョブの最後に呼ぶ
+void ReleaseThreadStageData(void)
+{
+	ReleaseStageData(&g_Stage);
+}
+
+//読み込んであるステージを現在のステージにする。
+void SetStageData(const STAGEDATA* data)
+{
+	CopyStageData(&g_Stage, data);
+	g_StageVersion++;
+}
+
+//現在のステージを保存する。
+void GetStageData(STAGEDATA* data)
+{
+	CopyStageData(data, &g_Stage);
+}
+
+//ステージと選んでいるブロックを保存する。
+void GetStageBlockState(STAGEBLOCKSTATE* state)
+{
+	CopyStageData(&state->stage, &g_Stage);
+	state->currentBlock = g_CurrentBlock;
+}
+
+//保存した状態に戻す。ファイルは読まない。
+void SetStageBlockState(const STAGEBLOCKSTATE* state)
+{
+	CopyStageData(&g_Stage, &state->stage);
+	g_CurrentBlock = state->currentBlock;
+	g_StageVersion++;
+}
+
+//保存してあるステージのマスを取得する。変わっていなければファイルのセル。
+BLOCK GetStageDataBlock(const STAGEDATA* data, int height, int width)
 {
-	for (int i = 0; i < MAX_BLOCK_HEIGHT; i++)
+	if (IsInStage(data, height, width) && data->editNum > 0)
 	{
-		for (int k = 0; k < MAX_BLOCK_WIDTH; k++)
+		int slot = FindEditSlot(data, height * data->map->file.width + width);
+		if (data->editIndex[slot] != 0)
 		{
-			if (GetIsDebug())
-			{
-				if ((g_Block[i][k].npos.x == g_CurrentBlock.npos.x) &&
-					(g_Block[i][k].npos.y == g_CurrentBlock.npos.y) &&
-					(g_Block[i][k].isUse))
-				{
-					g_Block[i][k].isUse = false;
-					g_Block[i][k].npos = MakeInt2(0, 0);
-					g_Block[i][k].fpos = MakeFloat2(0, 0);
-					g_Block[i][k].type = type_normal;
+			return data->edit[data->editIndex[slot] - 1].block;
+		}
+	}
 
-					break;
-				}
-			}
-			else
-			{
-				if ((g_Block[i][k].npos.x == g_CurrentBlock.npos.x) &&
-					(g_Block[i][k].npos.y == g_CurrentBlock.npos.y) &&
-					(g_Block[i][k].isUse) &&
-					g_Block[i][k].IsPlayerBlock)
-				{
-					g_Block[i][k].IsPlayerBlock = false;
-					g_Item[g_Block[i][k].type].num++;
+	STAGEFILECELL cell;
+	cell.type = type_normal;
+	cell.dir = dir_top;
+	cell.tube = -1;
+	cell.flags = 0;
+	if (data->map != NULL)
+	{
+		cell = GetTile(data->map, height, width);
+	}
+	return MakeBlock(&cell, height, width);
+}
 
-					g_Block[i][k].isUse = false;
-					g_Block[i][k].npos = MakeInt2(0, 0);
-					g_Block[i][k].fpos = MakeFloat2(0, 0);
-					g_Block[i][k].type = type_normal;
+//保存してあるステージのマスを書き換える。
+void SetStageDataBlock(STAGEDATA* data, int height, int width, const BLOCK* block)
+{
+	BLOCK* edit = EditStageDataBlock(data, height, width);
+	if (edit == NULL)return;
 
-					break;
-				}
+	*edit = *block;
+}
+
+//プレイヤーのブロックを設置する。アイテムの数は呼び出し側で減らす。置けなければfalse
+bool SetPlayerBlock(Int2 npos, BLOCKTYPE type, DIR dir)
+{
+	BLOCK* block = EditBlock(npos.y, npos.x);
+	if (block == NULL)return false;
+
+	block->isUse = true;
+	block->fpos = GetBlockFpos(npos);
+	block->npos = npos;
+	block->type = type;
+	block->dir = dir;
+	block->IsPlayerBlock = true;
+	return true;
+}
+
+//今のステージのマスを書き換える準備。
+static BLOCK* EditBlock(int height, int width)
+{
+	g_StageVersion++;
+	return EditStageDataBlock(&g_Stage, height, width);
+}
+
+//初めて変えるマスならファイルのセルを写してeditに入れる。editがいっぱいなら倍にする。
+//ステージの外か、メモリが取れなければNULL
+static BLOCK* EditStageDataBlock(STAGEDATA* data, int height, int width)
+{
+	if (!IsInStage(data, height, width))return NULL;
+
+	if (data->editNum >= data->editMax &&
+		!GrowStageEdit(data, data->editMax * 2 > STAGE_EDITGROWMIN ? data->editMax * 2 : STAGE_EDITGROWMIN))
+	{
+		NN_LOG("EditStageDataBlock: out of memory (%d edits)\n", data->editNum);
+		return NULL;
+	}
+
+	int cell = height * data->map->file.width + width;
+	int slot = FindEditSlot(data, cell);
+
+	if (data->editIndex[slot] == 0)
+	{
+		STAGEFILECELL tile = GetTile(data->map, height, width);
+		data->edit[data->editNum].cell = cell;
+		data->edit[data->editNum].version = 0;
+		data->edit[data->editNum].block = MakeBlock(&tile, height, width);
+		data->editNum++;
+		data->editIndex[slot] = data->editNum;
+	}
+
+	//書き換えるつもりで取るので、変わったことにする
+	STAGEEDIT* edit = &data->edit[data->editIndex[slot] - 1];
+	data->editVersion++;
+	edit->version = data->editVersion;
+	return &edit->block;
+}
+
+//cellの入っているハッシュの場所。なければ次に入れる場所。editはハッシュの半分までなので必ず空きがある
+static int FindEditSlot(const STAGEDATA* data, int cell)
+{
+	int mask = data->editMax * 2 - 1;
+	unsigned int hash = (unsigned int)cell * 2654435761u;
+	int slot = (int)(hash ^ (hash >> 16)) & mask;
+
+	while (data->editIndex[slot] != 0 && data->edit[data->editIndex[slot] - 1].cell != cell)
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//editをeditMaxまで増やす。ハッシュの大きさが変わるので作り直す。
+//editMaxは2のべき乗にしておく。取れなければ前のまま
+static bool GrowStageEdit(STAGEDATA* data, int editMax)
+{
+	if (editMax <= data->editMax)return true;
+
+	STAGEEDIT* edit = (STAGEEDIT*)realloc(data->edit, sizeof(STAGEEDIT) * editMax);
+	if (edit == NULL)
+	{
+		return false;
+	}
+	data->edit = edit;
+
+	int* index = (int*)malloc(sizeof(int) * editMax * 2);
+	if (index == NULL)
+	{
+		return false;
+	}
+
+	free(data->editIndex);
+	data->editIndex = index;
+	data->editMax = editMax;
+	RebuildEditIndex(data);
+	return true;
+}
+
+static void RebuildEditIndex(STAGEDATA* data)
+{
+	memset(data->editIndex, 0, sizeof(int) * data->editMax * 2);
+
+	for (int n = 0; n < data->editNum; n++)
+	{
+		data->editIndex[FindEditSlot(data, data->edit[n].cell)] = n + 1;
+	}
+}
+
+static bool IsInStage(const STAGEDATA* data, int height, int width)
+{
+	return data->map != NULL && height >= 0 && width >= 0 &&
+		height < data->map->file.height && width < data->map->file.width;
+}
+
+//ファイルのセルからブロックを作る。位置は配列の位置から決める
+static BLOCK MakeBlock(const STAGEFILECELL* cell, int height, int width)
+{
+	BLOCK block;
+	block.fpos = GetBlockFpos(MakeInt2(width, height));
+	block.npos = MakeInt2(width, height);
+	block.isUse = (cell->flags & STAGEFILE_CELL_USE) != 0;
+	block.type = (BLOCKTYPE)cell->type;
+	block.dir = (DIR)cell->dir;
+	block.warp_turn_num = cell->tube;
+	block.fireCnt = 0;
+	block.IsBurn = false;
+	block.IsPlayerBlock = false;
+
+	return block;
+}
+
+//editは使っている所だけ写す。dstのeditが大きければハッシュは作り直す
+static void CopyStageData(STAGEDATA* dst, const STAGEDATA* src)
+{
+	dst->map = src->map;
+	memcpy(dst->item, src->item, sizeof(dst->item));
+	dst->editVersion = src->editVersion;
+	if (!CopyTimerWheel(&dst->burnTimer, &src->burnTimer))
+	{
+		NN_LOG("CopyStageData: burn timer copy failed\n");
+	}
+
+	if (!GrowStageEdit(dst, src->editMax))
+	{
+		NN_LOG("CopyStageData: edit copy failed\n");
+		dst->editNum = 0;
+		if (dst->editIndex != NULL)RebuildEditIndex(dst);
+		return;
+	}
+
+	dst->editNum = src->editNum;
+	if (src->editNum > 0)
+	{
+		memcpy(dst->edit, src->edit, sizeof(STAGEEDIT) * src->editNum);
+	}
+	if (dst->editMax == src->editMax && src->editMax > 0)
+	{
+		memcpy(dst->editIndex, src->editIndex, sizeof(int) * src->editMax * 2);
+	}
+	else if (dst->editIndex != NULL)
+	{
+		RebuildEditIndex(dst);
+	}
+}
+
+//ステージ全体から探すブロック(土管と爆弾ブロック)があるかもしれないマスの数。
+//ファイルのオブジェクト表と、プレイヤーが置いたかもしれない変わったマス。
+static int GetObjectNum(void)
+{
+	return g_Stage.map != NULL ? g_Stage.map->file.objectNum + g_Stage.editNum : 0;
+}
+
+static Int2 GetObjectNpos(int n)
+{
+	const STAGEFILEINFO* file = &g_Stage.map->file;
+
+	if (n < file->objectNum)
+	{
+		return file->object[n];
+	}
+
+	int cell = g_Stage.edit[n - file->objectNum].cell;
+	return MakeInt2(cell % file->width, cell / file->width);
+}
+
+static Int2 FindTube(int tubenum)
+{
+	for (int n = 0; n < GetObjectNum(); n++)
+	{
+		Int2 npos = GetObjectNpos(n);
+		BLOCK block = GetBlock(npos.y, npos.x);
+
+		if (!block.isUse)continue;
+
+		if (block.type == type_tube_in || block.type == type_tube_out)
+		{
+			if (block.warp_turn_num == tubenum)
+			{
+				return npos;
 			}
 		}
 	}
+
+	return MakeInt2(-1, -1);
 }
 
-BLOCK GetBlock(int height, int width)
+//ステージの状態をハッシュに混ぜる。ファイルのセルは変わらないので変わったマスだけ。fposなどのfloatは含めない。
+unsigned int HashStageBlock(unsigned int hash)
 {
-	return g_Block[height][width];
+	for (int n = 0; n < g_Stage.editNum; n++)
+	{
+		const BLOCK* block = &g_Stage.edit[n].block;
+
+		int alfa[6];
+		alfa[0] = g_Stage.edit[n].cell;
+		alfa[1] = block->isUse ? 1 : 0;
+		alfa[2] = block->type;
+		alfa[3] = block->dir;
+		alfa[4] = block->IsBurn ? 1 : 0;
+		alfa[5] = block->fireCnt;
+
+		hash = HashData(hash, alfa, sizeof(alfa));
+	}
+	return hash;
+}
+
+//StageBlockStaticDRAWで描くものが変わったら変わる値。カメラ、変えたマス、読んだチャンク、デバッグ表示
+unsigned int GetStageDrawKey(void)
+{
+	Float2 camera = GetCameraPos();
+	unsigned int key[5];
+	memcpy(&key[0], &camera.x, sizeof(float));
+	memcpy(&key[1], &camera.y, sizeof(float));
+	key[2] = g_StageVersion;
+	key[3] = (unsigned int)g_StageMap.loadNum;
+	key[4] = GetIsDebug() ? 1 : 0;
+
+	return HashData(0, key, sizeof(key));
 }
 
 void StageBlockUNINIT(void)
@@ -774,4 +984,10 @@ void StageBlockUNINIT(void)
 	g_BlockTex = NULL;
 	g_numtex = NULL;
 	g_PlayerFrameTex = NULL;
+
+	ReleaseStageData(&g_Stage);
+	ReleaseStageData(&g_PristineStage);
+
+	//ロードスレッドが読んでいる途中なら待つ
+	CloseTileMap(&g_StageMap);
 }
\ No newline at end of file
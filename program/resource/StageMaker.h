@@ -3,11 +3,19 @@
 
 #include"main.h"
 #include"Mytype.h"
+#include"Scene.h"
+#include"TimerWheel.h"
+#include"TileMap.h"
 
-#define MAX_BLOCK_WIDTH (32)
-#define MAX_BLOCK_HEIGHT (18)
-#define MAXBLOCK (MAX_BLOCK_WIDTH * MAX_BLOCK_HEIGHT)
-#define BLOCKSIZE (MakeFloat2(SCREEN_WIDTH / MAX_BLOCK_WIDTH,SCREEN_WIDTH / MAX_BLOCK_WIDTH))
+//1画面に入るマスの数。ステージはこれより大きくてもいい。
+#define SCREEN_BLOCK_WIDTH (32)
+#define SCREEN_BLOCK_HEIGHT (18)
+#define BLOCKSIZE (MakeFloat2(SCREEN_WIDTH / SCREEN_BLOCK_WIDTH,SCREEN_WIDTH / SCREEN_BLOCK_WIDTH))
+//ステージの左上のワールド座標。1画面目はカメラが動かなければ画面と同じ位置
+#define STAGE_ORIGIN (MakeFloat2(-SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2))
+
+//最初に作るeditの数。足りなくなったら倍にしていく
+#define STAGE_EDITGROWMIN (256)
 
 enum BLOCKTYPE
 {
@@ -33,6 +41,13 @@ enum BLOCKTYPE
 	TYPEMAX
 };
 
+//StageBlockResetでプレイヤーのブロックをどうするか
+enum STAGERESET
+{
+	stagereset_clear,		//消してアイテムも戻す
+	stagereset_keepplayer,	//置いたまま残す
+};
+
 typedef struct
 {
 	DIR x;
@@ -47,23 +62,90 @@ typedef struct
 	BLOCKTYPE type;
 	DIR dir;
 	int warp_turn_num;
-	int fireCnt;
+	int fireCnt;//燃え終わるtick
 	bool IsBurn;
 	bool IsPlayerBlock;
 
 }BLOCK;
 
+typedef struct
+{
+	int num;
+	bool IsUse;
+}ENABLEBLOCK;
+
+typedef struct
+{
+	int cell;//height * ステージの幅 + width
+	unsigned int version;//最後に変えた時のeditVersion
+	BLOCK block;
+}STAGEEDIT;
+
+//ステージの状態。ファイルのセルはmapに置いたままで、変わったマスだけeditに持つ。
+typedef struct
+{
+	TILEMAP* map;
+	ENABLEBLOCK item[TYPEMAX];
+	TIMERWHEEL burnTimer;
+	int editNum;
+	int editMax;
+	unsigned int editVersion;//マスを変えるたびに増やす。予測線はここから区間で変わったマスを探す
+	STAGEEDIT* edit;
+	int* editIndex;//cellから引くハッシュ。大きさはeditMaxの2倍。editの番号+1、空は0
+}STAGEDATA;
+
+//ステージとプレイヤーの選んでいるブロック。リプレイ用
+typedef struct
+{
+	STAGEDATA stage;
+	BLOCK currentBlock;
+}STAGEBLOCKSTATE;
+
 void StageBlockINIT(void);
 void StageBlockUPDATE(void);
+//背景と一緒にレイヤーに入れる、動かないマス
+void StageBlockStaticDRAW(void);
+//アニメーションするマスとカレント。毎フレーム描く
 void StageBlockDRAW(void);
 void StageBlockUNINIT(void);
 
 BLOCK GetNextTubeBlock(int tubenum);
 void BombBlockExplotion(void);
-void StageBlockReset(void);
+void StageBlockReset(STAGERESET mode);
 Int2 GetTubeEscapePos(int OutTubeNum);
 void DestroyBlock(int height, int width);
 BLOCK GetBlock(int height, int width);
 void SetBurn(int height, int width);
+unsigned int HashStageBlock(unsigned int hash);
+unsigned int GetStageDrawKey(void);
+void StageBlockBurnUPDATE(void);
+
+bool GetBurnArea(Int2* min, Int2* max);
+int GetStageWidth(void);
+int GetStageHeight(void);
+Int2 GetBlockNpos(Float2 pos);
+Float2 GetBlockFpos(Int2 npos);
+Float2 GetCurrentBlockPos(void);
+
+const char* GetStageFileName(STAGE stage);
+bool LoadStageData(STAGE stage, TILEMAP* map, TILEMAPMODE mode, STAGEDATA* data);
+void ReleaseStageData(STAGEDATA* data);
+void ReleaseThreadStageData(void);
+void SetStageData(const STAGEDATA* data);
+void GetStageData(STAGEDATA* data);
+BLOCK GetStageDataBlock(const STAGEDATA* data, int height, int width);
+void SetStageDataBlock(STAGEDATA* data, int height, int width, const BLOCK* block);
+bool SetPlayerBlock(Int2 npos, BLOCKTYPE type, DIR dir);
+void GetStageBlockState(STAGEBLOCKSTATE* state);
+void SetStageBlockState(const STAGEBLOCKSTATE* state);
+
+//予測線のチェックポイント用。ステージ全体は写さずに、変わったマスと燃焼タイマーだけ出し入れする
+unsigned int GetStageEditVersion(void);
+int GetStageEditNum(void);
+const STAGEEDIT* GetStageEdit(int n);
+void SetBlock(int height, int width, const BLOCK* block);
+void GetBurnTimer(TIMERWHEEL* timer);
+void SetBurnTimer(const TIMERWHEEL* timer);
+TILEMAP* GetStageTileMap(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,484 @@
+//=================================
+//
+//チャンクに分けたステージ
+//
+//ステージをCHUNK_SIZE四方のチャンクに分けて、決まった数のスロットにだけ置く。
+//カメラの近くのチャンクはロードスレッドで先に読んでおき、
+//スロットが足りなくなったら先読みの範囲の外で一番長く使っていないチャンクを追い出す。
+//常駐させるマップは全部のチャンクの分だけスロットを作るので追い出さない。
+//
+//=================================
+
+#include"TileMap.h"
+#include"MemoryLedger.h"
+
+#include<stdlib.h>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<deque>
+
+typedef struct
+{
+	TILEMAP* map;
+	int slot;
+}TILELOADJOB;
+
+static void LoadThread(void);
+static void FinishLoad(TILEMAP* map);
+static void QueueLoad(TILEMAP* map, int chunk, int slot);
+static int GetFreeSlot(TILEMAP* map, bool IsForce);
+static int WaitFreeSlot(TILEMAP* map);
+static bool IsKeepChunk(const TILEMAP* map, int chunk);
+static TILESLOT* LoadChunkNow(TILEMAP* map, int chunk);
+static void ClearSlot(TILEMAP* map);
+static bool CreateSlot(TILEMAP* map, int slotNum);
+
+//ロードスレッドはtilemap_streamのマップが開いている間だけ動かす
+static std::thread g_LoadThread;
+static std::mutex g_LoadMutex;
+static std::condition_variable g_LoadCond;
+static std::deque<TILELOADJOB> g_LoadJob;
+static TILEMAP* g_LoadingMap;//ロードスレッドが今読んでいるマップ
+static int g_StreamMapNum;
+static bool g_IsLoadThreadEnd;
+
+bool OpenTileMap(TILEMAP* map, const char* filename, TILEMAPMODE mode)
+{
+	CloseTileMap(map);
+	ClearSlot(map);
+
+	if (!OpenStageFile(filename, &map->file))
+	{
+		return false;
+	}
+	map->mode = mode;
+
+	int chunknum = map->file.chunkWidth * map->file.chunkHeight;
+	if (!CreateSlot(map, mode == tilemap_resident || chunknum < TILEMAP_SLOTMAX ? chunknum : TILEMAP_SLOTMAX))
+	{
+		NN_LOG("OpenTileMap: no memory for %s (%d chunks)\n", filename, chunknum);
+		return false;
+	}
+
+	if (mode == tilemap_resident)
+	{
+		for (int i = 0; i < chunknum; i++)
+		{
+			ReadStageFileChunk(&map->file, i, &map->slot[i].cell[0][0]);
+			map->slot[i].chunk = i;
+			map->slot[i].state = tileslot_ready;
+			map->slot[i].IsLoaded = true;
+			map->slotOf[i] = (short)i;
+			map->loadNum++;
+		}
+	}
+	else
+	{
+		if (g_StreamMapNum == 0)
+		{
+			g_IsLoadThreadEnd = false;
+			g_LoadThread = std::thread(LoadThread);
+		}
+		g_StreamMapNum++;
+	}
+
+	map->IsOpen = true;
+	return true;
+}
+
+bool OpenTileMapFromCell(TILEMAP* map, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum)
+{
+	CloseTileMap(map);
+	ClearSlot(map);
+
+	if (!MakeStageFileInfo(&map->file, cell, width, height, item, itemNum))
+	{
+		NN_LOG("OpenTileMapFromCell: %dx%d is too large\n", width, height);
+		return false;
+	}
+	map->mode = tilemap_resident;
+
+	if (!CreateSlot(map, map->file.chunkWidth * map->file.chunkHeight))
+	{
+		NN_LOG("OpenTileMapFromCell: no memory for %dx%d\n", width, height);
+		return false;
+	}
+
+	for (int i = 0; i < map->file.chunkWidth * map->file.chunkHeight; i++)
+	{
+		GetStageFileChunkCell(cell, width, height, i % map->file.chunkWidth, i / map->file.chunkWidth, &map->slot[i].cell[0][0]);
+		map->slot[i].chunk = i;
+		map->slot[i].state = tileslot_ready;
+		map->slot[i].IsLoaded = true;
+		map->slotOf[i] = (short)i;
+	}
+
+	map->IsOpen = true;
+	return true;
+}
+
+void CloseTileMap(TILEMAP* map)
+{
+	if (!map->IsOpen)return;
+
+	if (map->mode == tilemap_stream)
+	{
+		std::unique_lock<std::mutex> lock(g_LoadMutex);
+
+		//まだ始まっていない読み込みは捨てて、読んでいる途中なら終わるまで待つ
+		for (std::deque<TILELOADJOB>::iterator it = g_LoadJob.begin(); it != g_LoadJob.end();)
+		{
+			it = it->map == map ? g_LoadJob.erase(it) : it + 1;
+		}
+		while (g_LoadingMap == map)
+		{
+			g_LoadCond.wait(lock);
+		}
+
+		g_StreamMapNum--;
+		if (g_StreamMapNum == 0)
+		{
+			g_IsLoadThreadEnd = true;
+			g_LoadCond.notify_all();
+			lock.unlock();
+			g_LoadThread.join();
+		}
+	}
+
+	if (map->slot != NULL)UnregisterLedger(ledger_buffer, (uintptr_t)map->slot);
+	free(map->slot);
+	map->slot = NULL;
+	map->slotNum = 0;
+	map->IsOpen = false;
+}
+
+void UpdateTileMap(TILEMAP* map, Int2 min, Int2 max)
+{
+	if (!map->IsOpen)return;
+
+	map->frame++;
+	map->keepMin = min;
+	map->keepMax = max;
+
+	if (map->mode != tilemap_stream)return;
+
+	FinishLoad(map);
+
+	int left = min.x < 0 ? 0 : min.x / CHUNK_SIZE;
+	int top = min.y < 0 ? 0 : min.y / CHUNK_SIZE;
+	int right = max.x / CHUNK_SIZE;
+	int under = max.y / CHUNK_SIZE;
+	if (right > map->file.chunkWidth - 1)right = map->file.chunkWidth - 1;
+	if (under > map->file.chunkHeight - 1)under = map->file.chunkHeight - 1;
+
+	for (int i = top; i <= under; i++)
+	{
+		for (int k = left; k <= right; k++)
+		{
+			int chunk = i * map->file.chunkWidth + k;
+
+			if (map->slotOf[chunk] >= 0)
+			{
+				map->slot[map->slotOf[chunk]].lastUse = map->frame;
+				continue;
+			}
+
+			//空のスロットがなければ範囲が広すぎるので、次のフレームでまた試す
+			int slot = GetFreeSlot(map, false);
+			if (slot < 0)continue;
+
+			QueueLoad(map, chunk, slot);
+		}
+	}
+}
+
+STAGEFILECELL GetTile(TILEMAP* map, int height, int width)
+{
+	STAGEFILECELL cell;
+	cell.type = 0;
+	cell.dir = 0;
+	cell.tube = -1;
+	cell.flags = 0;
+
+	if (!map->IsOpen || height < 0 || width < 0 || height >= map->file.height || width >= map->file.width)
+	{
+		return cell;
+	}
+
+	int chunk = (height / CHUNK_SIZE) * map->file.chunkWidth + width / CHUNK_SIZE;
+	int slot = map->slotOf[chunk];
+
+	//止まらずに読み込みだけ頼む。読み終わるまでピンで追い出されないようにする
+	if (map->IsNoWait && map->mode == tilemap_stream)
+	{
+		if (slot < 0)
+		{
+			slot = GetFreeSlot(map, false);
+			if (slot < 0)
+			{
+				map->fullNum++;
+				return cell;
+			}
+			QueueLoad(map, chunk, slot);
+		}
+
+		map->slot[slot].IsPin = true;
+		if (map->slot[slot].state != tileslot_ready)
+		{
+			map->waitNum++;
+			return cell;
+		}
+		return map->slot[slot].cell[height % CHUNK_SIZE][width % CHUNK_SIZE];
+	}
+
+	TILESLOT* tileslot = slot >= 0 && map->slot[slot].state == tileslot_ready ? &map->slot[slot] : LoadChunkNow(map, chunk);
+	if (tileslot == NULL)
+	{
+		return cell;
+	}
+
+	return tileslot->cell[height % CHUNK_SIZE][width % CHUNK_SIZE];
+}
+
+void SetTileMapNoWait(TILEMAP* map, bool IsNoWait)
+{
+	map->IsNoWait = IsNoWait;
+	map->waitNum = 0;
+	map->fullNum = 0;
+}
+
+void ClearTileMapPin(TILEMAP* map)
+{
+	for (int i = 0; i < map->slotNum; i++)
+	{
+		map->slot[i].IsPin = false;
+	}
+}
+
+//空いたスロットにチャンクを入れて、ロードスレッドに読ませる
+static void QueueLoad(TILEMAP* map, int chunk, int slot)
+{
+	map->slot[slot].chunk = chunk;
+	map->slot[slot].state = tileslot_loading;
+	map->slot[slot].lastUse = map->frame;
+	map->slotOf[chunk] = (short)slot;
+
+	TILELOADJOB job;
+	job.map = map;
+	job.slot = slot;
+
+	std::lock_guard<std::mutex> lock(g_LoadMutex);
+	map->slot[slot].IsLoaded = false;
+	g_LoadJob.push_back(job);
+	g_LoadCond.notify_all();
+}
+
+//先読みが間に合わなかったチャンクをこのスレッドで読む
+static TILESLOT* LoadChunkNow(TILEMAP* map, int chunk)
+{
+	if (map->mode != tilemap_stream)return NULL;
+
+	int slot = map->slotOf[chunk];
+	if (slot >= 0)
+	{
+		std::unique_lock<std::mutex> lock(g_LoadMutex);
+
+		//ロードスレッドが読み始めていたら待つ。まだならこっちで読む
+		bool IsQueued = false;
+		for (std::deque<TILELOADJOB>::iterator it = g_LoadJob.begin(); it != g_LoadJob.end(); ++it)
+		{
+			if (it->map == map && it->slot == slot)
+			{
+				g_LoadJob.erase(it);
+				IsQueued = true;
+				break;
+			}
+		}
+
+		if (!IsQueued)
+		{
+			while (!map->slot[slot].IsLoaded)
+			{
+				g_LoadCond.wait(lock);
+			}
+			map->slot[slot].state = tileslot_ready;
+			map->loadNum++;
+			return &map->slot[slot];
+		}
+	}
+	else
+	{
+		//今すぐ要るので、先読みの範囲のチャンクを追い出しても読む
+		slot = GetFreeSlot(map, true);
+		if (slot < 0)
+		{
+			slot = WaitFreeSlot(map);
+		}
+		map->slot[slot].chunk = chunk;
+		map->slotOf[chunk] = (short)slot;
+	}
+
+	ReadStageFileChunk(&map->file, chunk, &map->slot[slot].cell[0][0]);
+	map->slot[slot].state = tileslot_ready;
+	map->slot[slot].lastUse = map->frame;
+	map->loadNum++;
+	map->missNum++;
+
+	std::lock_guard<std::mutex> lock(g_LoadMutex);
+	map->slot[slot].IsLoaded = true;
+
+	return &map->slot[slot];
+}
+
+static void LoadThread(void)
+{
+	std::unique_lock<std::mutex> lock(g_LoadMutex);
+
+	while (true)
+	{
+		while (g_LoadJob.empty() && !g_IsLoadThreadEnd)
+		{
+			g_LoadCond.wait(lock);
+		}
+		if (g_IsLoadThreadEnd)break;
+
+		TILELOADJOB job = g_LoadJob.front();
+		g_LoadJob.pop_front();
+		g_LoadingMap = job.map;
+
+		//読み込み中のスロットはメインスレッドが触らないので、ロックを外して読む
+		TILESLOT* slot = &job.map->slot[job.slot];
+		int chunk = slot->chunk;
+		lock.unlock();
+
+		ReadStageFileChunk(&job.map->file, chunk, &slot->cell[0][0]);
+
+		lock.lock();
+		slot->IsLoaded = true;
+		g_LoadingMap = NULL;
+		g_LoadCond.notify_all();
+	}
+}
+
+//ロードスレッドが読み終わったスロットを使えるようにする
+static void FinishLoad(TILEMAP* map)
+{
+	std::lock_guard<std::mutex> lock(g_LoadMutex);
+
+	for (int i = 0; i < map->slotNum; i++)
+	{
+		if (map->slot[i].state != tileslot_loading || !map->slot[i].IsLoaded)continue;
+
+		map->slot[i].state = tileslot_ready;
+		map->loadNum++;
+	}
+}
+
+//空のスロットを探す。なければ先読みの範囲の外で、ピンもない一番長く使っていないチャンクを追い出す。
+//IsForceなら先読みの範囲とピンのチャンクも追い出す。読み込み中のスロットは使わない。
+static int GetFreeSlot(TILEMAP* map, bool IsForce)
+{
+	int oldest = -1;
+	int oldestkeep = -1;
+
+	for (int i = 0; i < map->slotNum; i++)
+	{
+		if (map->slot[i].state == tileslot_empty)return i;
+		if (map->slot[i].state == tileslot_loading)continue;
+
+		if (map->slot[i].IsPin || IsKeepChunk(map, map->slot[i].chunk))
+		{
+			if (oldestkeep < 0 || map->slot[i].lastUse < map->slot[oldestkeep].lastUse)
+			{
+				oldestkeep = i;
+			}
+			continue;
+		}
+
+		if (oldest < 0 || map->slot[i].lastUse < map->slot[oldest].lastUse)
+		{
+			oldest = i;
+		}
+	}
+
+	if (oldest < 0 && IsForce)
+	{
+		oldest = oldestkeep;
+	}
+
+	if (oldest >= 0)
+	{
+		map->slotOf[map->slot[oldest].chunk] = -1;
+		map->slot[oldest].chunk = -1;
+		map->slot[oldest].state = tileslot_empty;
+		map->slot[oldest].IsPin = false;
+	}
+	return oldest;
+}
+
+//全部のスロットが読み込み中なら、どれかが読み終わるまで待ってそこを使う
+static int WaitFreeSlot(TILEMAP* map)
+{
+	NN_LOG("WaitFreeSlot: all %d slots are loading\n", map->slotNum);
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(g_LoadMutex);
+
+			bool IsLoaded = false;
+			while (!IsLoaded)
+			{
+				for (int i = 0; i < map->slotNum; i++)
+				{
+					if (map->slot[i].state == tileslot_loading && map->slot[i].IsLoaded)IsLoaded = true;
+				}
+				if (!IsLoaded)g_LoadCond.wait(lock);
+			}
+		}
+
+		FinishLoad(map);
+
+		int slot = GetFreeSlot(map, true);
+		if (slot >= 0)return slot;
+	}
+}
+
+static bool IsKeepChunk(const TILEMAP* map, int chunk)
+{
+	int left = (chunk % map->file.chunkWidth) * CHUNK_SIZE;
+	int top = (chunk / map->file.chunkWidth) * CHUNK_SIZE;
+
+	return left + CHUNK_SIZE > map->keepMin.x && left <= map->keepMax.x &&
+		top + CHUNK_SIZE > map->keepMin.y && top <= map->keepMax.y;
+}
+
+//閉じたマップを空にする。スロットはCloseTileMapで解放してある
+static void ClearSlot(TILEMAP* map)
+{
+	memset(map, 0, sizeof(TILEMAP));
+	memset(map->slotOf, -1, sizeof(map->slotOf));
+}
+
+static bool CreateSlot(TILEMAP* map, int slotNum)
+{
+	map->slot = (TILESLOT*)malloc(sizeof(TILESLOT) * slotNum);
+	if (map->slot == NULL)
+	{
+		return false;
+	}
+	map->slotNum = slotNum;
+	RegisterLedger(ledger_buffer, (uintptr_t)map->slot, sizeof(TILESLOT) * slotNum, __FILE__,
+		map->file.filename[0] != '\0' ? map->file.filename : "tile map");
+
+	for (int i = 0; i < slotNum; i++)
+	{
+		map->slot[i].chunk = -1;
+		map->slot[i].state = tileslot_empty;
+		map->slot[i].IsLoaded = false;
+		map->slot[i].IsPin = false;
+		map->slot[i].lastUse = 0;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef TILEMAP_H_
+#define TILEMAP_H_
+
+#include"main.h"
+#include"Mytype.h"
+#include"StageFile.h"
+
+//tilemap_streamでチャンクを置いておける数。ステージがどれだけ大きくてもこれ以上メモリを使わない。
+//tilemap_residentは全部のチャンクの分だけスロットを作る。
+#define TILEMAP_SLOTMAX (16)
+
+enum TILEMAPMODE
+{
+	tilemap_stream,		//画面の近くのチャンクだけ置く。ロードスレッドで先読みする
+	tilemap_resident,	//開いた時に全部読む。どのスレッドからでも読める(ソルバー用)
+};
+
+enum TILESLOTSTATE
+{
+	tileslot_empty,
+	tileslot_loading,
+	tileslot_ready,
+};
+
+typedef struct
+{
+	int chunk;
+	TILESLOTSTATE state;//メインスレッドだけが書く
+	bool IsLoaded;//ロードスレッドが読み終わった。ロードスレッドのミューテックスで守る
+	bool IsPin;//予測線が使うチャンク。ClearTileMapPinまで追い出さない
+	int lastUse;
+	STAGEFILECELL cell[CHUNK_SIZE][CHUNK_SIZE];
+}TILESLOT;
+
+//ステージのファイルに入っている、変わらない部分のセル
+typedef struct
+{
+	STAGEFILEINFO file;
+	TILEMAPMODE mode;
+	bool IsOpen;
+	int frame;
+	Int2 keepMin;//先読みの範囲(マス)。ここにかかるチャンクは追い出さない
+	Int2 keepMax;
+	int loadNum;//ファイルから読んだチャンクの数
+	int missNum;//先読みが間に合わずにその場で読んだ数
+	bool IsNoWait;//置かれていないチャンクはその場で読まずに空のセルを返す
+	int waitNum;//IsNoWaitで読み込みを待っているチャンクに当たった数
+	int fullNum;//IsNoWaitで空けられるスロットがなかった数
+	short slotOf[STAGEFILE_MAXCHUNK];//チャンクが入っているスロット。なければ-1
+	int slotNum;
+	TILESLOT* slot;//開いた時に作る
+}TILEMAP;
+
+bool OpenTileMap(TILEMAP* map, const char* filename, TILEMAPMODE mode);
+//ファイルを使わずにwidth × heightのセルから作る。tilemap_residentになる。
+bool OpenTileMapFromCell(TILEMAP* map, const STAGEFILECELL* cell, int width, int height, const STAGEFILEITEM* item, int itemNum);
+//読み込み中のチャンクがあれば待ってから閉じる
+void CloseTileMap(TILEMAP* map);
+
+//min～maxのマスにかかるチャンクを先読みする。読み終わったチャンクを使えるようにする。毎フレーム呼ぶ。
+void UpdateTileMap(TILEMAP* map, Int2 min, Int2 max);
+//セルを取得する。ステージの外は空のセル。
+//tilemap_streamでチャンクが置かれていなければその場で読むので、メインスレッドからだけ呼ぶ。
+//スロットが足りなければ先読みの範囲のチャンクも追い出し、全部読み込み中なら終わるのを待つ。
+STAGEFILECELL GetTile(TILEMAP* map, int height, int width);
+//trueにすると、置かれていないチャンクは先読みを頼んでピンを付け、空のセルを返す。
+//メインスレッドを止めたくないシミュレーション用。waitNumとfullNumを見て結果を捨てる。
+void SetTileMapNoWait(TILEMAP* map, bool IsNoWait);
+//ピンを全部外す。予測線を最初から作り直す時に呼ぶ
+void ClearTileMapPin(TILEMAP* map);
+
+#endif
\ No newline at end of file
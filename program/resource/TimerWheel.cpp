@@ -0,0 +1,224 @@
+//=================================
+//
+//階層タイマーホイール
+//
+//64スロットの輪を3段持つ。近いタイマーは下の段、遠いタイマーは上の段に入れて、
+//下の段が一周するたびに上の段の1スロット分を下の段に入れ直す。
+//登録、削除、1tick進めるのはどれもタイマーの数に関係なく一定の手間。
+//
+//=================================
+
+#include"TimerWheel.h"
+#include<string.h>
+#include<stddef.h>
+#include<stdlib.h>
+
+static void LinkNode(TIMERWHEEL* wheel, int* head, int id, int slot);
+static void UnlinkNode(TIMERWHEEL* wheel, int* head, int id);
+static void InsertNode(TIMERWHEEL* wheel, int id);
+static void Cascade(TIMERWHEEL* wheel, int level);
+
+bool CreateTimerWheel(TIMERWHEEL* wheel, int nodeMax)
+{
+	memset(wheel, 0, sizeof(TIMERWHEEL));
+
+	return GrowTimerWheel(wheel, nodeMax);
+}
+
+void DestroyTimerWheel(TIMERWHEEL* wheel)
+{
+	free(wheel->node);
+	memset(wheel, 0, sizeof(TIMERWHEEL));
+}
+
+//ノードは使う時に全部書き直すので、ノード以外だけ消せばいい
+void InitTimerWheel(TIMERWHEEL* wheel)
+{
+	memset(wheel, 0, offsetof(TIMERWHEEL, nodeMax));
+}
+
+//ノードはIDで指しているので、場所が変わってもつなぎ直さなくていい
+bool GrowTimerWheel(TIMERWHEEL* wheel, int nodeMax)
+{
+	if (nodeMax <= wheel->nodeMax)return true;
+
+	TIMERNODE* node = (TIMERNODE*)realloc(wheel->node, sizeof(TIMERNODE) * nodeMax);
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	wheel->node = node;
+	wheel->nodeMax = nodeMax;
+	return true;
+}
+
+bool CopyTimerWheel(TIMERWHEEL* dst, const TIMERWHEEL* src)
+{
+	if (!GrowTimerWheel(dst, src->nodeMax))
+	{
+		return false;
+	}
+
+	memcpy(dst, src, offsetof(TIMERWHEEL, nodeMax));
+	if (src->usedNum > 0)
+	{
+		memcpy(dst->node, src->node, sizeof(TIMERNODE) * src->usedNum);
+	}
+	return true;
+}
+
+int AddTimer(TIMERWHEEL* wheel, unsigned int delay, int type, int param)
+{
+	int id = 0;
+
+	//使い終わったノードを先に使う
+	if (wheel->free != 0)
+	{
+		id = wheel->free;
+		UnlinkNode(wheel, &wheel->free, id);
+	}
+	else if (wheel->usedNum < wheel->nodeMax)
+	{
+		wheel->usedNum++;
+		id = wheel->usedNum;
+	}
+	else
+	{
+		return 0;
+	}
+
+	if (delay < 1)delay = 1;
+	if (delay > TIMER_MAXDELAY)delay = TIMER_MAXDELAY;
+
+	TIMERNODE* node = &wheel->node[id - 1];
+	node->expire = wheel->tick + delay;
+	node->type = type;
+	node->param = param;
+
+	InsertNode(wheel, id);
+
+	return id;
+}
+
+void RemoveTimer(TIMERWHEEL* wheel, int id)
+{
+	if (id <= 0 || id > wheel->usedNum)return;
+
+	TIMERNODE* node = &wheel->node[id - 1];
+	if (node->slot == 0)return;
+
+	int slot = node->slot - 1;
+	UnlinkNode(wheel, &wheel->slot[slot / TIMER_SLOTNUM][slot % TIMER_SLOTNUM], id);
+	LinkNode(wheel, &wheel->free, id, 0);
+}
+
+void AdvanceTimerWheel(TIMERWHEEL* wheel)
+{
+	wheel->tick++;
+
+	//下の段が一周したら上の段から入れ直す。上の段から先にやる。
+	if ((wheel->tick & TIMER_SLOTMASK) == 0)
+	{
+		if (((wheel->tick >> TIMER_SLOTBIT) & TIMER_SLOTMASK) == 0)
+		{
+			Cascade(wheel, 2);
+		}
+		Cascade(wheel, 1);
+	}
+
+	//今のスロットは全部時間が来ている
+	int* head = &wheel->slot[0][wheel->tick & TIMER_SLOTMASK];
+	while (*head != 0)
+	{
+		int id = *head;
+		UnlinkNode(wheel, head, id);
+		LinkNode(wheel, &wheel->fired, id, 0);
+	}
+}
+
+bool PopTimerEvent(TIMERWHEEL* wheel, TIMEREVENT* event)
+{
+	if (wheel->fired == 0)return false;
+
+	int id = wheel->fired;
+	UnlinkNode(wheel, &wheel->fired, id);
+
+	event->type = wheel->node[id - 1].type;
+	event->param = wheel->node[id - 1].param;
+
+	LinkNode(wheel, &wheel->free, id, 0);
+
+	return true;
+}
+
+unsigned int GetTimerTick(const TIMERWHEEL* wheel)
+{
+	return wheel->tick;
+}
+
+//expireとtickを段ごとの単位で比べて、差が一周未満になる一番下の段に入れる
+static void InsertNode(TIMERWHEEL* wheel, int id)
+{
+	TIMERNODE* node = &wheel->node[id - 1];
+
+	for (int level = 0; level < TIMER_LEVEL; level++)
+	{
+		int shift = TIMER_SLOTBIT * level;
+		unsigned int diff = (node->expire >> shift) - (wheel->tick >> shift);
+
+		if (diff < TIMER_SLOTNUM || level == TIMER_LEVEL - 1)
+		{
+			int slot = (node->expire >> shift) & TIMER_SLOTMASK;
+			LinkNode(wheel, &wheel->slot[level][slot], id, level * TIMER_SLOTNUM + slot + 1);
+			return;
+		}
+	}
+}
+
+static void Cascade(TIMERWHEEL* wheel, int level)
+{
+	int* head = &wheel->slot[level][(wheel->tick >> (TIMER_SLOTBIT * level)) & TIMER_SLOTMASK];
+
+	while (*head != 0)
+	{
+		int id = *head;
+		UnlinkNode(wheel, head, id);
+		InsertNode(wheel, id);
+	}
+}
+
+static void LinkNode(TIMERWHEEL* wheel, int* head, int id, int slot)
+{
+	TIMERNODE* node = &wheel->node[id - 1];
+
+	node->slot = slot;
+	node->prev = 0;
+	node->next = *head;
+	if (*head != 0)
+	{
+		wheel->node[*head - 1].prev = id;
+	}
+	*head = id;
+}
+
+static void UnlinkNode(TIMERWHEEL* wheel, int* head, int id)
+{
+	TIMERNODE* node = &wheel->node[id - 1];
+
+	if (node->prev != 0)
+	{
+		wheel->node[node->prev - 1].next = node->next;
+	}
+	else
+	{
+		*head = node->next;
+	}
+	if (node->next != 0)
+	{
+		wheel->node[node->next - 1].prev = node->prev;
+	}
+	node->slot = 0;
+	node->next = 0;
+	node->prev = 0;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+//階層タイマーホイール。
+//「何tick後にこれが終わる」を登録しておけば、毎フレーム全部を調べなくても
+//そのtickに終わるものだけが取り出せる。
+//ノードはCreateTimerWheelで使う数だけ確保する。保存、復帰はCopyTimerWheelで、使ったノードだけ写す。
+//構造体が全部0なら、ノードのない空のホイールになる。
+
+#define TIMER_SLOTBIT (6)
+#define TIMER_SLOTNUM (1 << TIMER_SLOTBIT)
+#define TIMER_SLOTMASK (TIMER_SLOTNUM - 1)
+#define TIMER_LEVEL (3)
+#define TIMER_GROWMIN (16)	//ノードを増やす時の最小の数
+#define TIMER_MAXDELAY ((TIMER_SLOTNUM - 1) << (TIMER_SLOTBIT * (TIMER_LEVEL - 1)))
+
+typedef struct
+{
+	unsigned int expire;
+	int type;
+	int param;
+	int slot;	//入っているスロット+1。0なら使っていない
+	int next;	//ノード番号+1。0なら終わり
+	int prev;
+}TIMERNODE;
+
+typedef struct
+{
+	unsigned int tick;
+	int slot[TIMER_LEVEL][TIMER_SLOTNUM];
+	int fired;		//時間が来たノードのリスト
+	int free;		//使い終わったノードのリスト
+	int usedNum;	//一回でも使ったノードの数
+	int nodeMax;
+	TIMERNODE* node;
+}TIMERWHEEL;
+
+typedef struct
+{
+	int type;
+	int param;
+}TIMEREVENT;
+
+//nodeMax個のタイマーを登録できるホイールを作る。0ならAddTimerで増やすまでノードを持たない
+bool CreateTimerWheel(TIMERWHEEL* wheel, int nodeMax);
+void DestroyTimerWheel(TIMERWHEEL* wheel);
+//タイマーを全部消す。ノードはそのまま
+void InitTimerWheel(TIMERWHEEL* wheel);
+//登録できる数をnodeMaxまで増やす。登録してあるタイマーはそのまま
+bool GrowTimerWheel(TIMERWHEEL* wheel, int nodeMax);
+//dstのノードが足りなければ増やして、srcの使ったノードだけ写す
+bool CopyTimerWheel(TIMERWHEEL* dst, const TIMERWHEEL* src);
+//delay tick後に時間が来るタイマーを登録する。戻り値はRemoveTimer用のID。いっぱいなら0。
+int AddTimer(TIMERWHEEL* wheel, unsigned int delay, int type, int param);
+void RemoveTimer(TIMERWHEEL* wheel, int id);
+//1tick進める。時間が来たタイマーはPopTimerEventで取り出す。
+void AdvanceTimerWheel(TIMERWHEEL* wheel);
+bool PopTimerEvent(TIMERWHEEL* wheel, TIMEREVENT* event);
+unsigned int GetTimerTick(const TIMERWHEEL* wheel);
+
+#endif
\ No newline at end of file
@@ -5,25 +5,20 @@
 #include"controller.h"
 #include"Scene.h"
 #include"sound.h"
+#include"Input.h"
+#include"Widget.h"
+#include"Redraw.h"
 
 #define MAXTITLEFADE (3)
 
-static enum TITLEBOTTUN
-{
-	key_w,
-	key_s,
-	key_space,
-	TITLEKEYMAX
-};
-
 static UINT g_TitleTex;
 static UINT g_BottunTex;
 static UINT g_FrameTex;
 static UINT g_BottunDispTex;
 static UINT g_TitleTextTex;
 
-static bool g_IsTouch_title[TITLEKEYMAX] = {};
-static int g_currentBottunPos;
+static WIDGETSCREEN g_UI;
+static int g_BottunList;
 
 static UINT g_Stage1Tex;
 static UINT g_Stage2Tex;
@@ -47,65 +42,40 @@ void TitleINIT(void)
 	g_NextStageCnt = 0;
 	g_IsChanging = false;
 
-	memset(g_IsTouch_title, false, sizeof(g_IsTouch_title));
-	g_currentBottunPos = 0;
-}
+	InitWidgetScreen(&g_UI);
 
-void TitleUPDATE(void)
-{
-	if (GetKeyState(VK_SPACE) & 0x80)
-	{
-		if (!g_IsTouch_title[key_space])
-		{
-			if (g_currentBottunPos == 0)
-			{
-				PlaySE(SE_POP);
-				//Xe[W1ցB
-				SetNextStage(scene_game);
-			}
-			else
-			{
-				UNINIT();
-			}
-			g_IsTouch_title[key_space] = true;
-		}
-	}
-	else
+	//現在選択しているボタンのフレーム
+	g_BottunList = AddListWidget(&g_UI, MakeFloat2(512, 128), g_FrameTex);
+
+	//ボタン　始める && 終わる
+	for (int i = 0; i < 2; i++)
 	{
-		g_IsTouch_title[key_space] = false;
+		AddListItem(&g_UI, g_BottunList, AddButtonWidget(&g_UI, MakeFloat2(0, 256 * i), MakeFloat2(512, 128), g_BottunTex, 0, i, 1, 4));
 	}
 
-	if (GetKeyState('W') & 0x80)
-	{
-		if (!g_IsTouch_title[key_w])
-		{
-			PlaySE(SE_FINGER);
+	//決定キー
+	AddImageWidget(&g_UI, MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
+		g_BottunDispTex, 0, 0, 1, 4, NORMALCOLOR);
 
-			g_currentBottunPos = (g_currentBottunPos + 1) % 2;
+	//説明
+	AddTextWidget(&g_UI, MakeFloat2(0, SCREEN_HEIGHT / 2 - 160), MakeFloat2(64, 64), NORMALCOLOR, "push tab to menu");
 
-			g_IsTouch_title[key_w] = true;
-		}
-	}
-	else
-	{
-		g_IsTouch_title[key_w] = false;
-	}
+	//タイトル文字
+	AddImageWidget(&g_UI, MakeFloat2(0, -256), MakeFloat2(1024, 128), g_TitleTextTex, 0, 0, 1, 1, NORMALCOLOR);
+}
 
-	if (GetKeyState('S') & 0x80)
+void TitleUPDATE(void)
+{
+	int decide = UpdateWidgetList(&g_UI, g_BottunList, action_place);
+	if (decide == 0)
 	{
-		if (!g_IsTouch_title[key_s])
-		{
-			PlaySE(SE_FINGER);
-
-			g_currentBottunPos = (g_currentBottunPos - 1) % 2;
-			if (g_currentBottunPos < 0)g_currentBottunPos *= -1;
-
-			g_IsTouch_title[key_s] = true;
-		}
+		PlaySE(SE_POP);
+		//ステージ1へ。
+		SetNextStage(scene_game);
 	}
-	else
+	else if (decide == 1)
 	{
-		g_IsTouch_title[key_s] = false;
+		UNINIT();
 	}
 
 	if (!g_IsChanging)
@@ -120,6 +90,7 @@ void TitleUPDATE(void)
 	}
 	else
 	{
+		RequestRedraw();
 		g_AlphaNum += 0.01f;
 
 		if (g_AlphaNum >= 1.0f)
@@ -135,43 +106,27 @@ void TitleUPDATE(void)
 
 void TitleDRAW(void)
 {
-	//wi
+	//背景
 
 	UINT texID = g_CurrentDispStageNum == 0 ? g_Stage1Tex :
 		g_CurrentDispStageNum == 1 ? g_Stage2Tex : g_Stage3Tex;
 
-	//̔wi
+	//下の背景
 	FaceGenforTex(MakeFloat2(0, 0), MakeFloat2(SCREEN_WIDTH, SCREEN_HEIGHT), 0, 0, 1, 1, true, texID, MakeFloat4(1, 1, 1, 1));
 
 	UINT texID_2 = g_CurrentDispStageNum == 0 ? g_Stage2Tex :
 		g_CurrentDispStageNum == 1 ? g_Stage3Tex : g_Stage1Tex;
 
-	//̔wi
-	FaceGenforTex(MakeFloat2(0, 0), MakeFloat2(SCREEN_WIDTH, SCREEN_HEIGHT), 0, 0, 1, 1, true, texID_2, MakeFloat4(1, 1, 1, g_AlphaNum));
-
-
-
-	//ݑIĂ{^̃t[\
-	FaceGenforTex(MakeFloat2(0, 256 * g_currentBottunPos),
-		MakeFloat2(512, 128), 0, 0, 1, 1, true, g_FrameTex, MakeFloat4(1, 1, 1, 1));
-
-	//{^@n߂ && I
-	for (int i = 0; i < 2; i++)
+	//上の背景。切り替えていない間は見えないので描かない
+	if (g_IsChanging)
 	{
-		FaceGenforTex(MakeFloat2(0, 256 * i), MakeFloat2(512, 128), 
-			0, i, 1, 4, true, g_BottunTex, MakeFloat4(1, 1, 1, 1));
+		FaceGenforTex(MakeFloat2(0, 0), MakeFloat2(SCREEN_WIDTH, SCREEN_HEIGHT), 0, 0, 1, 1, true, texID_2, MakeFloat4(1, 1, 1, g_AlphaNum));
 	}
 
-	//L[
-	FaceGenforTex(MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
-		0, 0, 1, 4, true, g_BottunDispTex, MakeFloat4(1, 1, 1, 1));
 
-	//
-	TextGen(MakeFloat2(0, SCREEN_HEIGHT / 2 - 160), 
-		MakeFloat2(64, 64), NORMALCOLOR, "push tab to menu");
 
-	//^Cg
-	FaceGenforTex(MakeFloat2(0, -256), MakeFloat2(1024, 128), 0, 0, 1, 1, true, g_TitleTextTex, NORMALCOLOR);
+	//ボタン、フレーム、文字
+	DrawWidgetScreen(&g_UI);
 }
 
 void TitleUNINIT(void)
@@ -181,10 +136,16 @@ void TitleUNINIT(void)
 	UnloadTexture(g_FrameTex);
 	UnloadTexture(g_BottunDispTex);
 	UnloadTexture(g_TitleTextTex);
+	UnloadTexture(g_Stage1Tex);
+	UnloadTexture(g_Stage2Tex);
+	UnloadTexture(g_Stage3Tex);
 
 	g_TitleTex = NULL;
 	g_BottunTex = NULL;
 	g_FrameTex = NULL;
 	g_BottunDispTex = NULL;
 	g_TitleTextTex = NULL;
+	g_Stage1Tex = NULL;
+	g_Stage2Tex = NULL;
+	g_Stage3Tex = NULL;
 }
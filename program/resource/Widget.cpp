@@ -0,0 +1,298 @@
+//=================================
+//
+//UIのウィジェット
+//
+//画面のボタン、フレーム、文字はINITで一度作り、選択やコインの数が変わった時だけ
+//頂点を作り直す。毎フレームは作ってあるバッチを描くだけ。
+//リストの上下選択はここでまとめてやる。
+//
+//=================================
+
+#include"Widget.h"
+#include"sound.h"
+#include"Redraw.h"
+#include"Resolution.h"
+
+#include<string.h>
+
+static WIDGET* AddWidget(WIDGETSCREEN* screen, WIDGETTYPE type, Float2 pos, Float2 size);
+static void MoveListSelect(WIDGETSCREEN* screen, WIDGET* list, int step);
+static void FixListSelect(WIDGETSCREEN* screen);
+static void BuildWidgetScreen(WIDGETSCREEN* screen);
+static void SetWidgetScreenDirty(WIDGETSCREEN* screen);
+
+void InitWidgetScreen(WIDGETSCREEN* screen)
+{
+	screen->widgetNum = 0;
+	screen->IsVisible = true;
+	SetWidgetScreenDirty(screen);
+	screen->buildNum = 0;
+	ClearFaceBatch(&screen->batch);
+}
+
+int AddImageWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, UINT texture, int frameX, int frameY, int sheetX, int sheetY, Float4 color)
+{
+	WIDGET* widget = AddWidget(screen, widget_image, pos, size);
+	if (widget == NULL)return -1;
+
+	widget->texture = texture;
+	widget->frameX = frameX;
+	widget->frameY = frameY;
+	widget->sheetX = sheetX;
+	widget->sheetY = sheetY;
+	widget->color = color;
+
+	return (int)(widget - screen->widget);
+}
+
+int AddAnimWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texture, Float4 color)
+{
+	int id = AddImageWidget(screen, pos, size, texture, 0, 0, anim->sheetX, anim->sheetY, color);
+	if (id < 0)return -1;
+
+	screen->widget[id].IsAnim = true;
+	screen->widget[id].anim = *anim;
+
+	return id;
+}
+
+int AddButtonWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, UINT texture, int frameX, int frameY, int sheetX, int sheetY)
+{
+	int id = AddImageWidget(screen, pos, size, texture, frameX, frameY, sheetX, sheetY, NORMALCOLOR);
+	if (id < 0)return -1;
+
+	screen->widget[id].type = widget_button;
+
+	return id;
+}
+
+int AddTextWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, Float4 color, const char* text)
+{
+	WIDGET* widget = AddWidget(screen, widget_text, pos, size);
+	if (widget == NULL)return -1;
+
+	widget->color = color;
+	strncpy(widget->text, text, WIDGET_TEXTMAX - 1);
+	widget->text[WIDGET_TEXTMAX - 1] = '\0';
+
+	return (int)(widget - screen->widget);
+}
+
+int AddListWidget(WIDGETSCREEN* screen, Float2 frameSize, UINT frameTexture)
+{
+	WIDGET* widget = AddWidget(screen, widget_list, MakeFloat2(0, 0), frameSize);
+	if (widget == NULL)return -1;
+
+	widget->texture = frameTexture;
+	widget->color = NORMALCOLOR;
+
+	return (int)(widget - screen->widget);
+}
+
+void AddListItem(WIDGETSCREEN* screen, int list, int button)
+{
+	WIDGET* widget = &screen->widget[list];
+	if (widget->itemNum >= WIDGET_LISTMAX)return;
+
+	widget->item[widget->itemNum++] = button;
+	SetWidgetScreenDirty(screen);
+}
+
+void SetWidgetScreenVisible(WIDGETSCREEN* screen, bool IsVisible)
+{
+	if (screen->IsVisible == IsVisible)return;
+
+	screen->IsVisible = IsVisible;
+	RequestRedraw();
+}
+
+void SetWidgetVisible(WIDGETSCREEN* screen, int id, bool IsVisible)
+{
+	if (screen->widget[id].IsVisible == IsVisible)return;
+
+	screen->widget[id].IsVisible = IsVisible;
+	SetWidgetScreenDirty(screen);
+
+	FixListSelect(screen);
+}
+
+bool GetWidgetVisible(const WIDGETSCREEN* screen, int id)
+{
+	return screen->widget[id].IsVisible;
+}
+
+void SetWidgetFrame(WIDGETSCREEN* screen, int id, int frameX, int frameY)
+{
+	WIDGET* widget = &screen->widget[id];
+	if (widget->frameX == frameX && widget->frameY == frameY)return;
+
+	widget->frameX = frameX;
+	widget->frameY = frameY;
+	SetWidgetScreenDirty(screen);
+}
+
+void SetWidgetText(WIDGETSCREEN* screen, int id, const char* text)
+{
+	WIDGET* widget = &screen->widget[id];
+	if (strncmp(widget->text, text, WIDGET_TEXTMAX - 1) == 0)return;
+
+	strncpy(widget->text, text, WIDGET_TEXTMAX - 1);
+	widget->text[WIDGET_TEXTMAX - 1] = '\0';
+	SetWidgetScreenDirty(screen);
+}
+
+void SetWidgetAnim(WIDGETSCREEN* screen, int id, bool IsAnim)
+{
+	if (screen->widget[id].IsAnim == IsAnim)return;
+
+	screen->widget[id].IsAnim = IsAnim;
+	SetWidgetScreenDirty(screen);
+}
+
+void SetListSelect(WIDGETSCREEN* screen, int list, int index)
+{
+	WIDGET* widget = &screen->widget[list];
+	if (index < 0 || index >= widget->itemNum || widget->select == index)return;
+
+	widget->select = index;
+	SetWidgetScreenDirty(screen);
+
+	FixListSelect(screen);
+}
+
+int GetListSelect(const WIDGETSCREEN* screen, int list)
+{
+	return screen->widget[list].select;
+}
+
+int UpdateWidgetList(WIDGETSCREEN* screen, int list, INPUTACTION decide)
+{
+	WIDGET* widget = &screen->widget[list];
+	if (!screen->IsVisible || widget->itemNum == 0)return -1;
+
+	//決定は動かす前に選んでいたもの
+	int decided = GetInputPressed(decide) ? widget->select : -1;
+
+	if (GetInputPressed(action_up))
+	{
+		PlaySE(SE_FINGER);
+		MoveListSelect(screen, widget, -1);
+	}
+
+	if (GetInputPressed(action_down))
+	{
+		PlaySE(SE_FINGER);
+		MoveListSelect(screen, widget, 1);
+	}
+
+	return decided;
+}
+
+void DrawWidgetScreen(WIDGETSCREEN* screen)
+{
+	if (!screen->IsVisible)return;
+
+	if (screen->IsDirty)BuildWidgetScreen(screen);
+
+	//UIは画面の解像度で描く
+	BeginResolutionUI();
+
+	DrawFaceBatch(&screen->batch);
+}
+
+static WIDGET* AddWidget(WIDGETSCREEN* screen, WIDGETTYPE type, Float2 pos, Float2 size)
+{
+	if (screen->widgetNum >= WIDGET_MAX)
+	{
+		NN_LOG("AddWidget: no more than %d widgets\n", WIDGET_MAX);
+		return NULL;
+	}
+
+	WIDGET* widget = &screen->widget[screen->widgetNum++];
+	memset(widget, 0, sizeof(WIDGET));
+	widget->type = type;
+	widget->IsVisible = true;
+	widget->pos = pos;
+	widget->size = size;
+	widget->sheetX = 1;
+	widget->sheetY = 1;
+
+	SetWidgetScreenDirty(screen);
+	return widget;
+}
+
+//stepの向きに見えているボタンまで進める。端まで行ったら反対に回る
+static void MoveListSelect(WIDGETSCREEN* screen, WIDGET* list, int step)
+{
+	int select = list->select;
+
+	for (int i = 0; i < list->itemNum; i++)
+	{
+		select = (select + step + list->itemNum) % list->itemNum;
+		if (screen->widget[list->item[select]].IsVisible)break;
+	}
+
+	if (select == list->select)return;
+
+	list->select = select;
+	SetWidgetScreenDirty(screen);
+}
+
+static void FixListSelect(WIDGETSCREEN* screen)
+{
+	for (int i = 0; i < screen->widgetNum; i++)
+	{
+		WIDGET* list = &screen->widget[i];
+		if (list->type != widget_list || list->itemNum == 0)continue;
+
+		if (!screen->widget[list->item[list->select]].IsVisible)MoveListSelect(screen, list, 1);
+	}
+}
+
+static void BuildWidgetScreen(WIDGETSCREEN* screen)
+{
+	ClearFaceBatch(&screen->batch);
+
+	for (int i = 0; i < screen->widgetNum; i++)
+	{
+		const WIDGET* widget = &screen->widget[i];
+		if (!widget->IsVisible)continue;
+
+		switch (widget->type)
+		{
+		case widget_image:
+		case widget_button:
+			if (widget->IsAnim)
+			{
+				AddFaceBatchAnim(&screen->batch, widget->pos, widget->size, &widget->anim, widget->texture, widget->color);
+			}
+			else
+			{
+				AddFaceBatch(&screen->batch, widget->pos, widget->size, widget->frameX, widget->frameY,
+					widget->sheetX, widget->sheetY, widget->texture, widget->color);
+			}
+			break;
+		case widget_text:
+			AddTextBatch(&screen->batch, widget->pos, widget->size, widget->color, widget->text);
+			break;
+		case widget_list:
+			//選んでいるボタンの所にフレーム
+			if (widget->itemNum > 0 && screen->widget[widget->item[widget->select]].IsVisible)
+			{
+				AddFaceBatch(&screen->batch, screen->widget[widget->item[widget->select]].pos, widget->size,
+					0, 0, 1, 1, widget->texture, widget->color);
+			}
+			break;
+		}
+	}
+
+	screen->IsDirty = false;
+	screen->buildNum++;
+}
+
+//作り直すのは描く時。画面も描き直す
+static void SetWidgetScreenDirty(WIDGETSCREEN* screen)
+{
+	screen->IsDirty = true;
+	RequestRedraw();
+}
\ No newline at end of file
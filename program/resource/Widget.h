@@ -0,0 +1,78 @@
+#ifndef WIDGET_H_
+#define WIDGET_H_
+
+#include"main.h"
+#include"FaceGen.h"
+#include"Input.h"
+
+#define WIDGET_MAX (32)		//1画面のウィジェットの数
+#define WIDGET_TEXTMAX (32)
+#define WIDGET_LISTMAX (8)	//リストに入るボタンの数
+
+enum WIDGETTYPE
+{
+	widget_image,
+	widget_button,	//リストに入れて選べる画像
+	widget_text,
+	widget_list,	//ボタンを並べて上下で選ぶ。選んでいるボタンにフレームを出す
+};
+
+typedef struct
+{
+	WIDGETTYPE type;
+	bool IsVisible;
+	Float2 pos;
+	Float2 size;
+	UINT texture;
+	int frameX;
+	int frameY;
+	int sheetX;
+	int sheetY;
+	Float4 color;
+	bool IsAnim;
+	SPRITEANIM anim;
+	char text[WIDGET_TEXTMAX];
+	int item[WIDGET_LISTMAX];//リストのボタン
+	int itemNum;
+	int select;
+}WIDGET;
+
+//1画面分。変わった時だけ頂点を作り直し、描く時はバッチを出すだけ
+typedef struct
+{
+	WIDGET widget[WIDGET_MAX];
+	int widgetNum;
+	bool IsVisible;
+	bool IsDirty;
+	int buildNum;//頂点を作り直した回数
+	FACEBATCH batch;
+}WIDGETSCREEN;
+
+void InitWidgetScreen(WIDGETSCREEN* screen);
+//作ったウィジェットの番号を返す。入らなければ-1
+int AddImageWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, UINT texture, int frameX, int frameY, int sheetX, int sheetY, Float4 color);
+int AddAnimWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, const SPRITEANIM* anim, UINT texture, Float4 color);
+int AddButtonWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, UINT texture, int frameX, int frameY, int sheetX, int sheetY);
+int AddTextWidget(WIDGETSCREEN* screen, Float2 pos, Float2 size, Float4 color, const char* text);
+//フレームはボタンより先に描くので、ボタンより前に作る
+int AddListWidget(WIDGETSCREEN* screen, Float2 frameSize, UINT frameTexture);
+void AddListItem(WIDGETSCREEN* screen, int list, int button);
+
+//値が変わった時だけ作り直す
+void SetWidgetScreenVisible(WIDGETSCREEN* screen, bool IsVisible);
+void SetWidgetVisible(WIDGETSCREEN* screen, int id, bool IsVisible);
+bool GetWidgetVisible(const WIDGETSCREEN* screen, int id);
+void SetWidgetFrame(WIDGETSCREEN* screen, int id, int frameX, int frameY);
+void SetWidgetText(WIDGETSCREEN* screen, int id, const char* text);
+//アニメーションするか。しなければframeX, frameYのコマを出す
+void SetWidgetAnim(WIDGETSCREEN* screen, int id, bool IsAnim);
+
+//選んでいるボタンが見えなくなったら、次の見えているボタンに移す
+void SetListSelect(WIDGETSCREEN* screen, int list, int index);
+int GetListSelect(const WIDGETSCREEN* screen, int list);
+//上下で選ぶ。decideが押されたら選んでいる番号、それ以外は-1
+int UpdateWidgetList(WIDGETSCREEN* screen, int list, INPUTACTION decide);
+
+void DrawWidgetScreen(WIDGETSCREEN* screen);
+
+#endif
\ No newline at end of file
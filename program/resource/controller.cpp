@@ -1,26 +1,27 @@
 
 #include "main.h"
 #include "controller.h"
+#include "Input.h"
 
 
 
-// pbhϐ
+// パッド変数
 NpadJoyDualState g_OldPadState;
 NpadJoyDualState g_PadState;
 
 
-// Uqϐ
+// 振動子変数
 VibrationDeviceHandle g_VibrationDevice[2];
 int g_VibrationLeftFrame;
 int g_VibrationRightFrame;
 float g_VibrationLeftFreq = 320;
 float g_VibrationRightFreq = 320;
 
-// 6ZTϐ
+// 6軸センサ変数
 SixAxisSensorHandle g_SixAxisSensor[2];
 SixAxisSensorState g_SixAxisSensorState[2] = {};
 
-// ^b`XN[ϐ
+// タッチスクリーン変数
 TouchScreenState<1> g_TouchScreenState;
 
 
@@ -29,7 +30,6 @@ TouchScreenState<1> g_TouchScreenState;
 
 #define PAD_BTN_NUM	(24)
 
-XINPUT_STATE		xi_sts;
 XINPUT_VIBRATION	xi_vib;
 
 int btn_code[PAD_BTN_NUM] =
@@ -54,14 +54,11 @@ int vk_code[PAD_BTN_NUM] =
 	0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-RECT screen_rect;
-POINT touch_pt;
-
 
 void InitController()
 {
 
-	//// pbh
+	//// パッド初期化
 
 	//InitializeNpad();
 	//NpadIdType npadIds[] = { NpadId::No1,
@@ -71,7 +68,7 @@ void InitController()
 
 
 
-	//// Uq
+	//// 振動子初期化
 	//if (GetNpadStyleSet(NpadId::No1).Test<nn::hid::NpadStyleJoyDual>())
 	//	GetVibrationDeviceHandles(g_VibrationDevice, 2, NpadId::No1, NpadStyleJoyDual::Mask);
 	//else if (GetNpadStyleSet(NpadId::Handheld).Test<nn::hid::NpadStyleHandheld>())
@@ -87,7 +84,7 @@ void InitController()
 
 	//
 
-	//// 6ZT
+	//// 6軸センサ初期化
 	//if (GetNpadStyleSet(NpadId::No1).Test<nn::hid::NpadStyleJoyDual>())
 	//	GetSixAxisSensorHandles(g_SixAxisSensor, 2, NpadId::No1, NpadStyleJoyDual::Mask);
 	//else if (GetNpadStyleSet(NpadId::Handheld).Test<nn::hid::NpadStyleHandheld>())
@@ -100,7 +97,7 @@ void InitController()
 
 
 
-	//// ^b`XN[
+	//// タッチスクリーン初期化
 	//InitializeTouchScreen();
 
 	UninitController();
@@ -109,11 +106,7 @@ void InitController()
 	g_PadState.buttons.Reset();
 	g_OldPadState.buttons.Reset();
 
-	memset(&xi_sts, 0, sizeof(XINPUT_STATE));
 	memset(&xi_vib, 0, sizeof(XINPUT_VIBRATION));
-
-	GetClientRect(GetForegroundWindow(), &screen_rect);
-	GetControllerTouchScreen();
 }
 
 
@@ -130,14 +123,14 @@ void UpdateController()
 	g_OldPadState = g_PadState;
 
 
-	//// pbhԎ擾
+	//// パッド状態取得
 	//if (GetNpadStyleSet(NpadId::No1).Test<nn::hid::NpadStyleJoyDual>())
 	//	GetNpadState(&g_PadState, NpadId::No1);
 	//else if (GetNpadStyleSet(NpadId::Handheld).Test<nn::hid::NpadStyleHandheld>())
 	//	GetNpadState((NpadHandheldState*)&g_PadState, NpadId::Handheld);
 
 
-	//// 6ZTԎ擾
+	//// 6軸センサ状態取得
 	//GetSixAxisSensorState(&g_SixAxisSensorState[0], g_SixAxisSensor[0]);
 
 	//if (g_SixAxisSensor[1]._storage)
@@ -146,12 +139,12 @@ void UpdateController()
 	//	g_SixAxisSensorState[1] = g_SixAxisSensorState[0];
 
 
-	//// ^b`XN[Ԏ擾
+	//// タッチスクリーン状態取得
 	//GetTouchScreenStates(&g_TouchScreenState, 1);
 
 
 
-	// Uq~
+	// 振動子停止
 	if (g_VibrationLeftFrame > 0)
 	{
 		g_VibrationLeftFrame--;
@@ -199,19 +192,24 @@ void UpdateController()
 
 	g_PadState.buttons.Reset();
 
+	// XInputとキーボードはInputUPDATEで読んだものを使う
+	const INPUTRAW* raw = GetInputRaw();
+
 	// XInput
-	XInputGetState(0, &xi_sts);
 	for (int i = 0; i < PAD_BTN_NUM; i++)
 	{
-		if (xi_sts.Gamepad.wButtons & btn_code[i]) g_PadState.buttons.Set(i, true);
+		for (int bit = 0; bit < 16; bit++)
+		{
+			if ((btn_code[i] & (1 << bit)) && GetInputRawKey(raw, INPUTKEY_PAD(bit))) g_PadState.buttons.Set(i, true);
+		}
 	}
-	if (xi_sts.Gamepad.bLeftTrigger) g_PadState.buttons.Set(nn::hid::NpadButton::ZL::Index, true);
-	if (xi_sts.Gamepad.bRightTrigger) g_PadState.buttons.Set(nn::hid::NpadButton::ZR::Index, true);
+	if (raw->leftTrigger) g_PadState.buttons.Set(nn::hid::NpadButton::ZL::Index, true);
+	if (raw->rightTrigger) g_PadState.buttons.Set(nn::hid::NpadButton::ZR::Index, true);
 
-	// L[{[h
+	// キーボード
 	for (int i = 0; i < PAD_BTN_NUM; i++)
 	{
-		if (GetAsyncKeyState(vk_code[i])) g_PadState.buttons.Set(i, true);
+		if (vk_code[i] != 0 && GetInputRawKey(raw, vk_code[i])) g_PadState.buttons.Set(i, true);
 	}
 }
 
@@ -235,8 +233,8 @@ Float2 GetControllerLeftStick()
 	//	stick.y = (float)g_PadState.analogStickL.y / AnalogStickMax;
 
 		// XInput
-	stick.x = (float)xi_sts.Gamepad.sThumbLX / 0x7FFF;
-	stick.y = (float)xi_sts.Gamepad.sThumbLY / 0x7FFF;
+	stick.x = (float)GetInputRaw()->leftStick[0] / 0x7FFF;
+	stick.y = (float)GetInputRaw()->leftStick[1] / 0x7FFF;
 	if (fabs(stick.x) < 0.1f) stick.x = 0;
 	if (fabs(stick.y) < 0.1f) stick.y = 0;
 	float r = sqrt(stick.x * stick.x + stick.y * stick.y);
@@ -246,7 +244,7 @@ Float2 GetControllerLeftStick()
 		stick.y /= r;
 	}
 
-	// L[{[h
+	// キーボード
 	//if (stick.x == 0 && stick.y == 0)
 	//{
 	//	stick.x = (float)((GetAsyncKeyState('H') != 0) - (GetAsyncKeyState('F') != 0));
@@ -268,8 +266,8 @@ Float2 GetControllerRightStick()
 	//stick.y = (float)g_PadState.analogStickR.y / AnalogStickMax;
 
 	// XInput
-	stick.x = (float)xi_sts.Gamepad.sThumbRX / 0x7FFF;
-	stick.y = (float)xi_sts.Gamepad.sThumbRY / 0x7FFF;
+	stick.x = (float)GetInputRaw()->rightStick[0] / 0x7FFF;
+	stick.y = (float)GetInputRaw()->rightStick[1] / 0x7FFF;
 	if (fabs(stick.x) < 0.1f) stick.x = 0;
 	if (fabs(stick.y) < 0.1f) stick.y = 0;
 	float r = sqrt(stick.x * stick.x + stick.y * stick.y);
@@ -279,7 +277,7 @@ Float2 GetControllerRightStick()
 		stick.y /= r;
 	}
 
-	// L[{[h
+	// キーボード
 	//if (stick.x == 0 && stick.y == 0)
 	//{
 	//	stick.x = (float)((GetAsyncKeyState('J') != 0) - (GetAsyncKeyState('L') != 0));
@@ -376,15 +374,7 @@ bool GetControllerTouchScreen()
 	//else
 	//	return false;
 
-	GetCursorPos(&touch_pt);
-	ScreenToClient(GetForegroundWindow(), &touch_pt);
-
-	if (GetAsyncKeyState(VK_LBUTTON) && PtInRect(&screen_rect, touch_pt))
-	{
-		return true;
-	}
-
-	return false;
+	return GetInputDown(action_paint) && GetIsInputPointerIn();
 }
 
 Float2 GetControllerTouchScreenPosition()
@@ -393,8 +383,7 @@ Float2 GetControllerTouchScreenPosition()
 	position.x = g_TouchScreenState.touches[0].x * SCREEN_WIDTH / 1280.0f - SCREEN_WIDTH / 2.0f;
 	position.y = g_TouchScreenState.touches[0].y * SCREEN_HEIGHT / 720.0f - SCREEN_HEIGHT / 2.0f;
 
-	position.x = (float)touch_pt.x * SCREEN_WIDTH / screen_rect.right - SCREEN_WIDTH / 2;
-	position.y = (float)touch_pt.y * SCREEN_HEIGHT / screen_rect.bottom - SCREEN_HEIGHT / 2;
+	position = GetInputPointer();
 
 	return position;
 }
@@ -15,19 +15,18 @@
 #include"Scene.h"
 #include"FaceGen.h"
 #include"sound.h"
+#include"Solver.h"
+#include"Random.h"
+#include"Input.h"
+#include"InputLog.h"
+#include"Job.h"
+#include"FrameHeap.h"
+#include"AllocTrack.h"
+#include"MemoryLedger.h"
+#include"Redraw.h"
+#include"Resolution.h"
 //===================================include
 
-//===================================enum
-enum KEYMAIN
-{
-	mainkey_b,
-	mainkey_p,
-	mainkey_tab,
-
-	MAINKEYMAX,
-};
-//===================================
-
 //===================================プロトタイプ関数宣言
 bool INIT(void);
 void UPDATE(void);
@@ -36,10 +35,11 @@ void UNINIT(void);
 //===================================プロトタイプ関数宣言
 
 //===================================グローバル変数
-static bool g_IsTouch_main[MAINKEYMAX] = {};
 static bool g_IsDebug;
 static bool g_IsDispMenu;
 static UINT g_MenuTex;
+static thread_local bool g_IsHeadless;//描画、音、エフェクトを使わないスレッド
+static bool g_IsPresentationOff;//リプレイの早送り中。音とエフェクトだけ止めて、ゲームはそのまま進める
 //===================================グローバル変数
 
 // エントリー関数
@@ -61,15 +61,36 @@ extern "C" void nnMain()
 	{
 		GetTime();
 
-		glClearColor(0.0f, 0.05f, 0.09f, 1.0f);		// 画⾯のクリア
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		// 画⾯のクリア
+		//前のフレームのスクラッチを返す
+		ResetThreadFrameHeap();
 
+		//確保の数をフレームごとに区切る
+		AllocTrackFrame(GetCurrentScene());
 
+		SetAllocPhase(allocphase_update);
 		UPDATE();
 
-		DRAW();
+		//見た目が変わった時だけ描く。リプレイの早送り中はたまにしか描画しない
+		bool IsRedraw = UpdateRedraw();
+		bool IsDraw = GetIsInputLogFastForward() ? GetInputLogFrame() % INPUTLOG_DRAWINTERVAL == 0 : IsRedraw;
+
+		SetAllocPhase(allocphase_draw);
+		if (IsDraw)
+		{
+			//内部解像度のターゲットに描く
+			BeginResolutionFrame();
+			FaceGenFillFrame();
+
+			glClearColor(0.0f, 0.05f, 0.09f, 1.0f);		// 画⾯のクリア
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		// 画⾯のクリア
+
+			DRAW();
+		}
 
+		//シーンの読み込みはゲーム中の確保に入れない
+		SetAllocPhase(allocphase_load);
 		ExecuteStage();
+		SetAllocPhase(allocphase_other);
 	}
 
 	UNINIT();
@@ -80,22 +101,35 @@ extern "C" void nnMain()
 
 bool INIT()
 {
-	srand((unsigned)time(NULL));
+	CreateThreadFrameHeap(FRAMEHEAP_MAINSIZE);
+
+	//seedをログに出しておけば同じ乱数列を再現できる
+	unsigned int seed = (unsigned int)time(NULL);
+	RandomINIT(seed);
+	NN_LOG("Random seed:%u\n", seed);
 
 	InitTime();
 
+	//テクスチャの読み込みもジョブで分けるので最初に作る
+	JobINIT(0);
+
 	SetVolumeBGM(0.01f);
 
 	FacegenINIT();
 
+	ResolutionINIT();
+
+	InputINIT();
+#ifdef INPUT_USETHREAD
+	InputStartThread(INPUT_THREADHZ);
+#endif
+
 	InitController();
 
 	SceneINIT();
 
 	g_MenuTex = LoadTexture("asset/option.tga");
 
-	memset(g_IsTouch_main, false, sizeof(g_IsTouch_main));
-
 	g_IsDebug = false;
 
 	g_IsDispMenu = false;
@@ -105,64 +139,88 @@ bool INIT()
 
 void UPDATE()
 {
+	//入力はフレームの最初に1回だけ読む
+	InputUPDATE();
+
+	//リプレイの記録、再生
+	InputLogUPDATE();
+
 	UpdateController();
 
 	UpdateSound();
 
-	if (!g_IsDispMenu)
+	//ウィンドウが裏にある間はメニューと同じように止める。記録、再生中は入力とずれるので止めない
+	bool IsBackground = !GetIsWindowActive() && GetInputLogMode() == inputlog_none;
+
+	if (!g_IsDispMenu && !IsBackground)
 	{
 		SceneUPDATE();
+
+		FacegenUPDATE();
 	}
 
-	if (GetKeyState('B') & 0x80)
+	if (GetInputPressed(action_debug))
 	{
-		if (!g_IsTouch_main[mainkey_b])
-		{
-			g_IsDebug == true ? g_IsDebug = false : g_IsDebug = true;
-
-			g_IsTouch_main[mainkey_b] = true;
-		}
+		g_IsDebug == true ? g_IsDebug = false : g_IsDebug = true;
 	}
-	else
+
+	if (GetInputPressed(action_voice))
 	{
-		g_IsTouch_main[mainkey_b] = false;
+		GetRandomNum(random_sound, 0, 2) == 0 ? PlaySE(SE_BABY) : PlaySE(SE_CAT);
 	}
 
-	if (GetKeyState('P') & 0x80)
+	if (GetInputPressed(action_menu))
 	{
-		if (!g_IsTouch_main[mainkey_p])
-		{
-			GetRandomNum(0, 2) == 0 ? PlaySE(SE_BABY) : PlaySE(SE_CAT);
-
-			g_IsTouch_main[mainkey_p] = true;
-		}
+		g_IsDispMenu = g_IsDispMenu ? false : true;
 	}
-	else
+
+	//デバッグ中なら全ステージの解を探す
+	if (GetInputPressed(action_solve) && g_IsDebug)
 	{
-		g_IsTouch_main[mainkey_p] = false;
+		SolveAllStages();
 	}
 
-	if (GetKeyState(VK_TAB) & 0x80)
+	//F5で記録を始める・止める。F6で再生、F7で早送り再生。再生中ならどちらも止める
+	if (GetInputPressed(action_record))
 	{
-		if (!g_IsTouch_main[mainkey_tab])
+		if (GetInputLogMode() == inputlog_record)
 		{
-			g_IsDispMenu = g_IsDispMenu ? false : true;
-
-			g_IsTouch_main[mainkey_tab] = true;
+			StopInputRecord(INPUTLOG_FILENAME);
+		}
+		else if (GetInputLogMode() == inputlog_none)
+		{
+			g_IsDispMenu = false;
+			StartInputRecord();
 		}
 	}
-	else
+
+	if (GetInputPressed(action_playback) || GetInputPressed(action_fastforward))
 	{
-		g_IsTouch_main[mainkey_tab] = false;
+		if (GetInputLogMode() == inputlog_play)
+		{
+			StopInputPlayback();
+		}
+		else if (GetInputLogMode() == inputlog_none)
+		{
+			g_IsDispMenu = false;
+			StartInputPlayback(INPUTLOG_FILENAME, GetInputPressed(action_fastforward));
+		}
 	}
 
-	CheckTime();//FPSがオーバーしていないか確認
+	//止めている間は回す回数も減らす
+	SetFrameRate(IsBackground ? REDRAW_BACKGROUNDRATE : g_IsDispMenu ? REDRAW_PAUSERATE : FRAME_RATE);
+
+	//早送り中は待たない
+	if (!GetIsInputLogFastForward())CheckTime();//FPSがオーバーしていないか確認
 }
 
 void DRAW()
 {
 	if (g_IsDispMenu)
 	{
+		//メニューは全部UI
+		BeginResolutionUI();
+
 		//背景
 		FaceGen(MakeFloat2(0, 0), MakeFloat2(0, 0), 0, 1, 1, false, 0, 'B', COLOR_BLACK);
 
@@ -177,21 +235,78 @@ void DRAW()
 		SceneDRAW();
 	}
 
-	SwapBuffers();// 画⾯バッファの切り替え
+	//デバッグなら入力してから画面に出るまでの時間を表示
+	if (g_IsDebug)
+	{
+		BeginResolutionUI();
+
+		const INPUTLATENCY* latency = GetInputLatency();
+		TextGen(MakeFloat2(-SCREEN_WIDTH / 2 + 32 * 10, -SCREEN_HEIGHT / 2 + 32), MakeFloat2(32, 32), NORMALCOLOR,
+			FormatScratch("in %dus max %dus", (int)latency->last, (int)latency->max));
+
+		//前のフレームでロード以外に確保した数
+		const ALLOCFRAME* alloc = GetAllocFrame();
+		TextGen(MakeFloat2(-SCREEN_WIDTH / 2 + 32 * 10, -SCREEN_HEIGHT / 2 + 64), MakeFloat2(32, 32), NORMALCOLOR,
+			FormatScratch("alloc %d %d %d", alloc->count[allocphase_update], alloc->count[allocphase_draw], alloc->count[allocphase_worker]));
+
+		//今のシーンとシーンに属さないものの量。KB
+		SCENE scene = GetCurrentScene();
+		const LEDGERBUDGET* budget = GetLedgerBudget(scene);
+		TextGen(MakeFloat2(-SCREEN_WIDTH / 2 + 32 * 10, -SCREEN_HEIGHT / 2 + 96), MakeFloat2(32, 32), NORMALCOLOR,
+			FormatScratch("gpu %d/%d cpu %d/%d shared %d %d",
+				(int)(GetLedgerSize(scene, ledger_texture) / 1024), (int)(budget->gpu / 1024),
+				(int)((GetLedgerSize(scene, ledger_buffer) + GetLedgerSize(scene, ledger_sound)) / 1024), (int)(budget->cpu / 1024),
+				(int)(GetLedgerSize(LEDGER_SHARED, ledger_texture) / 1024),
+				(int)((GetLedgerSize(LEDGER_SHARED, ledger_buffer) + GetLedgerSize(LEDGER_SHARED, ledger_sound)) / 1024)));
+
+		//内部解像度とGPUの時間
+		TextGen(MakeFloat2(-SCREEN_WIDTH / 2 + 32 * 10, -SCREEN_HEIGHT / 2 + 128), MakeFloat2(32, 32), NORMALCOLOR,
+			FormatScratch("res %d%% %dus", (int)(GetResolutionScale() * 100 + 0.5f), GetResolutionFrameTime()));
+
+		//前のフレームで塗った面積。画面1枚で100
+		const FACEGENFILL* fill = GetFaceGenFill();
+		TextGen(MakeFloat2(-SCREEN_WIDTH / 2 + 32 * 10, -SCREEN_HEIGHT / 2 + 160), MakeFloat2(32, 32), NORMALCOLOR,
+			FormatScratch("fill %d blend %d sw %d",
+				(int)(fill->opaqueArea * 100 / (SCREEN_WIDTH * SCREEN_HEIGHT)), (int)(fill->blendArea * 100 / (SCREEN_WIDTH * SCREEN_HEIGHT)), fill->blendSwitchNum));
+	}
+
+	PresentResolution();// 拡大して画⾯バッファの切り替え
+
+	InputPresent();
 }
 
 void UNINIT(void)
 {
+	//記録中に終わったら、そこまでを書いておく
+	StopInputRecord(INPUTLOG_FILENAME);
+
 	SceneUNINIT();
 
+	DiscardTexturePreload();
+
 	UninitController();
 
+	InputUNINIT();
+
+	ResolutionUNINIT();
+
 	FacegenUNINIT();
 
 	UninitSound();
 
 	UnloadTexture(g_MenuTex);
 
+	JobUNINIT();
+
+	const FRAMEHEAP* heap = GetThreadFrameHeap();
+	NN_LOG("FrameHeap: peak %dKB of %dKB, %d overflows\n", (int)(heap->peak / 1024), (int)(heap->size / 1024), heap->overflowNum);
+	NN_LOG("Redraw: %d frames drawn, %d skipped\n", GetRedrawNum(), GetRedrawSkipNum());
+	DestroyThreadFrameHeap();
+
+	LedgerReport();
+
+	AllocTrackReport();
+
 	exit(0);
 }
 
@@ -203,4 +318,24 @@ bool GetIsDebug(void)
 bool GetIsDispMenu(void)
 {
 	return g_IsDispMenu;
+}
+
+bool GetIsHeadless(void)
+{
+	return g_IsHeadless;
+}
+
+void SetIsHeadless(bool IsHeadless)
+{
+	g_IsHeadless = IsHeadless;
+}
+
+bool GetIsPresentationOff(void)
+{
+	return g_IsPresentationOff;
+}
+
+void SetIsPresentationOff(bool IsOff)
+{
+	g_IsPresentationOff = IsOff;
 }
\ No newline at end of file
@@ -11,5 +11,10 @@
 bool GetIsDebug(void);
 void UNINIT(void);
 bool GetIsDispMenu(void);
+bool GetIsHeadless(void);
+void SetIsHeadless(bool IsHeadless);
+//見た目と音だけ止める。クリアやゲームオーバーはいつもどおり。ソルバーはGetIsHeadlessを使う
+bool GetIsPresentationOff(void);
+void SetIsPresentationOff(bool IsOff);
 
 #endif // !MAIN_H_
\ No newline at end of file
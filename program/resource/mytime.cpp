@@ -1,21 +1,19 @@
 
 #include "mytime.h"
 
-// }N
-#define FRAME_RATE (60)
-
-// Ԍvp
+// 時間計測用
 DWORD dwExecLastTime;
 DWORD dwFPSLastTime;
 DWORD dwCurrentTime;
 DWORD dwFrameCount;
 float fCountFPS;
+int nFrameRate = FRAME_RATE;
 
 void InitTime(void)
 {
-	// t[JEg
-	timeBeginPeriod(1);					// \ݒ
-	dwExecLastTime = dwFPSLastTime = timeGetTime();	// VXe~bPʂŎ擾
+	// フレームカウント初期化
+	timeBeginPeriod(1);					// 分解能を設定
+	dwExecLastTime = dwFPSLastTime = timeGetTime();	// システム時刻をミリ秒単位で取得
 	dwCurrentTime = dwFrameCount = 0;
 }
 
@@ -23,7 +21,7 @@ void InitTime(void)
 
 void GetTime(void)
 {
-	dwCurrentTime = timeGetTime();		// VXe擾
+	dwCurrentTime = timeGetTime();		// システム時刻を取得
 }
 
 
@@ -31,26 +29,38 @@ void CheckTime(void)
 {
 	while (1)
 	{
-		//FPŠv
-		if (dwCurrentTime - dwFPSLastTime >= 500) // 500m/sɃ`FbNĂ
+		//FPSの計測
+		if (dwCurrentTime - dwFPSLastTime >= 500) // 500m/s毎にチェックしてる
 		{
 			fCountFPS = dwFrameCount * 1000.0f / (dwCurrentTime - dwFPSLastTime);
 			dwFPSLastTime = dwCurrentTime;
 			dwFrameCount = 0;
 		}
 
-		if ((dwCurrentTime - dwExecLastTime) >= (1000 / FRAME_RATE))	// 1/60bƂɎs
+		DWORD frameTime = 1000 / nFrameRate;
+		if ((dwCurrentTime - dwExecLastTime) >= frameTime)	// 1/60秒ごとに実行
 		{
-			dwExecLastTime = dwCurrentTime;	// ۑ
-			dwFrameCount++;		// 񐔂̃JEgZ
+			dwExecLastTime = dwCurrentTime;	// 処理した時刻を保存
+			dwFrameCount++;		// 処理回数のカウントを加算
 
 			break;
 		}
-		dwCurrentTime = timeGetTime();					// VXe擾
+
+		// 2ms以上あれば回し続けずに寝る。分解能は1msにしてある
+		if (frameTime - (dwCurrentTime - dwExecLastTime) >= 2)
+		{
+			Sleep(1);
+		}
+		dwCurrentTime = timeGetTime();					// システム時刻を取得
 	}
 }
 
-// FPS擾
+void SetFrameRate(int rate)
+{
+	nFrameRate = rate;
+}
+
+// FPS取得
 float GetFps(void)
 {
 	return fCountFPS;
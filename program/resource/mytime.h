@@ -3,8 +3,12 @@
 #include <Windows.h>
 #include <time.h>
 
+// マクロ
+#define FRAME_RATE (60)
+
 
 void InitTime(void);
 void GetTime(void);
 void CheckTime(void);
-float GetFps(void);	// t[JEg擾
+void SetFrameRate(int rate);	// CheckTimeで待つ間隔。ポーズ中などは下げる
+float GetFps(void);	// フレームカウント取得
@@ -1,22 +1,13 @@
 
 #include"main.h"
 #include"FaceGen.h"
-#include"controller.h"
-
-#define MAXMOUSELINE (3)
-#define MAXLINE (256)
-
-typedef struct
-{
-	Float2 pos;
-	bool IsUse;
-}MOUSELINE;
+#include"Input.h"
+#include"paint.h"
 
 void SetMouseLine(Float2 pos);
 void PaintINIT(void);
 
 static MOUSELINE g_MouseLine[MAXMOUSELINE][MAXLINE] = {};
-static bool g_IsTouch_paint;
 static bool g_IsFirstMouseLine[MAXMOUSELINE] = {};
 static bool g_IsMouseDown;
 static int g_LineNum;
@@ -24,7 +15,6 @@ static int g_LineNum;
 void PaintINIT(void)
 {
 	memset(g_MouseLine, 0, sizeof(g_MouseLine));
-	g_IsTouch_paint = false;
 	memset(g_IsFirstMouseLine, false, sizeof(g_IsFirstMouseLine));
 	g_IsMouseDown = false;
 	g_LineNum = 0;
@@ -32,28 +22,19 @@ void PaintINIT(void)
 
 void PaintUPDATE(void)
 {
-	if ((GetKeyState(VK_LCONTROL) & 0x80) && (GetKeyState('Z') & 0x80))
-	{
-		if (!g_IsTouch_paint)
-		{
-			memset(g_IsFirstMouseLine, 0, sizeof(g_IsFirstMouseLine));
-			memset(g_MouseLine, 0, sizeof(g_MouseLine));
-			g_IsMouseDown = false;
-			g_LineNum = 0;
-
-			g_IsTouch_paint = true;
-		}
-	}
-	else
+	if (GetInputPressed(action_paintclear))
 	{
-		g_IsTouch_paint = false;
+		memset(g_IsFirstMouseLine, 0, sizeof(g_IsFirstMouseLine));
+		memset(g_MouseLine, 0, sizeof(g_MouseLine));
+		g_IsMouseDown = false;
+		g_LineNum = 0;
 	}
 
 	if (g_LineNum < 3)
 	{
-		if (GetControllerTouchScreen())
+		if (GetInputDown(action_paint) && GetIsInputPointerIn())
 		{
-			SetMouseLine(GetControllerTouchScreenPosition());
+			SetMouseLine(GetInputPointer());
 			g_IsMouseDown = true;
 		}
 		else
@@ -106,4 +87,20 @@ void SetMouseLine(Float2 pos)
 
 		break;
 	}
+}
+
+void GetPaintState(PAINTSTATE* state)
+{
+	memcpy(state->MouseLine, g_MouseLine, sizeof(g_MouseLine));
+	memcpy(state->IsFirstMouseLine, g_IsFirstMouseLine, sizeof(g_IsFirstMouseLine));
+	state->IsMouseDown = g_IsMouseDown;
+	state->LineNum = g_LineNum;
+}
+
+void SetPaintState(const PAINTSTATE* state)
+{
+	memcpy(g_MouseLine, state->MouseLine, sizeof(g_MouseLine));
+	memcpy(g_IsFirstMouseLine, state->IsFirstMouseLine, sizeof(g_IsFirstMouseLine));
+	g_IsMouseDown = state->IsMouseDown;
+	g_LineNum = state->LineNum;
 }
\ No newline at end of file
@@ -1,11 +1,34 @@
 #ifndef PAINT_H_
 #define PAINT_H_
 
+#include"main.h"
+#include"Mytype.h"
+
+#define MAXMOUSELINE (3)
+#define MAXLINE (256)
+
+typedef struct
+{
+	Float2 pos;
+	bool IsUse;
+}MOUSELINE;
+
+//描いた線全部。リプレイ用
+typedef struct
+{
+	MOUSELINE MouseLine[MAXMOUSELINE][MAXLINE];
+	bool IsFirstMouseLine[MAXMOUSELINE];
+	bool IsMouseDown;
+	int LineNum;
+}PAINTSTATE;
+
 void PaintINIT(void);
 void PaintUPDATE(void);
 void PaintDRAW(void);
 void PaintUNINIT(void);
 
+void GetPaintState(PAINTSTATE* state);
+void SetPaintState(const PAINTSTATE* state);
 
 
 #endif
@@ -4,6 +4,9 @@
 #include"FaceGen.h"
 #include"Scene.h"
 #include"Ball.h"
+#include"Input.h"
+#include"FrameHeap.h"
+#include"Widget.h"
 
 #define COINSIZE (MakeFloat2(96,96))
 
@@ -11,11 +14,14 @@ static UINT g_resultTex;
 static UINT g_CoinTex;
 static UINT g_BottunDispTex;
 static UINT g_ResultTextTex;
-static bool g_IsTouch_result;
-static int g_coinCnt;
-static int g_coinFrame;
 static int g_CoinNum;
 static int g_Point;
+static WIDGETSCREEN g_UI;
+static int g_CoinWidget[3];
+static int g_RankWidget;
+static int g_CoinText;
+
+static void SetResultCoin(int coinNum);
 
 void ResultINIT(void)
 {
@@ -24,123 +30,61 @@ void ResultINIT(void)
 	g_BottunDispTex = LoadTexture("asset/DispKey.tga");
 	g_ResultTextTex = LoadTexture("asset/result_text.tga");
 
-	g_IsTouch_result = false;
-	g_coinCnt = 0;
-	g_coinFrame = 0;
 	g_CoinNum = 0;
 
-	GetCurrentStage();
-}
+	InitWidgetScreen(&g_UI);
 
-void ResultUPDATE(void)
-{
-	if (GetCurrentStage() > stage_4)
-	{
-		if (GetKeyState(VK_RETURN) & 0x80)
-		{
-			if (!g_IsTouch_result)
-			{
-				if (GetCurrentStage() <= stage_4)
-				{
-					CoinNumResetScene();
-					SetNextStage(scene_game);
-				}
-				else
-				{
-					CoinNumResetScene();
-					StageReset();
-					SetNextStage(scene_title);
-				}
-
-				g_IsTouch_result = true;
-			}
-		}
-		else
-		{
-			g_IsTouch_result = false;
-		}
-	}
-	else
+	//背景
+	AddImageWidget(&g_UI, MakeFloat2(0, 0), MakeFloat2(SCREEN_WIDTH, SCREEN_HEIGHT), g_resultTex, 0, 0, 1, 1, NORMALCOLOR);
+
+	//取得したコイン。取れていないものは止まった絵
+	SPRITEANIM anim = MakeSpriteAnim(0, 2, 31, 3, 1, animloop_loop, 0);
+	for (int i = 0; i < 3; i++)
 	{
-		if (GetKeyState(VK_SPACE) & 0x80)
-		{
-			if (!g_IsTouch_result)
-			{
-				if (GetCurrentStage() <= stage_4)
-				{
-					CoinNumResetScene();
-					SetNextStage(scene_game);
-				}
-				else
-				{
-					CoinNumResetScene();
-					StageReset();
-					SetNextStage(scene_title);
-				}
-
-				g_IsTouch_result = true;
-			}
-		}
-		else
-		{
-			g_IsTouch_result = false;
-		}
+		g_CoinWidget[i] = AddAnimWidget(&g_UI, MakeFloat2(-COINSIZE.x - COINSIZE.x / 2 + 96 * i + 32, 128), COINSIZE,
+			&anim, g_CoinTex, NORMALCOLOR);
+		SetWidgetFrame(&g_UI, g_CoinWidget[i], 2, 1);
 	}
 
+	//決定キー。最後のステージの後は別のキー
+	AddImageWidget(&g_UI, MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
+		g_BottunDispTex, 0, GetCurrentStage() <= stage_4 ? 0 : 1, 1, 4, NORMALCOLOR);
 
-	g_coinCnt++;
-	if (g_coinCnt > 30)
-	{
-		g_coinCnt = 0;
-		g_coinFrame++;
-	}
-	if (g_coinFrame >= 2)
-	{
-		g_coinFrame = 0;
-	}
+	//評価文字
+	g_RankWidget = AddImageWidget(&g_UI, MakeFloat2(0, -64), MakeFloat2(256, 256), g_ResultTextTex, 3, 1, 4, 1, NORMALCOLOR);
+
+	//取得したコインの数
+	g_CoinText = AddTextWidget(&g_UI, MakeFloat2(0, 128 + 96 + 16), MakeFloat2(64, 64), NORMALCOLOR, "");
+
+	SetResultCoin(GetCoinNumScene());
 }
 
-void ResultDRAW(void)
+void ResultUPDATE(void)
 {
-	//wi
-	FaceGen(MakeFloat2(0, 0), MakeFloat2(0, 0), 0, 1, 1, true, g_resultTex, 'B', NORMALCOLOR);
+	SetResultCoin(GetCoinNumScene());
 
-	//擾RC
-	for (int i = 0; i < 3; i++)
+	//最後のステージの後はEnter、それ以外はSpaceで進む
+	INPUTACTION action = GetCurrentStage() > stage_4 ? action_launch : action_place;
+
+	if (GetInputPressed(action))
 	{
-		if (i < GetCoinNumScene())
+		if (GetCurrentStage() <= stage_4)
 		{
-			FaceGenforTex(MakeFloat2(-COINSIZE.x - COINSIZE.x / 2 + 96 * i + 32, 128), COINSIZE,
-				g_coinFrame, 1, 3, 1, true, g_CoinTex, NORMALCOLOR);
+			CoinNumResetScene();
+			SetNextStage(scene_game);
 		}
 		else
 		{
-			FaceGenforTex(MakeFloat2(-COINSIZE.x - COINSIZE.x / 2 + 96 * i + 32, 128), COINSIZE,
-				2, 1, 3, 1, true, g_CoinTex, NORMALCOLOR);
+			CoinNumResetScene();
+			StageReset();
+			SetNextStage(scene_title);
 		}
 	}
+}
 
-	if (GetCurrentStage() <= stage_4)
-	{
-		//L[
-		FaceGenforTex(MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
-			0, 0, 1, 4, true, g_BottunDispTex, MakeFloat4(1, 1, 1, 1));
-	}
-	else
-	{
-		//L[
-		FaceGenforTex(MakeFloat2(0, SCREEN_HEIGHT / 2 - ((1024 / 3) / 3) / 2), MakeFloat2(1024, (1024 / 3) / 3),
-			0, 1, 1, 4, true, g_BottunDispTex, MakeFloat4(1, 1, 1, 1));
-	}
-
-	//]
-	FaceGenforTex(MakeFloat2(0,-64), MakeFloat2(256,256),
-		3 - GetCoinNumScene(), 1, 4, 1, true, g_ResultTextTex, NORMALCOLOR);
-
-	//擾RC̐
-	char alpha[32] = {};
-	sprintf(alpha, "%d / 3",GetCoinNumScene());
-	TextGen(MakeFloat2(0, 128 + 96 + 16), MakeFloat2(64, 64), NORMALCOLOR, alpha);
+void ResultDRAW(void)
+{
+	DrawWidgetScreen(&g_UI);
 }
 
 void ResultUNINIT(void)
@@ -155,3 +99,15 @@ void ResultUNINIT(void)
 	g_BottunDispTex = NULL;
 	g_ResultTextTex = NULL;
 }
+
+
+//コインの数が変わった時だけ作り直される
+static void SetResultCoin(int coinNum)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		SetWidgetAnim(&g_UI, g_CoinWidget[i], i < coinNum);
+	}
+	SetWidgetFrame(&g_UI, g_RankWidget, 3 - coinNum, 1);
+	SetWidgetText(&g_UI, g_CoinText, FormatScratch("%d / 3", coinNum));
+}
\ No newline at end of file
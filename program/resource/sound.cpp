@@ -4,6 +4,8 @@
 
 #include "main.h"
 #include "sound.h"
+#include "FrameHeap.h"
+#include "MemoryLedger.h"
 
 #pragma comment(lib, "dsound.lib")
 #pragma comment(lib, "dxguid.lib")
@@ -174,6 +176,7 @@ void UninitSound()
 	{
 		pDSB_bgm->Release();
 		pDSB_bgm = NULL;
+		UnregisterLedger(ledger_sound, (uintptr_t)&pDSB_bgm);
 	}
 
 	for (int i = 0; i < SE_CH_NUM; i++)
@@ -182,6 +185,7 @@ void UninitSound()
 		{
 			pDSB_se[i]->Release();
 			pDSB_se[i] = NULL;
+			UnregisterLedger(ledger_sound, (uintptr_t)&pDSB_se[i]);
 		}
 	}
 
@@ -278,10 +282,12 @@ void PlaySnd(int ch, const char* filename)
 		return;
 	}
 
-	char* pData = new char[dataChunk.cksize];
+	//DirectSoundのバッファに写したら要らないのでスクラッチに置く
+	FRAMEHEAPSTATE state = GetScratchState();
+	char* pData = (char*)AllocScratch(dataChunk.cksize);
 	size = mmioRead(hMmio, (HPSTR)pData, dataChunk.cksize);
 	if (size != dataChunk.cksize) {
-		delete[] pData;
+		RestoreScratch(&state);
 		return;
 	}
 
@@ -310,14 +316,20 @@ void PlaySnd(int ch, const char* filename)
 	ptmpBuf->QueryInterface(IID_IDirectSoundBuffer8, (void**)ppDSB);
 	ptmpBuf->Release();
 
+	//チャンネルごとに作り直すので、どのシーンにも入れない
+	int ledgerScene = GetLedgerScene();
+	SetLedgerScene(LEDGER_SHARED);
+	RegisterLedger(ledger_sound, (uintptr_t)ppDSB, dataChunk.cksize, __FILE__, filename);
+	SetLedgerScene(ledgerScene);
+
 	// セカンダリバッファにWaveデータ書き込み
 	LPVOID lpvWrite = 0;
 	DWORD dwLength = 0;
 	if (DS_OK == (*ppDSB)->Lock(0, 0, &lpvWrite, &dwLength, NULL, NULL, DSBLOCK_ENTIREBUFFER)) {
 		memcpy(lpvWrite, pData, dwLength);
 		(*ppDSB)->Unlock(lpvWrite, dwLength, NULL, 0);
-		delete[] pData;
 	}
+	RestoreScratch(&state);
 
 	pDS8->SetCooperativeLevel(GetForegroundWindow(), DSSCL_NORMAL);
 	hr = (*ppDSB)->Play(0, 0, ch == SND_CH_BGM);
@@ -352,5 +364,8 @@ void PlaySE(nn::atk::SoundArchive::ItemId soundId)
 {
 	//g_SoundArchivePlayer.StartSound(&g_SoundHandleSE, soundId);
 
+	//ソルバーのスレッドと早送り中は鳴らさない
+	if (GetIsHeadless() || GetIsPresentationOff()) return;
+
 	PlaySnd(SND_CH_SE, (const char*)soundId);
 }
@@ -7,55 +7,118 @@ char* g_CacheBuffer = NULL;
 
 GraphicsHelper g_GraphicsHelper;
 
-GLuint g_VertexShaderId;
-GLuint g_FragmentShaderId;
-GLuint g_ShaderProgramId;
+//シェーダーの組み合わせ。ソースは同じで、頭に付けるdefineで分ける
+typedef struct
+{
+	const char* define;
+	GLuint vertexShader;
+	GLuint fragmentShader;
+	GLuint program;
+	GLint uProjection;//毎回探さないように作った時に覚えておく
+	GLint uSampler;
+	GLint uTime;
+}SHADERPROGRAM;
+
+static SHADERPROGRAM g_ShaderProgram[SHADERVARIANTMAX] =
+{
+	{ "" },
+	{ "#define TEXTURED\n" },
+	{ "#define TEXTURED\n#define ANIM\n" },
+};
+static int g_CurrentVariant = SHADERVARIANTMAX;//今使っているもの。SHADERVARIANTMAXならわからない
+
+static GLuint CreateShader(GLenum type, const char* define, const char* source);
 
 
 
 
 GLuint GetShaderProgramId()
 {
-	return g_ShaderProgramId;
+	return g_CurrentVariant < SHADERVARIANTMAX ? g_ShaderProgram[g_CurrentVariant].program : 0;
 }
 
+void UseShaderProgram(SHADERVARIANT variant)
+{
+	if (g_CurrentVariant == variant)return;
 
-const char* VertexShaderSource =
+	glUseProgram(g_ShaderProgram[variant].program);
+	g_CurrentVariant = variant;
+}
+
+void ResetShaderProgram(void)
+{
+	g_CurrentVariant = SHADERVARIANTMAX;
+}
+
+void SetShaderTime(float time)
+{
+	UseShaderProgram(shader_anim);
+	glUniform1f(g_ShaderProgram[shader_anim].uTime, time);
+}
+
+
+static const char* ShaderVersionSource =
 "#version 330\n"
-"precision highp float;\n"
+"precision highp float;\n";
 
+const char* VertexShaderSource =
 "uniform mat4 uProjection;\n"
 
-"layout( location = 0 ) in vec3 inPosition;\n"
+"layout( location = 0 ) in vec2 inPosition;\n"//1/VERTEX_POSITIONSCALEドット単位
 "layout( location = 1 ) in vec4 inColor;\n"
-"layout( location = 2 ) in vec2 inTexCoord;\n"
 
 "out vec4 vColor;\n"
+
+"#ifdef TEXTURED\n"
+"layout( location = 2 ) in vec2 inTexCoord;\n"
 "out vec2 vTexCoord;\n"
+"#endif\n"
+
+"#ifdef ANIM\n"
+"uniform float uTime;\n"//アニメーションのtick
+"layout( location = 3 ) in float inStartTick;\n"
+"layout( location = 4 ) in vec4 inAnim;\n"//コマ数, 1コマのtick, 1回だけなら1
+"layout( location = 5 ) in vec4 inSheet;\n"//シートの横の分割数, 縦の分割数, 最初のコマ
+"#endif\n"
 
 "void main() {\n"
 "    vColor = inColor;\n"
+"#ifdef ANIM\n"
+//アニメーションしないものはコマ数1なのでずっと最初のコマ
+//割り算の誤差でコマの境目がずれないように0.5足してから切り捨てる
+"    float frame = floor((max(uTime - inStartTick, 0.0) + 0.5) / inAnim.y);\n"
+"    if(inAnim.z > 0.5)\n"
+"        frame = min(frame, inAnim.x - 1.0);\n"
+"    else\n"
+"        frame -= floor((frame + 0.5) / inAnim.x) * inAnim.x;\n"
+"    frame += inSheet.z;\n"
+"    float row = floor((frame + 0.5) / inSheet.x);\n"
+"    vTexCoord = (vec2(frame - row * inSheet.x, row) + inTexCoord) / inSheet.xy;\n"
+"#elif defined(TEXTURED)\n"
 "    vTexCoord = inTexCoord;\n"
-"    gl_Position = vec4(inPosition, 1.0) * uProjection;\n"
+"#endif\n"
+"    gl_Position = vec4(inPosition * 0.25, 0.0, 1.0) * uProjection;\n"
 "}\n";
 
 const char* FragmentShaderSource =
-"#version 330\n"
-"precision highp float;\n"
-
 "uniform sampler2D uSampler;\n"
-"uniform bool uTextureEnable;\n"
 
 "in vec4 vColor;\n"
+"#ifdef TEXTURED\n"
 "in vec2 vTexCoord;\n"
+"#endif\n"
 
 "out vec4 outColor;\n"
 
 "void main() {\n"
-"    if(uTextureEnable)\n"
-"		outColor = vColor * texture(uSampler, vTexCoord);\n"
-"    else\n"
-"		outColor = vColor;\n"
+"#ifdef TEXTURED\n"
+"    outColor = vColor * texture(uSampler, vTexCoord);\n"
+"#else\n"
+"    outColor = vColor;\n"
+"#endif\n"
+//透明な所は書かない。抜きのあるスプライトが読み書きする所を減らす
+"    if(outColor.a <= 0.0)\n"
+"		discard;\n"
 "}\n";
 
 
@@ -81,7 +144,7 @@ void GL_APIENTRY DebugCallbackFunc(GLenum source, GLenum type, GLuint id, GLenum
 void InitSystem()
 {
 	/*
-		// t@CVXe}Eg
+		// ファイルシステムマウント
 		{
 			nn::Result result;
 			size_t cacheSize = 0;
@@ -101,7 +164,7 @@ void InitSystem()
 	*/
 
 
-	// OpenGL
+	// OpenGL初期化
 	{
 		g_GraphicsHelper.Initialize();
 
@@ -120,54 +183,55 @@ void InitSystem()
 
 
 
-	// VF[_
+	// シェーダ初期化
 	{
-		GLint result;
-		GLchar shaderLog[1024];
-		GLsizei shaderLogSize;
-
-		g_VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-		NN_ASSERT(g_VertexShaderId != 0, "Failed to create vertex shader\n");
-		glShaderSource(g_VertexShaderId, 1, &VertexShaderSource, 0);
-		glCompileShader(g_VertexShaderId);
-		glGetShaderiv(g_VertexShaderId, GL_COMPILE_STATUS, &result);
-		if (!result)
-		{
-			glGetShaderInfoLog(g_VertexShaderId, sizeof(shaderLog), &shaderLogSize, shaderLog);
-			NN_ASSERT(false, "Failed to compile vertex shader: %s\n", shaderLog);
-		}
+		Matrix4x4f projection;
+		projection = Matrix4x4f::OrthographicRightHanded(SCREEN_WIDTH, -SCREEN_HEIGHT, 0.0f, 1.0f);
+
+		Float4x4 fprojection;
+		MatrixStore(&fprojection, projection);
 
-		g_FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-		NN_ASSERT(g_FragmentShaderId != 0, "Failed to create fragment shader\n");
-		glShaderSource(g_FragmentShaderId, 1, &FragmentShaderSource, 0);
-		glCompileShader(g_FragmentShaderId);
-		glGetShaderiv(g_FragmentShaderId, GL_COMPILE_STATUS, &result);
-		if (!result)
+		for (int i = 0; i < SHADERVARIANTMAX; i++)
 		{
-			glGetShaderInfoLog(g_FragmentShaderId, sizeof(shaderLog), &shaderLogSize, shaderLog);
-			NN_ASSERT(false, "Failed to compile fragment shader: %s\n", shaderLog);
-		}
+			SHADERPROGRAM* shader = &g_ShaderProgram[i];
+			GLint result;
+			GLchar shaderLog[1024];
+			GLsizei shaderLogSize;
+
+			shader->vertexShader = CreateShader(GL_VERTEX_SHADER, shader->define, VertexShaderSource);
+			shader->fragmentShader = CreateShader(GL_FRAGMENT_SHADER, shader->define, FragmentShaderSource);
+
+			shader->program = glCreateProgram();
+			NN_ASSERT(shader->program != 0, "Failed to create shader program\n");
+
+			glAttachShader(shader->program, shader->vertexShader);
+			glAttachShader(shader->program, shader->fragmentShader);
+			glLinkProgram(shader->program);
+			glGetProgramiv(shader->program, GL_LINK_STATUS, &result);
+			if (!result)
+			{
+				glGetProgramInfoLog(shader->program, sizeof(shaderLog), &shaderLogSize, shaderLog);
+				NN_ASSERT(false, "Failed to link shader program: %s\n", shaderLog);
+			}
 
-		g_ShaderProgramId = glCreateProgram();
-		NN_ASSERT(g_ShaderProgramId != 0, "Failed to create shader program\n");
+			shader->uProjection = glGetUniformLocation(shader->program, "uProjection");
+			shader->uSampler = glGetUniformLocation(shader->program, "uSampler");
+			shader->uTime = glGetUniformLocation(shader->program, "uTime");
 
-		glAttachShader(g_ShaderProgramId, g_VertexShaderId);
-		glAttachShader(g_ShaderProgramId, g_FragmentShaderId);
-		glLinkProgram(g_ShaderProgramId);
-		glUseProgram(g_ShaderProgramId);
+			glUseProgram(shader->program);
+			glUniformMatrix4fv(shader->uProjection, 1, GL_TRUE, (float*)&fprojection);
+			if (shader->uSampler >= 0)glUniform1i(shader->uSampler, 0);
+			if (shader->uTime >= 0)glUniform1f(shader->uTime, 0.0f);
+		}
+		g_CurrentVariant = SHADERVARIANTMAX;
+		UseShaderProgram(shader_textured);
 
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
 		glEnableVertexAttribArray(2);
 
-		Matrix4x4f projection;
-		projection = Matrix4x4f::OrthographicRightHanded(SCREEN_WIDTH, -SCREEN_HEIGHT, 0.0f, 1.0f);
-
-		Float4x4 fprojection;
-		MatrixStore(&fprojection, projection);
-		glUniformMatrix4fv(glGetUniformLocation(g_ShaderProgramId, "uProjection"), 1, GL_TRUE, (float*)&fprojection);
-
+		//3～5はアニメーションする時だけ配列を使う
 	}
 
 }
@@ -179,20 +243,26 @@ void UninitSystem()
 {
 
 
-	glDetachShader(g_ShaderProgramId, g_VertexShaderId);
-	glDetachShader(g_ShaderProgramId, g_FragmentShaderId);
+	for (int i = 0; i < SHADERVARIANTMAX; i++)
+	{
+		SHADERPROGRAM* shader = &g_ShaderProgram[i];
 
-	glDeleteShader(g_VertexShaderId);
-	glDeleteShader(g_FragmentShaderId);
+		glDetachShader(shader->program, shader->vertexShader);
+		glDetachShader(shader->program, shader->fragmentShader);
 
-	glDeleteProgram(g_ShaderProgramId);
+		glDeleteShader(shader->vertexShader);
+		glDeleteShader(shader->fragmentShader);
+
+		glDeleteProgram(shader->program);
+	}
+	g_CurrentVariant = SHADERVARIANTMAX;
 
 
 
 	g_GraphicsHelper.Finalize();
 
 
-	// t@CVXeA}Eg
+	// ファイルシステムアンマウント
 	{
 		nn::fs::Unmount("rom");
 
@@ -210,3 +280,24 @@ void SwapBuffers()
 }
 
 
+//#versionの後にdefineを入れてから作る
+static GLuint CreateShader(GLenum type, const char* define, const char* source)
+{
+	GLint result;
+	GLchar shaderLog[1024];
+	GLsizei shaderLogSize;
+
+	GLuint shader = glCreateShader(type);
+	NN_ASSERT(shader != 0, "Failed to create shader\n");
+
+	const char* sources[3] = { ShaderVersionSource, define, source };
+	glShaderSource(shader, 3, sources, 0);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+	if (!result)
+	{
+		glGetShaderInfoLog(shader, sizeof(shaderLog), &shaderLogSize, shaderLog);
+		NN_ASSERT(false, "Failed to compile %s shader (%s): %s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", define, shaderLog);
+	}
+	return shader;
+}
@@ -32,7 +32,25 @@ using namespace nn::util;
 
 
 
+#define VERTEX_POSITIONSCALE (4)	//頂点の位置は1/4ドット単位の整数。シェーダーで0.25を掛けて戻す
+
+//コンパイルする時に選んでおくシェーダーの組み合わせ
+enum SHADERVARIANT
+{
+	shader_untextured,	//色だけ
+	shader_textured,
+	shader_anim,		//シートのコマを頂点シェーダーで決める。テクスチャあり
+	SHADERVARIANTMAX,
+};
+
+//今使っているプログラム
 GLuint GetShaderProgramId();
+//プログラムを変える。今と同じなら何もしない
+void UseShaderProgram(SHADERVARIANT variant);
+//他のプログラムをglUseProgramした後に呼ぶ。次のUseShaderProgramで必ず変える
+void ResetShaderProgram(void);
+//アニメーションのtick
+void SetShaderTime(float time);
 
 void InitSystem();
 void UninitSystem();
@@ -1,7 +1,199 @@
 
 #include "main.h"
+#include "texture.h"
+#include "Job.h"
+#include "FrameHeap.h"
+#include "MemoryLedger.h"
 
-unsigned int LoadTexture(const char *FileName)
+#define TEXTURE_PRELOADMAX (32)
+#define TEXTURE_NAMEMAX (64)
+#define TEXTURE_PRELOADOWNER "preload"	//使う所に渡すまでの持ち主
+
+typedef struct
+{
+	const char* const* FileName;
+	TEXTUREIMAGE* image;
+	bool* IsDecoded;
+}TEXTUREBATCH;
+
+enum TEXTUREPRELOADSTATE
+{
+	texpreload_empty,
+	texpreload_decoding,	//ワーカーが読んでいる。終わったかはcounterで見る
+	texpreload_ready,		//テクスチャまで作ってある
+};
+
+//先読みしたテクスチャ。LoadTextureで同じ名前が来たら渡す
+typedef struct
+{
+	char FileName[TEXTURE_NAMEMAX];
+	TEXTUREPRELOADSTATE state;//メインスレッドだけが書く
+	JOBCOUNTER counter;
+	bool IsDecoded;
+	TEXTUREIMAGE image;
+	unsigned int texture;
+}TEXTUREPRELOAD;
+
+static void DecodeTextureJob(int begin, int end, void* argument);
+static void DecodePreloadJob(void* argument);
+static int FindPreload(const char* FileName);
+static unsigned int TakePreload(int n, const char* Owner);
+static void DiscardPreload(int n);
+static void ScanTextureOpacity(TEXTUREIMAGE* Image);
+
+static TEXTUREPRELOAD g_Preload[TEXTURE_PRELOADMAX];
+static int g_LoadNum;
+static int g_PreloadHitNum;
+static unsigned char g_TextureOpacity[TEXTURE_OPACITYMAX][TEXTURE_OPACITYGRID * TEXTURE_OPACITYGRID];//テクスチャの番号ごと。0は半透明
+
+unsigned int LoadTextureFrom(const char *FileName, const char* Owner)
+{
+	g_LoadNum++;
+
+	int n = FindPreload(FileName);
+	if (n >= 0)
+	{
+		return TakePreload(n, Owner);
+	}
+
+	//画像はGLに渡したら要らないのでスクラッチに置く
+	FRAMEHEAPSTATE state = GetScratchState();
+
+	TEXTUREIMAGE image;
+	unsigned int texture = DecodeTexture(FileName, &image, true) ? UploadTexture(&image, FileName, Owner) : -1;
+
+	RestoreScratch(&state);
+
+	return texture;
+}
+
+void LoadTexturesFrom(const char* const* FileName, unsigned int* Texture, int num, const char* Owner)
+{
+	FRAMEHEAPSTATE state = GetScratchState();
+
+	TEXTUREIMAGE* image = (TEXTUREIMAGE*)AllocScratch(sizeof(TEXTUREIMAGE) * num);
+	bool* IsDecoded = (bool*)AllocScratch(sizeof(bool) * num);
+	const char** missName = (const char**)AllocScratch(sizeof(const char*) * num);
+	int* missIndex = (int*)AllocScratch(sizeof(int) * num);
+	int missNum = 0;
+
+	//先読みしてあるものはそのまま使う
+	for (int i = 0; i < num; i++)
+	{
+		g_LoadNum++;
+
+		int n = FindPreload(FileName[i]);
+		if (n >= 0)
+		{
+			Texture[i] = TakePreload(n, Owner);
+			continue;
+		}
+		missName[missNum] = FileName[i];
+		missIndex[missNum] = i;
+		missNum++;
+	}
+
+	//ファイルの読み込みとR<->Bはワーカーで、GLはこのスレッドで
+	TEXTUREBATCH batch;
+	batch.FileName = missName;
+	batch.image = image;
+	batch.IsDecoded = IsDecoded;
+	ParallelFor(missNum, 1, DecodeTextureJob, &batch);
+
+	for (int i = 0; i < missNum; i++)
+	{
+		Texture[missIndex[i]] = IsDecoded[i] ? UploadTexture(&image[i], missName[i], Owner) : -1;
+	}
+
+	RestoreScratch(&state);
+}
+
+void PreloadTextures(const char* const* FileName, int num)
+{
+	//もう要らないものを捨てる
+	for (int i = 0; i < TEXTURE_PRELOADMAX; i++)
+	{
+		if (g_Preload[i].state == texpreload_empty)continue;
+
+		bool IsUse = false;
+		for (int k = 0; k < num; k++)
+		{
+			if (strcmp(g_Preload[i].FileName, FileName[k]) == 0)IsUse = true;
+		}
+		if (!IsUse)DiscardPreload(i);
+	}
+
+	for (int i = 0; i < num; i++)
+	{
+		if (FindPreload(FileName[i]) >= 0)continue;
+
+		if (strlen(FileName[i]) >= TEXTURE_NAMEMAX)
+		{
+			NN_LOG("PreloadTextures: %s is too long\n", FileName[i]);
+			continue;
+		}
+
+		int slot = -1;
+		for (int k = 0; k < TEXTURE_PRELOADMAX && slot < 0; k++)
+		{
+			if (g_Preload[k].state == texpreload_empty)slot = k;
+		}
+		if (slot < 0)
+		{
+			NN_LOG("PreloadTextures: no free slot for %s\n", FileName[i]);
+			return;
+		}
+
+		TEXTUREPRELOAD* preload = &g_Preload[slot];
+		strcpy(preload->FileName, FileName[i]);
+		preload->state = texpreload_decoding;
+		preload->IsDecoded = false;
+		InitializeJobCounter(&preload->counter);
+
+		JOB job;
+		job.function = DecodePreloadJob;
+		job.argument = preload;
+		RunJobs(&job, 1, &preload->counter);
+	}
+}
+
+int UpdateTexturePreload(int num)
+{
+	int pendingNum = 0;
+
+	for (int i = 0; i < TEXTURE_PRELOADMAX; i++)
+	{
+		TEXTUREPRELOAD* preload = &g_Preload[i];
+		if (preload->state != texpreload_decoding)continue;
+
+		if (num <= 0 || !TryWaitJobCounter(&preload->counter))
+		{
+			pendingNum++;
+			continue;
+		}
+
+		preload->texture = preload->IsDecoded ? UploadTexture(&preload->image, preload->FileName, TEXTURE_PRELOADOWNER) : -1;
+		preload->state = texpreload_ready;
+		num--;
+	}
+	return pendingNum;
+}
+
+void DiscardTexturePreload(void)
+{
+	for (int i = 0; i < TEXTURE_PRELOADMAX; i++)
+	{
+		DiscardPreload(i);
+	}
+}
+
+void GetTextureLoadCount(int* loadNum, int* preloadNum)
+{
+	*loadNum = g_LoadNum;
+	*preloadNum = g_PreloadHitNum;
+}
+
+bool DecodeTexture(const char *FileName, TEXTUREIMAGE* Image, bool IsScratch)
 {
 /*
 	nn::Result result;
@@ -18,10 +210,9 @@ unsigned int LoadTexture(const char *FileName)
 	file = fopen(FileName, "rb");
 	if (file == NULL)
 	{
-		return -1;
+		return false;
 	}
 
-	unsigned int	texture;
 	unsigned char	header[18];
 	unsigned char	*image;
 	unsigned int	width, height;
@@ -30,11 +221,11 @@ unsigned int LoadTexture(const char *FileName)
 	unsigned int	format;
 
 
-	// wb_ǂݍ
+	// ヘッダ読み込み
 	//nn::fs::ReadFile(&readSize, file, 0, header, sizeof(header));
 	fread(header, sizeof(header), 1, file);
 
-	// 摜TCY擾
+	// 画像サイズ取得
 	width = header[13] * 256 + header[12];
 	height = header[15] * 256 + header[14];
 	depth = header[16];
@@ -56,10 +247,10 @@ unsigned int LoadTexture(const char *FileName)
 	}
 
 
-	// m
-	image = (unsigned char*)new unsigned char[width * height * bpp];
+	// メモリ確保
+	image = IsScratch ? (unsigned char*)AllocScratch(width * height * bpp) : new unsigned char[width * height * bpp];
 
-	// 摜ǂݍ
+	// 画像読み込み
 	//nn::fs::ReadFile(&readSize, file, sizeof(header), image, width * height * bpp);
 	fread(image, width * height * bpp, 1, file);
 
@@ -78,8 +269,22 @@ unsigned int LoadTexture(const char *FileName)
 	//nn::fs::CloseFile(file);
 	fclose(file);
 
+	Image->image = image;
+	Image->width = width;
+	Image->height = height;
+	Image->format = format;
+	Image->IsScratch = IsScratch;
+
+	ScanTextureOpacity(Image);
+
+	return true;
+}
+
+unsigned int UploadTexture(TEXTUREIMAGE* Image, const char* Name, const char* Owner)
+{
+	unsigned int	texture;
 
-	// eNX`
+	// テクスチャ生成
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture);
 
@@ -87,16 +292,24 @@ unsigned int LoadTexture(const char *FileName)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+	glTexImage2D(GL_TEXTURE_2D, 0, Image->format, Image->width, Image->height, 0, Image->format, GL_UNSIGNED_BYTE, Image->image);
 
-	// ~bv}bv
+	// ミップマップ
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	//glGenerateMipmap(GL_TEXTURE_2D);
 
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	delete image;
+	RegisterLedger(ledger_texture, texture, Image->width * Image->height * (Image->format == GL_RGBA ? 4 : 3), Owner, Name);
+
+	if (texture < TEXTURE_OPACITYMAX)
+	{
+		memcpy(g_TextureOpacity[texture], Image->opacity, sizeof(Image->opacity));
+	}
+
+	if (!Image->IsScratch)delete[] Image->image;
+	Image->image = NULL;
 
 	return texture;
 }
@@ -106,19 +319,153 @@ void UnloadTexture(unsigned int Texture)
 
 	glDeleteTextures(1, &Texture);
 
+	UnregisterLedger(ledger_texture, Texture);
+
+	//同じ番号で次に作られるものに残さない
+	if (Texture < TEXTURE_OPACITYMAX)
+	{
+		memset(g_TextureOpacity[Texture], texopacity_translucent, sizeof(g_TextureOpacity[Texture]));
+	}
 }
 
 void SetTexture(unsigned int Texture)
 {
-	if (Texture == 0)
+	if (Texture != 0)glBindTexture(GL_TEXTURE_2D, Texture);
+}
+
+TEXOPACITY GetTextureOpacity(unsigned int Texture, float u0, float v0, float u1, float v1)
+{
+	if (Texture == 0 || Texture >= TEXTURE_OPACITYMAX)return texopacity_translucent;
+
+	//向きを変えて描く時は逆になっている
+	if (u0 > u1) { float u = u0; u0 = u1; u1 = u; }
+	if (v0 > v1) { float v = v0; v0 = v1; v1 = v; }
+
+	//繰り返しているUVは全部を見る
+	if (u0 < 0.0f || u1 > 1.0f) { u0 = 0.0f; u1 = 1.0f; }
+	if (v0 < 0.0f || v1 > 1.0f) { v0 = 0.0f; v1 = 1.0f; }
+
+	int x0 = (int)(u0 * TEXTURE_OPACITYGRID);
+	int y0 = (int)(v0 * TEXTURE_OPACITYGRID);
+	int x1 = (int)ceilf(u1 * TEXTURE_OPACITYGRID);
+	int y1 = (int)ceilf(v1 * TEXTURE_OPACITYGRID);
+	if (x1 <= x0)x1 = x0 + 1;
+	if (y1 <= y0)y1 = y0 + 1;
+	if (x1 > TEXTURE_OPACITYGRID)x1 = TEXTURE_OPACITYGRID;
+	if (y1 > TEXTURE_OPACITYGRID)y1 = TEXTURE_OPACITYGRID;
+	if (x0 >= x1)x0 = x1 - 1;
+	if (y0 >= y1)y0 = y1 - 1;
+
+	unsigned char opacity = texopacity_opaque;
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			unsigned char cell = g_TextureOpacity[Texture][y * TEXTURE_OPACITYGRID + x];
+			if (cell < opacity)opacity = cell;
+		}
+	}
+	return (TEXOPACITY)opacity;
+}
+
+void SetTextureOpacity(unsigned int Texture, TEXOPACITY opacity)
+{
+	if (Texture >= TEXTURE_OPACITYMAX)return;
+
+	memset(g_TextureOpacity[Texture], opacity, sizeof(g_TextureOpacity[Texture]));
+}
+
+//分けた所ごとに一番厳しいアルファを探す。アルファのない画像は全部不透明
+static void ScanTextureOpacity(TEXTUREIMAGE* Image)
+{
+	memset(Image->opacity, texopacity_opaque, sizeof(Image->opacity));
+	if (Image->format != GL_RGBA)return;
+
+	for (unsigned int y = 0; y < Image->height; y++)
+	{
+		unsigned char* cellRow = &Image->opacity[(y * TEXTURE_OPACITYGRID / Image->height) * TEXTURE_OPACITYGRID];
+		const unsigned char* pixel = &Image->image[y * Image->width * 4];
+
+		for (unsigned int x = 0; x < Image->width; x++, pixel += 4)
+		{
+			unsigned char alpha = pixel[3];
+			if (alpha == 255)continue;
+
+			unsigned char* cell = &cellRow[x * TEXTURE_OPACITYGRID / Image->width];
+			if (alpha == 0)
+			{
+				if (*cell > texopacity_cutout)*cell = texopacity_cutout;
+			}
+			else
+			{
+				*cell = texopacity_translucent;
+			}
+		}
+	}
+}
+
+static void DecodeTextureJob(int begin, int end, void* argument)
+{
+	TEXTUREBATCH* batch = (TEXTUREBATCH*)argument;
+
+	for (int i = begin; i < end; i++)
 	{
-		glUniform1i(glGetUniformLocation(GetShaderProgramId(), "uTextureEnable"), 0);
+		//ワーカーのスクラッチはジョブが終わると戻るので、ヒープに置く
+		batch->IsDecoded[i] = DecodeTexture(batch->FileName[i], &batch->image[i], false);
+	}
+}
+
+static void DecodePreloadJob(void* argument)
+{
+	TEXTUREPRELOAD* preload = (TEXTUREPRELOAD*)argument;
+
+	preload->IsDecoded = DecodeTexture(preload->FileName, &preload->image, false);
+}
+
+static int FindPreload(const char* FileName)
+{
+	for (int i = 0; i < TEXTURE_PRELOADMAX; i++)
+	{
+		if (g_Preload[i].state != texpreload_empty && strcmp(g_Preload[i].FileName, FileName) == 0)return i;
+	}
+	return -1;
+}
+
+//先読みしたテクスチャを渡して場所を空ける。読み終わっていなければ待つ
+static unsigned int TakePreload(int n, const char* Owner)
+{
+	TEXTUREPRELOAD* preload = &g_Preload[n];
+
+	if (preload->state == texpreload_decoding)
+	{
+		WaitJobCounter(&preload->counter);
+		preload->texture = preload->IsDecoded ? UploadTexture(&preload->image, preload->FileName, Owner) : -1;
 	}
 	else
 	{
-		glUniform1i(glGetUniformLocation(GetShaderProgramId(), "uTextureEnable"), 1);
-		glBindTexture(GL_TEXTURE_2D, Texture);
+		//先読みの持ち主から、今読んでいるシーンに移す
+		SetLedgerOwner(ledger_texture, preload->texture, Owner);
 	}
+
+	preload->state = texpreload_empty;
+	g_PreloadHitNum++;
+
+	return preload->texture;
 }
 
+static void DiscardPreload(int n)
+{
+	TEXTUREPRELOAD* preload = &g_Preload[n];
+
+	if (preload->state == texpreload_decoding)
+	{
+		WaitJobCounter(&preload->counter);
+		if (preload->IsDecoded)delete[] preload->image.image;
+	}
+	else if (preload->state == texpreload_ready && preload->texture != (unsigned int)-1)
+	{
+		UnloadTexture(preload->texture);
+	}
 
+	preload->state = texpreload_empty;
+}
\ No newline at end of file
@@ -1,7 +1,52 @@
 #pragma once
 
-unsigned int LoadTexture(const char *FileName);
+#define TEXTURE_OPACITYGRID (8)	//透明度を調べる時のテクスチャの縦横の分割数
+#define TEXTURE_OPACITYMAX (512)	//透明度を覚えておくテクスチャの番号の上限
+
+//テクスチャの透明度。小さい方が厳しい。範囲をまとめる時は一番小さいものになる
+enum TEXOPACITY
+{
+	texopacity_translucent,	//半透明がある。わからない時もこれ
+	texopacity_cutout,		//アルファが0か255だけ
+	texopacity_opaque,		//全部255。ブレンドしなくていい
+};
+
+//R,Bを入れ替えた画像。GLを使わないのでどのスレッドで作ってもいい
+typedef struct
+{
+	unsigned char* image;
+	unsigned int width;
+	unsigned int height;
+	unsigned int format;
+	bool IsScratch;//スクラッチに置いた。UploadTextureで消さない
+	unsigned char opacity[TEXTURE_OPACITYGRID * TEXTURE_OPACITYGRID];//分けた所ごとのTEXOPACITY。読んだスレッドで調べる
+}TEXTUREIMAGE;
+
+//Ownerはメモリの台帳に載せる持ち主。LoadTextureなら呼んだファイルになる
+unsigned int LoadTextureFrom(const char *FileName, const char* Owner);
+#define LoadTexture(FileName) LoadTextureFrom(FileName, __FILE__)
+//numこのファイルをワーカーで並列に読んでから、このスレッドでテクスチャにする
+void LoadTexturesFrom(const char* const* FileName, unsigned int* Texture, int num, const char* Owner);
+#define LoadTextures(FileName, Texture, num) LoadTexturesFrom(FileName, Texture, num, __FILE__)
+//IsScratchならこのスレッドのスクラッチに置く。次のフレームまで残すならfalse
+bool DecodeTexture(const char *FileName, TEXTUREIMAGE* Image, bool IsScratch);
+//GLのテクスチャを作ってImageを消す。GLのスレッドから呼ぶ。台帳にはNameで載せる
+unsigned int UploadTexture(TEXTUREIMAGE* Image, const char* Name, const char* Owner);
 void UnloadTexture(unsigned int Texture);
+
+//次のシーンのテクスチャをワーカーで読み始める。FileNameにない先読みは捨てる。
+//先読みしたものはLoadTexture、LoadTexturesで同じ名前を読んだ時にそのまま渡す。
+void PreloadTextures(const char* const* FileName, int num);
+//読み終わった先読みをnum個までテクスチャにする。毎フレーム呼ぶ。まだテクスチャになっていない数を返す
+int UpdateTexturePreload(int num);
+void DiscardTexturePreload(void);
+//今までにLoadTextureで読んだ数と、そのうち先読みしてあった数
+void GetTextureLoadCount(int* loadNum, int* preloadNum);
+//0ならテクスチャなし。テクスチャを使うかはFaceGenが描く時にシェーダーの組み合わせで選ぶ
 void SetTexture(unsigned int Texture);
+//UVの範囲(0～1)の透明度。範囲にかかる所を全部見る。覚えていないテクスチャは半透明
+TEXOPACITY GetTextureOpacity(unsigned int Texture, float u0, float v0, float u1, float v1);
+//ファイルから読んでいないテクスチャ(フレームバッファを写したものなど)の透明度を決める
+void SetTextureOpacity(unsigned int Texture, TEXOPACITY opacity);
 
 